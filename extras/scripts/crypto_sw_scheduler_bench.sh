@@ -0,0 +1,121 @@
+#!/usr/bin/env bash
+#
+# Async crypto throughput of the sw scheduler with skewed load: all the
+# packets are received on worker 0, by the packet generator, and sent
+# to an IPsec protected tunnel, so worker 0 enqueues all the crypto
+# frames and the other workers only get work by taking it. Compares
+# whole frames (chunk-size 64) with smaller chunks, and reports the
+# share of the elts the other workers took and what each processed.
+#
+# usage: crypto_sw_scheduler_bench.sh [-b <vpp build dir>] [-t <seconds>]
+#                                     [-c <first cpu>] [-s <packet size>]
+#                                     [workers ...]
+#
+# e.g. crypto_sw_scheduler_bench.sh -b build-root/install-vpp-native/vpp 2 4 8
+
+build=build-root/install-vpp-native/vpp
+seconds=5
+first_cpu=1
+size=1400
+
+while getopts "b:t:c:s:" opt; do
+  case $opt in
+    b) build=$OPTARG ;;
+    t) seconds=$OPTARG ;;
+    c) first_cpu=$OPTARG ;;
+    s) size=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+workers_list=${@:-2 4 8}
+chunk_sizes="64 16"
+dir=$(mktemp -d /tmp/crypto_sw_scheduler_bench.XXXXXX)
+sock=$dir/cli.sock
+key=4a506a794f574265564551694d653768
+
+vppctl() {
+  $build/bin/vppctl -s $sock "$@"
+}
+
+run() {
+  local workers=$1 chunk_size=$2 i
+
+  cat > $dir/startup.conf <<EOC
+unix { nodaemon cli-listen $sock }
+cpu { main-core $((first_cpu - 1)) corelist-workers $first_cpu-$((first_cpu + workers - 1)) }
+buffers { buffers-per-numa 65536 }
+plugins {
+  plugin default { disable }
+  plugin crypto_sw_scheduler_plugin.so { enable }
+  plugin crypto_native_plugin.so { enable }
+  plugin crypto_ipsecmb_plugin.so { enable }
+  plugin crypto_openssl_plugin.so { enable }
+}
+EOC
+
+  $build/bin/vpp -c $dir/startup.conf > $dir/vpp.log 2>&1 &
+  local pid=$!
+
+  for i in $(seq 50); do
+    [ -S $sock ] && vppctl show version > /dev/null 2>&1 && break
+    sleep 0.2
+  done
+
+  vppctl create packet-generator interface pg0 > /dev/null
+  vppctl create packet-generator interface pg1 > /dev/null
+  vppctl set interface ip address pg0 10.0.0.1/24
+  vppctl set interface ip address pg1 10.0.1.1/24
+  vppctl set interface state pg0 up
+  vppctl set interface state pg1 up
+  vppctl set ip neighbor pg1 10.0.1.2 02:00:00:00:00:02
+  vppctl create ipip tunnel src 10.0.1.1 dst 10.0.1.2 > /dev/null
+  vppctl ipsec sa add 10 spi 1000 esp crypto-alg aes-gcm-128 crypto-key $key
+  vppctl ipsec sa add 20 spi 2000 esp crypto-alg aes-gcm-128 crypto-key $key
+  vppctl ipsec tunnel protect ipip0 sa-in 20 sa-out 10
+  vppctl set interface unnumbered ipip0 use pg1
+  vppctl set interface state ipip0 up
+  vppctl ip route add 198.18.0.0/15 via ipip0
+  vppctl set ipsec async mode on
+  vppctl set sw_scheduler chunk-size $chunk_size
+
+  vppctl packet-generator new "{ name s0 limit 0 size $size-$size worker 0" \
+    "interface pg0 node ethernet-input data {" \
+    "IP4: 1.2.3 -> 4.5.6" \
+    "UDP: 10.0.0.2 -> 198.18.0.1" \
+    "UDP: 1234 -> 2345 incrementing 22 } }"
+
+  vppctl packet-generator enable
+  sleep 1
+  vppctl clear sw_scheduler counters
+  vppctl clear interfaces
+  sleep $seconds
+  vppctl packet-generator disable
+  sleep 0.5
+
+  vppctl show sw_scheduler workers > $dir/workers
+  vppctl show interface ipip0 > $dir/ipip0
+  kill $pid
+  wait $pid 2> /dev/null
+
+  awk -v workers=$workers -v chunk_size=$chunk_size -v t=$seconds '
+    /tx packets/ { tx = $NF; next }
+    /^[0-9]+ / && NF == 9 {
+      elts += $4
+      if ($1 != 0) taken += $4
+      w = w sprintf (" %u", $4)
+    }
+    END {
+      printf "%3u workers  chunk %2u  %8.2f Mpps  %5.1f%% taken  elts:%s\n",
+	workers, chunk_size, tx / t / 1e6, elts ? 100.0 * taken / elts : 0, w
+    }' $dir/ipip0 $dir/workers
+}
+
+for workers in $workers_list; do
+  for chunk_size in $chunk_sizes; do
+    run $workers $chunk_size
+  done
+done
+
+rm -rf $dir
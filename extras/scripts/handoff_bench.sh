@@ -0,0 +1,95 @@
+#!/usr/bin/env bash
+#
+# Worker handoff throughput, with the packet generator: each worker
+# generates UDP packets on pg0, which hands them over to all workers by
+# flow hash, as NAT or IPsec handoff would after RSS. The receivers drop
+# them after ip4-lookup. Runs each worker count with every handoff mode
+# of "set frame-queue" and reports what went through the queue.
+#
+# usage: handoff_bench.sh [-b <vpp build dir>] [-t <seconds>] [-c <first cpu>]
+#                         [workers ...]
+#
+# e.g. handoff_bench.sh -b build-root/install-vpp-native/vpp 2 4 8 16
+
+build=build-root/install-vpp-native/vpp
+seconds=5
+first_cpu=1
+
+while getopts "b:t:c:" opt; do
+  case $opt in
+    b) build=$OPTARG ;;
+    t) seconds=$OPTARG ;;
+    c) first_cpu=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+workers_list=${@:-2 4 8 16}
+modes=("drop" "coalesce 20" "coalesce 20 push-back")
+dir=$(mktemp -d /tmp/handoff_bench.XXXXXX)
+sock=$dir/cli.sock
+
+vppctl() {
+  $build/bin/vppctl -s $sock "$@"
+}
+
+run() {
+  local workers=$1 mode=$2 w
+
+  cat > $dir/startup.conf <<EOF
+unix { nodaemon cli-listen $sock }
+cpu { main-core $((first_cpu - 1)) corelist-workers $first_cpu-$((first_cpu + workers - 1)) }
+buffers { buffers-per-numa 65536 }
+plugins { plugin default { disable } }
+EOF
+
+  $build/bin/vpp -c $dir/startup.conf > $dir/vpp.log 2>&1 &
+  local pid=$!
+
+  for w in $(seq 50); do
+    [ -S $sock ] && vppctl show version > /dev/null 2>&1 && break
+    sleep 0.2
+  done
+
+  vppctl create packet-generator interface pg0 > /dev/null
+  vppctl set interface state pg0 up
+  vppctl set interface ip address pg0 10.0.0.1/24
+  vppctl ip route add 198.18.0.0/15 via drop
+  vppctl set interface handoff pg0 workers 0-$((workers - 1))
+  vppctl set frame-queue node ethernet-input $mode
+
+  for w in $(seq 0 $((workers - 1))); do
+    vppctl packet-generator new "{ name s$w limit 0 size 64-64 worker $w" \
+      "node ethernet-input interface pg0 data {" \
+      "IP4: 1.2.3 -> 4.5.6" \
+      "UDP: 1.$w.0.1 - 1.$w.255.254 -> 198.18.0.1" \
+      "UDP: 1234 -> 2345 incrementing 22 } }"
+  done
+
+  vppctl packet-generator enable
+  sleep $seconds
+  vppctl packet-generator disable
+  sleep 0.5
+
+  vppctl show frame-queue occupancy > $dir/occupancy
+  kill $pid
+  wait $pid 2> /dev/null
+
+  awk -v workers=$workers -v mode="$mode" -v t=$seconds '
+    /sender/ { senders = 1; next }
+    /queued/ { senders = 0 }
+    senders { buffers += $3; elts += $2; dropped += $6 }
+    END {
+      printf "%3u workers  %-24s %8.2f Mpps  %6.1f per elt  %u dropped\n",
+	workers, mode, buffers / t / 1e6, elts ? buffers / elts : 0, dropped
+    }' $dir/occupancy
+}
+
+for workers in $workers_list; do
+  for mode in "${modes[@]}"; do
+    run $workers "$mode"
+  done
+done
+
+rm -rf $dir
@@ -0,0 +1,142 @@
+#!/usr/bin/env bash
+#
+# TLS connections per second with and without private key offload. Runs
+# the hs_apps http tps server over tls on an af_packet interface backed by
+# a veth pair and opens short lived https connections to it from the host,
+# once with handshakes done inline and once with private key operations on
+# dedicated crypto threads (tls openssl set pkey-offload threads <n>).
+# Needs root, python3 on the host.
+#
+# usage: tls_pkey_offload_cps.sh [-b <vpp build dir>] [-t <crypto threads>]
+#                                [-c <client procs>] [-v tls12|tls13]
+#                                [seconds]
+#
+# e.g. tls_pkey_offload_cps.sh -b build-root/install-vpp-native/vpp -t 2 10
+
+build=build-root/install-vpp-native/vpp
+threads=1
+procs=4
+version=tls13
+
+while getopts "b:t:c:v:" opt; do
+  case $opt in
+    b) build=$OPTARG ;;
+    t) threads=$OPTARG ;;
+    c) procs=$OPTARG ;;
+    v) version=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+secs=${1:-10}
+dir=$(mktemp -d /tmp/tls_pkey_offload.XXXXXX)
+sock=$dir/cli.sock
+
+vppctl() {
+  $build/bin/vppctl -s $sock "$@"
+}
+
+# each client proc opens a connection, fetches a small file and closes
+cat > $dir/cps.py <<'EOF_PY'
+import multiprocessing, socket, ssl, sys, time
+
+addr, secs, procs, version = sys.argv[1], float(sys.argv[2]), \
+    int(sys.argv[3]), sys.argv[4]
+
+
+def client(q):
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+    v = ssl.TLSVersion.TLSv1_3 if version == "tls13" else \
+        ssl.TLSVersion.TLSv1_2
+    ctx.minimum_version = ctx.maximum_version = v
+    n = errors = 0
+    end = time.time() + secs
+    while time.time() < end:
+        try:
+            with ctx.wrap_socket(socket.create_connection((addr, 443),
+                                                          timeout=5)) as s:
+                s.sendall(b"GET /test_file_64 HTTP/1.1\r\n\r\n")
+                rsp = b""
+                while b"\r\n\r\n" not in rsp or len(rsp) < 64:
+                    data = s.recv(4096)
+                    if not data:
+                        break
+                    rsp += data
+                n += 1
+        except OSError:
+            errors += 1
+    q.put((n, errors))
+
+
+q = multiprocessing.Queue()
+ps = [multiprocessing.Process(target=client, args=(q,))
+      for _ in range(procs)]
+for p in ps:
+    p.start()
+for p in ps:
+    p.join()
+res = [q.get() for _ in ps]
+n = sum(r[0] for r in res)
+print("%d connections, %d errors, %.1f connections/s" %
+      (n, sum(r[1] for r in res), n / secs))
+EOF_PY
+
+ip link add vpp_cps type veth peer name vpp_cps_host
+ip link set vpp_cps up
+ip link set vpp_cps_host up
+ip addr add 10.10.1.2/24 dev vpp_cps_host
+
+run() {
+  local offload=$1
+
+  cat > $dir/startup.conf <<EOF_CONF
+unix { nodaemon cli-listen $sock }
+session { enable }
+plugins {
+  plugin default { disable }
+  plugin hs_apps_plugin.so { enable }
+  plugin http_plugin.so { enable }
+  plugin tlsopenssl_plugin.so { enable }
+}
+EOF_CONF
+
+  for try in $(seq 5); do
+    rm -f $sock
+    $build/bin/vpp -c $dir/startup.conf > $dir/vpp.log 2>&1 &
+    pid=$!
+    for i in $(seq 50); do
+      [ -S $sock ] && vppctl show version > /dev/null 2>&1 && break
+      sleep 0.2
+    done
+    kill -0 $pid 2> /dev/null && break
+  done
+
+  vppctl create host-interface name vpp_cps > /dev/null
+  vppctl set interface ip address host-vpp_cps 10.10.1.1/24
+  vppctl set interface state host-vpp_cps up
+  # af_packet mac changes across runs
+  ip neigh flush dev vpp_cps_host
+
+  [ -n "$offload" ] && vppctl tls openssl set pkey-offload threads $threads \
+    > /dev/null
+  vppctl http tps uri tls://10.10.1.1/443
+
+  # warm up arp and caches
+  python3 $dir/cps.py 10.10.1.1 1 $procs $version > /dev/null
+
+  printf "%-16s " "${offload:-inline}"
+  python3 $dir/cps.py 10.10.1.1 $secs $procs $version
+
+  kill $pid
+  wait $pid 2> /dev/null
+}
+
+echo "$version, $procs client procs, $threads crypto threads"
+run ""
+run "pkey-offload"
+
+ip link del vpp_cps
+rm -rf $dir
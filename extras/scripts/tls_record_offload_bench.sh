@@ -0,0 +1,93 @@
+#!/usr/bin/env bash
+#
+# TLS bulk throughput with and without record offload. Runs the hs_apps
+# echo server and client over tls between two loopbacks in different fib
+# tables, once with records handled by the openssl engine and once with
+# the tls record layer (tls { record-offload }), and prints the client's
+# throughput for each run. Received data is checked with test-bytes.
+#
+# usage: tls_record_offload_bench.sh [-b <vpp build dir>] [mbytes]
+#
+# e.g. tls_record_offload_bench.sh -b build-root/install-vpp-native/vpp 2000
+
+build=build-root/install-vpp-native/vpp
+
+while getopts "b:" opt; do
+  case $opt in
+    b) build=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+mbytes=${1:-1000}
+dir=$(mktemp -d /tmp/tls_record_offload.XXXXXX)
+sock=$dir/cli.sock
+
+vppctl() {
+  $build/bin/vppctl -s $sock "$@"
+}
+
+run() {
+  local tls_cfg=$1
+
+  cat > $dir/startup.conf <<EOF
+unix { nodaemon cli-listen $sock }
+buffers { buffers-per-numa 65536 }
+session { enable }
+tls { use-test-cert-in-ca $tls_cfg }
+plugins {
+  plugin default { disable }
+  plugin hs_apps_plugin.so { enable }
+  plugin tlsopenssl_plugin.so { enable }
+  plugin crypto_native_plugin.so { enable }
+  plugin crypto_openssl_plugin.so { enable }
+}
+EOF
+
+  for try in $(seq 5); do
+    rm -f $sock
+    $build/bin/vpp -c $dir/startup.conf > $dir/vpp.log 2>&1 &
+    pid=$!
+    for i in $(seq 50); do
+      [ -S $sock ] && vppctl show version > /dev/null 2>&1 && break
+      sleep 0.2
+    done
+    kill -0 $pid 2> /dev/null && break
+  done
+
+  vppctl ip table add 1
+  vppctl create loopback interface > /dev/null
+  vppctl create loopback interface > /dev/null
+  vppctl set interface ip table loop1 1
+  vppctl set interface state loop0 up
+  vppctl set interface state loop1 up
+  vppctl set interface ip address loop0 172.16.1.1/24
+  vppctl set interface ip address loop1 172.16.2.1/24
+  # loop each table's traffic back through the other loopback
+  mac0=$(vppctl show hardware loop0 | grep -o "Ethernet address [^ ]*" | cut -d' ' -f3)
+  mac1=$(vppctl show hardware loop1 | grep -o "Ethernet address [^ ]*" | cut -d' ' -f3)
+  vppctl set ip neighbor loop1 172.16.2.2 $mac1 static
+  vppctl set ip neighbor loop0 172.16.1.2 $mac0 static
+  vppctl ip route add 172.16.2.1/32 via 172.16.2.2 loop1
+  vppctl ip route add 172.16.1.1/32 table 1 via 172.16.1.2 loop0
+  vppctl app ns add id 0 secret 0 sw_if_index 1
+  vppctl app ns add id 1 secret 0 sw_if_index 2
+
+  vppctl test echo server appns 0 fifo-size 4096 \
+    uri tls://172.16.1.1/1234
+  vppctl test echo client mbytes $mbytes appns 1 fifo-size 4096 \
+    test-bytes test-timeout 600 uri tls://172.16.1.1/1234 > $dir/out 2>&1
+
+  printf "%-16s " "${tls_cfg:-openssl}"
+  grep -E "gbit|failed" $dir/out
+
+  kill $pid
+  wait $pid 2> /dev/null
+}
+
+echo "$mbytes MB"
+run ""
+run "record-offload"
+
+rm -rf $dir
@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+#
+# WireGuard control plane at scale: adds N peers with random public keys
+# to one interface and removes them again, timing each step. Each add
+# looks the key up among the existing peers and sends a first handshake
+# initiation. Every peer gets its own /32 allowed-ip and an endpoint
+# routed to drop, so the handshake timers of all peers keep running on
+# the timer wheel without any traffic leaving vpp.
+#
+# usage: wireguard_scale.sh [-b <vpp build dir>] [peers]
+#
+# e.g. wireguard_scale.sh -b build-root/install-vpp-native/vpp 50000
+
+build=build-root/install-vpp-native/vpp
+
+while getopts "b:" opt; do
+  case $opt in
+    b) build=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+peers=${1:-50000}
+dir=$(mktemp -d /tmp/wireguard_scale.XXXXXX)
+sock=$dir/cli.sock
+
+vppctl() {
+  $build/bin/vppctl -s $sock "$@"
+}
+
+timed() {
+  local what=$1 start end
+  shift
+  start=$(date +%s.%N)
+  "$@" > $dir/out 2>&1
+  end=$(date +%s.%N)
+  awk -v what="$what" -v s=$start -v e=$end -v n=$peers '
+    END { printf "%-12s %8.2f s  %10.0f peers/s\n", what, e - s, n / (e - s) }
+  ' /dev/null
+}
+
+cat > $dir/startup.conf <<EOF
+unix { nodaemon cli-listen $sock }
+buffers { buffers-per-numa 65536 }
+plugins {
+  plugin default { disable }
+  plugin wireguard_plugin.so { enable }
+  plugin crypto_native_plugin.so { enable }
+  plugin crypto_openssl_plugin.so { enable }
+}
+EOF
+
+$build/bin/vpp -c $dir/startup.conf > $dir/vpp.log 2>&1 &
+pid=$!
+
+for i in $(seq 50); do
+  [ -S $sock ] && vppctl show version > /dev/null 2>&1 && break
+  sleep 0.2
+done
+
+vppctl create loopback interface > /dev/null
+vppctl set interface state loop0 up
+vppctl set interface ip address loop0 192.0.2.1/24
+vppctl ip route add 198.18.0.0/15 via drop
+vppctl wireguard create listen-port 51820 generate-key src 192.0.2.1 > /dev/null
+vppctl set interface state wg0 up
+vppctl set interface ip address wg0 100.64.0.1/10
+
+python3 - $peers $dir <<'EOF'
+import base64, os, sys
+
+n, dir = int(sys.argv[1]), sys.argv[2]
+with open(dir + "/add", "w") as add, open(dir + "/del", "w") as rm:
+    for i in range(n):
+        key = base64.b64encode(os.urandom(32)).decode()
+        add.write(
+            "wireguard peer add wg0 public-key %s endpoint 198.18.%u.%u "
+            "allowed-ip 10.%u.%u.%u/32 dst-port 51820\n"
+            % (key, i >> 8 & 0xFF, i & 0xFF,
+               i >> 16 & 0xFF, i >> 8 & 0xFF, i & 0xFF))
+        rm.write("wireguard peer remove %u\n" % i)
+EOF
+
+timed "add" vppctl exec $dir/add
+sleep 5
+vppctl show runtime wg-timer-manager | grep wg-timer
+timed "remove" vppctl exec $dir/del
+
+kill $pid
+wait $pid 2> /dev/null
+rm -rf $dir
@@ -2577,6 +2577,13 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val != 0);
       goto done;
     }
+  if (unformat (input, "use-batched-hash-acl-matching %u", &val))
+    {
+      am->use_batched_hash_acl_matching = (val != 0);
+      if (unformat (input, "min-entries %u", &val))
+	am->batched_hash_acl_matching_min_entries = val;
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -2989,6 +2996,25 @@ acl_set_aclplugin_acl_fn (vlib_main_t * vm,
   return (NULL);
 }
 
+static clib_error_t *
+acl_delete_aclplugin_acl_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  u32 acl_index = ~0;
+  int rv;
+
+  if (!unformat (input, "index %u", &acl_index))
+    return clib_error_return (0, "expecting ACL index, got `%U`",
+			      format_unformat_error, input);
+
+  rv = acl_del_list (acl_index);
+  if (rv)
+    return clib_error_return (0, "failed: %U", format_vnet_api_errno, rv);
+
+  return (NULL);
+}
+
 static clib_error_t *
 acl_show_aclplugin_macip_acl_fn (vlib_main_t * vm,
 				 unformat_input_t *
@@ -3473,6 +3499,11 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
 		   acl_main.interface_acl_counters_enabled);
   vlib_cli_output (vm, "Use hash-based lookup for ACLs: %d",
 		   acl_main.use_hash_acl_matching);
+  vlib_cli_output (vm,
+		   "Use batched hash-based lookup for ACLs: %d "
+		   "(from %u applied entries)",
+		   acl_main.use_batched_hash_acl_matching,
+		   acl_main.batched_hash_acl_matching_min_entries);
   if (show_mask_type)
     acl_plugin_show_tables_mask_type ();
   if (show_acl_hash_info)
@@ -3604,6 +3635,18 @@ VLIB_CLI_COMMAND (aclplugin_set_acl_command, static) = {
     .short_help = "set acl-plugin acl <permit|deny> src <PREFIX> dst <PREFIX> proto X sport X-Y dport X-Y [tag FOO] {use comma separated list for multiple rules}",
     .function = acl_set_aclplugin_acl_fn,
 };
+
+/*?
+ * Delete an ACL which isn't applied to any interface or used by any
+ * lookup context.
+ *
+ * @cliexcmd{delete acl-plugin acl index <n>}
+ ?*/
+VLIB_CLI_COMMAND (aclplugin_delete_acl_command, static) = {
+    .path = "delete acl-plugin acl",
+    .short_help = "delete acl-plugin acl index <n>",
+    .function = acl_delete_aclplugin_acl_fn,
+};
 /* *INDENT-ON* */
 
 static clib_error_t *
@@ -3760,6 +3803,10 @@ acl_init (vlib_main_t * vm)
 
   /* use the new fancy hash-based matching */
   am->use_hash_acl_matching = 1;
+  /* probe each mask type for the whole frame, once the hash is big */
+  am->use_batched_hash_acl_matching = 1;
+  am->batched_hash_acl_matching_min_entries =
+    ACL_PLUGIN_BATCHED_HASH_MIN_ENTRIES;
   /* use tuplemerge by default */
   am->use_tuple_merge = 1;
   /* Set the default threshold */
@@ -45,6 +45,7 @@
 
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_BUCKETS 65536
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_MEMORY (2 << 25)
+#define ACL_PLUGIN_BATCHED_HASH_MIN_ENTRIES 16384
 
 extern vlib_node_registration_t acl_in_node;
 extern vlib_node_registration_t acl_out_node;
@@ -176,6 +177,11 @@ typedef struct {
   /* Do we use hash-based ACL matching or linear */
   int use_hash_acl_matching;
 
+  /* Do we look up the hash ACLs a frame at a time or packet by packet */
+  int use_batched_hash_acl_matching;
+  /* ... and from how many applied hash entries in the lookup context */
+  u32 batched_hash_acl_matching_min_entries;
+
   /* Do we use the TupleMerge for hash ACLs or not */
   int use_tuple_merge;
 
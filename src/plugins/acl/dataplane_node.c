@@ -318,6 +318,68 @@ acl_fa_node_common_prepare_fn (vlib_main_t * vm,
     }
 }
 
+/*
+ * Look up the hash ACLs of all the packets of the frame which are not
+ * part of an established session, a lookup context at a time. The
+ * results are used by the inner loop, which still looks up packet by
+ * packet the ones left with ~0. So are those of the lookup contexts with
+ * fewer applied entries than the batching threshold: while the hash fits
+ * in the cache the out of order per packet lookup is faster.
+ */
+always_inline void
+acl_fa_node_batch_acl_match (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			     u32 n_packets, int is_ip6, int is_input,
+			     int with_stateful_datapath)
+{
+  u32 other[VLIB_FRAME_SIZE];
+  u32 *todo = pw->acl_lookup_indices;
+  u32 i, lc_index, n_left = 0, n_same, n_other;
+  u64 sess_id;
+
+  for (i = 0; i < n_packets; i++)
+    {
+      pw->acl_match_indices[i] = ~0;
+
+      lc_index = is_input ?
+	am->input_lc_index_by_sw_if_index[pw->sw_if_indices[i]] :
+	am->output_lc_index_by_sw_if_index[pw->sw_if_indices[i]];
+      if (lc_index >= vec_len (am->hash_entry_vec_by_lc_index) ||
+	  vec_len (am->hash_entry_vec_by_lc_index[lc_index]) <
+	  am->batched_hash_acl_matching_min_entries)
+	continue;
+
+      /* tuplemerge leaves those to the linear lookup */
+      if (PREDICT_FALSE (pw->fa_5tuples[i].pkt.is_nonfirst_fragment))
+	continue;
+      if (with_stateful_datapath
+	  && acl_fa_find_session_with_hash (am, is_ip6,
+					    pw->sw_if_indices[i],
+					    pw->hashes[i], &pw->fa_5tuples[i],
+					    &sess_id))
+	continue;
+
+      pw->lc_indices[i] = lc_index;
+      todo[n_left++] = i;
+    }
+
+  while (n_left)
+    {
+      lc_index = pw->lc_indices[todo[0]];
+      n_same = n_other = 0;
+      for (i = 0; i < n_left; i++)
+	if (pw->lc_indices[todo[i]] == lc_index)
+	  todo[n_same++] = todo[i];
+	else
+	  other[n_other++] = todo[i];
+
+      multi_acl_match_get_applied_ace_index_xN (am, is_ip6, lc_index,
+						pw->fa_5tuples, todo, n_same,
+						pw->acl_match_indices);
+
+      clib_memcpy_fast (todo, other, n_other * sizeof (other[0]));
+      n_left = n_other;
+    }
+}
 
 always_inline uword
 acl_fa_inner_node_fn (vlib_main_t * vm,
@@ -337,12 +399,15 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
   u64 now = clib_cpu_time_now ();
   uword thread_index = os_get_thread_index ();
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  int do_batched_acl_match = am->use_hash_acl_matching &&
+    am->use_batched_hash_acl_matching;
 
   u16 *next;
   vlib_buffer_t **b;
   u32 *sw_if_index;
   fa_5tuple_t *fa_5tuple;
   u64 *hash;
+  u32 *acl_match_index;
   /* for the delayed counters */
   u32 saved_matched_acl_index = 0;
   u32 saved_matched_ace_index = 0;
@@ -358,6 +423,11 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
   sw_if_index = pw->sw_if_indices;
   fa_5tuple = pw->fa_5tuples;
   hash = pw->hashes;
+  acl_match_index = pw->acl_match_indices;
+
+  if (do_batched_acl_match)
+    acl_fa_node_batch_acl_match (am, pw, frame->n_vectors, is_ip6, is_input,
+				 with_stateful_datapath);
 
   /*
    * Now the "hard" work of session lookups and ACL lookups for new sessions.
@@ -472,13 +542,22 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 		  am->output_lc_index_by_sw_if_index[sw_if_index[0]];
 
 	      action = 0;	/* deny by default */
-	      int is_match = acl_plugin_match_5tuple_inline (am, lc_index0,
-							     (fa_5tuple_opaque_t *) & fa_5tuple[0], is_ip6,
-							     &action,
-							     &match_acl_pos,
-							     &match_acl_in_index,
-							     &match_rule_index,
-							     &trace_bitmap);
+	      int is_match;
+	      if (do_batched_acl_match && acl_match_index[0] != ~0)
+		is_match = hash_multi_acl_match_result (am, lc_index0,
+							acl_match_index[0],
+							&action,
+							&match_acl_pos,
+							&match_acl_in_index,
+							&match_rule_index);
+	      else
+		is_match = acl_plugin_match_5tuple_inline (am, lc_index0,
+							   (fa_5tuple_opaque_t *) & fa_5tuple[0], is_ip6,
+							   &action,
+							   &match_acl_pos,
+							   &match_acl_in_index,
+							   &match_rule_index,
+							   &trace_bitmap);
 	      if (PREDICT_FALSE
 		  (is_match && am->interface_acl_counters_enabled))
 		{
@@ -574,6 +653,7 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 	  fa_5tuple++;
 	  sw_if_index++;
 	  hash++;
+	  acl_match_index++;
 	  n_left -= 1;
 	}
     }
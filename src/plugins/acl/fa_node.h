@@ -231,6 +231,10 @@ typedef struct {
   fa_5tuple_t fa_5tuples[VLIB_FRAME_SIZE];
   u64 hashes[VLIB_FRAME_SIZE];
   u16 nexts[VLIB_FRAME_SIZE];
+  /* batched hash ACL lookup, ~0 for the packets left to the inner loop */
+  u32 lc_indices[VLIB_FRAME_SIZE];
+  u32 acl_match_indices[VLIB_FRAME_SIZE];
+  u32 acl_lookup_indices[VLIB_FRAME_SIZE];
 
 } acl_fa_per_worker_data_t;
 
@@ -627,14 +627,139 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
   return curr_match_index;
 }
 
+/* tuples probed together, one mask type at a time */
+#define ACL_HASH_LOOKUP_BATCH_SIZE 64
+
+always_inline void
+acl_mask_5tuple (fa_5tuple_t * match, ace_mask_type_entry_t * mte,
+                 u32 mask_type_index, clib_bihash_kv_48_8_t * kv)
+{
+  fa_5tuple_t *kv_key = (fa_5tuple_t *) kv->key;
+  u8 *pmatch = (u8 *) match;
+  u8 *pmask = (u8 *) & mte->mask;
+  u8 *pkey = (u8 *) kv->key;
+
+#if defined(CLIB_HAVE_VEC256)
+  u64x4_store_unaligned (u64x4_load_unaligned (pmatch) &
+                         u64x4_load_unaligned (pmask), pkey);
+  u64x2_store_unaligned (u64x2_load_unaligned (pmatch + 32) &
+                         u64x2_load_unaligned (pmask + 32), pkey + 32);
+#elif defined(CLIB_HAVE_VEC128)
+  u64x2_store_unaligned (u64x2_load_unaligned (pmatch) &
+                         u64x2_load_unaligned (pmask), pkey);
+  u64x2_store_unaligned (u64x2_load_unaligned (pmatch + 16) &
+                         u64x2_load_unaligned (pmask + 16), pkey + 16);
+  u64x2_store_unaligned (u64x2_load_unaligned (pmatch + 32) &
+                         u64x2_load_unaligned (pmask + 32), pkey + 32);
+#else
+  int i;
+  for (i = 0; i < 6; i++)
+    kv->key[i] = ((u64 *) pmatch)[i] & ((u64 *) pmask)[i];
+#endif
+
+  fa_packet_info_t tmp_pkt = kv_key->pkt;
+  tmp_pkt.mask_type_index_lsb = mask_type_index;
+  kv_key->pkt.as_u64 = tmp_pkt.as_u64;
+}
+
+/*
+ * Same result as multi_acl_match_get_applied_ace_index() for each of
+ * the 5-tuples match[indices[0..n-1]], which all belong to lc_index,
+ * written to match_index[indices[...]]. Each mask type is applied to
+ * all the tuples still in the race before moving to the next one, so
+ * their hash probes are prefetched and overlap rather than run one
+ * after the other.
+ */
+always_inline void
+multi_acl_match_get_applied_ace_index_xN (acl_main_t * am, int is_ip6,
+                                          u32 lc_index, fa_5tuple_t * match,
+                                          u32 * indices, u32 n,
+                                          u32 * match_index)
+{
+  clib_bihash_kv_48_8_t kv[ACL_HASH_LOOKUP_BATCH_SIZE];
+  u64 hashes[ACL_HASH_LOOKUP_BATCH_SIZE];
+  int rv[ACL_HASH_LOOKUP_BATCH_SIZE];
+  u32 active[ACL_HASH_LOOKUP_BATCH_SIZE];
+  u32 n_active, n_left, a, k, order_index;
+
+  applied_hash_ace_entry_t **applied_hash_aces =
+    vec_elt_at_index (am->hash_entry_vec_by_lc_index, lc_index);
+  hash_applied_mask_info_t **hash_applied_mask_info_vec =
+    vec_elt_at_index (am->hash_applied_mask_info_vec_by_lc_index, lc_index);
+  hash_applied_mask_info_t *minfo;
+  ace_mask_type_entry_t *mte;
+
+  while (n > 0)
+    {
+      n_active = clib_min (n, ACL_HASH_LOOKUP_BATCH_SIZE);
+      for (a = 0; a < n_active; a++)
+        {
+          active[a] = indices[a];
+          match[active[a]].pkt.lc_index = lc_index;
+          match_index[active[a]] = (~0 - 1);
+        }
+      indices += n_active;
+      n -= n_active;
+
+      for (order_index = 0;
+           order_index < vec_len ((*hash_applied_mask_info_vec));
+           order_index++)
+        {
+          minfo = vec_elt_at_index ((*hash_applied_mask_info_vec), order_index);
+
+          /* drop the tuples which matched ahead of this partition */
+          n_left = n_active;
+          n_active = 0;
+          for (a = 0; a < n_left; a++)
+            if (minfo->first_rule_index <= match_index[active[a]])
+              active[n_active++] = active[a];
+          if (n_active == 0)
+            break;
+
+          mte = vec_elt_at_index (am->ace_mask_type_pool,
+                                  minfo->mask_type_index);
+          for (a = 0; a < n_active; a++)
+            {
+              acl_mask_5tuple (&match[active[a]], mte, minfo->mask_type_index,
+                               &kv[a]);
+              hashes[a] = clib_bihash_hash_48_8 (&kv[a]);
+            }
+
+          clib_bihash_search_batch_with_hash_48_8 (&am->acl_lookup_hash,
+                                                   hashes, kv, rv, n_active);
+
+          for (a = 0; a < n_active; a++)
+            {
+              if (rv[a])
+                continue;
+
+              /* There is a hit in the hash, so check the collision vector */
+              hash_acl_lookup_value_t *result_val =
+                (hash_acl_lookup_value_t *) & kv[a].value;
+              u32 *curr_match_index = &match_index[active[a]];
+              applied_hash_ace_entry_t *pae =
+                vec_elt_at_index ((*applied_hash_aces),
+                                  result_val->applied_entry_index);
+              collision_match_rule_t *crs = pae->colliding_rules;
+              for (k = 0; k < vec_len (crs); k++)
+                {
+                  if (crs[k].applied_entry_index >= *curr_match_index)
+                    continue;
+                  if (single_rule_match_5tuple (&crs[k].rule, is_ip6,
+                                                &match[active[a]]))
+                    *curr_match_index = crs[k].applied_entry_index;
+                }
+            }
+        }
+    }
+}
+
 always_inline int
-hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5tuple,
-                       int is_ip6, u8 *action, u32 *acl_pos_p, u32 * acl_match_p,
-                       u32 * rule_match_p, u32 * trace_bitmap)
+hash_multi_acl_match_result (acl_main_t * am, u32 lc_index, u32 match_index,
+                             u8 * action, u32 * acl_pos_p, u32 * acl_match_p,
+                             u32 * rule_match_p)
 {
-  acl_main_t *am = p_acl_main;
   applied_hash_ace_entry_t **applied_hash_aces = vec_elt_at_index(am->hash_entry_vec_by_lc_index, lc_index);
-  u32 match_index = multi_acl_match_get_applied_ace_index(am, is_ip6, pkt_5tuple);
   if (match_index < vec_len((*applied_hash_aces))) {
     applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), match_index);
     pae->hitcount++;
@@ -647,6 +772,17 @@ hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5
   return 0;
 }
 
+always_inline int
+hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5tuple,
+                       int is_ip6, u8 *action, u32 *acl_pos_p, u32 * acl_match_p,
+                       u32 * rule_match_p, u32 * trace_bitmap)
+{
+  acl_main_t *am = p_acl_main;
+  u32 match_index = multi_acl_match_get_applied_ace_index(am, is_ip6, pkt_5tuple);
+  return hash_multi_acl_match_result (am, lc_index, match_index, action,
+                                      acl_pos_p, acl_match_p, rule_match_p);
+}
+
 
 
 always_inline int
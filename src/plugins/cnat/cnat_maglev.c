@@ -19,7 +19,7 @@ cnat_maglev_perm_compare (void *_a, void *_b)
 static void
 cnat_maglev_shuffle (cnat_maglev_perm_t *permutation, u32 *buckets)
 {
-  u32 N, M, i, done = 0;
+  u32 N, M, i, c, done = 0;
   u32 *next = 0;
 
   N = vec_len (permutation);
@@ -29,22 +29,26 @@ cnat_maglev_shuffle (cnat_maglev_perm_t *permutation, u32 *buckets)
   M = vec_len (buckets);
   vec_set (buckets, -1);
 
+  /* next[i] is the next slot in the permutation of backend i, stepping
+   * it by skip (< M) avoids a modulo per probe */
   vec_validate (next, N - 1);
-  vec_zero (next);
+  for (i = 0; i < N; i++)
+    next[i] = permutation[i].offset;
 
   while (1)
     {
       for (i = 0; i < N; i++)
 	{
-	  u32 c = (permutation[i].offset + next[i] * permutation[i].skip) % M;
+	  c = next[i];
 	  while (buckets[c] != (u32) -1)
 	    {
-	      next[i]++;
-	      c = (permutation[i].offset + next[i] * permutation[i].skip) % M;
+	      c += permutation[i].skip;
+	      c = c >= M ? c - M : c;
 	    }
 
 	  buckets[c] = permutation[i].index;
-	  next[i]++;
+	  c += permutation[i].skip;
+	  next[i] = c >= M ? c - M : c;
 	  done++;
 
 	  if (done == M)
@@ -56,6 +60,36 @@ cnat_maglev_shuffle (cnat_maglev_perm_t *permutation, u32 *buckets)
     }
 }
 
+/**
+ * Install a new maglev table while workers may be using the current
+ * one: when the length is unchanged only the slots which differ are
+ * rewritten, else the new table is swapped in and the old one freed
+ * once no worker can be reading it.
+ */
+static void
+cnat_maglev_update (cnat_translation_t *ct, u32 *buckets)
+{
+  u32 *old = ct->lb_maglev;
+  u32 i;
+
+  ct->lb_maglev_n_changed = 0;
+  if (old && vec_len (old) == vec_len (buckets))
+    {
+      for (i = 0; i < vec_len (buckets); i++)
+	if (old[i] != buckets[i])
+	  {
+	    clib_atomic_store_relax_n (&old[i], buckets[i]);
+	    ct->lb_maglev_n_changed++;
+	  }
+      vec_free (buckets);
+      return;
+    }
+
+  ct->lb_maglev_n_changed = vec_len (buckets);
+  clib_atomic_store_rel_n (&ct->lb_maglev, buckets);
+  vlib_rcu_vec_free (old);
+}
+
 void
 cnat_translation_init_maglev (cnat_translation_t *ct)
 {
@@ -63,10 +97,14 @@ cnat_translation_init_maglev (cnat_translation_t *ct)
   cnat_main_t *cm = &cnat_main;
   cnat_ep_trk_t *trk;
   u32 backend_index = 0;
+  u32 *buckets = 0;
+  f64 start;
 
   if (vec_len (ct->ct_active_paths) == 0)
     return;
 
+  start = vlib_time_now (vlib_get_main ());
+
   vec_foreach (trk, ct->ct_active_paths)
     {
       cnat_maglev_perm_t permutation;
@@ -104,13 +142,19 @@ cnat_translation_init_maglev (cnat_translation_t *ct)
       vec_add1 (permutations, permutation);
     }
 
+  /* keep the current table if there is no backend to fill one with */
+  if (vec_len (permutations) == 0)
+    return;
+
   vec_sort_with_function (permutations, cnat_maglev_perm_compare);
 
-  vec_validate (ct->lb_maglev, cm->maglev_len - 1);
+  vec_validate (buckets, cm->maglev_len - 1);
 
-  cnat_maglev_shuffle (permutations, ct->lb_maglev);
+  cnat_maglev_shuffle (permutations, buckets);
+  cnat_maglev_update (ct, buckets);
 
   vec_free (permutations);
+  ct->lb_maglev_update_time = vlib_time_now (vlib_get_main ()) - start;
 }
 
 static int
@@ -165,6 +209,15 @@ cnat_maglev_print_changes (vlib_main_t *vm, u32 *changed_bk_indices,
 		     vec_len (new_maglev_lb) * 100.0);
 }
 
+static void
+cnat_maglev_print_updates (vlib_main_t *vm, u64 n_tests, u64 n_updated,
+			   f64 t_update)
+{
+  vlib_cli_output (vm,
+		   "Updates   : %U per pool, %llu slots rewritten per pool",
+		   format_duration, t_update / n_tests, n_updated / n_tests);
+}
+
 static u8 *
 format_cnat_maglev_buckets (u8 *s, va_list *args)
 {
@@ -192,6 +245,8 @@ cnat_translation_test_init_maglev (vlib_main_t *vm, unformat_input_t *input,
   cnat_ep_trk_t *trk;
   u32 rnd;
   u32 n_changes = 0, n_remove = 0, verbose = 0;
+  u64 n_updated = 0;
+  f64 t_update = 0;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -290,6 +345,8 @@ cnat_translation_test_init_maglev (vlib_main_t *vm, unformat_input_t *input,
 
   if (n_remove != 0)
     {
+      n_updated = 0;
+      t_update = 0;
       vlib_cli_output (
 	vm, "Removing %d entries (refered to as A), others (B,C) stay same",
 	n_remove);
@@ -313,6 +370,8 @@ cnat_translation_test_init_maglev (vlib_main_t *vm, unformat_input_t *input,
 
 	  old_maglev_lb = vec_dup (ct->lb_maglev);
 	  cnat_translation_init_maglev (ct);
+	  n_updated += ct->lb_maglev_n_changed;
+	  t_update += ct->lb_maglev_update_time;
 
 	  cnat_maglev_print_changes (vm, changed_bk_indices, old_maglev_lb,
 				     ct->lb_maglev);
@@ -320,11 +379,14 @@ cnat_translation_test_init_maglev (vlib_main_t *vm, unformat_input_t *input,
 	  vec_free (changed_bk_indices);
 	  vec_free (old_maglev_lb);
 	}
+      cnat_maglev_print_updates (vm, n_tests, n_updated, t_update);
     }
 
   /* Reshuffle and check changes */
   if (n_changes != 0)
     {
+      n_updated = 0;
+      t_update = 0;
       vlib_cli_output (
 	vm,
 	"Changing %d entries (refered to as A->A'), others (B,C) stay same",
@@ -352,16 +414,22 @@ cnat_translation_test_init_maglev (vlib_main_t *vm, unformat_input_t *input,
 	  old_maglev_lb = vec_dup (ct->lb_maglev);
 
 	  cnat_translation_init_maglev (ct);
+	  n_updated += ct->lb_maglev_n_changed;
+	  t_update += ct->lb_maglev_update_time;
 	  cnat_maglev_print_changes (vm, changed_bk_indices, old_maglev_lb,
 				     ct->lb_maglev);
 
 	  vec_free (changed_bk_indices);
 	  vec_free (old_maglev_lb);
 	}
+      cnat_maglev_print_updates (vm, n_tests, n_updated, t_update);
     }
 
   vec_foreach (ct, trs)
-    vec_free (ct->ct_active_paths);
+    {
+      vec_free (ct->ct_active_paths);
+      vec_free (ct->lb_maglev);
+    }
   vec_free (trs);
 
   return (NULL);
@@ -370,6 +438,6 @@ cnat_translation_test_init_maglev (vlib_main_t *vm, unformat_input_t *input,
 VLIB_CLI_COMMAND (cnat_translation_test_init_maglev_cmd, static) = {
   .path = "test cnat maglev",
   .short_help = "test cnat maglev tests [n_tests] backends [num_backends] len "
-		"[maglev_len]",
+		"[maglev_len] [change <n>] [rm <n>] [verbose <n>]",
   .function = cnat_translation_test_init_maglev,
 };
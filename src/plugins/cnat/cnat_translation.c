@@ -398,6 +398,8 @@ format_cnat_translation (u8 * s, va_list * args)
   u32 bid = 0;
   if (CNAT_LB_MAGLEV == ct->lb_type)
     {
+      s = format (s, "\nmaglev last update: %u slots changed in %.2fus",
+		  ct->lb_maglev_n_changed, ct->lb_maglev_update_time * 1e6);
       s = format (s, "\nmaglev backends map");
       uword *bitmap = NULL;
       clib_bitmap_alloc (bitmap, cm->maglev_len);
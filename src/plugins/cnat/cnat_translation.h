@@ -171,6 +171,12 @@ typedef struct cnat_translation_t_
   {
     u32 *lb_maglev;
   };
+
+  /**
+   * Slots the last maglev update changed and the time it took
+   */
+  u32 lb_maglev_n_changed;
+  f64 lb_maglev_update_time;
 } cnat_translation_t;
 
 extern cnat_translation_t *cnat_translation_pool;
@@ -0,0 +1,460 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/plugin/plugin.h>
+#include <vnet/crypto/crypto.h>
+#include <crypto_native/crypto_native.h>
+
+#if __GNUC__ > 4  && !__clang__ && CLIB_DEBUG == 0
+#pragma GCC optimize ("O3")
+#endif
+
+/*
+ * ChaCha20-Poly1305 AEAD, RFC 8439.
+ *
+ * ChaCha20 blocks are computed a vector at a time, one block per lane.
+ * The lanes are filled from all the ops of a batch, so that short
+ * packets, e.g. WireGuard keepalives or small ESP payloads, use them as
+ * well as long ones. Poly1305 runs per packet, with 44 bit limbs.
+ */
+
+#if defined(CLIB_HAVE_VEC512)
+#define CHACHA20_N_LANES 16
+typedef u32x16 chacha20_u32xn_t;
+#elif defined(CLIB_HAVE_VEC256)
+#define CHACHA20_N_LANES 8
+typedef u32x8 chacha20_u32xn_t;
+#else
+#define CHACHA20_N_LANES 4
+typedef u32x4 chacha20_u32xn_t;
+#endif
+
+#define CHACHA20_BLOCK_SIZE 64
+#define POLY1305_BLOCK_SIZE 16
+#define POLY1305_MASK44	    0xfffffffffffULL
+#define POLY1305_MASK42	    0x3ffffffffffULL
+
+/* input of one lane: the block of a given op, at a given counter */
+typedef struct
+{
+  const u32 *key;
+  const u8 *nonce;
+  u32 counter;
+} chacha20_lane_t;
+
+typedef struct
+{
+  u64 r[3];
+  u64 h[3];
+  u64 pad[2];
+} poly1305_t;
+
+static const u32 chacha20_sigma[4] = { 0x61707865, 0x3320646e, 0x79622d32,
+				       0x6b206574 };
+
+static_always_inline chacha20_u32xn_t
+chacha20_rotl (chacha20_u32xn_t v, int n)
+{
+  return (v << n) | (v >> (32 - n));
+}
+
+#define chacha20_quarter_round(a, b, c, d)                                    \
+  do                                                                          \
+    {                                                                         \
+      a += b;                                                                 \
+      d = chacha20_rotl (d ^ a, 16);                                          \
+      c += d;                                                                 \
+      b = chacha20_rotl (b ^ c, 12);                                          \
+      a += b;                                                                 \
+      d = chacha20_rotl (d ^ a, 8);                                           \
+      c += d;                                                                 \
+      b = chacha20_rotl (b ^ c, 7);                                           \
+    }                                                                         \
+  while (0)
+
+/* the keystream blocks of n_lanes lanes, ks[i] is the block of lane i */
+static_always_inline void
+chacha20_blocks (chacha20_lane_t *lanes, u32 n_lanes,
+		 u8 ks[][CHACHA20_BLOCK_SIZE])
+{
+  u32 s[16][CHACHA20_N_LANES] __attribute__ ((aligned (64)));
+  chacha20_u32xn_t x[16], in[16];
+  chacha20_lane_t *l;
+  int i, j;
+
+  for (i = 0; i < CHACHA20_N_LANES; i++)
+    {
+      /* unused lanes repeat the first one */
+      l = lanes + (i < n_lanes ? i : 0);
+      for (j = 0; j < 4; j++)
+	s[j][i] = chacha20_sigma[j];
+      for (j = 0; j < 8; j++)
+	s[4 + j][i] = l->key[j];
+      s[12][i] = l->counter;
+      for (j = 0; j < 3; j++)
+	s[13 + j][i] = clib_mem_unaligned (l->nonce + 4 * j, u32);
+    }
+
+  for (j = 0; j < 16; j++)
+    x[j] = in[j] = *(chacha20_u32xn_t *) s[j];
+
+  for (i = 0; i < 10; i++)
+    {
+      chacha20_quarter_round (x[0], x[4], x[8], x[12]);
+      chacha20_quarter_round (x[1], x[5], x[9], x[13]);
+      chacha20_quarter_round (x[2], x[6], x[10], x[14]);
+      chacha20_quarter_round (x[3], x[7], x[11], x[15]);
+      chacha20_quarter_round (x[0], x[5], x[10], x[15]);
+      chacha20_quarter_round (x[1], x[6], x[11], x[12]);
+      chacha20_quarter_round (x[2], x[7], x[8], x[13]);
+      chacha20_quarter_round (x[3], x[4], x[9], x[14]);
+    }
+
+  for (j = 0; j < 16; j++)
+    *(chacha20_u32xn_t *) s[j] = x[j] + in[j];
+
+  for (i = 0; i < n_lanes; i++)
+    for (j = 0; j < 16; j++)
+      ((u32u *) ks[i])[j] = s[j][i];
+}
+
+static_always_inline void
+chacha20_xor (u8 *dst, const u8 *src, const u8 *ks, u32 len)
+{
+  u32 i = 0;
+
+  if (len == CHACHA20_BLOCK_SIZE)
+    {
+      for (; i < CHACHA20_BLOCK_SIZE; i += 16)
+	*(u8x16u *) (dst + i) =
+	  *(u8x16u *) (src + i) ^ *(u8x16u *) (ks + i);
+      return;
+    }
+
+  for (; i < len; i++)
+    dst[i] = src[i] ^ ks[i];
+}
+
+static_always_inline void
+poly1305_init (poly1305_t *p, const u8 *key)
+{
+  u64 t0 = clib_mem_unaligned (key, u64);
+  u64 t1 = clib_mem_unaligned (key + 8, u64);
+
+  p->r[0] = t0 & 0xffc0fffffffULL;
+  p->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+  p->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+  p->h[0] = p->h[1] = p->h[2] = 0;
+  p->pad[0] = clib_mem_unaligned (key + 16, u64);
+  p->pad[1] = clib_mem_unaligned (key + 24, u64);
+}
+
+/* whole 16 byte blocks of m */
+static_always_inline void
+poly1305_blocks (poly1305_t *p, const u8 *m, u32 len)
+{
+  u64 r0 = p->r[0], r1 = p->r[1], r2 = p->r[2];
+  u64 s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+  u64 h0 = p->h[0], h1 = p->h[1], h2 = p->h[2];
+  u64 t0, t1, c;
+  u128 d0, d1, d2;
+
+  while (len >= POLY1305_BLOCK_SIZE)
+    {
+      t0 = clib_mem_unaligned (m, u64);
+      t1 = clib_mem_unaligned (m + 8, u64);
+
+      h0 += t0 & POLY1305_MASK44;
+      h1 += ((t0 >> 44) | (t1 << 20)) & POLY1305_MASK44;
+      h2 += ((t1 >> 24) & POLY1305_MASK42) | (1ULL << 40);
+
+      d0 = (u128) h0 * r0 + (u128) h1 * s2 + (u128) h2 * s1;
+      d1 = (u128) h0 * r1 + (u128) h1 * r0 + (u128) h2 * s2;
+      d2 = (u128) h0 * r2 + (u128) h1 * r1 + (u128) h2 * r0;
+
+      c = (u64) (d0 >> 44);
+      h0 = (u64) d0 & POLY1305_MASK44;
+      d1 += c;
+      c = (u64) (d1 >> 44);
+      h1 = (u64) d1 & POLY1305_MASK44;
+      d2 += c;
+      c = (u64) (d2 >> 42);
+      h2 = (u64) d2 & POLY1305_MASK42;
+      h0 += c * 5;
+      c = h0 >> 44;
+      h0 &= POLY1305_MASK44;
+      h1 += c;
+
+      m += POLY1305_BLOCK_SIZE;
+      len -= POLY1305_BLOCK_SIZE;
+    }
+
+  p->h[0] = h0;
+  p->h[1] = h1;
+  p->h[2] = h2;
+}
+
+/* m followed by zeroes up to a multiple of 16 bytes, as the AEAD pads */
+static_always_inline void
+poly1305_update_padded (poly1305_t *p, const u8 *m, u32 len)
+{
+  u8 last[POLY1305_BLOCK_SIZE] = {};
+  u32 n_whole = len & ~(POLY1305_BLOCK_SIZE - 1), i;
+
+  poly1305_blocks (p, m, n_whole);
+
+  if (len > n_whole)
+    {
+      for (i = 0; i < len - n_whole; i++)
+	last[i] = m[n_whole + i];
+      poly1305_blocks (p, last, POLY1305_BLOCK_SIZE);
+    }
+}
+
+static_always_inline void
+poly1305_final (poly1305_t *p, u8 *tag)
+{
+  u64 h0 = p->h[0], h1 = p->h[1], h2 = p->h[2];
+  u64 g0, g1, g2, c, t0 = p->pad[0], t1 = p->pad[1];
+
+  c = h1 >> 44;
+  h1 &= POLY1305_MASK44;
+  h2 += c;
+  c = h2 >> 42;
+  h2 &= POLY1305_MASK42;
+  h0 += c * 5;
+  c = h0 >> 44;
+  h0 &= POLY1305_MASK44;
+  h1 += c;
+  c = h1 >> 44;
+  h1 &= POLY1305_MASK44;
+  h2 += c;
+  c = h2 >> 42;
+  h2 &= POLY1305_MASK42;
+  h0 += c * 5;
+  c = h0 >> 44;
+  h0 &= POLY1305_MASK44;
+  h1 += c;
+
+  /* h - p, kept if h >= p */
+  g0 = h0 + 5;
+  c = g0 >> 44;
+  g0 &= POLY1305_MASK44;
+  g1 = h1 + c;
+  c = g1 >> 44;
+  g1 &= POLY1305_MASK44;
+  g2 = h2 + c - (1ULL << 42);
+
+  c = (g2 >> 63) - 1;
+  h0 = (h0 & ~c) | (g0 & c);
+  h1 = (h1 & ~c) | (g1 & c);
+  h2 = (h2 & ~c) | (g2 & c);
+
+  /* h + s mod 2^128 */
+  h0 += t0 & POLY1305_MASK44;
+  c = h0 >> 44;
+  h0 &= POLY1305_MASK44;
+  h1 += (((t0 >> 44) | (t1 << 20)) & POLY1305_MASK44) + c;
+  c = h1 >> 44;
+  h1 &= POLY1305_MASK44;
+  h2 += ((t1 >> 24) & POLY1305_MASK42) + c;
+  h2 &= POLY1305_MASK42;
+
+  clib_mem_unaligned (tag, u64) = h0 | (h1 << 44);
+  clib_mem_unaligned (tag + 8, u64) = (h1 >> 20) | (h2 << 24);
+}
+
+static_always_inline void
+chacha20_poly1305_tag (poly1305_t *p, vnet_crypto_op_t *op, const u8 *ct,
+		       u8 *tag)
+{
+  u64 lengths[2] = { op->aad_len, op->len };
+
+  poly1305_update_padded (p, op->aad, op->aad_len);
+  poly1305_update_padded (p, ct, op->len);
+  poly1305_blocks (p, (u8 *) lengths, sizeof (lengths));
+  poly1305_final (p, tag);
+}
+
+/* the data blocks queued in the lanes, xored into their ops */
+static_always_inline void
+chacha20_flush (chacha20_lane_t *lanes, vnet_crypto_op_t **lane_op,
+		u32 n_lanes)
+{
+  u8 ks[CHACHA20_N_LANES][CHACHA20_BLOCK_SIZE] __attribute__ ((aligned (64)));
+  vnet_crypto_op_t *op;
+  u32 i, off;
+
+  chacha20_blocks (lanes, n_lanes, ks);
+
+  for (i = 0; i < n_lanes; i++)
+    {
+      op = lane_op[i];
+      off = (lanes[i].counter - 1) * CHACHA20_BLOCK_SIZE;
+      chacha20_xor (op->dst + off, op->src + off, ks[i],
+		    clib_min (CHACHA20_BLOCK_SIZE, op->len - off));
+    }
+}
+
+static_always_inline int
+chacha20_poly1305_tag_ok (const u8 *tag, const u8 *expected, u32 len)
+{
+  u8 diff = 0;
+  u32 i;
+
+  if (len > POLY1305_BLOCK_SIZE)
+    return 0;
+
+  for (i = 0; i < len; i++)
+    diff |= tag[i] ^ expected[i];
+
+  return diff == 0;
+}
+
+static_always_inline u32
+chacha20_poly1305_ops (vlib_main_t *vm, vnet_crypto_op_t *ops[], u32 n_ops,
+		       int is_enc)
+{
+  chacha20_lane_t op_lanes[CHACHA20_N_LANES], lanes[CHACHA20_N_LANES];
+  vnet_crypto_op_t *op, *lane_op[CHACHA20_N_LANES];
+  u8 ks[CHACHA20_N_LANES][CHACHA20_BLOCK_SIZE] __attribute__ ((aligned (64)));
+  poly1305_t poly[CHACHA20_N_LANES];
+  u8 tag[POLY1305_BLOCK_SIZE];
+  u32 n_left = n_ops, n, i, off, n_lanes, n_fail = 0;
+
+  while (n_left)
+    {
+      n = clib_min (n_left, CHACHA20_N_LANES);
+
+      /* block 0 of each op keys its Poly1305 */
+      for (i = 0; i < n; i++)
+	{
+	  op = ops[i];
+	  /* ChaCha20 has no key schedule, so the key is read at op time;
+	   * users such as the wireguard handshake rewrite key data in place
+	   * after vnet_crypto_key_add () */
+	  op_lanes[i].key = (u32 *) vnet_crypto_get_key (op->key_index)->data;
+	  op_lanes[i].nonce = op->iv;
+	  op_lanes[i].counter = 0;
+	}
+      chacha20_blocks (op_lanes, n, ks);
+
+      for (i = 0; i < n; i++)
+	{
+	  op = ops[i];
+	  poly1305_init (poly + i, ks[i]);
+	  op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+
+	  /* the ciphertext may be decrypted in place, check it first */
+	  if (is_enc)
+	    continue;
+
+	  chacha20_poly1305_tag (poly + i, op, op->src, tag);
+	  if (!chacha20_poly1305_tag_ok (tag, op->tag, op->tag_len))
+	    {
+	      op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+	      n_fail++;
+	    }
+	}
+
+      /* then the data blocks of all the ops, a vector at a time */
+      n_lanes = 0;
+      for (i = 0; i < n; i++)
+	{
+	  op = ops[i];
+	  if (op->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	    continue;
+
+	  for (off = 0; off < op->len; off += CHACHA20_BLOCK_SIZE)
+	    {
+	      lanes[n_lanes] = op_lanes[i];
+	      lanes[n_lanes].counter = 1 + off / CHACHA20_BLOCK_SIZE;
+	      lane_op[n_lanes++] = op;
+
+	      if (n_lanes == CHACHA20_N_LANES)
+		{
+		  chacha20_flush (lanes, lane_op, n_lanes);
+		  n_lanes = 0;
+		}
+	    }
+	}
+
+      if (n_lanes)
+	chacha20_flush (lanes, lane_op, n_lanes);
+
+      if (is_enc)
+	for (i = 0; i < n; i++)
+	  {
+	    op = ops[i];
+	    chacha20_poly1305_tag (poly + i, op, op->dst, tag);
+	    clib_memcpy_fast (op->tag, tag,
+			      clib_min (op->tag_len, POLY1305_BLOCK_SIZE));
+	  }
+
+      ops += n;
+      n_left -= n;
+    }
+
+  return n_ops - n_fail;
+}
+
+static u32
+chacha20_poly1305_ops_enc (vlib_main_t *vm, vnet_crypto_op_t *ops[],
+			   u32 n_ops)
+{
+  return chacha20_poly1305_ops (vm, ops, n_ops, /* is_enc */ 1);
+}
+
+static u32
+chacha20_poly1305_ops_dec (vlib_main_t *vm, vnet_crypto_op_t *ops[],
+			   u32 n_ops)
+{
+  return chacha20_poly1305_ops (vm, ops, n_ops, /* is_enc */ 0);
+}
+
+clib_error_t *
+#ifdef __VAES__
+crypto_native_chacha20_poly1305_init_icl (vlib_main_t *vm)
+#elif __AVX512F__
+crypto_native_chacha20_poly1305_init_skx (vlib_main_t *vm)
+#elif __AVX2__
+crypto_native_chacha20_poly1305_init_hsw (vlib_main_t *vm)
+#elif __aarch64__
+crypto_native_chacha20_poly1305_init_neon (vlib_main_t *vm)
+#else
+crypto_native_chacha20_poly1305_init_slm (vlib_main_t *vm)
+#endif
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC,
+				    chacha20_poly1305_ops_enc);
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC,
+				    chacha20_poly1305_ops_dec);
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
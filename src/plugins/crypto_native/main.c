@@ -126,6 +126,31 @@ crypto_native_init (vlib_main_t * vm)
     goto error;
 #endif
 
+  if (0);
+#if __x86_64__
+  else if (crypto_native_chacha20_poly1305_init_icl &&
+	   clib_cpu_supports_vaes ())
+    error = crypto_native_chacha20_poly1305_init_icl (vm);
+  else if (crypto_native_chacha20_poly1305_init_skx &&
+	   clib_cpu_supports_avx512f ())
+    error = crypto_native_chacha20_poly1305_init_skx (vm);
+  else if (crypto_native_chacha20_poly1305_init_hsw &&
+	   clib_cpu_supports_avx2 ())
+    error = crypto_native_chacha20_poly1305_init_hsw (vm);
+  else if (crypto_native_chacha20_poly1305_init_slm)
+    error = crypto_native_chacha20_poly1305_init_slm (vm);
+#endif
+#if __aarch64__
+  else if (crypto_native_chacha20_poly1305_init_neon)
+    error = crypto_native_chacha20_poly1305_init_neon (vm);
+#endif
+  else
+    error =
+      clib_error_return (0, "No ChaCha20-Poly1305 implemenation available");
+
+  if (error)
+    goto error;
+
   vnet_crypto_register_key_handler (vm, cm->crypto_engine_index,
 				    crypto_native_key_handler);
 
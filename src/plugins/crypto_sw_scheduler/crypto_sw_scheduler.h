@@ -32,14 +32,57 @@ typedef enum crypto_sw_scheduler_queue_type_t_
   CRYPTO_SW_SCHED_QUEUE_N_TYPES
 } crypto_sw_scheduler_queue_type_t;
 
+/* elts of a frame processed at a time, so that idle threads can help
+ * with the frames of a busy one */
+#define CRYPTO_SW_SCHEDULER_CHUNK_SIZE 16
+
+/*
+ * The elts of a queued frame are handed out by claiming them from the
+ * claim word of its slot: the queue position of the frame, which tells
+ * a claim for a frame since returned from one for the frame now in the
+ * slot, its number of elts and the next one to hand out.
+ */
+#define CRYPTO_SW_SCHEDULER_CLAIM(pos, n_elts, next)                          \
+  ((u64) (pos) << 32 | (u64) (n_elts) << 16 | (next))
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  volatile u64 claim;
+  /* elts processed, the thread completing the last of them sets the
+   * frame state */
+  u32 n_done;
+  u8 error;
+} crypto_sw_scheduler_slot_t;
+
+/*
+ * Each thread's frames, in the order they are returned to it. Frames
+ * from tail to claim have had all their elts handed out, those from
+ * claim to head still have some: the owner and the threads stealing
+ * from it take them from claim.
+ */
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u32 head;
   u32 tail;
   vnet_crypto_async_frame_t **jobs;
+  crypto_sw_scheduler_slot_t *slots;
+
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  volatile u32 claim;
 } crypto_sw_scheduler_queue_t;
 
+/* elts claimed from another thread's frame, processed later */
+typedef struct
+{
+  crypto_sw_scheduler_queue_t *queue;
+  vnet_crypto_async_frame_t *frame;
+  u32 pos;
+  u16 start;
+  u16 n_elts;
+} crypto_sw_scheduler_work_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -53,6 +96,21 @@ typedef struct
   vnet_crypto_op_t *chained_integ_ops;
   vnet_crypto_op_chunk_t *chunks;
   u8 self_crypto_enabled;
+
+  /* half the frames of a loaded thread, taken at once */
+  crypto_sw_scheduler_work_t *stolen;
+  u32 stolen_index;
+
+  /* crypto done by the thread */
+  u64 n_elts;
+  u64 n_bytes;
+  u64 busy_clocks;
+  /* chunks of its own frames, and of another thread's last frame */
+  u64 n_chunks;
+  u64 n_chunks_split;
+  /* frames taken from other threads, and how many times */
+  u64 n_frames_stolen;
+  u64 n_steals;
 } crypto_sw_scheduler_per_thread_data_t;
 
 typedef struct
@@ -60,11 +118,13 @@ typedef struct
   u32 crypto_engine_index;
   crypto_sw_scheduler_per_thread_data_t *per_thread_data;
   vnet_crypto_key_t *keys;
+  u32 chunk_size;
 } crypto_sw_scheduler_main_t;
 
 extern crypto_sw_scheduler_main_t crypto_sw_scheduler_main;
 
 extern int crypto_sw_scheduler_set_worker_crypto (u32 worker_idx, u8 enabled);
+extern int crypto_sw_scheduler_set_chunk_size (u32 chunk_size);
 
 extern clib_error_t *crypto_sw_scheduler_api_init (vlib_main_t * vm);
 
@@ -83,7 +83,9 @@ crypto_sw_scheduler_frame_enqueue (vlib_main_t *vm,
   crypto_sw_scheduler_queue_t *current_queue =
     is_enc ? &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT] :
 	     &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
-  u64 head = current_queue->head;
+  u32 head = current_queue->head;
+  crypto_sw_scheduler_slot_t *slot =
+    current_queue->slots + (head & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
 
   if (current_queue->jobs[head & CRYPTO_SW_SCHEDULER_QUEUE_MASK])
     {
@@ -94,6 +96,11 @@ crypto_sw_scheduler_frame_enqueue (vlib_main_t *vm,
     }
 
   current_queue->jobs[head & CRYPTO_SW_SCHEDULER_QUEUE_MASK] = frame;
+  slot->n_done = 0;
+  slot->error = 0;
+  __atomic_store_n (&slot->claim,
+		    CRYPTO_SW_SCHEDULER_CLAIM (head, frame->n_elts, 0),
+		    __ATOMIC_RELEASE);
   head += 1;
   CLIB_MEMORY_STORE_BARRIER ();
   current_queue->head = head;
@@ -105,14 +112,14 @@ crypto_sw_scheduler_frame_enqueue_decrypt (vlib_main_t *vm,
 					   vnet_crypto_async_frame_t *frame)
 {
   return crypto_sw_scheduler_frame_enqueue (vm, frame, 0);
-    }
-    static int
-    crypto_sw_scheduler_frame_enqueue_encrypt (
-      vlib_main_t *vm, vnet_crypto_async_frame_t *frame)
-    {
+}
 
-      return crypto_sw_scheduler_frame_enqueue (vm, frame, 1);
-    }
+static int
+crypto_sw_scheduler_frame_enqueue_encrypt (vlib_main_t *vm,
+					   vnet_crypto_async_frame_t *frame)
+{
+  return crypto_sw_scheduler_frame_enqueue (vm, frame, 1);
+}
 
 static_always_inline void
 cryptodev_sw_scheduler_sgl (vlib_main_t *vm,
@@ -302,24 +309,30 @@ process_chained_ops (vlib_main_t * vm, vnet_crypto_async_frame_t * f,
 }
 
 static_always_inline void
+crypto_sw_scheduler_reset_ops (crypto_sw_scheduler_per_thread_data_t *ptd)
+{
+  vec_reset_length (ptd->crypto_ops);
+  vec_reset_length (ptd->integ_ops);
+  vec_reset_length (ptd->chained_crypto_ops);
+  vec_reset_length (ptd->chained_integ_ops);
+  vec_reset_length (ptd->chunks);
+}
+
+static_always_inline u8
 crypto_sw_scheduler_process_aead (vlib_main_t *vm,
 				  crypto_sw_scheduler_per_thread_data_t *ptd,
-				  vnet_crypto_async_frame_t *f, u32 aead_op,
-				  u32 aad_len, u32 digest_len)
+				  vnet_crypto_async_frame_t *f, u32 start,
+				  u32 n_elts, u32 aead_op, u32 aad_len,
+				  u32 digest_len)
 {
   vnet_crypto_async_frame_elt_t *fe;
   u32 *bi;
-  u32 n_elts = f->n_elts;
   u8 state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
 
-  vec_reset_length (ptd->crypto_ops);
-  vec_reset_length (ptd->integ_ops);
-  vec_reset_length (ptd->chained_crypto_ops);
-  vec_reset_length (ptd->chained_integ_ops);
-  vec_reset_length (ptd->chunks);
+  crypto_sw_scheduler_reset_ops (ptd);
 
-  fe = f->elts;
-  bi = f->buffer_indices;
+  fe = f->elts + start;
+  bi = f->buffer_indices + start;
 
   while (n_elts--)
     {
@@ -332,72 +345,69 @@ crypto_sw_scheduler_process_aead (vlib_main_t *vm,
       fe++;
     }
 
-      process_ops (vm, f, ptd->crypto_ops, &state);
-      process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks,
-			   &state);
-      f->state = state;
-    }
+  process_ops (vm, f, ptd->crypto_ops, &state);
+  process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks, &state);
+  return state;
+}
 
-    static_always_inline void
-    crypto_sw_scheduler_process_link (
-      vlib_main_t *vm, crypto_sw_scheduler_main_t *cm,
-      crypto_sw_scheduler_per_thread_data_t *ptd, vnet_crypto_async_frame_t *f,
-      u32 crypto_op, u32 auth_op, u16 digest_len, u8 is_enc)
-    {
-      vnet_crypto_async_frame_elt_t *fe;
-      u32 *bi;
-      u32 n_elts = f->n_elts;
-      u8 state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
+static_always_inline u8
+crypto_sw_scheduler_process_link (vlib_main_t *vm,
+				  crypto_sw_scheduler_main_t *cm,
+				  crypto_sw_scheduler_per_thread_data_t *ptd,
+				  vnet_crypto_async_frame_t *f, u32 start,
+				  u32 n_elts, u32 crypto_op, u32 auth_op,
+				  u16 digest_len, u8 is_enc)
+{
+  vnet_crypto_async_frame_elt_t *fe;
+  u32 *bi;
+  u8 state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
 
-      vec_reset_length (ptd->crypto_ops);
-      vec_reset_length (ptd->integ_ops);
-      vec_reset_length (ptd->chained_crypto_ops);
-      vec_reset_length (ptd->chained_integ_ops);
-      vec_reset_length (ptd->chunks);
-      fe = f->elts;
-      bi = f->buffer_indices;
+  crypto_sw_scheduler_reset_ops (ptd);
 
-      while (n_elts--)
-	{
-	  if (n_elts > 1)
-	    clib_prefetch_load (fe + 1);
-
-	  crypto_sw_scheduler_convert_link_crypto (
-	    vm, ptd, cm->keys + fe->key_index, fe, fe - f->elts, bi[0],
-	    crypto_op, auth_op, digest_len, is_enc);
-	  bi++;
-	  fe++;
-	}
+  fe = f->elts + start;
+  bi = f->buffer_indices + start;
 
-      if (is_enc)
-	{
-	  process_ops (vm, f, ptd->crypto_ops, &state);
-	  process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks,
-			       &state);
-	  process_ops (vm, f, ptd->integ_ops, &state);
-	  process_chained_ops (vm, f, ptd->chained_integ_ops, ptd->chunks,
-			       &state);
-	}
-      else
-	{
-	  process_ops (vm, f, ptd->integ_ops, &state);
-	  process_chained_ops (vm, f, ptd->chained_integ_ops, ptd->chunks,
-			       &state);
-	  process_ops (vm, f, ptd->crypto_ops, &state);
-	  process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks,
-			       &state);
-	}
+  while (n_elts--)
+    {
+      if (n_elts > 1)
+	clib_prefetch_load (fe + 1);
 
-      f->state = state;
+      crypto_sw_scheduler_convert_link_crypto (
+	vm, ptd, cm->keys + fe->key_index, fe, fe - f->elts, bi[0], crypto_op,
+	auth_op, digest_len, is_enc);
+      bi++;
+      fe++;
     }
 
-    static_always_inline int
-    convert_async_crypto_id (vnet_crypto_async_op_id_t async_op_id,
-			     u32 *crypto_op, u32 *auth_op_or_aad_len,
-			     u16 *digest_len, u8 *is_enc)
+  if (is_enc)
+    {
+      process_ops (vm, f, ptd->crypto_ops, &state);
+      process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks,
+			   &state);
+      process_ops (vm, f, ptd->integ_ops, &state);
+      process_chained_ops (vm, f, ptd->chained_integ_ops, ptd->chunks,
+			   &state);
+    }
+  else
+    {
+      process_ops (vm, f, ptd->integ_ops, &state);
+      process_chained_ops (vm, f, ptd->chained_integ_ops, ptd->chunks,
+			   &state);
+      process_ops (vm, f, ptd->crypto_ops, &state);
+      process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks,
+			   &state);
+    }
+
+  return state;
+}
+
+static_always_inline int
+convert_async_crypto_id (vnet_crypto_async_op_id_t async_op_id,
+			 u32 *crypto_op, u32 *auth_op_or_aad_len,
+			 u16 *digest_len, u8 *is_enc)
+{
+  switch (async_op_id)
     {
-      switch (async_op_id)
-	{
 #define _(n, s, k, t, a)                                                      \
   case VNET_CRYPTO_OP_##n##_TAG##t##_AAD##a##_ENC:                            \
     *crypto_op = VNET_CRYPTO_OP_##n##_ENC;                                    \
@@ -411,7 +421,7 @@ crypto_sw_scheduler_process_aead (vlib_main_t *vm,
     *digest_len = t;                                                          \
     *is_enc = 0;                                                              \
     return 1;
-	  foreach_crypto_aead_async_alg
+      foreach_crypto_aead_async_alg
 #undef _
 
 #define _(c, h, s, k, d)                                                      \
@@ -427,136 +437,337 @@ crypto_sw_scheduler_process_aead (vlib_main_t *vm,
     *digest_len = d;                                                          \
     *is_enc = 0;                                                              \
     return 0;
-	    foreach_crypto_link_async_alg
+	foreach_crypto_link_async_alg
 #undef _
 
-	    default : return -1;
-	}
-
-      return -1;
+	default : return -1;
     }
 
-    static_always_inline vnet_crypto_async_frame_t *
-    crypto_sw_scheduler_dequeue (vlib_main_t *vm, u32 *nb_elts_processed,
-				 u32 *enqueue_thread_idx)
+  return -1;
+}
+
+/*
+ * Claim up to n_max of the elts left in the frame at queue position pos,
+ * returns how many, 0 once they have all been handed out.
+ */
+static_always_inline u32
+crypto_sw_scheduler_claim (crypto_sw_scheduler_queue_t *q, u32 pos,
+			   u32 n_max, u32 *start)
+{
+  crypto_sw_scheduler_slot_t *slot =
+    q->slots + (pos & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
+  u64 claim = __atomic_load_n (&slot->claim, __ATOMIC_ACQUIRE);
+  u32 n_elts, next, n;
+
+  while (1)
     {
-      crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
-      crypto_sw_scheduler_per_thread_data_t *ptd =
-	cm->per_thread_data + vm->thread_index;
-      vnet_crypto_async_frame_t *f = 0;
-      crypto_sw_scheduler_queue_t *current_queue = 0;
-      u32 tail, head;
-      u8 found = 0;
+      /* returned, and the slot reused */
+      if ((u32) (claim >> 32) != pos)
+	return 0;
+
+      n_elts = (claim >> 16) & 0xffff;
+      next = claim & 0xffff;
+      if (next >= n_elts)
+	return 0;
+
+      n = clib_min (n_max, n_elts - next);
+      if (__atomic_compare_exchange_n (&slot->claim, &claim, claim + n,
+				       0 /* weak */, __ATOMIC_ACQUIRE,
+				       __ATOMIC_ACQUIRE))
+	{
+	  *start = next;
+	  return n;
+	}
+    }
+}
+
+/* the frame at pos has been handed out, move the queue past it */
+static_always_inline void
+crypto_sw_scheduler_claimed (crypto_sw_scheduler_queue_t *q, u32 pos)
+{
+  u32 claim = pos;
+
+  __atomic_compare_exchange_n (&q->claim, &claim, pos + 1, 0 /* weak */,
+			       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
 
-      /* get a pending frame to process */
-      if (ptd->self_crypto_enabled)
+/* claim up to n_max elts of the oldest frame with any left */
+static_always_inline u32
+crypto_sw_scheduler_claim_next (crypto_sw_scheduler_queue_t *q, u32 n_max,
+				u32 *pos, u32 *start)
+{
+  u32 head = __atomic_load_n (&q->head, __ATOMIC_ACQUIRE);
+  u32 p = __atomic_load_n (&q->claim, __ATOMIC_RELAXED);
+  u32 n;
+
+  for (; (i32) (head - p) > 0; p++)
+    {
+      n = crypto_sw_scheduler_claim (q, p, n_max, start);
+      if (n)
 	{
-	  u32 i = ptd->last_serve_lcore_id + 1;
+	  *pos = p;
+	  return n;
+	}
+      crypto_sw_scheduler_claimed (q, p);
+    }
 
-	  while (1)
-	    {
-	      crypto_sw_scheduler_per_thread_data_t *st;
-	      u32 j;
+  return 0;
+}
 
-	      if (i >= vec_len (cm->per_thread_data))
-		i = 0;
+static_always_inline u32
+crypto_sw_scheduler_n_pending (crypto_sw_scheduler_queue_t *q)
+{
+  i32 n = __atomic_load_n (&q->head, __ATOMIC_ACQUIRE) -
+	  __atomic_load_n (&q->claim, __ATOMIC_RELAXED);
 
-	      st = cm->per_thread_data + i;
+  return clib_max (n, 0);
+}
 
-	      if (ptd->last_serve_encrypt)
-		current_queue = &st->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
-	      else
-		current_queue = &st->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT];
+/*
+ * With nothing of its own to do, a thread takes from the thread with
+ * the most frames waiting: half of them, to be processed in the calls
+ * that follow, or a chunk of the last one so that a frame can be
+ * spread over threads.
+ */
+static_always_inline int
+crypto_sw_scheduler_steal (crypto_sw_scheduler_main_t *cm,
+			   crypto_sw_scheduler_per_thread_data_t *ptd,
+			   crypto_sw_scheduler_work_t *w)
+{
+  crypto_sw_scheduler_per_thread_data_t *st;
+  crypto_sw_scheduler_queue_t *q, *victim = 0;
+  crypto_sw_scheduler_work_t *sw;
+  u32 n_threads = vec_len (cm->per_thread_data);
+  u32 i, j, t, n, n_max = 0, pos, start, n_steal;
+
+  i = ptd->last_serve_lcore_id;
+  for (j = 0; j < n_threads; j++)
+    {
+      if (++i >= n_threads)
+	i = 0;
 
-	      tail = current_queue->tail;
-	      head = current_queue->head;
+      st = cm->per_thread_data + i;
+      if (st == ptd)
+	continue;
 
-	      for (j = tail; j != head; j++)
-		{
+      for (t = 0; t < CRYPTO_SW_SCHED_QUEUE_N_TYPES; t++)
+	{
+	  n = crypto_sw_scheduler_n_pending (&st->queue[t]);
+	  if (n > n_max)
+	    {
+	      n_max = n;
+	      victim = &st->queue[t];
+	      ptd->last_serve_lcore_id = i;
+	    }
+	}
+    }
 
-		  f = current_queue->jobs[j & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
+  if (!victim)
+    return 0;
 
-		  if (!f)
-		    continue;
+  q = victim;
 
-		  if (clib_atomic_bool_cmp_and_swap (
-			&f->state, VNET_CRYPTO_FRAME_STATE_PENDING,
-			VNET_CRYPTO_FRAME_STATE_WORK_IN_PROGRESS))
-		    {
-		      found = 1;
-		      break;
-		    }
-		}
+  if (n_max == 1)
+    {
+      w->n_elts = crypto_sw_scheduler_claim_next (q, cm->chunk_size, &w->pos,
+						  &start);
+      if (!w->n_elts)
+	return 0;
+
+      w->queue = q;
+      w->start = start;
+      w->frame = q->jobs[w->pos & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
+      ptd->n_chunks_split++;
+      return 1;
+    }
 
-	      if (found || i == ptd->last_serve_lcore_id)
-		{
-		  CLIB_MEMORY_STORE_BARRIER ();
-		  ptd->last_serve_encrypt = !ptd->last_serve_encrypt;
-		  break;
-		}
+  vec_reset_length (ptd->stolen);
+  ptd->stolen_index = 0;
+  n_steal = n_max / 2;
+  pos = __atomic_load_n (&q->claim, __ATOMIC_RELAXED);
 
-	      i++;
-	    }
+  for (; n_steal && (i32) (q->head - pos) > 0; pos++)
+    {
+      n = crypto_sw_scheduler_claim (q, pos, VNET_CRYPTO_FRAME_SIZE, &start);
+      crypto_sw_scheduler_claimed (q, pos);
+      if (!n)
+	continue;
+
+      vec_add2 (ptd->stolen, sw, 1);
+      sw->queue = q;
+      sw->pos = pos;
+      sw->start = start;
+      sw->n_elts = n;
+      sw->frame = q->jobs[pos & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
+      n_steal--;
+    }
 
-	  ptd->last_serve_lcore_id = i;
-	}
+  if (vec_len (ptd->stolen) == 0)
+    return 0;
 
-      if (found)
-	{
-	  u32 crypto_op, auth_op_or_aad_len;
-	  u16 digest_len;
-	  u8 is_enc;
-	  int ret;
-
-	  ret = convert_async_crypto_id (
-	    f->op, &crypto_op, &auth_op_or_aad_len, &digest_len, &is_enc);
-
-	  if (ret == 1)
-	    crypto_sw_scheduler_process_aead (vm, ptd, f, crypto_op,
-					      auth_op_or_aad_len, digest_len);
-	  else if (ret == 0)
-	    crypto_sw_scheduler_process_link (vm, cm, ptd, f, crypto_op,
-					      auth_op_or_aad_len, digest_len,
-					      is_enc);
-
-	  *enqueue_thread_idx = f->enqueue_thread_index;
-	  *nb_elts_processed = f->n_elts;
-	}
+  ptd->n_steals++;
+  ptd->n_frames_stolen += vec_len (ptd->stolen);
+  *w = ptd->stolen[ptd->stolen_index++];
+  return 1;
+}
 
-      if (ptd->last_return_queue)
-	{
-	  current_queue = &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
-	  ptd->last_return_queue = 0;
-	}
-      else
+/* the next elts for the thread to process, its own frames first */
+static_always_inline int
+crypto_sw_scheduler_get_work (crypto_sw_scheduler_main_t *cm,
+			      crypto_sw_scheduler_per_thread_data_t *ptd,
+			      crypto_sw_scheduler_work_t *w)
+{
+  crypto_sw_scheduler_queue_t *q;
+  u32 t, start;
+
+  if (ptd->stolen_index < vec_len (ptd->stolen))
+    {
+      *w = ptd->stolen[ptd->stolen_index++];
+      return 1;
+    }
+
+  for (t = 0; t < CRYPTO_SW_SCHED_QUEUE_N_TYPES; t++)
+    {
+      ptd->last_serve_encrypt = !ptd->last_serve_encrypt;
+      q = &ptd->queue[ptd->last_serve_encrypt ?
+			CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT :
+			CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
+
+      w->n_elts =
+	crypto_sw_scheduler_claim_next (q, cm->chunk_size, &w->pos, &start);
+      if (w->n_elts)
 	{
-	  current_queue = &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT];
-	  ptd->last_return_queue = 1;
+	  w->queue = q;
+	  w->start = start;
+	  w->frame = q->jobs[w->pos & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
+	  ptd->n_chunks++;
+	  return 1;
 	}
+    }
 
-      tail = current_queue->tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK;
+  return crypto_sw_scheduler_steal (cm, ptd, w);
+}
 
-      if (current_queue->jobs[tail] &&
-	  current_queue->jobs[tail]->state >= VNET_CRYPTO_FRAME_STATE_SUCCESS)
-	{
+static_always_inline void
+crypto_sw_scheduler_process_work (vlib_main_t *vm,
+				  crypto_sw_scheduler_main_t *cm,
+				  crypto_sw_scheduler_per_thread_data_t *ptd,
+				  crypto_sw_scheduler_work_t *w)
+{
+  vnet_crypto_async_frame_t *f = w->frame;
+  crypto_sw_scheduler_slot_t *slot =
+    w->queue->slots + (w->pos & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
+  u32 crypto_op, auth_op_or_aad_len, i, n_elts = f->n_elts;
+  u8 state = VNET_CRYPTO_FRAME_STATE_ELT_ERROR;
+  u64 t0 = clib_cpu_time_now ();
+  u16 digest_len;
+  u8 is_enc;
+  int ret;
+
+  ret = convert_async_crypto_id (f->op, &crypto_op, &auth_op_or_aad_len,
+				 &digest_len, &is_enc);
+
+  if (ret == 1)
+    state = crypto_sw_scheduler_process_aead (
+      vm, ptd, f, w->start, w->n_elts, crypto_op, auth_op_or_aad_len,
+      digest_len);
+  else if (ret == 0)
+    state = crypto_sw_scheduler_process_link (
+      vm, cm, ptd, f, w->start, w->n_elts, crypto_op, auth_op_or_aad_len,
+      digest_len, is_enc);
+  else
+    for (i = w->start; i < w->start + w->n_elts; i++)
+      f->elts[i].status = VNET_CRYPTO_OP_STATUS_FAIL_ENGINE_ERR;
+
+  for (i = w->start; i < w->start + w->n_elts; i++)
+    ptd->n_bytes += f->elts[i].crypto_total_length;
+  ptd->n_elts += w->n_elts;
+  ptd->busy_clocks += clib_cpu_time_now () - t0;
+
+  if (state != VNET_CRYPTO_FRAME_STATE_SUCCESS)
+    __atomic_store_n (&slot->error, 1, __ATOMIC_RELAXED);
+
+  /* the owner may return the frame as soon as the state is set, which
+   * another thread may do once the elts are counted done, so the frame
+   * size is read before */
+  if (__atomic_add_fetch (&slot->n_done, w->n_elts, __ATOMIC_ACQ_REL) ==
+      n_elts)
+    __atomic_store_n (&f->state,
+		      slot->error ? VNET_CRYPTO_FRAME_STATE_ELT_ERROR :
+				    VNET_CRYPTO_FRAME_STATE_SUCCESS,
+		      __ATOMIC_RELEASE);
+}
 
-	  CLIB_MEMORY_STORE_BARRIER ();
-	  current_queue->tail++;
-	  f = current_queue->jobs[tail];
-	  current_queue->jobs[tail] = 0;
+static_always_inline vnet_crypto_async_frame_t *
+crypto_sw_scheduler_dequeue (vlib_main_t *vm, u32 *nb_elts_processed,
+			     u32 *enqueue_thread_idx)
+{
+  crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  crypto_sw_scheduler_per_thread_data_t *ptd =
+    cm->per_thread_data + vm->thread_index;
+  crypto_sw_scheduler_queue_t *current_queue = 0;
+  crypto_sw_scheduler_work_t w;
+  vnet_crypto_async_frame_t *f;
+  u32 tail;
+
+  /* process some pending elts, of this thread or another, and finish
+   * what was stolen before crypto was turned off on the thread */
+  if ((ptd->self_crypto_enabled ||
+       ptd->stolen_index < vec_len (ptd->stolen)) &&
+      crypto_sw_scheduler_get_work (cm, ptd, &w))
+    {
+      *enqueue_thread_idx = w.frame->enqueue_thread_index;
+      *nb_elts_processed = w.n_elts;
+      crypto_sw_scheduler_process_work (vm, cm, ptd, &w);
+    }
 
-	  return f;
-	}
+  if (ptd->last_return_queue)
+    {
+      current_queue = &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
+      ptd->last_return_queue = 0;
+    }
+  else
+    {
+      current_queue = &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT];
+      ptd->last_return_queue = 1;
+    }
+
+  tail = current_queue->tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK;
+
+  if (current_queue->jobs[tail] &&
+      __atomic_load_n (&current_queue->jobs[tail]->state, __ATOMIC_ACQUIRE) >=
+	VNET_CRYPTO_FRAME_STATE_SUCCESS)
+    {
+
+      CLIB_MEMORY_STORE_BARRIER ();
+      current_queue->tail++;
+      f = current_queue->jobs[tail];
+      current_queue->jobs[tail] = 0;
 
-      return 0;
+      return f;
     }
 
+  return 0;
+}
+
+int
+crypto_sw_scheduler_set_chunk_size (u32 chunk_size)
+{
+  crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+
+  if (chunk_size == 0 || chunk_size > VNET_CRYPTO_FRAME_SIZE)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  cm->chunk_size = chunk_size;
+  return 0;
+}
+
 static clib_error_t *
 sw_scheduler_set_worker_crypto (vlib_main_t * vm, unformat_input_t * input,
 				vlib_cli_command_t * cmd)
 {
   unformat_input_t _line_input, *line_input = &_line_input;
-  u32 worker_index;
+  u32 worker_index = ~0, chunk_size = ~0;
   u8 crypto_enable;
   int rv;
 
@@ -566,7 +777,9 @@ sw_scheduler_set_worker_crypto (vlib_main_t * vm, unformat_input_t * input,
 
   while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
     {
-      if (unformat (line_input, "worker %u", &worker_index))
+      if (unformat (line_input, "chunk-size %u", &chunk_size))
+	;
+      else if (unformat (line_input, "worker %u", &worker_index))
 	{
 	  if (unformat (line_input, "crypto"))
 	    {
@@ -588,6 +801,15 @@ sw_scheduler_set_worker_crypto (vlib_main_t * vm, unformat_input_t * input,
 				   format_unformat_error, line_input));
     }
 
+  if (chunk_size != ~0 &&
+      crypto_sw_scheduler_set_chunk_size (chunk_size) ==
+	VNET_API_ERROR_INVALID_VALUE)
+    return (clib_error_return (0, "chunk size 1 to %u please",
+			       VNET_CRYPTO_FRAME_SIZE));
+
+  if (worker_index == ~0)
+    return 0;
+
   rv = crypto_sw_scheduler_set_worker_crypto (worker_index, crypto_enable);
   if (rv == VNET_API_ERROR_INVALID_VALUE)
     {
@@ -601,17 +823,23 @@ sw_scheduler_set_worker_crypto (vlib_main_t * vm, unformat_input_t * input,
 }
 
 /*?
- * This command sets if worker will do crypto processing.
+ * This command sets if worker will do crypto processing, and how many
+ * elts of a frame are processed at a time: smaller chunks let more
+ * workers share a frame, larger ones cost less per elt.
  *
  * @cliexpar
  * Example of how to set worker crypto processing off:
  * @cliexstart{set sw_scheduler worker 0 crypto off}
  * @cliexend
+ * Example of how to process whole frames:
+ * @cliexstart{set sw_scheduler chunk-size 64}
+ * @cliexend
  ?*/
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (cmd_set_sw_scheduler_worker_crypto, static) = {
   .path = "set sw_scheduler",
-  .short_help = "set sw_scheduler worker <idx> crypto <on|off>",
+  .short_help = "set sw_scheduler [worker <idx> crypto <on|off>] "
+		"[chunk-size <n>]",
   .function = sw_scheduler_set_worker_crypto,
   .is_mp_safe = 1,
 };
@@ -622,26 +850,43 @@ sw_scheduler_show_workers (vlib_main_t * vm, unformat_input_t * input,
 			   vlib_cli_command_t * cmd)
 {
   crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  crypto_sw_scheduler_per_thread_data_t *ptd;
+  f64 busy;
   u32 i;
 
-  vlib_cli_output (vm, "%-7s%-20s%-8s", "ID", "Name", "Crypto");
+  vlib_cli_output (vm, "chunk size %u", cm->chunk_size);
+  vlib_cli_output (vm, "%-7s%-20s%-8s%12s%10s%12s%12s%10s%10s", "ID", "Name",
+		   "Crypto", "Elts", "Gbps", "Chunks", "Split", "Steals",
+		   "Stolen");
   for (i = 1; i < vlib_thread_main.n_vlib_mains; i++)
     {
-      vlib_cli_output (vm, "%-7d%-20s%-8s", vlib_get_worker_index (i),
+      ptd = cm->per_thread_data + i;
+      busy = ptd->busy_clocks / vm->clib_time.clocks_per_second;
+      vlib_cli_output (vm, "%-7d%-20s%-8s%12llu%10.2f%12llu%12llu%10llu%10llu",
+		       vlib_get_worker_index (i),
 		       (vlib_worker_threads + i)->name,
-		       cm->
-		       per_thread_data[i].self_crypto_enabled ? "on" : "off");
+		       ptd->self_crypto_enabled ? "on" : "off", ptd->n_elts,
+		       busy > 0 ? ptd->n_bytes * 8 / busy / 1e9 : 0.0,
+		       ptd->n_chunks, ptd->n_chunks_split, ptd->n_steals,
+		       ptd->n_frames_stolen);
     }
 
   return 0;
 }
 
 /*?
- * This command displays sw_scheduler workers.
+ * This command displays sw_scheduler workers, and the crypto each did:
+ * elts processed, throughput while processing them, chunks of its own
+ * frames and of the last frame of another worker, and how many times
+ * it took half of another worker's frames, and how many in all.
  *
  * @cliexpar
  * Example of how to show workers:
  * @cliexstart{show sw_scheduler workers}
+ * chunk size 16
+ * ID     Name                Crypto          Elts      Gbps      Chunks       Split    Steals    Stolen
+ * 0      vpp_wk_0            on           2046976      9.87      127936           0         0         0
+ * 1      vpp_wk_1            on           1535232     10.02          12       31210      1120      5372
  * @cliexend
  ?*/
 /* *INDENT-OFF* */
@@ -653,6 +898,37 @@ VLIB_CLI_COMMAND (cmd_show_sw_scheduler_workers, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+sw_scheduler_clear_counters (vlib_main_t *vm, unformat_input_t *input,
+			     vlib_cli_command_t *cmd)
+{
+  crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  crypto_sw_scheduler_per_thread_data_t *ptd;
+
+  vec_foreach (ptd, cm->per_thread_data)
+    {
+      ptd->n_elts = ptd->n_bytes = ptd->busy_clocks = 0;
+      ptd->n_chunks = ptd->n_chunks_split = 0;
+      ptd->n_steals = ptd->n_frames_stolen = 0;
+    }
+
+  return 0;
+}
+
+/*?
+ * This command clears the crypto counters of the sw_scheduler workers.
+ *
+ * @cliexpar
+ * @cliexstart{clear sw_scheduler counters}
+ * @cliexend
+ ?*/
+VLIB_CLI_COMMAND (cmd_clear_sw_scheduler_counters, static) = {
+  .path = "clear sw_scheduler counters",
+  .short_help = "clear sw_scheduler counters",
+  .function = sw_scheduler_clear_counters,
+  .is_mp_safe = 1,
+};
+
 clib_error_t *
 sw_scheduler_cli_init (vlib_main_t * vm)
 {
@@ -669,6 +945,7 @@ crypto_sw_scheduler_init (vlib_main_t * vm)
   vlib_thread_main_t *tm = vlib_get_thread_main ();
   clib_error_t *error = 0;
   crypto_sw_scheduler_per_thread_data_t *ptd;
+  u32 i, j;
 
   vec_validate_aligned (cm->per_thread_data, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
@@ -693,8 +970,23 @@ crypto_sw_scheduler_init (vlib_main_t * vm)
     vec_validate_aligned (ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT].jobs,
 			  CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
 			  CLIB_CACHE_LINE_BYTES);
+
+    for (i = 0; i < CRYPTO_SW_SCHED_QUEUE_N_TYPES; i++)
+      {
+	crypto_sw_scheduler_queue_t *q = &ptd->queue[i];
+
+	q->claim = 0;
+	vec_validate_aligned (q->slots, CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
+			      CLIB_CACHE_LINE_BYTES);
+	/* no frame at any position yet */
+	for (j = 0; j < CRYPTO_SW_SCHEDULER_QUEUE_SIZE; j++)
+	  q->slots[j].claim =
+	    CRYPTO_SW_SCHEDULER_CLAIM (j - CRYPTO_SW_SCHEDULER_QUEUE_SIZE, 0, 0);
+      }
   }
 
+  cm->chunk_size = CRYPTO_SW_SCHEDULER_CHUNK_SIZE;
+
   cm->crypto_engine_index =
     vnet_crypto_register_engine (vm, "sw_scheduler", 100,
 				 "SW Scheduler Async Engine");
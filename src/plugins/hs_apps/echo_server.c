@@ -47,6 +47,7 @@ typedef struct
   u64 private_segment_size;	/**< Size of private segments  */
   char *server_uri;		/**< Server URI */
   u32 tls_engine;		/**< TLS engine: mbedtls/openssl */
+  u8 ec_cert;			/**< Use the EC test cert, not RSA */
   u32 ckpair_index;		/**< Cert and key for tls/quic */
   u8 is_dgram;			/**< set if transport is dgram */
 
@@ -355,10 +356,20 @@ echo_server_attach (u8 * appns_id, u64 appns_flags, u64 appns_secret)
   vec_free (a->name);
 
   clib_memset (ck_pair, 0, sizeof (*ck_pair));
-  ck_pair->cert = (u8 *) test_srv_crt_rsa;
-  ck_pair->key = (u8 *) test_srv_key_rsa;
-  ck_pair->cert_len = test_srv_crt_rsa_len;
-  ck_pair->key_len = test_srv_key_rsa_len;
+  if (esm->ec_cert)
+    {
+      ck_pair->cert = (u8 *) test_srv_crt_ec;
+      ck_pair->key = (u8 *) test_srv_key_ec;
+      ck_pair->cert_len = test_srv_crt_ec_len;
+      ck_pair->key_len = test_srv_key_ec_len;
+    }
+  else
+    {
+      ck_pair->cert = (u8 *) test_srv_crt_rsa;
+      ck_pair->key = (u8 *) test_srv_key_rsa;
+      ck_pair->cert_len = test_srv_crt_rsa_len;
+      ck_pair->key_len = test_srv_key_rsa_len;
+    }
   vnet_app_add_cert_key_pair (ck_pair);
   esm->ckpair_index = ck_pair->index;
 
@@ -474,6 +485,7 @@ echo_server_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
   esm->private_segment_count = 0;
   esm->private_segment_size = 512 << 20;
   esm->tls_engine = CRYPTO_ENGINE_OPENSSL;
+  esm->ec_cert = 0;
   vec_free (esm->server_uri);
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
@@ -509,6 +521,8 @@ echo_server_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	is_stop = 1;
       else if (unformat (input, "tls-engine %d", &esm->tls_engine))
 	;
+      else if (unformat (input, "ec-cert"))
+	esm->ec_cert = 1;
       else
 	{
 	  error = clib_error_return (0, "failed: unknown input `%U'",
@@ -572,7 +586,7 @@ VLIB_CLI_COMMAND (echo_server_create_command, static) =
   .short_help = "test echo server proto <proto> [no echo][fifo-size <mbytes>]"
       "[rcv-buf-size <bytes>][prealloc-fifos <count>]"
       "[private-segment-count <count>][private-segment-size <bytes[m|g]>]"
-      "[uri <tcp://ip/port>]",
+      "[uri <tcp://ip/port>][ec-cert]",
   .function = echo_server_create_command_fn,
 };
 /* *INDENT-ON* */
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2026 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Relays each connection it accepts to a server, moving the data both
+ * ways with splice () or, with -f, sendfile (). Under ldp this moves it
+ * fifo to fifo between the two sessions, never through a user buffer.
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/epoll.h>
+#include <hs_apps/vcl/sock_test.h>
+
+#define SOCK_SPLICE_MAX_CONN	     32
+#define SOCK_SPLICE_MAX_EPOLL_EVENTS 16
+#define SOCK_SPLICE_MAX_BYTES	     (1 << 20)
+
+typedef struct
+{
+  int fd;
+  /* where what is read from fd goes */
+  int peer_fd;
+  uint64_t bytes;
+} sock_splice_end_t;
+
+typedef struct
+{
+  int listen_fd;
+  int epfd;
+  int use_sendfile;
+  struct sockaddr_in server_addr;
+  /* the client and server ends of each relayed connection */
+  sock_splice_end_t ends[2 * SOCK_SPLICE_MAX_CONN];
+  struct epoll_event wait_events[SOCK_SPLICE_MAX_EPOLL_EVENTS];
+} sock_splice_main_t;
+
+sock_splice_main_t sock_splice_main;
+
+static void
+print_usage_and_exit (void)
+{
+  fprintf (stderr,
+	   "sock_test_splice [OPTIONS] <port> <server ip> <server port>\n"
+	   "  OPTIONS\n"
+	   "  -h               Print this message and exit.\n"
+	   "  -f               Use sendfile () rather than splice ()\n");
+  exit (1);
+}
+
+static void
+ssp_end_add (sock_splice_end_t *end, int fd, int peer_fd)
+{
+  sock_splice_main_t *ssp = &sock_splice_main;
+  struct epoll_event ev = { .events = EPOLLIN };
+
+  end->fd = fd;
+  end->peer_fd = peer_fd;
+  end->bytes = 0;
+
+  if (fcntl (fd, F_SETFL, O_NONBLOCK) < 0)
+    stfail ("ssp_end_add() fcntl()");
+
+  ev.data.u32 = end - ssp->ends;
+  if (epoll_ctl (ssp->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    stfail ("ssp_end_add() epoll_ctl()");
+}
+
+static void
+ssp_new_client (void)
+{
+  sock_splice_main_t *ssp = &sock_splice_main;
+  int client_fd, server_fd, i;
+
+  client_fd = accept (ssp->listen_fd, 0, 0);
+  if (client_fd < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+	stfail ("ssp_new_client() accept()");
+      return;
+    }
+
+  for (i = 0; i < SOCK_SPLICE_MAX_CONN; i++)
+    if (!ssp->ends[2 * i].fd)
+      break;
+
+  if (i == SOCK_SPLICE_MAX_CONN)
+    {
+      stwrn ("too many connections, closing fd %d", client_fd);
+      close (client_fd);
+      return;
+    }
+
+  server_fd = socket (AF_INET, SOCK_STREAM, 0);
+  if (server_fd < 0)
+    stfail ("ssp_new_client() socket()");
+
+  if (connect (server_fd, (struct sockaddr *) &ssp->server_addr,
+	       sizeof (ssp->server_addr)) < 0)
+    stfail ("ssp_new_client() connect()");
+
+  ssp_end_add (&ssp->ends[2 * i], client_fd, server_fd);
+  ssp_end_add (&ssp->ends[2 * i + 1], server_fd, client_fd);
+}
+
+static void
+ssp_close (int conn_index)
+{
+  sock_splice_main_t *ssp = &sock_splice_main;
+  sock_splice_end_t *client = &ssp->ends[2 * conn_index];
+  sock_splice_end_t *server = client + 1;
+
+  stinf ("connection %d: %lu bytes to the server, %lu back", conn_index,
+	 client->bytes, server->bytes);
+
+  close (client->fd);
+  close (server->fd);
+  memset (client, 0, 2 * sizeof (*client));
+}
+
+/* move what can be moved without blocking */
+static void
+ssp_relay (sock_splice_end_t *end)
+{
+  sock_splice_main_t *ssp = &sock_splice_main;
+  ssize_t n;
+
+  while (1)
+    {
+      if (ssp->use_sendfile)
+	n = sendfile (end->peer_fd, end->fd, 0, SOCK_SPLICE_MAX_BYTES);
+      else
+	n = splice (end->fd, 0, end->peer_fd, 0, SOCK_SPLICE_MAX_BYTES,
+		    SPLICE_F_NONBLOCK);
+
+      if (n > 0)
+	{
+	  end->bytes += n;
+	  continue;
+	}
+
+      /* the input is empty or the output full, the level triggered
+       * epoll comes back while there is something to read */
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	return;
+
+      if (n < 0 && errno != ECONNRESET && errno != EPIPE)
+	stfail ("ssp_relay()");
+
+      ssp_close ((end - ssp->ends) / 2);
+      return;
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  sock_splice_main_t *ssp = &sock_splice_main;
+  struct sockaddr_in addr = { .sin_family = AF_INET };
+  struct epoll_event ev = { .events = EPOLLIN, .data.u32 = ~0 };
+  int c, i, v, num_ev;
+
+  opterr = 0;
+  while ((c = getopt (argc, argv, "f")) != -1)
+    switch (c)
+      {
+      case 'f':
+	ssp->use_sendfile = 1;
+	break;
+
+      case '?':
+	if (isprint (optopt))
+	  stinf ("ERROR: Unknown option `-%c'", optopt);
+	else
+	  stinf ("ERROR: Unknown option character `\\x%x'.\n", optopt);
+	/* fall thru */
+      case 'h':
+      default:
+	print_usage_and_exit ();
+      }
+
+  if (argc < (optind + 3))
+    {
+      stinf ("ERROR: Insufficient number of arguments!\n");
+      print_usage_and_exit ();
+    }
+
+  if (sscanf (argv[optind], "%d", &v) != 1)
+    {
+      stinf ("ERROR: Invalid port (%s)!\n", argv[optind]);
+      print_usage_and_exit ();
+    }
+  addr.sin_port = htons (v);
+
+  ssp->server_addr.sin_family = AF_INET;
+  if (inet_pton (AF_INET, argv[optind + 1], &ssp->server_addr.sin_addr) != 1
+      || sscanf (argv[optind + 2], "%d", &v) != 1)
+    {
+      stinf ("ERROR: Invalid server address (%s %s)!\n", argv[optind + 1],
+	     argv[optind + 2]);
+      print_usage_and_exit ();
+    }
+  ssp->server_addr.sin_port = htons (v);
+
+  ssp->listen_fd = socket (AF_INET, SOCK_STREAM, 0);
+  if (ssp->listen_fd < 0)
+    stfail ("main socket()");
+
+  addr.sin_addr.s_addr = htonl (INADDR_ANY);
+  if (bind (ssp->listen_fd, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+    stfail ("main bind()");
+
+  if (fcntl (ssp->listen_fd, F_SETFL, O_NONBLOCK) < 0)
+    stfail ("main fcntl()");
+
+  if (listen (ssp->listen_fd, 10) < 0)
+    stfail ("main listen()");
+
+  ssp->epfd = epoll_create (1);
+  if (ssp->epfd < 0)
+    stfail ("main epoll_create()");
+
+  if (epoll_ctl (ssp->epfd, EPOLL_CTL_ADD, ssp->listen_fd, &ev) < 0)
+    stfail ("main epoll_ctl()");
+
+  stinf ("Relaying port %d to %s:%s with %s...\n", ntohs (addr.sin_port),
+	 argv[optind + 1], argv[optind + 2],
+	 ssp->use_sendfile ? "sendfile" : "splice");
+
+  while (1)
+    {
+      num_ev = epoll_wait (ssp->epfd, ssp->wait_events,
+			   SOCK_SPLICE_MAX_EPOLL_EVENTS, 60000);
+      if (num_ev < 0)
+	stfail ("main epoll_wait()");
+
+      for (i = 0; i < num_ev; i++)
+	{
+	  if (ssp->wait_events[i].data.u32 == ~0)
+	    {
+	      ssp_new_client ();
+	      continue;
+	    }
+
+	  /* closed along with the other end earlier in this batch */
+	  if (!ssp->ends[ssp->wait_events[i].data.u32].fd)
+	    continue;
+
+	  ssp_relay (&ssp->ends[ssp->wait_events[i].data.u32]);
+	}
+    }
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -347,6 +347,7 @@ static void vl_api_lb_add_del_intf_nat6_t_handler
 static clib_error_t * lb_api_init (vlib_main_t * vm)
 {
   lb_main_t * lbm = &lb_main;
+  api_main_t *am = vlibapi_get_main ();
 
   lbm->vlib_main = vm;
   lbm->vnet_main = vnet_get_main();
@@ -354,6 +355,9 @@ static clib_error_t * lb_api_init (vlib_main_t * vm)
   /* Ask for a correctly-sized block of API message decode slots */
   lbm->msg_id_base = setup_message_id_table ();
 
+  /* takes the barrier itself, only while it changes the ASs */
+  am->is_mp_safe[lbm->msg_id_base + VL_API_LB_ADD_DEL_AS] = 1;
+
   return 0;
 }
 
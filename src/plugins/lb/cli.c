@@ -295,6 +295,7 @@ VLIB_CLI_COMMAND (lb_as_command, static) =
   .short_help = "lb as <vip-prefix> [protocol (tcp|udp) port <n>]"
       " [<address> [<address> [...]]] [del] [flush]",
   .function = lb_as_command_fn,
+  .is_mp_safe = 1,
 };
 
 static clib_error_t *
@@ -308,6 +309,7 @@ lb_conf_command_fn (vlib_main_t * vm,
   u32 per_cpu_sticky_buckets = lbm->per_cpu_sticky_buckets;
   u32 per_cpu_sticky_buckets_log2 = 0;
   u32 flow_timeout = lbm->flow_timeout;
+  u8 sticky_shared = lbm->sticky_shared;
   int ret;
   clib_error_t *error = 0;
 
@@ -328,6 +330,10 @@ lb_conf_command_fn (vlib_main_t * vm,
       per_cpu_sticky_buckets = 1 << per_cpu_sticky_buckets_log2;
     } else if (unformat(line_input, "timeout %d", &flow_timeout))
       ;
+    else if (unformat(line_input, "sticky-table shared"))
+      sticky_shared = 1;
+    else if (unformat(line_input, "sticky-table per-cpu"))
+      sticky_shared = 0;
     else {
       error = clib_error_return (0, "parse error: '%U'",
                                  format_unformat_error, line_input);
@@ -342,6 +348,11 @@ lb_conf_command_fn (vlib_main_t * vm,
     goto done;
   }
 
+  if ((ret = lb_conf_sticky_table(sticky_shared))) {
+    error = clib_error_return (0, "lb_conf_sticky_table error %d", ret);
+    goto done;
+  }
+
 done:
   unformat_free (line_input);
 
@@ -351,7 +362,7 @@ done:
 VLIB_CLI_COMMAND (lb_conf_command, static) =
 {
   .path = "lb conf",
-  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>]",
+  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>] [sticky-table (shared|per-cpu)]",
   .function = lb_conf_command_fn,
 };
 
@@ -108,6 +108,13 @@ u8 *format_lb_main (u8 * s, va_list * args)
   s = format(s, " #vips: %u\n", pool_elts(lbm->vips));
   s = format(s, " #ass: %u\n", pool_elts(lbm->ass) - 1);
 
+  if (lbm->shared_sticky_ht) {
+    lb_shared_hash_t *h = lbm->shared_sticky_ht;
+    s = format(s, "shared sticky table\n");
+    s = format(s, "  timeout: %ds\n", h->timeout);
+    s = format(s, "  usage: %d / %d\n", lb_shared_hash_elts(h, lb_hash_time_now(vlib_get_main())), lb_hash_size(h));
+  }
+
   u32 thread_index;
   for(thread_index = 0; thread_index < tm->n_vlib_mains; thread_index++ ) {
     lb_hash_t *h = lbm->per_cpu[thread_index].sticky_ht;
@@ -242,6 +249,10 @@ u8 *format_lb_vip_detailed (u8 * s, va_list * args)
                vlib_get_simple_counter(&lbm->vip_counters[i], vip - lbm->vips));
 
 
+  s = format(s, "%U  last update: %u entries changed in %.2fus\n",
+             format_white_space, indent,
+             vip->last_update_n_changed, vip->last_update_duration * 1e6);
+
   s = format(s, "%U  #as:%u\n",
              format_white_space, indent,
              pool_elts(vip->as_indexes));
@@ -358,6 +369,7 @@ void lb_garbage_collection()
 {
   lb_main_t *lbm = &lb_main;
   lb_get_writer_lock();
+  vlib_worker_thread_barrier_sync (vlib_get_main ());
   lb_vip_t *vip;
   u32 *to_be_removed_vips = 0, *i;
   pool_foreach (vip, lbm->vips) {
@@ -376,6 +388,7 @@ void lb_garbage_collection()
   }
 
   vec_free(to_be_removed_vips);
+  vlib_worker_thread_barrier_release (vlib_get_main ());
   lb_put_writer_lock();
 }
 
@@ -387,6 +400,7 @@ static void lb_vip_update_new_flow_table(lb_vip_t *vip)
   lb_new_flow_entry_t *new_flow_table = 0;
   lb_as_t *as;
   lb_pseudorand_t *pr, *sort_arr = 0;
+  f64 start = vlib_time_now(vlib_get_main());
 
   CLIB_SPINLOCK_ASSERT_LOCKED (&lbm->writer_lock); // We must have the lock
 
@@ -468,9 +482,56 @@ out:
 finished:
   vec_free(sort_arr);
 
+  /*
+   * Workers keep using the table while it is updated, adding and
+   * removing ASs doesn't hold the barrier for it. When its size is
+   * unchanged, only the entries whose AS changed are rewritten, each
+   * with a single store, so no entry is ever invalid. Otherwise the new
+   * table is swapped in and the old one freed once no worker can still
+   * be reading it.
+   */
   old_table = vip->new_flow_table;
-  vip->new_flow_table = new_flow_table;
-  vec_free(old_table);
+  vip->last_update_n_changed = 0;
+  if (old_table && vec_len(old_table) == vec_len(new_flow_table)) {
+    for (i = 0; i < vec_len(new_flow_table); i++)
+      if (old_table[i].as_index != new_flow_table[i].as_index) {
+        clib_atomic_store_relax_n(&old_table[i].as_index,
+                                  new_flow_table[i].as_index);
+        vip->last_update_n_changed++;
+      }
+    vec_free(new_flow_table);
+  } else {
+    vip->last_update_n_changed = vec_len(new_flow_table);
+    clib_atomic_store_rel_n(&vip->new_flow_table, new_flow_table);
+    vlib_rcu_vec_free(old_table);
+  }
+  vip->last_update_duration = vlib_time_now(vlib_get_main()) - start;
+}
+
+/**
+ * (Re)create the shared sticky table when it is enabled and the
+ * configured size changed. Workers use the table without taking any
+ * lock, so this is called with them stopped at the barrier, as the
+ * configuration commands are.
+ */
+static void lb_shared_sticky_table_update(void)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_shared_hash_t *h = lbm->shared_sticky_ht;
+  u32 buckets = lbm->per_cpu_sticky_buckets *
+      max_pow2(clib_max(vlib_num_workers(), 1));
+
+  if (h && (!lbm->sticky_shared || lb_hash_nbuckets(h) != buckets)) {
+    lb_flush_vip_as(~0, ~0);
+    lb_shared_hash_free(h);
+    lbm->shared_sticky_ht = h = NULL;
+  }
+
+  if (lbm->sticky_shared && h == NULL)
+    lbm->shared_sticky_ht = lb_shared_hash_alloc(buckets, lbm->flow_timeout);
+
+  if (lbm->shared_sticky_ht)
+    lbm->shared_sticky_ht->timeout = lbm->flow_timeout;
 }
 
 int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
@@ -486,6 +547,21 @@ int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
   lbm->ip6_src_address = *ip6_address;
   lbm->per_cpu_sticky_buckets = per_cpu_sticky_buckets;
   lbm->flow_timeout = flow_timeout;
+  lb_shared_sticky_table_update();
+  lb_put_writer_lock();
+  return 0;
+}
+
+int lb_conf_sticky_table(u8 shared)
+{
+  lb_main_t *lbm = &lb_main;
+
+  lb_get_writer_lock();
+  if (lbm->sticky_shared != shared) {
+    lb_flush_vip_as(~0, ~0);
+    lbm->sticky_shared = shared;
+    lb_shared_sticky_table_update();
+  }
   lb_put_writer_lock();
   return 0;
 }
@@ -634,6 +710,13 @@ next:
     continue;
   }
 
+  /*
+   * Workers index the AS pool and the FIB, so those change under the
+   * barrier. The flow table is recomputed and applied after it, see
+   * lb_vip_update_new_flow_table().
+   */
+  vlib_worker_thread_barrier_sync (vlib_get_main ());
+
   //Update reused ASs
   vec_foreach(ip, to_be_updated) {
     lbm->ass[*ip].flags = LB_AS_FLAGS_USED;
@@ -748,12 +831,14 @@ next:
   }
   vec_free(to_be_added);
 
-  //Recompute flows
-  lb_vip_update_new_flow_table(vip);
-
   //Garbage collection maybe
   lb_vip_garbage_collection(vip);
 
+  vlib_worker_thread_barrier_release (vlib_get_main ());
+
+  //Recompute flows
+  lb_vip_update_new_flow_table(vip);
+
   lb_put_writer_lock();
   return 0;
 }
@@ -790,6 +875,36 @@ lb_flush_vip_as (u32 vip_index, u32 as_index)
       }
     }
 
+  if (lbm->shared_sticky_ht != NULL) {
+      lb_shared_hash_t *h = lbm->shared_sticky_ht;
+      lb_shared_hash_bucket_t *b;
+      u32 i, vip, as;
+      u64 k, v;
+
+      lb_shared_hash_foreach_entry(h, b, i) {
+        k = clib_atomic_load_acq_n (&b->key[i]);
+        vip = k >> 32;
+        if (k == LB_SHARED_HASH_KEY_BUSY)
+          continue;
+        if ((vip_index != ~0) && (vip != vip_index))
+          continue;
+        v = clib_atomic_load_relax_n (&b->value[i]);
+        if ((vip_index != ~0) && (as_index != ~0) &&
+            (lb_shared_hash_value_as(v) != as_index))
+          continue;
+        /* claim it as a writer would, a worker may be using it */
+        if (!clib_atomic_bool_cmp_and_swap (&b->key[i], k,
+                                            LB_SHARED_HASH_KEY_BUSY))
+          continue;
+        v = clib_atomic_load_relax_n (&b->value[i]);
+        as = lb_shared_hash_value_as(v);
+        vlib_refcount_add(&lbm->as_refcount, 0, as, -1);
+        vlib_refcount_add(&lbm->as_refcount, 0, 0, 1);
+        clib_atomic_store_rel_n (&b->value[i], 0);
+        clib_atomic_store_rel_n (&b->key[i], LB_SHARED_HASH_KEY (~0, 0));
+      }
+    }
+
   return 0;
 }
 
@@ -827,6 +942,8 @@ next:
   continue;
   }
 
+  vlib_worker_thread_barrier_sync (vlib_get_main ());
+
   //Garbage collection maybe
   lb_vip_garbage_collection(vip);
 
@@ -841,10 +958,16 @@ next:
           lb_flush_vip_as(vip_index, *ip);
         }
     }
+  }
+
+  vlib_worker_thread_barrier_release (vlib_get_main ());
 
-    //Recompute flows
+  /*
+   * A deleted AS keeps getting new flows until the update is applied,
+   * it is not reclaimed before LB_CONCURRENCY_TIMEOUT anyway
+   */
+  if (indexes != NULL)
     lb_vip_update_new_flow_table(vip);
-  }
 
   vec_free(indexes);
   return 0;
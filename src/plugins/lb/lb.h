@@ -280,6 +280,13 @@ typedef struct {
    */
   u32 last_garbage_collection;
 
+  /**
+   * Number of new flow table entries the last update changed,
+   * and how long it took to compute and apply.
+   */
+  u32 last_update_n_changed;
+  f64 last_update_duration;
+
   //Not runtime
 
   /**
@@ -521,6 +528,14 @@ typedef struct {
    */
   u32 per_cpu_sticky_buckets;
 
+  /**
+   * Use one sticky table shared by all workers instead of the
+   * per-cpu ones, so flows keep their AS when they move between
+   * workers. It is sized per_cpu_sticky_buckets per worker.
+   */
+  u8 sticky_shared;
+  lb_shared_hash_t *shared_sticky_ht;
+
   /**
    * Flow timeout in seconds.
    */
@@ -599,6 +614,14 @@ extern vlib_node_registration_t lb_nat6_in2out_node;
 int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
             u32 sticky_buckets, u32 flow_timeout);
 
+/**
+ * Select the per-cpu sticky tables or a single shared one.
+ * Flows tracked by the tables in use are flushed when this changes.
+ * @param shared 1 for a sticky table shared by all workers
+ * @return 0 on success. VNET_LB_ERR_XXX on error
+ */
+int lb_conf_sticky_table(u8 shared);
+
 int lb_vip_add(lb_vip_add_args_t args, u32 *vip_index);
 
 int lb_vip_del(u32 vip_index);
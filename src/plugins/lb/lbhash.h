@@ -194,4 +194,165 @@ u32 lb_hash_elts(lb_hash_t *h, u32 time_now)
   return tot;
 }
 
+/*
+ * Shared sticky table.
+ *
+ * One table for all workers, so that a flow keeps its AS when it moves
+ * to another worker (RSS rebalancing, worker added...).
+ * Readers are lock-free and writers use CAS. Each entry is made of
+ * two 64 bits words which are individually atomic:
+ *   key   = vip << 32 | hash
+ *   value = timeout << 32 | as_index
+ * A writer claims an expired entry by swapping its key to a key no
+ * lookup can match, then writes the value and releases the new key.
+ * A reader checks the key again after loading the value, so it never
+ * returns a value together with a key it does not belong to.
+ */
+
+#define LB_SHARED_HASH_KEY(vip, hash) (((u64) (vip) << 32) | (hash))
+#define LB_SHARED_HASH_VALUE(timeout, as) (((u64) (timeout) << 32) | (as))
+#define lb_shared_hash_value_timeout(v) ((u32) ((v) >> 32))
+#define lb_shared_hash_value_as(v) ((u32) (v))
+
+/* Key of an entry being written, vip ~0 is never looked up */
+#define LB_SHARED_HASH_KEY_BUSY LB_SHARED_HASH_KEY (~0, ~0)
+
+/*
+ * @brief One bucket contains 4 entries.
+ * Each bucket takes one 64B cache line in memory.
+ */
+typedef struct {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u64 key[LBHASH_ENTRY_PER_BUCKET];
+  u64 value[LBHASH_ENTRY_PER_BUCKET];
+} lb_shared_hash_bucket_t;
+
+typedef struct {
+  u32 buckets_mask;
+  u32 timeout;
+  lb_shared_hash_bucket_t buckets[];
+} lb_shared_hash_t;
+
+#define lb_shared_hash_foreach_entry(h, bucket, i) \
+  for (bucket = (h)->buckets; \
+       bucket < (h)->buckets + lb_hash_nbuckets(h); \
+       bucket++) \
+    for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++)
+
+static_always_inline
+lb_shared_hash_t *lb_shared_hash_alloc(u32 buckets, u32 timeout)
+{
+  if (!is_pow2(buckets))
+    return NULL;
+
+  // Allocate 1 more bucket for prefetch
+  u32 size = ((uword)&((lb_shared_hash_t *)(0))->buckets[0]) +
+      sizeof(lb_shared_hash_bucket_t) * (buckets + 1);
+  u8 *mem = 0;
+  lb_shared_hash_t *h;
+  vec_alloc_aligned(mem, size, CLIB_CACHE_LINE_BYTES);
+  clib_memset(mem, 0, size);
+  h = (lb_shared_hash_t *)mem;
+  h->buckets_mask = (buckets - 1);
+  h->timeout = timeout;
+  return h;
+}
+
+static_always_inline
+void lb_shared_hash_free(lb_shared_hash_t *h)
+{
+  u8 *mem = (u8 *)h;
+  vec_free(mem);
+}
+
+static_always_inline
+void lb_shared_hash_prefetch_bucket(lb_shared_hash_t *ht, u32 hash)
+{
+  lb_shared_hash_bucket_t *bucket = &ht->buckets[hash & ht->buckets_mask];
+  CLIB_PREFETCH(bucket, sizeof(*bucket), READ);
+}
+
+/*
+ * Same contract as lb_hash_get: found_value is the AS of the flow or 0,
+ * available_index an expired entry the flow could be put in, or ~0.
+ * The timeout of a found entry is refreshed at most once per second.
+ */
+static_always_inline
+void lb_shared_hash_get(lb_shared_hash_t *ht, u32 hash, u32 vip, u32 time_now,
+			u32 *available_index, u32 *found_value)
+{
+  lb_shared_hash_bucket_t *bucket = &ht->buckets[hash & ht->buckets_mask];
+  u64 key = LB_SHARED_HASH_KEY (vip, hash);
+  u64 k, v;
+  u32 i;
+
+  *found_value = 0;
+  *available_index = ~0;
+
+  for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++) {
+      k = clib_atomic_load_acq_n (&bucket->key[i]);
+      v = clib_atomic_load_acq_n (&bucket->value[i]);
+      if (clib_u32_loop_gt(time_now, lb_shared_hash_value_timeout(v))) {
+	  if (*available_index == ~0)
+	    *available_index = i;
+	  continue;
+      }
+      if (k != key || clib_atomic_load_relax_n (&bucket->key[i]) != key)
+	continue;
+
+      *found_value = lb_shared_hash_value_as(v);
+      if (lb_shared_hash_value_timeout(v) != time_now + ht->timeout)
+	/* a failure means someone else just wrote it */
+	clib_atomic_bool_cmp_and_swap (&bucket->value[i], v,
+	    LB_SHARED_HASH_VALUE (time_now + ht->timeout, *found_value));
+      return;
+  }
+}
+
+/*
+ * Put a flow in the entry returned by lb_shared_hash_get.
+ * Returns 0 when another worker took the entry in the meantime, else 1
+ * with the AS the entry previously held in old_value.
+ */
+static_always_inline
+int lb_shared_hash_put(lb_shared_hash_t *h, u32 hash, u32 value, u32 vip,
+		       u32 available_index, u32 time_now, u32 *old_value)
+{
+  lb_shared_hash_bucket_t *bucket = &h->buckets[hash & h->buckets_mask];
+  u64 k, v;
+
+  k = clib_atomic_load_acq_n (&bucket->key[available_index]);
+  v = clib_atomic_load_relax_n (&bucket->value[available_index]);
+  if (k == LB_SHARED_HASH_KEY_BUSY ||
+      !clib_u32_loop_gt(time_now, lb_shared_hash_value_timeout(v)))
+    return 0;
+
+  if (!clib_atomic_bool_cmp_and_swap (&bucket->key[available_index], k,
+				      LB_SHARED_HASH_KEY_BUSY))
+    return 0;
+
+  /* only a stale timeout refresh may have changed it, not the AS */
+  v = clib_atomic_load_relax_n (&bucket->value[available_index]);
+  *old_value = lb_shared_hash_value_as(v);
+  clib_atomic_store_rel_n (&bucket->value[available_index],
+			   LB_SHARED_HASH_VALUE (time_now + h->timeout, value));
+  clib_atomic_store_rel_n (&bucket->key[available_index],
+			   LB_SHARED_HASH_KEY (vip, hash));
+  return 1;
+}
+
+static_always_inline
+u32 lb_shared_hash_elts(lb_shared_hash_t *h, u32 time_now)
+{
+  lb_shared_hash_bucket_t *bucket;
+  u32 i, tot = 0;
+
+  lb_shared_hash_foreach_entry(h, bucket, i) {
+    if (!clib_u32_loop_gt(time_now,
+			  lb_shared_hash_value_timeout(bucket->value[i])))
+      tot++;
+  }
+  return tot;
+}
+
 #endif /* LB_PLUGIN_LB_LBHASH_H_ */
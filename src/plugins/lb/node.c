@@ -264,7 +264,8 @@ lb_node_fn (vlib_main_t * vm,
   u32 thread_index = vm->thread_index;
   u32 lb_time = lb_hash_time_now (vm);
 
-  lb_hash_t *sticky_ht = lb_get_sticky_table (thread_index);
+  lb_shared_hash_t *shared_ht = lbm->shared_sticky_ht;
+  lb_hash_t *sticky_ht = shared_ht ? 0 : lb_get_sticky_table (thread_index);
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
   next_index = node->cached_next_index;
@@ -301,7 +302,10 @@ lb_node_fn (vlib_main_t * vm,
               lb_node_get_hash (lbm, p1, is_input_v4,
                                 &nexthash0, &next_vip_idx0,
                                 per_port_vip);
-              lb_hash_prefetch_bucket (sticky_ht, nexthash0);
+              if (shared_ht)
+                lb_shared_hash_prefetch_bucket (shared_ht, nexthash0);
+              else
+                lb_hash_prefetch_bucket (sticky_ht, nexthash0);
               //Prefetch for encap, next
               CLIB_PREFETCH(vlib_buffer_get_current (p1) - 64, 64, STORE);
             }
@@ -339,9 +343,14 @@ lb_node_fn (vlib_main_t * vm,
                   + sizeof(ip6_header_t);
             }
 
-          lb_hash_get (sticky_ht, hash0,
-                       vip_index0, lb_time,
-                       &available_index0, &asindex0);
+          if (shared_ht)
+            lb_shared_hash_get (shared_ht, hash0,
+                                vip_index0, lb_time,
+                                &available_index0, &asindex0);
+          else
+            lb_hash_get (sticky_ht, hash0,
+                         vip_index0, lb_time,
+                         &available_index0, &asindex0);
 
           if (PREDICT_TRUE(asindex0 != 0))
             {
@@ -359,19 +368,41 @@ lb_node_fn (vlib_main_t * vm,
               //TODO: There are race conditions with as0 and vip0 manipulation.
               //Configuration may be changed, vectors resized, etc...
 
-              //Dereference previously used
-              vlib_refcount_add (
-                  &lbm->as_refcount, thread_index,
-                  lb_hash_available_value (sticky_ht, hash0, available_index0),
-                  -1);
-              vlib_refcount_add (&lbm->as_refcount, thread_index, asindex0, 1);
-
-              //Add sticky entry
-              //Note that when there is no AS configured, an entry is configured anyway.
-              //But no configured AS is not something that should happen
-              lb_hash_put (sticky_ht, hash0, asindex0,
-                           vip_index0,
-                           available_index0, lb_time);
+              if (shared_ht)
+                {
+                  u32 old_asindex0;
+
+                  //Another worker may take the entry first
+                  if (lb_shared_hash_put (shared_ht, hash0, asindex0,
+                                          vip_index0, available_index0,
+                                          lb_time, &old_asindex0))
+                    {
+                      vlib_refcount_add (&lbm->as_refcount, thread_index,
+                                         old_asindex0, -1);
+                      vlib_refcount_add (&lbm->as_refcount, thread_index,
+                                         asindex0, 1);
+                    }
+                  else
+                    counter = LB_VIP_COUNTER_UNTRACKED_PACKET;
+                }
+              else
+                {
+                  //Dereference previously used
+                  vlib_refcount_add (
+                      &lbm->as_refcount, thread_index,
+                      lb_hash_available_value (sticky_ht, hash0,
+                                               available_index0),
+                      -1);
+                  vlib_refcount_add (&lbm->as_refcount, thread_index,
+                                     asindex0, 1);
+
+                  //Add sticky entry
+                  //Note that when there is no AS configured, an entry is configured anyway.
+                  //But no configured AS is not something that should happen
+                  lb_hash_put (sticky_ht, hash0, asindex0,
+                               vip_index0,
+                               available_index0, lb_time);
+                }
             }
           else
             {
@@ -37,6 +37,8 @@
 #include <nat/nat44-ed/nat44_ed.h>
 #include <nat/nat44-ed/nat44_ed_affinity.h>
 #include <nat/nat44-ed/nat44_ed_inlines.h>
+#include <nat/nat44-ed/nat44_ed_offload.h>
+#include <nat/nat44-ed/nat44_ed_expire.h>
 
 #include <vpp/stats/stat_segment.h>
 
@@ -2352,6 +2354,8 @@ nat_init (vlib_main_t * vm)
 			 FIB_SOURCE_BH_SIMPLE);
 
   nat_affinity_init (vm);
+  nat44_ed_offload_init (vm);
+  nat44_ed_expire_init (vm);
   test_key_calc_split ();
 
   return nat44_api_hookup (vm);
@@ -2425,6 +2429,9 @@ nat44_plugin_enable (nat44_config_t c)
   sm->enabled = 1;
   sm->rconfig = c;
 
+  nat44_ed_offload_enable ();
+  nat44_ed_expire_enable ();
+
   return 0;
 }
 
@@ -2575,6 +2582,8 @@ nat44_plugin_disable ()
   vec_free (sm->max_translations_per_fib);
   sm->max_translations_per_fib = 0;
 
+  nat44_ed_offload_flush ();
+
   clib_bihash_free_16_8 (&sm->flow_hash);
 
   vec_foreach (tsm, sm->per_thread_data)
@@ -2876,6 +2885,21 @@ nat44_ed_get_in2out_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 	    }
 	}
 
+      /* offloaded sessions are found by the flow mark */
+      if (PREDICT_FALSE (b->flow_id != 0))
+	{
+	  u32 session_index, thread_index;
+
+	  thread_index = nat44_ed_offload_handoff_thread (
+	    sm, b, ip, NAT44_ED_DIR_I2O, &session_index);
+	  if (thread_index != ~0)
+	    {
+	      next_worker_index = thread_index;
+	      vnet_buffer2 (b)->nat.cached_session_index = session_index;
+	      goto out;
+	    }
+	}
+
       if (PREDICT_FALSE (ip->protocol == IP_PROTOCOL_ICMP))
 	{
 	  ip4_address_t lookup_saddr, lookup_daddr;
@@ -2967,6 +2991,20 @@ nat44_ed_get_out2in_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 
   proto = ip->protocol;
 
+  /* offloaded sessions are found by the flow mark */
+  if (PREDICT_FALSE (b->flow_id != 0))
+    {
+      u32 session_index, thread_index;
+
+      thread_index = nat44_ed_offload_handoff_thread (
+	sm, b, ip, NAT44_ED_DIR_O2I, &session_index);
+      if (thread_index != ~0)
+	{
+	  vnet_buffer2 (b)->nat.cached_session_index = session_index;
+	  return thread_index;
+	}
+    }
+
   if (PREDICT_FALSE (IP_PROTOCOL_ICMP == proto))
     {
       ip4_address_t lookup_saddr, lookup_daddr;
@@ -3183,6 +3221,13 @@ nat44_ed_worker_db_init (snat_main_per_thread_data_t *tsm, u32 translations,
   pool_get (tsm->lru_pool, head);
   tsm->unk_proto_lru_head_index = head - tsm->lru_pool;
   clib_dlist_init (tsm->lru_pool, tsm->unk_proto_lru_head_index);
+
+  tw_timer_wheel_init_16t_2w_512sl (&tsm->expire_wheel, 0,
+				    NAT44_ED_EXPIRE_TICK,
+				    nat44_ed_expire_main.budget);
+  pool_alloc (tsm->expire_wheel.timers, translations);
+  /* not null, so that the wheel appends expired timers to it */
+  vec_alloc (tsm->expired_sessions, nat44_ed_expire_main.budget);
 }
 
 static void
@@ -3217,6 +3262,8 @@ nat44_ed_worker_db_free (snat_main_per_thread_data_t *tsm)
   pool_free (tsm->lru_pool);
   pool_free (tsm->sessions);
   vec_free (tsm->per_vrf_sessions_vec);
+  tw_timer_wheel_free_16t_2w_512sl (&tsm->expire_wheel);
+  vec_free (tsm->expired_sessions);
 }
 
 void
@@ -3225,6 +3272,7 @@ nat44_ed_sessions_clear ()
   snat_main_t *sm = &snat_main;
   snat_main_per_thread_data_t *tsm;
 
+  nat44_ed_offload_flush ();
   reinit_ed_flow_hash ();
 
   vec_foreach (tsm, sm->per_thread_data)
@@ -3234,6 +3282,7 @@ nat44_ed_sessions_clear ()
 			       sm->translation_buckets);
     }
   vlib_zero_simple_counter (&sm->total_sessions, 0);
+  nat44_ed_offload_enable ();
 }
 
 static void
@@ -30,6 +30,7 @@
 #include <vppinfra/bihash_16_8.h>
 #include <vppinfra/hash.h>
 #include <vppinfra/dlist.h>
+#include <vppinfra/tw_timer_16t_2w_512sl.h>
 #include <vppinfra/error.h>
 #include <vlibapi/api.h>
 
@@ -187,6 +188,8 @@ format_function_t format_nat44_ed_tcp_state;
 #define SNAT_SESSION_FLAG_AFFINITY	     (1 << 6)
 #define SNAT_SESSION_FLAG_EXACT_ADDRESS	     (1 << 7)
 #define SNAT_SESSION_FLAG_HAIRPINNING	     (1 << 8)
+#define SNAT_SESSION_FLAG_OFFLOAD_I2O	     (1 << 9)
+#define SNAT_SESSION_FLAG_OFFLOAD_O2I	     (1 << 10)
 
 /* NAT interface flags */
 #define NAT_INTERFACE_FLAG_IS_INSIDE 1
@@ -329,6 +332,9 @@ typedef CLIB_PACKED(struct
   u32 lru_index;
   f64 last_lru_update;
 
+  /* expiry timer handle in the thread timer wheel */
+  u32 expire_timer_handle;
+
   /* Last heard timer */
   f64 last_heard;
 
@@ -500,6 +506,12 @@ typedef struct
 
   per_vrf_sessions_t *per_vrf_sessions_vec;
 
+  /* Session expiry timer wheel, user id is the session index */
+  tw_timer_wheel_16t_2w_512sl_t expire_wheel;
+
+  /* Expired timers not yet processed by the expire node */
+  u32 *expired_sessions;
+
 } snat_main_per_thread_data_t;
 
 struct snat_main_s;
@@ -26,6 +26,8 @@
 #include <nat/nat44-ed/nat44_ed.h>
 #include <nat/nat44-ed/nat44_ed_inlines.h>
 #include <nat/nat44-ed/nat44_ed_affinity.h>
+#include <nat/nat44-ed/nat44_ed_offload.h>
+#include <nat/nat44-ed/nat44_ed_expire.h>
 
 #define NAT44_ED_EXPECTED_ARGUMENT "expected required argument(s)"
 
@@ -1676,6 +1678,96 @@ nat_show_timeouts_command_fn (vlib_main_t * vm,
   return 0;
 }
 
+static clib_error_t *
+nat44_offload_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			  vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  clib_error_t *error = 0;
+  u32 threshold = ~0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "threshold %u", &threshold))
+	;
+      else if (unformat (line_input, "disable"))
+	threshold = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (threshold == ~0)
+    {
+      error = clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+      goto done;
+    }
+
+  nat44_ed_offload_set_threshold (threshold);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+static clib_error_t *
+nat44_show_offload_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			       vlib_cli_command_t *cmd)
+{
+  vlib_cli_output (vm, "NAT44 session offload: %U", format_nat44_ed_offload);
+  return 0;
+}
+
+static clib_error_t *
+nat44_expire_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			 vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  clib_error_t *error = 0;
+  u32 budget = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "budget %u", &budget))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (!budget)
+    {
+      error = clib_error_return (0, "budget must be non-zero");
+      goto done;
+    }
+
+  nat44_ed_expire_set_budget (budget);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+static clib_error_t *
+nat44_show_expire_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			      vlib_cli_command_t *cmd)
+{
+  vlib_cli_output (vm, "NAT44 session expiry: %U", format_nat44_ed_expire);
+  return 0;
+}
+
 static clib_error_t *
 set_frame_queue_nelts_command_fn (vlib_main_t *vm, unformat_input_t *input,
 				  vlib_cli_command_t *cmd)
@@ -1795,6 +1887,77 @@ VLIB_CLI_COMMAND (nat_show_timeouts_command, static) = {
   .function = nat_show_timeouts_command_fn,
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 offload}
+ * Offload TCP and UDP sessions to the NIC once they have seen a number of
+ * packets. A flow rule marking the packets of each session direction is
+ * installed on the receiving interface, and marked packets are matched to
+ * their session without a lookup. Interfaces without flow support keep
+ * using the lookup. To offload sessions after 1000 packets use:
+ *  vpp# nat44 offload threshold 1000
+ * To remove the flow rules and stop offloading use:
+ *  vpp# nat44 offload disable
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_offload_command, static) = {
+  .path = "nat44 offload",
+  .short_help = "nat44 offload threshold <packets> | disable",
+  .function = nat44_offload_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat44 offload}
+ * Show NAT44 session offload configuration and counters.
+ * vpp# show nat44 offload
+ * NAT44 session offload: threshold 1000 packets, flow ids 1-64512
+ *                        installed flows: 2
+ *                        installs: 2 removals: 0 failures: 0 unsupported: 0
+ *                        mark hits: 4096
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_show_offload_command, static) = {
+  .path = "show nat44 offload",
+  .short_help = "show nat44 offload",
+  .function = nat44_show_offload_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 expire}
+ * Set the number of expired session timers each thread processes per
+ * dispatch of the nat44-ed-expire node. The rest are processed on the
+ * following dispatches. To process at most 64 per dispatch use:
+ *  vpp# nat44 expire budget 64
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_expire_command, static) = {
+  .path = "nat44 expire",
+  .short_help = "nat44 expire budget <sessions>",
+  .function = nat44_expire_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat44 expire}
+ * Show NAT44 session expiry timers, counters and the histogram of the
+ * time spent by the nat44-ed-expire node per dispatch.
+ * vpp# show nat44 expire
+ * NAT44 session expiry: budget 256 sessions per dispatch, tick 1.00s
+ *                       thread 0 vpp_main: timers 1000 backlog 0
+ *                       reclaimed: 4000 rearmed: 12
+ *                       reclaim latency:
+ *                                  4096ns -         8191ns: 3
+ *                                 65536ns -       131071ns: 16
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_show_expire_command, static) = {
+  .path = "show nat44 expire",
+  .short_help = "show nat44 expire",
+  .function = nat44_show_expire_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{set nat frame-queue-nelts}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 endpoint-dependent session expiry
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+
+#include <nat/nat44-ed/nat44_ed.h>
+#include <nat/nat44-ed/nat44_ed_inlines.h>
+#include <nat/nat44-ed/nat44_ed_expire.h>
+
+nat44_ed_expire_main_t nat44_ed_expire_main;
+
+/* interval between two interrupts of the expire node on each thread */
+#define NAT44_ED_EXPIRE_INTERVAL (NAT44_ED_EXPIRE_TICK / 10)
+
+typedef enum
+{
+  NAT44_ED_EXPIRE_EVENT_ENABLE = 1,
+} nat44_ed_expire_event_t;
+
+static_always_inline void
+nat44_ed_expire_session (snat_main_t *sm, snat_main_per_thread_data_t *tsm,
+			 u32 session_index, f64 now, u32 *n_reclaimed,
+			 u32 *n_rearmed)
+{
+  u32 thread_index = tsm - sm->per_thread_data;
+  snat_session_t *s;
+  f64 sess_timeout_time;
+
+  /* deleted since its timer expired, the index may have been reused */
+  if (pool_is_free_index (tsm->sessions, session_index))
+    return;
+  s = pool_elt_at_index (tsm->sessions, session_index);
+  if (s->expire_timer_handle != NAT44_ED_EXPIRE_TIMER_PENDING)
+    return;
+
+  sess_timeout_time = s->last_heard + (f64) nat44_session_get_timeout (sm, s);
+  if (now >= sess_timeout_time)
+    {
+      nat44_ed_free_session_data (sm, s, thread_index, 0);
+      nat_ed_session_delete (sm, s, thread_index, 1);
+      (*n_reclaimed)++;
+      return;
+    }
+
+  /* refreshed since the timer was started */
+  s->expire_timer_handle = tw_timer_start_16t_2w_512sl (
+    &tsm->expire_wheel, session_index, 0,
+    nat44_ed_expire_ticks (sess_timeout_time - now));
+  (*n_rearmed)++;
+}
+
+static uword
+nat44_ed_expire_node_fn (vlib_main_t *vm, vlib_node_runtime_t *node,
+			 vlib_frame_t *frame)
+{
+  nat44_ed_expire_main_t *em = &nat44_ed_expire_main;
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  u32 n_reclaimed = 0, n_rearmed = 0, n_left, n, *si, bucket;
+  snat_main_per_thread_data_t *tsm;
+  f64 now = vlib_time_now (vm);
+  u64 t0 = clib_cpu_time_now (), ns;
+  snat_session_t *s;
+
+  if (!sm->enabled || thread_index >= vec_len (sm->per_thread_data))
+    return 0;
+  tsm = &sm->per_thread_data[thread_index];
+
+  /* new expirations are taken once the backlog is done */
+  if (!vec_len (tsm->expired_sessions))
+    {
+      tsm->expired_sessions = tw_timer_expire_timers_vec_16t_2w_512sl (
+	&tsm->expire_wheel, now, tsm->expired_sessions);
+      vec_foreach (si, tsm->expired_sessions)
+	{
+	  s = pool_elt_at_index (tsm->sessions, si[0]);
+	  s->expire_timer_handle = NAT44_ED_EXPIRE_TIMER_PENDING;
+	}
+    }
+
+  n_left = vec_len (tsm->expired_sessions);
+  if (!n_left)
+    return 0;
+
+  n = clib_min (n_left, em->budget);
+  si = tsm->expired_sessions + n_left - n;
+  while (si < vec_end (tsm->expired_sessions))
+    {
+      nat44_ed_expire_session (sm, tsm, si[0], now, &n_reclaimed,
+			       &n_rearmed);
+      si++;
+    }
+  vec_set_len (tsm->expired_sessions, n_left - n);
+
+  /* the rest of the backlog is done on the next dispatch */
+  if (vec_len (tsm->expired_sessions))
+    vlib_node_set_interrupt_pending (vm, node->node_index);
+
+  vlib_increment_simple_counter (&em->reclaimed, thread_index, 0,
+				 n_reclaimed);
+  vlib_increment_simple_counter (&em->rearmed, thread_index, 0, n_rearmed);
+
+  ns = (clib_cpu_time_now () - t0) * vm->clib_time.seconds_per_clock * 1e9;
+  bucket = ns ? min_log2 (ns) : 0;
+  bucket = clib_min (bucket, NAT44_ED_EXPIRE_N_LATENCY_BUCKETS - 1);
+  vlib_increment_simple_counter (&em->latency, thread_index, bucket, 1);
+
+  return n;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_expire_node) = {
+  .function = nat44_ed_expire_node_fn,
+  .name = "nat44-ed-expire",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+};
+
+static uword
+nat44_ed_expire_process (vlib_main_t *vm, vlib_node_runtime_t *rt,
+			 vlib_frame_t *f)
+{
+  nat44_ed_expire_main_t *em = &nat44_ed_expire_main;
+  snat_main_t *sm = &snat_main;
+  u32 i;
+
+  while (1)
+    {
+      if (sm->enabled)
+	vlib_process_wait_for_event_or_clock (vm, NAT44_ED_EXPIRE_INTERVAL);
+      else
+	vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, NULL);
+
+      for (i = 0; i < vlib_get_n_threads (); i++)
+	vlib_node_set_interrupt_pending (vlib_get_main_by_index (i),
+					 em->node_index);
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_expire_process_node) = {
+  .function = nat44_ed_expire_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "nat44-ed-expire-process",
+};
+
+void
+nat44_ed_expire_set_budget (u32 budget)
+{
+  nat44_ed_expire_main_t *em = &nat44_ed_expire_main;
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+
+  em->budget = budget;
+
+  /* the wheel stops at the first slot which reaches the budget */
+  if (sm->enabled)
+    vec_foreach (tsm, sm->per_thread_data)
+      tsm->expire_wheel.max_expirations = budget;
+}
+
+void
+nat44_ed_expire_enable (void)
+{
+  nat44_ed_expire_main_t *em = &nat44_ed_expire_main;
+
+  nat44_ed_expire_set_budget (em->budget);
+  vlib_process_signal_event (vlib_get_main (), em->process_node_index,
+			     NAT44_ED_EXPIRE_EVENT_ENABLE, 0);
+}
+
+u8 *
+format_nat44_ed_expire (u8 *s, va_list *args)
+{
+  nat44_ed_expire_main_t *em = &nat44_ed_expire_main;
+  snat_main_t *sm = &snat_main;
+  u32 indent = format_get_indent (s);
+  snat_main_per_thread_data_t *tsm;
+  vlib_main_t *vm;
+  u64 count;
+  u32 i;
+
+  s = format (s, "budget %u sessions per dispatch, tick %.2fs", em->budget,
+	      NAT44_ED_EXPIRE_TICK);
+
+  vec_foreach (tsm, sm->per_thread_data)
+    {
+      i = tsm - sm->per_thread_data;
+      vm = vlib_get_main_by_index (i);
+      if (!vm || !tsm->expire_wheel.timers)
+	continue;
+      s = format (s, "\n%Uthread %u %s: timers %u backlog %u",
+		  format_white_space, indent, i,
+		  vlib_worker_threads[i].name,
+		  pool_elts (tsm->expire_wheel.timers) -
+		    ARRAY_LEN (tsm->expire_wheel.w) *
+		      ARRAY_LEN (tsm->expire_wheel.w[0]),
+		  vec_len (tsm->expired_sessions));
+    }
+
+  s = format (s, "\n%Ureclaimed: %llu rearmed: %llu", format_white_space,
+	      indent, vlib_get_simple_counter (&em->reclaimed, 0),
+	      vlib_get_simple_counter (&em->rearmed, 0));
+
+  s = format (s, "\n%Ureclaim latency:", format_white_space, indent);
+  for (i = 0; i < NAT44_ED_EXPIRE_N_LATENCY_BUCKETS; i++)
+    {
+      count = vlib_get_simple_counter (&em->latency, i);
+      if (count)
+	s = format (s, "\n%U%12lluns - %12lluns: %llu", format_white_space,
+		    indent + 2, 1ULL << i, (2ULL << i) - 1, count);
+    }
+
+  return s;
+}
+
+clib_error_t *
+nat44_ed_expire_init (vlib_main_t *vm)
+{
+  nat44_ed_expire_main_t *em = &nat44_ed_expire_main;
+
+  em->budget = NAT44_ED_EXPIRE_BUDGET_DEFAULT;
+  em->node_index = nat44_ed_expire_node.index;
+  em->process_node_index = nat44_ed_expire_process_node.index;
+
+  em->reclaimed.name = "reclaimed";
+  em->reclaimed.stat_segment_name = "/nat44-ed/expire/reclaimed";
+  vlib_validate_simple_counter (&em->reclaimed, 0);
+  vlib_zero_simple_counter (&em->reclaimed, 0);
+
+  em->rearmed.name = "rearmed";
+  em->rearmed.stat_segment_name = "/nat44-ed/expire/rearmed";
+  vlib_validate_simple_counter (&em->rearmed, 0);
+  vlib_zero_simple_counter (&em->rearmed, 0);
+
+  em->latency.name = "latency";
+  em->latency.stat_segment_name = "/nat44-ed/expire/latency";
+  vlib_validate_simple_counter (&em->latency,
+				NAT44_ED_EXPIRE_N_LATENCY_BUCKETS - 1);
+  vlib_clear_simple_counters (&em->latency);
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 endpoint-dependent session expiry
+ *
+ * Each session has a timer in the timer wheel of its thread, started when
+ * the session is allocated. Timers are not moved when packets refresh the
+ * session; when a timer expires, the session is deleted if it timed out,
+ * otherwise the timer is started again for the remaining time. Expired
+ * timers are processed by an interrupt node on the owning thread, at most
+ * a configured number of sessions per dispatch, so no thread ever walks
+ * its whole session table.
+ */
+
+#ifndef __included_nat44_ed_expire_h__
+#define __included_nat44_ed_expire_h__
+
+#include <nat/nat44-ed/nat44_ed.h>
+
+/* timer wheel tick, in seconds */
+#define NAT44_ED_EXPIRE_TICK 1.0
+
+/* longest timer of a two wheel, 512 slot timer wheel */
+#define NAT44_ED_EXPIRE_MAX_TICKS (512 * 512 - 1)
+
+/* default number of expired timers processed per dispatch */
+#define NAT44_ED_EXPIRE_BUDGET_DEFAULT 256
+
+/* reclaim latency histogram buckets, bucket n counts [2^n, 2^(n+1)) ns */
+#define NAT44_ED_EXPIRE_N_LATENCY_BUCKETS 32
+
+/* timer of the session expired, session index is in the thread backlog */
+#define NAT44_ED_EXPIRE_TIMER_PENDING ((u32) ~1)
+
+/* the timer wheel user id holds 28 bits of session index */
+#define NAT44_ED_EXPIRE_MAX_SESSIONS (1 << 28)
+
+typedef struct
+{
+  /* expired timers processed by each thread per dispatch */
+  u32 budget;
+
+  /* sessions deleted and timers restarted by the expire node */
+  vlib_simple_counter_main_t reclaimed;
+  vlib_simple_counter_main_t rearmed;
+
+  /* expire node dispatch time, indexed by log2 of nanoseconds */
+  vlib_simple_counter_main_t latency;
+
+  u32 node_index;
+  u32 process_node_index;
+} nat44_ed_expire_main_t;
+
+extern nat44_ed_expire_main_t nat44_ed_expire_main;
+
+/**
+ * @brief Set the number of expired timers each thread processes per
+ *  dispatch of the expire node.
+ */
+void nat44_ed_expire_set_budget (u32 budget);
+
+/**
+ * @brief Start the expire process, called when NAT44 is enabled.
+ */
+void nat44_ed_expire_enable (void);
+
+clib_error_t *nat44_ed_expire_init (vlib_main_t *vm);
+
+format_function_t format_nat44_ed_expire;
+
+always_inline u32
+nat44_ed_expire_ticks (f64 remaining)
+{
+  f64 ticks = remaining / NAT44_ED_EXPIRE_TICK;
+
+  if (ticks < 1)
+    return 1;
+  /* a session refreshed before then gets a new timer when it expires */
+  if (ticks > NAT44_ED_EXPIRE_MAX_TICKS)
+    return NAT44_ED_EXPIRE_MAX_TICKS;
+  return (u32) ticks + (ticks > (u32) ticks);
+}
+
+/**
+ * @brief Start the expiry timer of a new session. The session timeout
+ *  isn't known before the first packet is translated, so the timer is
+ *  started with the shortest timeout of the protocol.
+ */
+always_inline void
+nat44_ed_expire_session_start (snat_main_t *sm,
+			       snat_main_per_thread_data_t *tsm,
+			       snat_session_t *s, u8 proto)
+{
+  u32 timeout;
+
+  switch (proto)
+    {
+    case IP_PROTOCOL_ICMP:
+      timeout = sm->timeouts.icmp;
+      break;
+    case IP_PROTOCOL_TCP:
+      timeout = clib_min (sm->timeouts.tcp.transitory,
+			  sm->timeouts.tcp.established);
+      break;
+    default:
+      timeout = sm->timeouts.udp;
+      break;
+    }
+
+  ASSERT (s - tsm->sessions < NAT44_ED_EXPIRE_MAX_SESSIONS);
+  s->expire_timer_handle = tw_timer_start_16t_2w_512sl (
+    &tsm->expire_wheel, s - tsm->sessions, 0, nat44_ed_expire_ticks (timeout));
+}
+
+/**
+ * @brief Stop the expiry timer of a session which is being deleted.
+ */
+always_inline void
+nat44_ed_expire_session_stop (snat_main_per_thread_data_t *tsm,
+			      snat_session_t *s)
+{
+  /* an expired timer is already gone from the wheel */
+  if (s->expire_timer_handle != NAT44_ED_EXPIRE_TIMER_PENDING)
+    tw_timer_stop_16t_2w_512sl (&tsm->expire_wheel, s->expire_timer_handle);
+}
+
+#endif /* __included_nat44_ed_expire_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -26,6 +26,8 @@
 #include <nat/lib/log.h>
 #include <nat/lib/ipfix_logging.h>
 #include <nat/nat44-ed/nat44_ed.h>
+#include <nat/nat44-ed/nat44_ed_offload.h>
+#include <nat/nat44-ed/nat44_ed_expire.h>
 
 always_inline void
 init_ed_k (clib_bihash_kv_16_8_t *kv, u32 l_addr, u16 l_port, u32 r_addr,
@@ -335,6 +337,8 @@ nat_ed_session_delete (snat_main_t *sm, snat_session_t *ses, u32 thread_index,
       clib_dlist_remove (tsm->lru_pool, ses->lru_index);
     }
   pool_put_index (tsm->lru_pool, ses->lru_index);
+  nat44_ed_expire_session_stop (tsm, ses);
+  nat44_ed_offload_session_delete (sm, ses, thread_index);
   if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, ses, 0))
     nat_elog_warn (sm, "flow hash del failed");
   if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, ses, 0))
@@ -401,12 +405,12 @@ nat_ed_session_alloc (snat_main_t *sm, u32 thread_index, f64 now, u8 proto)
   snat_session_t *s;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
 
-  nat_lru_free_one (sm, thread_index, now);
-
+  /* expired sessions are deleted by the expire node */
   pool_get (tsm->sessions, s);
   clib_memset (s, 0, sizeof (*s));
 
   nat_ed_lru_insert (tsm, s, now, proto);
+  nat44_ed_expire_session_start (sm, tsm, s, proto);
 
   s->ha_last_refreshed = now;
   vlib_set_simple_counter (&sm->total_sessions, thread_index, 0,
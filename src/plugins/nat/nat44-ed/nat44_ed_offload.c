@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 endpoint-dependent session offload to NIC flow marks
+ */
+
+#include <nat/lib/log.h>
+
+#include <nat/nat44-ed/nat44_ed.h>
+#include <nat/nat44-ed/nat44_ed_offload.h>
+
+nat44_ed_offload_main_t nat44_ed_offload_main;
+
+/* interval between two batches of flow rule updates */
+#define NAT44_ED_OFFLOAD_INTERVAL 10e-3
+
+typedef enum
+{
+  NAT44_ED_OFFLOAD_EVENT_ENABLE = 1,
+} nat44_ed_offload_event_t;
+
+static_always_inline uword
+nat44_ed_offload_key (u32 mark, u8 dir)
+{
+  return ((uword) mark << 1) | dir;
+}
+
+static void
+nat44_ed_offload_del_flow (nat44_ed_offload_main_t *om, uword key)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  uword *p;
+
+  p = hash_get (om->flow_index_by_key, key);
+  if (!p)
+    return;
+
+  vnet_flow_del (vnm, p[0]);
+  hash_unset (om->flow_index_by_key, key);
+  om->n_removed++;
+}
+
+static void
+nat44_ed_offload_add_flow (nat44_ed_offload_main_t *om,
+			   nat44_ed_offload_req_t *r, uword key)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_hw_interface_t *hi;
+  vnet_flow_t flow = {
+    .type = VNET_FLOW_TYPE_IP4_N_TUPLE,
+    .actions = VNET_FLOW_ACTION_MARK,
+    .mark_flow_id = r->mark,
+  };
+  u32 flow_index;
+  int rv;
+
+  if (!vnet_sw_interface_is_valid (vnm, r->sw_if_index))
+    {
+      om->n_failed++;
+      return;
+    }
+
+  hi = vnet_get_sup_hw_interface (vnm, r->sw_if_index);
+  if (hash_get (om->unsupported_hw_if_indices, hi->hw_if_index))
+    {
+      om->n_unsupported++;
+      return;
+    }
+
+  flow.ip4_n_tuple.src_addr.addr = r->match.saddr;
+  flow.ip4_n_tuple.src_addr.mask.as_u32 = ~0;
+  flow.ip4_n_tuple.dst_addr.addr = r->match.daddr;
+  flow.ip4_n_tuple.dst_addr.mask.as_u32 = ~0;
+  flow.ip4_n_tuple.protocol.prot = r->match.proto;
+  flow.ip4_n_tuple.protocol.mask = 0xff;
+  flow.ip4_n_tuple.src_port.port = clib_net_to_host_u16 (r->match.sport);
+  flow.ip4_n_tuple.src_port.mask = 0xffff;
+  flow.ip4_n_tuple.dst_port.port = clib_net_to_host_u16 (r->match.dport);
+  flow.ip4_n_tuple.dst_port.mask = 0xffff;
+
+  if (vnet_flow_add (vnm, &flow, &flow_index))
+    {
+      om->n_failed++;
+      return;
+    }
+
+  rv = vnet_flow_enable (vnm, flow_index, hi->hw_if_index);
+  if (rv)
+    {
+      vnet_flow_del (vnm, flow_index);
+      if (rv == VNET_FLOW_ERROR_NOT_SUPPORTED)
+	{
+	  /* don't ask the driver again, sessions stay in software */
+	  hash_set (om->unsupported_hw_if_indices, hi->hw_if_index, 1);
+	  om->n_unsupported++;
+	}
+      else
+	om->n_failed++;
+      return;
+    }
+
+  hash_set (om->flow_index_by_key, key, flow_index);
+  om->n_installed++;
+}
+
+static void
+nat44_ed_offload_process_requests (nat44_ed_offload_main_t *om)
+{
+  nat44_ed_offload_per_thread_t *ptd;
+  nat44_ed_offload_req_t *r;
+  uword key;
+
+  vec_foreach (ptd, om->per_thread)
+    {
+      vec_foreach (r, ptd->reqs)
+	{
+	  /* the session index may have been reused since the last rule */
+	  key = nat44_ed_offload_key (r->mark, r->dir);
+	  nat44_ed_offload_del_flow (om, key);
+
+	  if (r->is_add && om->threshold)
+	    nat44_ed_offload_add_flow (om, r, key);
+	}
+      vec_reset_length (ptd->reqs);
+      ptd->n_pending = 0;
+    }
+}
+
+static int
+nat44_ed_offload_has_requests (nat44_ed_offload_main_t *om)
+{
+  nat44_ed_offload_per_thread_t *ptd;
+
+  vec_foreach (ptd, om->per_thread)
+    if (clib_atomic_load_acq_n (&ptd->n_pending))
+      return 1;
+
+  return 0;
+}
+
+static uword
+nat44_ed_offload_process (vlib_main_t *vm, vlib_node_runtime_t *rt,
+			  vlib_frame_t *f)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+
+  while (1)
+    {
+      if (om->threshold)
+	vlib_process_wait_for_event_or_clock (vm, NAT44_ED_OFFLOAD_INTERVAL);
+      else
+	vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, NULL);
+
+      /* the queues themselves are only read under the barrier */
+      if (!nat44_ed_offload_has_requests (om))
+	continue;
+
+      vlib_worker_thread_barrier_sync (vm);
+      nat44_ed_offload_process_requests (om);
+      vlib_worker_thread_barrier_release (vm);
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_offload_process_node) = {
+  .function = nat44_ed_offload_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "nat44-ed-offload-process",
+};
+
+void
+nat44_ed_offload_flush (void)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+  snat_main_t *sm = &snat_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  snat_main_per_thread_data_t *tsm;
+  nat44_ed_offload_per_thread_t *ptd;
+  snat_session_t *s;
+  uword key, flow_index;
+
+  hash_foreach (key, flow_index, om->flow_index_by_key,
+		({ vnet_flow_del (vnm, flow_index); }));
+  om->n_removed += hash_elts (om->flow_index_by_key);
+  hash_free (om->flow_index_by_key);
+
+  vec_foreach (ptd, om->per_thread)
+    {
+      vec_reset_length (ptd->reqs);
+      ptd->n_pending = 0;
+    }
+
+  /* let the sessions be offloaded again */
+  vec_foreach (tsm, sm->per_thread_data)
+    pool_foreach (s, tsm->sessions)
+      s->flags &=
+	~(SNAT_SESSION_FLAG_OFFLOAD_I2O | SNAT_SESSION_FLAG_OFFLOAD_O2I);
+}
+
+void
+nat44_ed_offload_enable (void)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+  snat_main_t *sm = &snat_main;
+  u32 n_flow_ids;
+
+  if (!om->threshold || !sm->enabled)
+    return;
+
+  /* flow ids can't be returned, keep the range unless it's too small */
+  n_flow_ids = vec_len (sm->per_thread_data) * sm->max_translations_per_thread;
+  if (n_flow_ids > om->n_flow_ids)
+    {
+      vnet_flow_get_range (vnet_get_main (), "nat44-ed", n_flow_ids,
+			   &om->flow_id_start);
+      om->n_flow_ids = n_flow_ids;
+    }
+  om->sessions_per_thread = sm->max_translations_per_thread;
+}
+
+void
+nat44_ed_offload_set_threshold (u32 threshold)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+
+  if (!threshold)
+    nat44_ed_offload_flush ();
+
+  om->threshold = threshold;
+  nat44_ed_offload_enable ();
+
+  vlib_process_signal_event (vlib_get_main (), om->process_node_index,
+			     NAT44_ED_OFFLOAD_EVENT_ENABLE, 0);
+}
+
+u8 *
+format_nat44_ed_offload (u8 *s, va_list *args)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 hw_if_index, indent = format_get_indent (s);
+  uword v;
+
+  if (!om->threshold)
+    s = format (s, "disabled");
+  else
+    s = format (s, "threshold %u packets", om->threshold);
+  if (om->n_flow_ids)
+    s = format (s, ", flow ids %u-%u", om->flow_id_start,
+		om->flow_id_start + om->n_flow_ids - 1);
+
+  s = format (s, "\n%Uinstalled flows: %u", format_white_space, indent,
+	      hash_elts (om->flow_index_by_key));
+  s = format (s, "\n%Uinstalls: %llu removals: %llu failures: %llu "
+	      "unsupported: %llu",
+	      format_white_space, indent, om->n_installed, om->n_removed,
+	      om->n_failed, om->n_unsupported);
+  s = format (s, "\n%Umark hits: %llu", format_white_space, indent,
+	      vlib_get_simple_counter (&om->mark_hits, 0));
+
+  hash_foreach (hw_if_index, v, om->unsupported_hw_if_indices, ({
+		  s = format (s, "\n%Uno flow support: %U", format_white_space,
+			      indent, format_vnet_hw_if_index_name, vnm,
+			      hw_if_index);
+		}));
+
+  return s;
+}
+
+clib_error_t *
+nat44_ed_offload_init (vlib_main_t *vm)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+
+  om->process_node_index = nat44_ed_offload_process_node.index;
+  vec_validate_aligned (om->per_thread, vlib_get_n_threads () - 1,
+			CLIB_CACHE_LINE_BYTES);
+
+  om->mark_hits.name = "mark-hits";
+  om->mark_hits.stat_segment_name = "/nat44-ed/offload/mark-hits";
+  vlib_validate_simple_counter (&om->mark_hits, 0);
+  vlib_zero_simple_counter (&om->mark_hits, 0);
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 endpoint-dependent session offload to NIC flow marks
+ *
+ * Once a TCP or UDP session has seen a configured number of packets, a
+ * flow rule with a mark action is installed on the receiving interface
+ * for each direction of the session. The mark encodes the thread and
+ * session index, so packets carrying it are matched to their session
+ * without a flow hash lookup. Rules are installed and removed by a
+ * process on the main thread, in batches under a single barrier.
+ */
+
+#ifndef __included_nat44_ed_offload_h__
+#define __included_nat44_ed_offload_h__
+
+#include <vnet/flow/flow.h>
+#include <nat/nat44-ed/nat44_ed.h>
+
+/* limit on requests queued by each thread between two batches */
+#define NAT44_ED_OFFLOAD_MAX_PENDING 1024
+
+typedef struct
+{
+  /* session flow match, network byte order */
+  nat_6t_t match;
+  u32 mark;
+  u32 sw_if_index;
+  u8 dir;
+  u8 is_add;
+} nat44_ed_offload_req_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* requests queued by the thread, drained under the barrier */
+  nat44_ed_offload_req_t *reqs;
+
+  /* length of reqs, read by the main thread without the barrier */
+  u32 n_pending;
+} nat44_ed_offload_per_thread_t;
+
+typedef struct
+{
+  /* packets seen by a session before it is offloaded, 0 to disable */
+  u32 threshold;
+
+  /* flow mark range reserved from vnet/flow */
+  u32 flow_id_start;
+  u32 n_flow_ids;
+  u32 sessions_per_thread;
+
+  /* (mark << 1 | dir) -> vnet flow index */
+  uword *flow_index_by_key;
+
+  /* hw interfaces which failed to install a rule */
+  uword *unsupported_hw_if_indices;
+
+  /* per-thread request queues */
+  nat44_ed_offload_per_thread_t *per_thread;
+
+  /* main thread counters */
+  u64 n_installed;
+  u64 n_removed;
+  u64 n_failed;
+  u64 n_unsupported;
+
+  /* packets matched to their session by the flow mark */
+  vlib_simple_counter_main_t mark_hits;
+
+  u32 process_node_index;
+} nat44_ed_offload_main_t;
+
+extern nat44_ed_offload_main_t nat44_ed_offload_main;
+
+/**
+ * @brief Set the offload packet threshold, 0 disables offload and removes
+ *  the installed flow rules.
+ *
+ * @param threshold Number of packets seen by a session before offload.
+ */
+void nat44_ed_offload_set_threshold (u32 threshold);
+
+/**
+ * @brief Reserve the flow mark range for the current session limits.
+ *  Called when NAT44 is enabled and when session limits change.
+ */
+void nat44_ed_offload_enable (void);
+
+/**
+ * @brief Remove all installed flow rules and drop queued requests.
+ *  Called with the barrier held, before the session pools are freed.
+ */
+void nat44_ed_offload_flush (void);
+
+clib_error_t *nat44_ed_offload_init (vlib_main_t *vm);
+
+format_function_t format_nat44_ed_offload;
+
+static_always_inline int
+nat44_ed_offload_mark_decode (nat44_ed_offload_main_t *om, u32 mark,
+			      u32 *thread_index, u32 *session_index)
+{
+  u32 i = mark - om->flow_id_start;
+
+  /* also rejects marks below the range */
+  if (i >= om->n_flow_ids)
+    return 0;
+
+  *thread_index = i / om->sessions_per_thread;
+  *session_index = i % om->sessions_per_thread;
+  return 1;
+}
+
+/**
+ * @brief Find the session of a packet carrying a flow mark on the current
+ *  thread. The caller still has to compare the session flow match with
+ *  the packet, as the mark may belong to a deleted session.
+ */
+static_always_inline snat_session_t *
+nat44_ed_offload_session_by_mark (snat_main_t *sm, u32 mark,
+				  u32 thread_index)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  u32 ti, si;
+
+  if (!nat44_ed_offload_mark_decode (om, mark, &ti, &si) ||
+      ti != thread_index || pool_is_free_index (tsm->sessions, si))
+    return 0;
+
+  return pool_elt_at_index (tsm->sessions, si);
+}
+
+static_always_inline void
+nat44_ed_offload_mark_hit (u32 thread_index)
+{
+  vlib_increment_simple_counter (&nat44_ed_offload_main.mark_hits,
+				 thread_index, 0, 1);
+}
+
+/**
+ * @brief Find the thread of a packet carrying a flow mark, for handoff.
+ *
+ * @returns thread index, or ~0 if the mark doesn't match a session.
+ */
+static_always_inline u32
+nat44_ed_offload_handoff_thread (snat_main_t *sm, vlib_buffer_t *b,
+				 ip4_header_t *ip, nat44_ed_dir_e dir,
+				 u32 *session_index)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+  snat_main_per_thread_data_t *tsm;
+  snat_session_t *s;
+  nat_6t_t *m;
+  u32 ti, si;
+
+  if (!nat44_ed_offload_mark_decode (om, b->flow_id, &ti, &si) ||
+      ti >= vec_len (sm->per_thread_data))
+    return ~0;
+
+  tsm = &sm->per_thread_data[ti];
+  if (pool_is_free_index (tsm->sessions, si))
+    return ~0;
+
+  /* fib index is checked by the owning thread */
+  s = pool_elt_at_index (tsm->sessions, si);
+  m = dir == NAT44_ED_DIR_I2O ? &s->i2o.match : &s->o2i.match;
+  if (m->saddr.as_u32 != ip->src_address.as_u32 ||
+      m->daddr.as_u32 != ip->dst_address.as_u32 ||
+      m->sport != vnet_buffer (b)->ip.reass.l4_src_port ||
+      m->dport != vnet_buffer (b)->ip.reass.l4_dst_port ||
+      m->proto != ip->protocol)
+    return ~0;
+
+  *session_index = si;
+  return ti;
+}
+
+always_inline void
+nat44_ed_offload_request (snat_main_t *sm, snat_session_t *s,
+			  u32 thread_index, nat44_ed_dir_e dir,
+			  u32 sw_if_index, int is_add)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+  nat44_ed_offload_per_thread_t *ptd = &om->per_thread[thread_index];
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat44_ed_offload_req_t *r;
+
+  /* removals are bounded by the installed rules and never dropped */
+  if (is_add && vec_len (ptd->reqs) >= NAT44_ED_OFFLOAD_MAX_PENDING)
+    return;
+
+  vec_add2 (ptd->reqs, r, 1);
+  r->mark = om->flow_id_start +
+	    thread_index * om->sessions_per_thread + (s - tsm->sessions);
+  r->match = dir == NAT44_ED_DIR_I2O ? s->i2o.match : s->o2i.match;
+  r->sw_if_index = sw_if_index;
+  r->dir = dir;
+  r->is_add = is_add;
+
+  /* only the count is shared, the vector is the thread's own */
+  clib_atomic_store_rel_n (&ptd->n_pending, vec_len (ptd->reqs));
+
+  if (is_add)
+    s->flags |= (SNAT_SESSION_FLAG_OFFLOAD_I2O << dir);
+  else
+    s->flags &= ~(SNAT_SESSION_FLAG_OFFLOAD_I2O << dir);
+}
+
+/**
+ * @brief Request offload of a session direction once it passes the packet
+ *  threshold. Called by the fast path after the session counters update,
+ *  with the flow which translated the packet.
+ */
+static_always_inline void
+nat44_ed_offload_session_update (snat_main_t *sm, snat_session_t *s,
+				 nat_6t_flow_t *f, u32 thread_index,
+				 nat44_ed_dir_e dir, u32 sw_if_index)
+{
+  nat44_ed_offload_main_t *om = &nat44_ed_offload_main;
+
+  if (PREDICT_TRUE (!om->threshold || s->total_pkts < om->threshold))
+    return;
+
+  if (s->flags & (SNAT_SESSION_FLAG_OFFLOAD_I2O << dir))
+    return;
+
+  /* hairpinning and twice-nat sessions translate with the other flow */
+  if (f != (dir == NAT44_ED_DIR_I2O ? &s->i2o : &s->o2i))
+    return;
+
+  if (f->match.proto != IP_PROTOCOL_TCP && f->match.proto != IP_PROTOCOL_UDP)
+    return;
+
+  nat44_ed_offload_request (sm, s, thread_index, dir, sw_if_index, 1);
+}
+
+/**
+ * @brief Remove the flow rules of a session which is being deleted.
+ */
+static_always_inline void
+nat44_ed_offload_session_delete (snat_main_t *sm, snat_session_t *s,
+				 u32 thread_index)
+{
+  if (PREDICT_TRUE (!(s->flags & (SNAT_SESSION_FLAG_OFFLOAD_I2O |
+				  SNAT_SESSION_FLAG_OFFLOAD_O2I))))
+    return;
+
+  if (s->flags & SNAT_SESSION_FLAG_OFFLOAD_I2O)
+    nat44_ed_offload_request (sm, s, thread_index, NAT44_ED_DIR_I2O, ~0, 0);
+  if (s->flags & SNAT_SESSION_FLAG_OFFLOAD_O2I)
+    nat44_ed_offload_request (sm, s, thread_index, NAT44_ED_DIR_O2I, ~0, 0);
+}
+
+#endif /* __included_nat44_ed_offload_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -837,6 +837,20 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 	  lookup.proto = ip0->protocol;
 	}
 
+      /* offloaded sessions are found by the flow mark set by the nic */
+      if (PREDICT_FALSE (b0->flow_id != 0))
+	{
+	  s0 = nat44_ed_offload_session_by_mark (sm, b0->flow_id,
+						 thread_index);
+	  if (s0 && nat_6t_t_eq (&s0->o2i.match, &lookup))
+	    {
+	      nat44_ed_offload_mark_hit (thread_index);
+	      lookup_skipped = 1;
+	      goto skip_lookup;
+	    }
+	  s0 = NULL;
+	}
+
       /* there might be a stashed index in vnet_buffer2 from handoff or
        * classify node, see if it can be used */
       if (is_multi_worker &&
@@ -988,6 +1002,8 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 				     thread_index);
       /* Per-user LRU list maintenance */
       nat44_session_update_lru (sm, s0, thread_index);
+      nat44_ed_offload_session_update (sm, s0, f, thread_index,
+				       NAT44_ED_DIR_O2I, sw_if_index0);
 
     trace0:
       if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
@@ -16,7 +16,9 @@
 #include <vnet/api_errno.h>
 #include <vlib/node_funcs.h>
 #include <openssl/engine.h>
+#include <openssl/async.h>
 #include <tlsopenssl/tls_openssl.h>
+#include <pthread.h>
 
 #define SSL_ASYNC_INFLIGHT    1
 #define SSL_ASYNC_READY       2
@@ -398,6 +400,426 @@ qat_polling ()
     }
 }
 
+#ifdef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+/*
+ * Private key offload
+ *
+ * Server handshakes are dominated by the certificate private key operation.
+ * With pkey offload the listener's key is given an RSA or EC method that,
+ * when called from an openssl async job, queues the operation to one of a
+ * few dedicated crypto threads and pauses the job. The connection stays
+ * parked as an inflight async event until the result is back. Crypto
+ * threads run all ops queued to them in one batch and hand results back to
+ * the owning thread's completion list, which is drained by the async
+ * polling node and resumed through the usual event run queue.
+ */
+
+typedef struct openssl_pkey_op_
+{
+  struct openssl_pkey_op_ *next;
+  int (*fn) (struct openssl_pkey_op_ *op);
+  union
+  {
+    struct
+    {
+      int flen;
+      const u8 *from;
+      u8 *to;
+      RSA *rsa;
+      int padding;
+    } rsa;
+    struct
+    {
+      int type;
+      const u8 *dgst;
+      int dlen;
+      u8 *sig;
+      unsigned int *siglen;
+      const BIGNUM *kinv;
+      const BIGNUM *r;
+      EC_KEY *eckey;
+    } ec;
+  };
+  ASYNC_callback_fn cb;
+  void *cb_arg;
+  u32 thread_index;
+  int rv;
+  u8 done;
+} openssl_pkey_op_t;
+
+typedef struct openssl_pkey_thread_
+{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  openssl_pkey_op_t *head;
+  openssl_pkey_op_t *tail;
+  /* run what is queued and exit */
+  u8 stop;
+  u64 n_ops;
+} openssl_pkey_thread_t;
+
+typedef struct openssl_pkey_done_
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  openssl_pkey_op_t *ops;
+  u32 next_thread;
+} openssl_pkey_done_t;
+
+typedef struct openssl_pkey_offload_
+{
+  openssl_pkey_thread_t *threads;
+  openssl_pkey_done_t *done;
+  RSA_METHOD *rsa_meth;
+  EC_KEY_METHOD *ec_meth;
+  int (*rsa_priv_enc) (int flen, const u8 *from, u8 *to, RSA *rsa,
+		       int padding);
+  int (*rsa_priv_dec) (int flen, const u8 *from, u8 *to, RSA *rsa,
+		       int padding);
+  int (*ec_sign) (int type, const u8 *dgst, int dlen, u8 *sig,
+		  unsigned int *siglen, const BIGNUM *kinv, const BIGNUM *r,
+		  EC_KEY *eckey);
+  /* ops run by crypto threads since stopped */
+  u64 n_ops_stopped;
+} openssl_pkey_offload_t;
+
+static openssl_pkey_offload_t openssl_pkey_offload;
+
+static int
+openssl_pkey_rsa_priv_enc_fn (openssl_pkey_op_t *op)
+{
+  return openssl_pkey_offload.rsa_priv_enc (op->rsa.flen, op->rsa.from,
+					    op->rsa.to, op->rsa.rsa,
+					    op->rsa.padding);
+}
+
+static int
+openssl_pkey_rsa_priv_dec_fn (openssl_pkey_op_t *op)
+{
+  return openssl_pkey_offload.rsa_priv_dec (op->rsa.flen, op->rsa.from,
+					    op->rsa.to, op->rsa.rsa,
+					    op->rsa.padding);
+}
+
+static int
+openssl_pkey_ec_sign_fn (openssl_pkey_op_t *op)
+{
+  return openssl_pkey_offload.ec_sign (op->ec.type, op->ec.dgst, op->ec.dlen,
+				       op->ec.sig, op->ec.siglen, op->ec.kinv,
+				       op->ec.r, op->ec.eckey);
+}
+
+static void *
+openssl_pkey_thread_fn (void *arg)
+{
+  openssl_pkey_offload_t *pm = &openssl_pkey_offload;
+  openssl_pkey_thread_t *pt = pm->threads + pointer_to_uword (arg);
+  openssl_pkey_op_t *op, *next;
+  openssl_pkey_done_t *pd;
+
+  while (1)
+    {
+      pthread_mutex_lock (&pt->lock);
+      while (!pt->head && !pt->stop)
+	pthread_cond_wait (&pt->cond, &pt->lock);
+      if (!pt->head)
+	{
+	  pthread_mutex_unlock (&pt->lock);
+	  break;
+	}
+      op = pt->head;
+      pt->head = pt->tail = 0;
+      pthread_mutex_unlock (&pt->lock);
+
+      /* run the whole batch, then hand each op back to its thread */
+      while (op)
+	{
+	  next = op->next;
+	  op->rv = op->fn (op);
+	  pt->n_ops += 1;
+	  pd = pm->done + op->thread_index;
+	  op->next = clib_atomic_load_relax_n (&pd->ops);
+	  while (!__atomic_compare_exchange_n (&pd->ops, &op->next, op, 1,
+					       __ATOMIC_RELEASE,
+					       __ATOMIC_RELAXED))
+	    ;
+	  op = next;
+	}
+    }
+
+  return 0;
+}
+
+static int
+openssl_pkey_op_run (openssl_pkey_op_t *op)
+{
+  openssl_pkey_offload_t *pm = &openssl_pkey_offload;
+  openssl_pkey_thread_t *pt;
+  openssl_pkey_done_t *pd;
+  ASYNC_WAIT_CTX *wctx;
+  ASYNC_JOB *job;
+
+  /* offload stopped, not in an async job or no way to be woken up, run
+   * inline */
+  job = ASYNC_get_current_job ();
+  if (!vec_len (pm->threads) || !job || !(wctx = ASYNC_get_wait_ctx (job)) ||
+      !ASYNC_WAIT_CTX_get_callback (wctx, &op->cb, &op->cb_arg) || !op->cb)
+    return op->fn (op);
+
+  op->thread_index = vlib_get_thread_index ();
+  op->done = 0;
+  op->next = 0;
+
+  pd = pm->done + op->thread_index;
+  pt = pm->threads + pd->next_thread++ % vec_len (pm->threads);
+
+  pthread_mutex_lock (&pt->lock);
+  if (pt->tail)
+    pt->tail->next = op;
+  else
+    pt->head = op;
+  pt->tail = op;
+  pthread_cond_signal (&pt->cond);
+  pthread_mutex_unlock (&pt->lock);
+
+  /* op lives on the job's stack, so wait for it with the job paused */
+  while (!op->done)
+    ASYNC_pause_job ();
+
+  return op->rv;
+}
+
+static int
+openssl_pkey_rsa_priv_enc (int flen, const u8 *from, u8 *to, RSA *rsa,
+			   int padding)
+{
+  openssl_pkey_op_t op = { .fn = openssl_pkey_rsa_priv_enc_fn,
+			   .rsa = { flen, from, to, rsa, padding } };
+  return openssl_pkey_op_run (&op);
+}
+
+static int
+openssl_pkey_rsa_priv_dec (int flen, const u8 *from, u8 *to, RSA *rsa,
+			   int padding)
+{
+  openssl_pkey_op_t op = { .fn = openssl_pkey_rsa_priv_dec_fn,
+			   .rsa = { flen, from, to, rsa, padding } };
+  return openssl_pkey_op_run (&op);
+}
+
+static int
+openssl_pkey_ec_sign (int type, const u8 *dgst, int dlen, u8 *sig,
+		      unsigned int *siglen, const BIGNUM *kinv,
+		      const BIGNUM *r, EC_KEY *eckey)
+{
+  openssl_pkey_op_t op = {
+    .fn = openssl_pkey_ec_sign_fn,
+    .ec = { type, dgst, dlen, sig, siglen, kinv, r, eckey },
+  };
+  return openssl_pkey_op_run (&op);
+}
+
+/* drain ops completed by the crypto threads for this thread */
+static void
+openssl_pkey_polling ()
+{
+  openssl_pkey_done_t *pd;
+  openssl_pkey_op_t *op, *next;
+
+  pd = openssl_pkey_offload.done + vlib_get_thread_index ();
+  if (!clib_atomic_load_relax_n (&pd->ops))
+    return;
+
+  op = clib_atomic_swap_acq_n (&pd->ops, 0);
+  while (op)
+    {
+      ASYNC_callback_fn cb = op->cb;
+      void *cb_arg = op->cb_arg;
+
+      /* job may resume and release op as soon as it's marked done */
+      next = op->next;
+      op->done = 1;
+      cb (cb_arg);
+      op = next;
+    }
+}
+
+EVP_PKEY *
+openssl_pkey_offload_wrap (EVP_PKEY *pkey)
+{
+  openssl_pkey_offload_t *pm = &openssl_pkey_offload;
+  EVP_PKEY *wrapped;
+  int key_type;
+  EC_KEY *ec;
+  RSA *rsa;
+
+  wrapped = EVP_PKEY_new ();
+  if (!wrapped)
+    return pkey;
+
+  key_type = EVP_PKEY_get_base_id (pkey);
+
+  /*
+   * Keys with a non default method are handled by openssl through the
+   * legacy key methods, so ops on the wrapped key end up in our callbacks
+   */
+  switch (key_type)
+    {
+    case EVP_PKEY_RSA:
+      if (!(rsa = EVP_PKEY_get1_RSA (pkey)))
+	break;
+      RSA_set_method (rsa, pm->rsa_meth);
+      if (EVP_PKEY_assign_RSA (wrapped, rsa))
+	goto done;
+      RSA_free (rsa);
+      break;
+    case EVP_PKEY_EC:
+      if (!(ec = EVP_PKEY_get1_EC_KEY (pkey)))
+	break;
+      EC_KEY_set_method (ec, pm->ec_meth);
+      if (EVP_PKEY_assign_EC_KEY (wrapped, ec))
+	goto done;
+      EC_KEY_free (ec);
+      break;
+    default:
+      break;
+    }
+
+  TLS_DBG (1, "private key type not supported by pkey offload");
+  EVP_PKEY_free (wrapped);
+  return pkey;
+
+done:
+  EVP_PKEY_free (pkey);
+  return wrapped;
+}
+
+int
+openssl_pkey_offload_enable (u32 n_threads)
+{
+  openssl_pkey_offload_t *pm = &openssl_pkey_offload;
+  openssl_async_t *om = &openssl_async_main;
+  ECDSA_SIG *(*sign_sig) (const u8 *dgst, int dlen, const BIGNUM *kinv,
+			  const BIGNUM *r, EC_KEY *eckey);
+  int (*sign_setup) (EC_KEY *eckey, BN_CTX *ctx, BIGNUM **kinv,
+		     BIGNUM **r);
+  openssl_pkey_thread_t *pt;
+  int i, rv;
+
+  if (vec_len (pm->threads) || !n_threads)
+    return -1;
+
+  /* async engines have their own polling */
+  if (om->polling && om->polling != openssl_pkey_polling)
+    return -1;
+
+  if (!pm->rsa_meth)
+    {
+      pm->rsa_meth = RSA_meth_dup (RSA_PKCS1_OpenSSL ());
+      pm->rsa_priv_enc = RSA_meth_get_priv_enc (RSA_PKCS1_OpenSSL ());
+      pm->rsa_priv_dec = RSA_meth_get_priv_dec (RSA_PKCS1_OpenSSL ());
+      RSA_meth_set1_name (pm->rsa_meth, "vpp pkey offload rsa");
+      RSA_meth_set_priv_enc (pm->rsa_meth, openssl_pkey_rsa_priv_enc);
+      RSA_meth_set_priv_dec (pm->rsa_meth, openssl_pkey_rsa_priv_dec);
+
+      pm->ec_meth = EC_KEY_METHOD_new (EC_KEY_OpenSSL ());
+      /* the default sign calls sign_setup and sign_sig through the
+       * key's method, so keep those */
+      EC_KEY_METHOD_get_sign (EC_KEY_OpenSSL (), &pm->ec_sign, &sign_setup,
+			      &sign_sig);
+      EC_KEY_METHOD_set_sign (pm->ec_meth, openssl_pkey_ec_sign, sign_setup,
+			      sign_sig);
+    }
+
+  vec_validate (pm->done, vec_len (om->queue) - 1);
+  vec_validate (pm->threads, n_threads - 1);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      pt = pm->threads + i;
+      pthread_mutex_init (&pt->lock, 0);
+      pthread_cond_init (&pt->cond, 0);
+      rv = pthread_create (&pt->thread, 0, openssl_pkey_thread_fn,
+			   uword_to_pointer (i, void *));
+      if (rv)
+	{
+	  clib_unix_warning ("pthread_create returned %d", rv);
+	  _vec_len (pm->threads) = i;
+	  break;
+	}
+    }
+
+  if (!vec_len (pm->threads))
+    return -1;
+
+  om->polling = openssl_pkey_polling;
+  openssl_async_node_enable_disable (1);
+  om->start_polling = 1;
+
+  return 0;
+}
+
+/*
+ * Stop and join the crypto threads, with the workers at the barrier. Ops
+ * already queued are run first, and parked handshakes resume through the
+ * polling node as usual. Wrapped keys run their ops inline from then on.
+ */
+int
+openssl_pkey_offload_disable (void)
+{
+  openssl_pkey_offload_t *pm = &openssl_pkey_offload;
+  openssl_pkey_thread_t *pt;
+
+  if (!vec_len (pm->threads))
+    return -1;
+
+  vec_foreach (pt, pm->threads)
+    {
+      pthread_mutex_lock (&pt->lock);
+      pt->stop = 1;
+      pthread_cond_signal (&pt->cond);
+      pthread_mutex_unlock (&pt->lock);
+    }
+
+  vec_foreach (pt, pm->threads)
+    {
+      pthread_join (pt->thread, 0);
+      pthread_cond_destroy (&pt->cond);
+      pthread_mutex_destroy (&pt->lock);
+      pm->n_ops_stopped += pt->n_ops;
+    }
+
+  vec_free (pm->threads);
+
+  return 0;
+}
+
+u8 *
+format_openssl_pkey_offload (u8 *s, va_list *args)
+{
+  openssl_pkey_offload_t *pm = &openssl_pkey_offload;
+  u64 n_ops = pm->n_ops_stopped;
+  openssl_pkey_thread_t *pt;
+
+  vec_foreach (pt, pm->threads)
+    n_ops += clib_atomic_load_relax_n (&pt->n_ops);
+
+  s = format (s, "crypto threads: %u\n", vec_len (pm->threads));
+  s = format (s, "ops offloaded: %lu", n_ops);
+
+  return s;
+}
+
+static clib_error_t *
+openssl_pkey_offload_exit (vlib_main_t *vm)
+{
+  openssl_pkey_offload_disable ();
+  return 0;
+}
+
+VLIB_MAIN_LOOP_EXIT_FUNCTION (openssl_pkey_offload_exit);
+#endif /* HAVE_OPENSSL_ASYNC_WAIT_CALLBACK */
+
 void
 openssl_async_polling ()
 {
@@ -417,7 +839,8 @@ openssl_async_node_enable_disable (u8 is_en)
 
   foreach_vlib_main ()
     {
-      if (have_workers && this_vlib_main->thread_index)
+      /* sessions only live on the main thread if there are no workers */
+      if (!have_workers || this_vlib_main->thread_index)
 	{
 	  vlib_node_set_state (this_vlib_main, tls_async_process_node.index,
 			       state);
@@ -64,10 +64,12 @@ openssl_ctx_free (tls_ctx_t * ctx)
   /* Cleanup ssl ctx unless migrated */
   if (!ctx->is_migrated)
     {
-      if (SSL_is_init_finished (oc->ssl) && !ctx->is_passive_close)
+      if (SSL_is_init_finished (oc->ssl) && !ctx->is_passive_close &&
+	  !oc->record.is_active)
 	SSL_shutdown (oc->ssl);
 
       SSL_free (oc->ssl);
+      tls_record_free (&oc->record);
       vec_free (ctx->srv_hostname);
 
 #ifdef HAVE_OPENSSL_ASYNC
@@ -176,6 +178,10 @@ openssl_read_from_ssl_into_fifo (svm_fifo_t * f, SSL * ssl)
   if (read <= 0)
     return 0;
 
+  /* Bytes must be contiguous, only use next segment if this one is full */
+  if (read < (int) fs[0].len)
+    goto done;
+
   for (i = 1; i < n_fs; i++)
     {
       rv = SSL_read (ssl, fs[i].data, fs[i].len);
@@ -185,6 +191,8 @@ openssl_read_from_ssl_into_fifo (svm_fifo_t * f, SSL * ssl)
 	break;
     }
 
+done:
+
   svm_fifo_enqueue_nocopy (f, read);
 
   return read;
@@ -216,6 +224,105 @@ openssl_write_from_fifo_into_ssl (svm_fifo_t *f, SSL *ssl, u32 max_len)
   return wrote;
 }
 
+typedef struct openssl_record_keys_args_
+{
+  u32 ctx_index;
+  u32 thread_index;
+  u64 record_id;
+} openssl_record_keys_args_t;
+
+/*
+ * On the main thread, with the workers at the barrier: add the record's
+ * crypto keys and bring the ctx back to the records that waited for them
+ */
+static void
+openssl_record_keys_rpc (void *args)
+{
+  openssl_record_keys_args_t *a = args;
+  openssl_main_t *om = &openssl_main;
+  openssl_ctx_t *oc;
+  session_t *ts;
+
+  if (pool_is_free_index (om->ctx_pool[a->thread_index], a->ctx_index))
+    return;
+
+  /* the ctx may have been closed, and its slot reused, since */
+  oc = (openssl_ctx_t *) openssl_ctx_get_w_thread (a->ctx_index,
+						   a->thread_index);
+  if (!oc->record.is_active || oc->record.id != a->record_id)
+    return;
+
+  tls_record_keys_add (vlib_get_main (), &oc->record);
+  oc->record.keys_requested = 0;
+
+  ts = session_get_from_handle (oc->ctx.tls_session_handle);
+  tls_add_vpp_q_builtin_rx_evt (ts);
+}
+
+static void
+openssl_record_keys_request (openssl_ctx_t *oc)
+{
+  openssl_record_keys_args_t args;
+
+  if (!tls_record_keys_pending (&oc->record) || oc->record.keys_requested)
+    return;
+
+  oc->record.keys_requested = 1;
+  args.ctx_index = oc->openssl_ctx_index;
+  args.thread_index = oc->ctx.c_thread_index;
+  args.record_id = oc->record.id;
+  vlib_rpc_call_main_thread (openssl_record_keys_rpc, (u8 *) &args,
+			     sizeof (args));
+}
+
+static int
+openssl_write_from_fifo_into_record (openssl_ctx_t *oc, svm_fifo_t *f,
+				     session_t *ts, u32 max_len)
+{
+  int wrote;
+
+  wrote = tls_record_write (&oc->record, f, ts->tx_fifo, max_len);
+  /* a key update waits for the new key */
+  openssl_record_keys_request (oc);
+  if (wrote <= 0)
+    return 0;
+
+  tls_add_vpp_q_tx_evt (ts);
+
+  return wrote;
+}
+
+static int
+openssl_read_from_record_into_fifo (openssl_ctx_t *oc, svm_fifo_t *f,
+				    session_t *ts)
+{
+  u32 max_deq;
+  int read;
+
+  max_deq = svm_fifo_max_dequeue_cons (ts->rx_fifo);
+  read = tls_record_read (&oc->record, ts->rx_fifo, f);
+  openssl_record_keys_request (oc);
+  if (PREDICT_FALSE (read < 0))
+    {
+      /* Bad record, drop everything and let the app close */
+      svm_fifo_dequeue_drop_all (ts->rx_fifo);
+      session_transport_closing_notify (&oc->ctx.connection);
+      return 0;
+    }
+
+  max_deq -= svm_fifo_max_dequeue_cons (ts->rx_fifo);
+  if (svm_fifo_needs_deq_ntf (ts->rx_fifo, max_deq))
+    {
+      svm_fifo_clear_deq_ntf (ts->rx_fifo);
+      session_send_io_evt_to_thread (ts->rx_fifo, SESSION_IO_EVT_RX);
+    }
+
+  if (svm_fifo_is_empty_cons (ts->rx_fifo))
+    svm_fifo_unset_event (ts->rx_fifo);
+
+  return read;
+}
+
 #ifdef HAVE_OPENSSL_ASYNC
 static int
 openssl_check_async_status (tls_ctx_t * ctx, openssl_resume_handler * handler,
@@ -240,6 +347,155 @@ openssl_check_async_status (tls_ctx_t * ctx, openssl_resume_handler * handler,
 
 #endif
 
+/*
+ * TLS 1.3 application traffic secrets are only exposed through the key log
+ * callback, stash them until the handshake completes
+ */
+static void
+openssl_keylog_cb (const SSL *ssl, const char *line)
+{
+  u8 *label = 0, *random = 0, *secret = 0;
+  unformat_input_t _input, *input = &_input;
+  tls_record_keys_t *keys = 0;
+  openssl_ctx_t *oc;
+  u32 ctx_index;
+
+  ctx_index = pointer_to_uword (SSL_get_app_data (ssl));
+  oc = (openssl_ctx_t *) openssl_ctx_get (ctx_index);
+
+  unformat_init_string (input, (char *) line, strlen (line));
+  if (!unformat (input, "%s %U %U", &label, unformat_hex_string, &random,
+		 unformat_hex_string, &secret))
+    goto done;
+
+  if (!strcmp ((char *) label, "CLIENT_TRAFFIC_SECRET_0"))
+    keys = SSL_is_server (ssl) ? &oc->record.rx : &oc->record.tx;
+  else if (!strcmp ((char *) label, "SERVER_TRAFFIC_SECRET_0"))
+    keys = SSL_is_server (ssl) ? &oc->record.tx : &oc->record.rx;
+
+  if (keys && vec_len (secret) <= TLS_RECORD_MAX_SECRET)
+    {
+      clib_memcpy_fast (keys->secret, secret, vec_len (secret));
+      oc->record.secret_len = vec_len (secret);
+    }
+
+done:
+  if (secret)
+    clib_memset (secret, 0, vec_len (secret));
+  vec_free (secret);
+  vec_free (random);
+  vec_free (label);
+  unformat_free (input);
+}
+
+static void
+openssl_record_offload_init (SSL_CTX *ssl_ctx)
+{
+  SSL_CTX_set_keylog_callback (ssl_ctx, openssl_keylog_cb);
+  /* Records after the handshake are handled by the record layer, so no
+   * tickets after a tls 1.3 handshake and no tls 1.2 renegotiation */
+  SSL_CTX_set_num_tickets (ssl_ctx, 0);
+  SSL_CTX_set_options (ssl_ctx, SSL_OP_NO_RENEGOTIATION);
+}
+
+static u8
+openssl_app_is_builtin (tls_ctx_t *ctx)
+{
+  app_worker_t *app_wrk;
+
+  app_wrk = app_worker_get_if_valid (ctx->parent_app_wrk_index);
+  return app_wrk &&
+	 application_is_builtin (application_get (app_wrk->app_index));
+}
+
+static u32
+openssl_app_rx_fifo_size (tls_ctx_t *ctx)
+{
+  segment_manager_props_t *props;
+  app_worker_t *app_wrk;
+
+  app_wrk = app_worker_get_if_valid (ctx->parent_app_wrk_index);
+  if (!app_wrk)
+    return 0;
+  props = application_get_segment_manager_properties (app_wrk->app_index);
+  return props->rx_fifo_size;
+}
+
+static void
+openssl_record_offload_enable (openssl_ctx_t *oc)
+{
+  const SSL_CIPHER *cipher = SSL_get_current_cipher (oc->ssl);
+  u8 tx_secret[TLS_RECORD_MAX_SECRET], rx_secret[TLS_RECORD_MAX_SECRET];
+  u8 master[48], client_random[32], server_random[32];
+  tls_record_t *r = &oc->record;
+  vnet_crypto_alg_t alg;
+  clib_sha2_type_t hash;
+  u8 secret_len;
+
+  if (!cipher)
+    return;
+
+  /* Records are decrypted whole into the app's rx fifo, one that can't
+   * hold the largest would stall the connection */
+  if (openssl_app_rx_fifo_size (&oc->ctx) < TLS_RECORD_MAX_PLAINTEXT)
+    {
+      TLS_DBG (1, "Record offload for %u: app rx fifo too small",
+	       oc->openssl_ctx_index);
+      return;
+    }
+
+  switch (SSL_CIPHER_get_cipher_nid (cipher))
+    {
+    case NID_aes_128_gcm:
+      alg = VNET_CRYPTO_ALG_AES_128_GCM;
+      break;
+    case NID_aes_256_gcm:
+      alg = VNET_CRYPTO_ALG_AES_256_GCM;
+      break;
+    default:
+      return;
+    }
+
+  switch (EVP_MD_type (SSL_CIPHER_get_handshake_digest (cipher)))
+    {
+    case NID_sha256:
+      hash = CLIB_SHA2_256;
+      break;
+    case NID_sha384:
+      hash = CLIB_SHA2_384;
+      break;
+    default:
+      return;
+    }
+
+  if (SSL_version (oc->ssl) == TLS1_3_VERSION)
+    {
+      secret_len = r->secret_len;
+      clib_memcpy_fast (tx_secret, r->tx.secret, sizeof (tx_secret));
+      clib_memcpy_fast (rx_secret, r->rx.secret, sizeof (rx_secret));
+      tls_record_init_tls13 (r, alg, hash, tx_secret, rx_secret, secret_len);
+      clib_memset (tx_secret, 0, sizeof (tx_secret));
+      clib_memset (rx_secret, 0, sizeof (rx_secret));
+    }
+  else if (SSL_version (oc->ssl) == TLS1_2_VERSION)
+    {
+      if (SSL_SESSION_get_master_key (SSL_get_session (oc->ssl), master,
+				      sizeof (master)) != sizeof (master))
+	return;
+      SSL_get_client_random (oc->ssl, client_random, sizeof (client_random));
+      SSL_get_server_random (oc->ssl, server_random, sizeof (server_random));
+      tls_record_init_tls12 (r, alg, hash, master, client_random,
+			     server_random, SSL_is_server (oc->ssl));
+      clib_memset (master, 0, sizeof (master));
+    }
+
+  TLS_DBG (1, "Record offload for %u %s", oc->openssl_ctx_index,
+	   r->is_active ? "enabled" : "not supported");
+
+  if (r->is_active)
+    openssl_record_keys_request (oc);
+}
+
 static void
 openssl_handle_handshake_failure (tls_ctx_t * ctx)
 {
@@ -275,6 +531,13 @@ openssl_ctx_handshake_rx (tls_ctx_t * ctx, session_t * tls_session)
   openssl_ctx_t *oc = (openssl_ctx_t *) ctx;
   int rv = 0, err;
 
+  /* Resumed async job may have been completed by an earlier rx event */
+  if (ctx->resume && !SSL_in_init (oc->ssl))
+    {
+      ctx->resume = 0;
+      return 0;
+    }
+
   while (SSL_in_init (oc->ssl))
     {
       if (ctx->resume)
@@ -316,6 +579,9 @@ openssl_ctx_handshake_rx (tls_ctx_t * ctx, session_t * tls_session)
   /*
    * Handshake complete
    */
+  if (vnet_tls_get_main ()->record_offload)
+    openssl_record_offload_enable (oc);
+
   if (!SSL_is_server (oc->ssl))
     {
       /*
@@ -364,7 +630,16 @@ static void
 openssl_confirm_app_close (tls_ctx_t * ctx)
 {
   openssl_ctx_t *oc = (openssl_ctx_t *) ctx;
-  SSL_shutdown (oc->ssl);
+  session_t *ts;
+
+  if (oc->record.is_active)
+    {
+      ts = session_get_from_handle (ctx->tls_session_handle);
+      tls_record_write_close_notify (&oc->record, ts->tx_fifo);
+      tls_add_vpp_q_tx_evt (ts);
+    }
+  else
+    SSL_shutdown (oc->ssl);
   tls_disconnect_transport (ctx);
   session_transport_closed_notify (&ctx->connection);
 }
@@ -393,6 +668,14 @@ openssl_ctx_write_tls (tls_ctx_t *ctx, session_t *app_session,
 
   deq_max = clib_min (deq_max, sp->max_burst_size);
 
+  if (oc->record.is_active)
+    {
+      wrote = openssl_write_from_fifo_into_record (oc, f, ts, deq_max);
+      if (!wrote)
+	goto check_tls_fifo;
+      goto check_deq_ntf;
+    }
+
   /* Make sure tcp's tx fifo can actually buffer all bytes to be dequeued.
    * If under memory pressure, tls's fifo segment might not be able to
    * allocate the chunks needed. This also avoids errors from the underlying
@@ -404,6 +687,8 @@ openssl_ctx_write_tls (tls_ctx_t *ctx, session_t *app_session,
   if (!wrote)
     goto check_tls_fifo;
 
+check_deq_ntf:
+
   if (svm_fifo_needs_deq_ntf (f, wrote))
     session_dequeue_notify (app_session);
 
@@ -503,18 +788,46 @@ openssl_ctx_read_tls (tls_ctx_t *ctx, session_t *tls_session)
 {
   openssl_ctx_t *oc = (openssl_ctx_t *) ctx;
   session_t *app_session;
-  int read;
+  int read, rv;
   svm_fifo_t *f;
 
   if (PREDICT_FALSE (SSL_in_init (oc->ssl)))
     {
       if (openssl_ctx_handshake_rx (ctx, tls_session) < 0)
 	return 0;
+
+      /* Accept may have allocated the app session and grown the pool */
+      tls_session = session_get_from_handle (ctx->tls_session_handle);
     }
 
   app_session = session_get_from_handle (ctx->app_session_handle);
   f = app_session->rx_fifo;
 
+  if (oc->record.is_active)
+    {
+      read = openssl_read_from_record_into_fifo (oc, f, tls_session);
+
+      if (read && app_session->session_state >= SESSION_STATE_READY)
+	tls_notify_app_enqueue (ctx, app_session);
+
+      /* Partial records wait for more data from the transport, full ones
+       * for the app to make room. Builtin apps don't notify rx dequeues,
+       * so poll for them as the openssl path does */
+      rv = tls_record_rx_pending (&oc->record, tls_session->rx_fifo, f);
+      if (rv > 0)
+	tls_add_vpp_q_builtin_rx_evt (tls_session);
+      else if (rv < 0)
+	{
+	  /* Recheck, the app may have dequeued before the request */
+	  svm_fifo_add_want_deq_ntf (f, SVM_FIFO_WANT_DEQ_NOTIF);
+	  if (openssl_app_is_builtin (ctx) ||
+	      tls_record_rx_pending (&oc->record, tls_session->rx_fifo, f) > 0)
+	    tls_add_vpp_q_builtin_rx_evt (tls_session);
+	}
+
+      return read;
+    }
+
   read = openssl_read_from_ssl_into_fifo (f, oc->ssl);
 
   /* If handshake just completed, session may still be in accepting state */
@@ -637,6 +950,8 @@ openssl_ctx_init_client (tls_ctx_t * ctx)
 
   SSL_CTX_set_options (oc->ssl_ctx, flags);
   SSL_CTX_set_cert_store (oc->ssl_ctx, om->cert_store);
+  if (vnet_tls_get_main ()->record_offload)
+    openssl_record_offload_init (oc->ssl_ctx);
 
   oc->ssl = SSL_new (oc->ssl_ctx);
   if (oc->ssl == NULL)
@@ -658,6 +973,7 @@ openssl_ctx_init_client (tls_ctx_t * ctx)
 
   SSL_set_bio (oc->ssl, oc->wbio, oc->rbio);
   SSL_set_connect_state (oc->ssl);
+  SSL_set_app_data (oc->ssl, uword_to_pointer (oc->openssl_ctx_index, void *));
 
   rv = SSL_set_tlsext_host_name (oc->ssl, ctx->srv_hostname);
   if (rv != 1)
@@ -743,6 +1059,8 @@ openssl_start_listen (tls_ctx_t * lctx)
 #endif
   SSL_CTX_set_options (ssl_ctx, flags);
   SSL_CTX_set_ecdh_auto (ssl_ctx, 1);
+  if (vnet_tls_get_main ()->record_offload)
+    openssl_record_offload_init (ssl_ctx);
 
   rv = SSL_CTX_set_cipher_list (ssl_ctx, (const char *) om->ciphers);
   if (rv != 1)
@@ -797,6 +1115,10 @@ openssl_start_listen (tls_ctx_t * lctx)
       clib_warning ("unable to parse pkey");
       goto err;
     }
+#ifdef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+  if (om->pkey_offload)
+    pkey = openssl_pkey_offload_wrap (pkey);
+#endif
   rv = SSL_CTX_use_PrivateKey (ssl_ctx, pkey);
   if (rv != 1)
     {
@@ -872,6 +1194,7 @@ openssl_ctx_init_server (tls_ctx_t * ctx)
 
   SSL_set_bio (oc->ssl, oc->wbio, oc->rbio);
   SSL_set_accept_state (oc->ssl);
+  SSL_set_app_data (oc->ssl, uword_to_pointer (oc->openssl_ctx_index, void *));
 
   TLS_DBG (1, "Initiating handshake for [%u]%u", ctx->c_thread_index,
 	   oc->openssl_ctx_index);
@@ -1085,7 +1408,8 @@ tls_openssl_set_command_fn (vlib_main_t * vm, unformat_input_t * input,
   char *engine_name = NULL;
   char *engine_alg = NULL;
   char *ciphers = NULL;
-  u8 engine_name_set = 0;
+  u8 engine_name_set = 0, pkey_offload = 0, is_disable = 0;
+  u32 n_threads = 1;
   int i, async = 0;
 
   /* By present, it is not allowed to configure engine again after running */
@@ -1115,11 +1439,51 @@ tls_openssl_set_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	{
 	  tls_openssl_set_ciphers (ciphers);
 	}
+      else if (unformat (input, "pkey-offload"))
+	{
+	  pkey_offload = 1;
+	}
+      else if (unformat (input, "threads %u", &n_threads))
+	;
+      else if (unformat (input, "disable"))
+	is_disable = 1;
       else
 	return clib_error_return (0, "failed: unknown input `%U'",
 				  format_unformat_error, input);
     }
 
+#ifndef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+  if (pkey_offload || is_disable)
+    return clib_error_return (0, "pkey offload needs openssl 3.0 or newer");
+#else
+  if (pkey_offload && is_disable)
+    {
+      if (!om->pkey_offload)
+	return clib_error_return (0, "pkey offload not enabled");
+      openssl_pkey_offload_disable ();
+      vlib_cli_output (vm, "pkey offload disabled");
+      om->pkey_offload = 0;
+      return 0;
+    }
+
+  if (pkey_offload)
+    {
+      if (engine_name_set)
+	return clib_error_return (0, "pkey offload can't be used with an "
+				  "engine");
+      if (om->pkey_offload)
+	return clib_error_return (0, "pkey offload already enabled");
+      vnet_session_enable_disable (vm, 1);
+      if (openssl_pkey_offload_enable (n_threads))
+	return clib_error_return (0, "failed to enable pkey offload");
+      vlib_cli_output (vm, "pkey offload enabled with %u threads",
+		       n_threads);
+      om->pkey_offload = 1;
+      om->async = 1;
+      return 0;
+    }
+#endif
+
   /* reset parameters if engine is not configured */
   if (!engine_name_set)
     {
@@ -1149,10 +1513,86 @@ tls_openssl_set_command_fn (vlib_main_t * vm, unformat_input_t * input,
 VLIB_CLI_COMMAND (tls_openssl_set_command, static) =
 {
   .path = "tls openssl set",
-  .short_help = "tls openssl set [engine <engine name>] [alg [algorithm] [async]",
+  .short_help = "tls openssl set [engine <engine name>] [alg [algorithm] "
+		"[async] [pkey-offload [threads <n>|disable]]",
   .function = tls_openssl_set_command_fn,
 };
 /* *INDENT-ON* */
+
+#ifdef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+static clib_error_t *
+show_tls_openssl_pkey_offload_command_fn (vlib_main_t *vm,
+					  unformat_input_t *input,
+					  vlib_cli_command_t *cmd)
+{
+  vlib_cli_output (vm, "%U", format_openssl_pkey_offload);
+  return 0;
+}
+
+/*?
+ * Show the crypto threads of tls private key offload and the private key
+ * operations they ran.
+ *
+ * @cliexpar
+ * @cliexstart{show tls openssl pkey-offload}
+ * crypto threads: 2
+ * ops offloaded: 8
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (show_tls_openssl_pkey_offload_command, static) = {
+  .path = "show tls openssl pkey-offload",
+  .short_help = "show tls openssl pkey-offload",
+  .function = show_tls_openssl_pkey_offload_command_fn,
+};
+#endif
+
+static clib_error_t *
+tls_openssl_config_fn (vlib_main_t *vm, unformat_input_t *input)
+{
+  openssl_main_t *om = &openssl_main;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "pkey-offload-threads %u",
+		    &om->pkey_offload_threads))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+#ifndef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+  if (om->pkey_offload_threads)
+    return clib_error_return (0, "pkey offload needs openssl 3.0 or newer");
+#endif
+
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (tls_openssl_config_fn, "tls-openssl");
+
+#ifdef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+/* after the workers start, so the polling node can be enabled on them */
+static clib_error_t *
+tls_openssl_main_loop_enter (vlib_main_t *vm)
+{
+  openssl_main_t *om = &openssl_main;
+
+  if (!om->pkey_offload_threads)
+    return 0;
+
+  if (openssl_pkey_offload_enable (om->pkey_offload_threads))
+    return clib_error_return (0, "failed to enable pkey offload");
+
+  om->pkey_offload = 1;
+  om->async = 1;
+  return 0;
+}
+
+VLIB_MAIN_LOOP_ENTER_FUNCTION (tls_openssl_main_loop_enter) = {
+  .runs_after = VLIB_INITS ("start_workers"),
+};
+#endif /* HAVE_OPENSSL_ASYNC_WAIT_CALLBACK */
 #endif
 
 /* *INDENT-OFF* */
@@ -23,6 +23,7 @@
 #include <vnet/plugin/plugin.h>
 #include <vpp/app/version.h>
 #include <vnet/tls/tls.h>
+#include <vnet/tls/tls_record.h>
 
 #define TLSO_CTRL_BYTES 1000
 #define TLSO_MIN_ENQ_SPACE (1 << 16)
@@ -37,6 +38,7 @@ typedef struct tls_ctx_openssl_
   SSL *ssl;
   BIO *rbio;
   BIO *wbio;
+  tls_record_t record;
 } openssl_ctx_t;
 
 typedef struct tls_listen_ctx_opensl_
@@ -63,6 +65,9 @@ typedef struct openssl_main_
   u8 *ciphers;
   int engine_init;
   int async;
+  int pkey_offload;
+  /* crypto threads to start pkey offload with, from startup config */
+  u32 pkey_offload_threads;
 } openssl_main_t;
 
 typedef int openssl_resume_handler (tls_ctx_t * ctx, session_t * tls_session);
@@ -80,6 +85,12 @@ void openssl_async_node_enable_disable (u8 is_en);
 clib_error_t *tls_openssl_api_init (vlib_main_t * vm);
 int tls_openssl_set_ciphers (char *ciphers);
 int vpp_openssl_is_inflight (tls_ctx_t * ctx);
+#ifdef HAVE_OPENSSL_ASYNC_WAIT_CALLBACK
+int openssl_pkey_offload_enable (u32 n_threads);
+int openssl_pkey_offload_disable (void);
+format_function_t format_openssl_pkey_offload;
+EVP_PKEY *openssl_pkey_offload_wrap (EVP_PKEY *pkey);
+#endif
 
 #endif /* SRC_PLUGINS_TLSOPENSSL_TLS_OPENSSL_H_ */
 
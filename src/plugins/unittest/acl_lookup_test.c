@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <vppinfra/random.h>
+#include <plugins/acl/exports.h>
+
+/* the lookup loops are built for each march variant, as in the node */
+CLIB_MARCH_FN (acl_lookup_test_variant, char *, void)
+{
+  return CLIB_MARCH_VARIANT_STR;
+}
+
+/* per packet, as the acl-plugin nodes do without batching */
+CLIB_MARCH_FN (acl_lookup_test_scalar, void, acl_main_t *am, u32 lc_index,
+	       fa_5tuple_t *match, u32 *match_index, u32 n)
+{
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    {
+      match[i].pkt.lc_index = lc_index;
+      match_index[i] =
+	multi_acl_match_get_applied_ace_index (am, 0 /* is_ip6 */, &match[i]);
+    }
+}
+
+CLIB_MARCH_FN (acl_lookup_test_batch, void, acl_main_t *am, u32 lc_index,
+	       fa_5tuple_t *match, u32 *indices, u32 *match_index, u32 n)
+{
+  multi_acl_match_get_applied_ace_index_xN (am, 0 /* is_ip6 */, lc_index,
+					    match, indices, n, match_index);
+}
+
+#ifndef CLIB_MARCH_VARIANT
+
+typedef struct
+{
+  ip4_address_t src, dst;
+  u8 src_len, dst_len;
+} acl_lookup_test_rule_t;
+
+static u32
+acl_lookup_test_mask (u8 len)
+{
+  return clib_host_to_net_u32 (len ? ~0 << (32 - len) : 0);
+}
+
+static int
+acl_lookup_test_cli (vlib_main_t *vm, char *fmt, ...)
+{
+  unformat_input_t input;
+  va_list va;
+  u8 *s;
+  int rv;
+
+  va_start (va, fmt);
+  s = va_format (0, fmt, &va);
+  va_end (va);
+
+  unformat_init_vector (&input, s);
+  rv = vlib_cli_input (vm, &input, 0, 0);
+  unformat_free (&input);
+  return rv;
+}
+
+/* the ACL which isn't in the bitmap of the ones which existed before */
+static u32
+acl_lookup_test_new_acl (acl_main_t *am, uword *acls_before)
+{
+  acl_list_t *a;
+  u32 acl_index = ~0;
+
+  pool_foreach (a, am->acls)
+    {
+      if (!clib_bitmap_get (acls_before, a - am->acls))
+	acl_index = a - am->acls;
+    }
+  return acl_index;
+}
+
+static clib_error_t *
+acl_lookup_test_perf (vlib_main_t *vm, unformat_input_t *input,
+		      vlib_cli_command_t *cmd)
+{
+  acl_plugin_methods_t acl_plugin;
+  clib_error_t *error = 0;
+  acl_main_t *am;
+  acl_list_t *a;
+  uword *acls_before = 0;
+  acl_lookup_test_rule_t *rules = 0, *r;
+  fa_5tuple_t *tuples = 0, *t;
+  u32 *scalar = 0, *batch = 0, *indices = 0, *acl_vec = 0;
+  u32 n_rules = 1000, n_mask_types = 64, n_lookups = 1 << 16, seed = 0xdead;
+  u32 i, c, user_id, acl_index = ~0, n_mismatch = 0, n_hits = 0;
+  u32 use_tuple_merge;
+  int lc_index;
+  u64 t0, t_scalar, t_batch;
+  u8 *s = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "rules %u", &n_rules))
+	;
+      else if (unformat (input, "mask-types %u", &n_mask_types))
+	;
+      else if (unformat (input, "lookups %u", &n_lookups))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (!n_rules || !n_mask_types || n_mask_types > 24 * 16)
+    return clib_error_return (0, "rules and mask-types (1 to 384) please");
+  n_lookups = round_pow2 (clib_max (n_lookups, 1), VLIB_FRAME_SIZE);
+
+  if ((error = acl_plugin_exports_init (&acl_plugin)))
+    return error;
+  am = acl_plugin.p_acl_main;
+
+  /* keep the mask types apart, rather than merged into the widest one */
+  use_tuple_merge = am->use_tuple_merge;
+  am->use_tuple_merge = 0;
+
+  /* each combination of source and destination prefix length is a mask */
+  vec_validate (rules, n_rules - 1);
+  for (i = 0; i < n_rules; i++)
+    {
+      r = &rules[i];
+      c = i % n_mask_types;
+      r->src_len = 8 + c % 24;
+      r->dst_len = 16 + c / 24;
+      r->src.as_u32 = random_u32 (&seed) & acl_lookup_test_mask (r->src_len);
+      r->dst.as_u32 = random_u32 (&seed) & acl_lookup_test_mask (r->dst_len);
+      s = format (s, "%spermit src %U/%u dst %U/%u proto 17 sport 0-65535 "
+		  "dport 1000-1999", i ? ", " : "", format_ip4_address,
+		  &r->src, r->src_len, format_ip4_address, &r->dst,
+		  r->dst_len);
+    }
+  vec_add1 (s, 0);
+
+  pool_foreach (a, am->acls)
+    acls_before = clib_bitmap_set (acls_before, a - am->acls, 1);
+
+  acl_lookup_test_cli (vm, "set acl-plugin acl %s", s);
+  acl_index = acl_lookup_test_new_acl (am, acls_before);
+  if (acl_index == ~0)
+    {
+      error = clib_error_return (0, "failed to add the ACL");
+      goto done;
+    }
+
+  user_id = acl_plugin.register_user_module ("unittest acl lookup", 0, 0);
+  lc_index = acl_plugin.get_lookup_context_index (user_id, 0, 0);
+  if (lc_index < 0)
+    {
+      error = clib_error_return (0, "no lookup context");
+      goto done;
+    }
+  vec_add1 (acl_vec, acl_index);
+  acl_plugin.set_acl_vec_for_context (lc_index, acl_vec);
+
+  vlib_cli_output (
+    vm, "%u rules, %u mask types applied", n_rules,
+    vec_len (am->hash_applied_mask_info_vec_by_lc_index[lc_index]));
+
+  /* half of the lookups hit a rule, the rest are random */
+  vec_validate (tuples, n_lookups - 1);
+  vec_validate (scalar, n_lookups - 1);
+  vec_validate (batch, n_lookups - 1);
+  vec_validate (indices, VLIB_FRAME_SIZE - 1);
+  for (i = 0; i < VLIB_FRAME_SIZE; i++)
+    indices[i] = i;
+
+  for (i = 0; i < n_lookups; i++)
+    {
+      t = &tuples[i];
+      clib_memset (t, 0, sizeof (*t));
+      t->ip4_addr[0].as_u32 = random_u32 (&seed);
+      t->ip4_addr[1].as_u32 = random_u32 (&seed);
+      if (i & 1)
+	{
+	  r = &rules[random_u32 (&seed) % n_rules];
+	  t->ip4_addr[0].as_u32 &= ~acl_lookup_test_mask (r->src_len);
+	  t->ip4_addr[0].as_u32 |= r->src.as_u32;
+	  t->ip4_addr[1].as_u32 &= ~acl_lookup_test_mask (r->dst_len);
+	  t->ip4_addr[1].as_u32 |= r->dst.as_u32;
+	}
+      t->l4.proto = IP_PROTOCOL_UDP;
+      t->l4.port[0] = random_u32 (&seed);
+      t->l4.port[1] = 1000 + random_u32 (&seed) % 1000;
+      t->pkt.l4_valid = 1;
+    }
+
+  /* a frame at a time, as the data plane would */
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_lookups; i += VLIB_FRAME_SIZE)
+    CLIB_MARCH_FN_SELECT (acl_lookup_test_scalar)
+    (am, lc_index, tuples + i, scalar + i, VLIB_FRAME_SIZE);
+  t_scalar = clib_cpu_time_now () - t0;
+
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_lookups; i += VLIB_FRAME_SIZE)
+    CLIB_MARCH_FN_SELECT (acl_lookup_test_batch)
+    (am, lc_index, tuples + i, indices, batch + i, VLIB_FRAME_SIZE);
+  t_batch = clib_cpu_time_now () - t0;
+
+  for (i = 0; i < n_lookups; i++)
+    {
+      if (scalar[i] != batch[i])
+	n_mismatch++;
+      if (scalar[i] != ~0 - 1)
+	n_hits++;
+    }
+
+  vlib_cli_output (vm, "%u lookups, %u hits, %s variant", n_lookups, n_hits,
+		   CLIB_MARCH_FN_SELECT (acl_lookup_test_variant) ());
+  vlib_cli_output (vm, "  scalar: %.2f clocks/lookup",
+		   (f64) t_scalar / n_lookups);
+  vlib_cli_output (vm, "  batch:  %.2f clocks/lookup, speedup %.2f",
+		   (f64) t_batch / n_lookups, (f64) t_scalar / t_batch);
+  vlib_cli_output (vm, "  mismatches: %u", n_mismatch);
+
+  if (n_mismatch)
+    error = clib_error_return (0, "%u batched lookups differ", n_mismatch);
+
+  vec_reset_length (acl_vec);
+  acl_plugin.set_acl_vec_for_context (lc_index, acl_vec);
+  acl_plugin.put_lookup_context_index (lc_index);
+
+done:
+  am->use_tuple_merge = use_tuple_merge;
+  if (acl_index != ~0)
+    acl_lookup_test_cli (vm, "delete acl-plugin acl index %u", acl_index);
+  clib_bitmap_free (acls_before);
+
+  vec_free (rules);
+  vec_free (tuples);
+  vec_free (scalar);
+  vec_free (batch);
+  vec_free (indices);
+  vec_free (acl_vec);
+  vec_free (s);
+  return error;
+}
+
+/*?
+ * Benchmark the tuple merge hash ACL lookup, per packet and batched a
+ * mask type at a time for a frame, against one ACL with the given
+ * number of rules spread over the given number of mask types.
+ *
+ * @cliexpar
+ * @cliexstart{test acl-plugin lookup perf rules 1000 mask-types 64}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (test_acl_lookup_perf_command, static) = {
+  .path = "test acl-plugin lookup perf",
+  .short_help = "test acl-plugin lookup perf [rules <n>] [mask-types <n>] "
+		"[lookups <n>] [seed <n>]",
+  .function = acl_lookup_test_perf,
+};
+
+#endif /* CLIB_MARCH_VARIANT */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -150,3 +150,57 @@ UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_tc3) = {
 };
 /* *INDENT-ON* */
 
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_1) = {
+  .name = "CHACHA20-POLY1305 (incr 1 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 1,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_63) = {
+  .name = "CHACHA20-POLY1305 (incr 63 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 63,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_64) = {
+  .name = "CHACHA20-POLY1305 (incr 64 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 64,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_65) = {
+  .name = "CHACHA20-POLY1305 (incr 65 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 65,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_1024) = {
+  .name = "CHACHA20-POLY1305 (incr 1024 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 1024,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_1500) = {
+  .name = "CHACHA20-POLY1305 (incr 1500 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 1500,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
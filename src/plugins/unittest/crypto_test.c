@@ -911,6 +911,12 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
       break;
     }
 
+  /* set crypto handler <alg> <engine> selects what is measured */
+  i = cm->opt_data[ad->op_by_type[ot]].active_engine_index_simple;
+  if (i != ~0)
+    vlib_cli_output (vm, "   engine %s",
+		     vec_elt_at_index (cm->engines, i)->name);
+
   for (i = 0; i < n_buffers; i++)
     {
       vlib_buffer_t *b = vlib_get_buffer (vm, buffer_indices[i]);
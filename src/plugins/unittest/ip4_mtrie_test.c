@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <vppinfra/random.h>
+#include <vnet/ip/ip4_mtrie.h>
+
+/*
+ * The lookup loops are built for each march variant, so the batched
+ * lookup uses whatever gathers the CPU running the test has.
+ */
+CLIB_MARCH_FN (ip4_mtrie_test_variant, char *, void)
+{
+  return CLIB_MARCH_VARIANT_STR;
+}
+
+/* the scalar lookup as done by ip4-lookup, four at a time */
+CLIB_MARCH_FN (ip4_mtrie_test_lookup_scalar, void, const ip4_mtrie_16_t *m,
+	       const ip4_address_t *a, u32 *adj_indices, u32 n)
+{
+  ip4_mtrie_leaf_t leaf[4];
+  u32 i;
+
+  for (i = 0; i + 4 <= n; i += 4)
+    {
+      leaf[0] = ip4_mtrie_16_lookup_step_one (m, &a[i + 0]);
+      leaf[1] = ip4_mtrie_16_lookup_step_one (m, &a[i + 1]);
+      leaf[2] = ip4_mtrie_16_lookup_step_one (m, &a[i + 2]);
+      leaf[3] = ip4_mtrie_16_lookup_step_one (m, &a[i + 3]);
+
+      leaf[0] = ip4_mtrie_16_lookup_step (leaf[0], &a[i + 0], 2);
+      leaf[1] = ip4_mtrie_16_lookup_step (leaf[1], &a[i + 1], 2);
+      leaf[2] = ip4_mtrie_16_lookup_step (leaf[2], &a[i + 2], 2);
+      leaf[3] = ip4_mtrie_16_lookup_step (leaf[3], &a[i + 3], 2);
+
+      leaf[0] = ip4_mtrie_16_lookup_step (leaf[0], &a[i + 0], 3);
+      leaf[1] = ip4_mtrie_16_lookup_step (leaf[1], &a[i + 1], 3);
+      leaf[2] = ip4_mtrie_16_lookup_step (leaf[2], &a[i + 2], 3);
+      leaf[3] = ip4_mtrie_16_lookup_step (leaf[3], &a[i + 3], 3);
+
+      adj_indices[i + 0] = ip4_mtrie_leaf_get_adj_index (leaf[0]);
+      adj_indices[i + 1] = ip4_mtrie_leaf_get_adj_index (leaf[1]);
+      adj_indices[i + 2] = ip4_mtrie_leaf_get_adj_index (leaf[2]);
+      adj_indices[i + 3] = ip4_mtrie_leaf_get_adj_index (leaf[3]);
+    }
+
+  for (; i < n; i++)
+    {
+      leaf[0] = ip4_mtrie_16_lookup_step_one (m, &a[i]);
+      leaf[0] = ip4_mtrie_16_lookup_step (leaf[0], &a[i], 2);
+      leaf[0] = ip4_mtrie_16_lookup_step (leaf[0], &a[i], 3);
+      adj_indices[i] = ip4_mtrie_leaf_get_adj_index (leaf[0]);
+    }
+}
+
+CLIB_MARCH_FN (ip4_mtrie_test_lookup_batch, void, const ip4_mtrie_16_t *m,
+	       const ip4_address_t *a, u32 *adj_indices, u32 n)
+{
+  ip4_mtrie_16_lookup_n (m, a, adj_indices, n);
+}
+
+#ifndef CLIB_MARCH_VARIANT
+
+typedef struct ip4_mtrie_test_route_t_
+{
+  ip4_address_t addr;
+  u32 len;
+} ip4_mtrie_test_route_t;
+
+/*
+ * Approximate prefix length distribution of the public IPv4 routing
+ * table, in percent. The remaining prefixes are spread over /8 to /15.
+ */
+static const u8 ip4_mtrie_test_len_pct[33] = {
+  [16] = 1, [17] = 1, [18] = 2, [19] = 3, [20] = 4,
+  [21] = 5, [22] = 12, [23] = 10, [24] = 60,
+};
+
+static u32
+ip4_mtrie_test_random_len (u32 *seed)
+{
+  u32 pct = random_u32 (seed) % 100, len, sum = 0;
+
+  for (len = 16; len <= 24; len++)
+    {
+      sum += ip4_mtrie_test_len_pct[len];
+      if (pct < sum)
+	return len;
+    }
+  return 8 + random_u32 (seed) % 8;
+}
+
+static u64
+ip4_mtrie_test_key (const ip4_address_t *addr, u32 len)
+{
+  return ((u64) addr->as_u32 << 8) | len;
+}
+
+static u32
+ip4_mtrie_test_mask (u32 len)
+{
+  return len ? clib_host_to_net_u32 (~0U << (32 - len)) : 0;
+}
+
+static clib_error_t *
+ip4_mtrie_test_perf (vlib_main_t *vm, unformat_input_t *input,
+		     vlib_cli_command_t *cmd)
+{
+  u32 n_routes = 900000, n_lookups = 1 << 20, seed = 0xdeadbeef;
+  u32 *scalar = 0, *batch = 0, *by_len[33] = {}, i, len, n_mismatch = 0;
+  ip4_mtrie_test_route_t *routes = 0, *r;
+  ip4_address_t *addrs = 0;
+  uword *route_by_key;
+  ip4_mtrie_16_t *m;
+  u64 t0, t_scalar, t_batch;
+  f64 start;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "routes %u", &n_routes))
+	;
+      else if (unformat (input, "lookups %u", &n_lookups))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  n_lookups = round_pow2 (clib_max (n_lookups, VLIB_FRAME_SIZE),
+			  VLIB_FRAME_SIZE);
+  route_by_key = hash_create (0, sizeof (uword));
+
+  m = clib_mem_alloc_aligned (sizeof (*m), CLIB_CACHE_LINE_BYTES);
+  ip4_mtrie_16_init (m);
+
+  /* a default route, so that every route has a cover when removed */
+  vec_add2 (routes, r, 1);
+  r->addr.as_u32 = 0;
+  r->len = 0;
+  hash_set (route_by_key, ip4_mtrie_test_key (&r->addr, 0), 0);
+
+  start = vlib_time_now (vm);
+  while (vec_len (routes) <= n_routes)
+    {
+      ip4_address_t addr;
+
+      len = ip4_mtrie_test_random_len (&seed);
+      /* unicast space, 1.0.0.0 to 223.255.255.255 */
+      addr.as_u32 = clib_host_to_net_u32 (
+	((1 + random_u32 (&seed) % 223) << 24) |
+	(random_u32 (&seed) & 0xffffff));
+      addr.as_u32 &= ip4_mtrie_test_mask (len);
+
+      if (hash_get (route_by_key, ip4_mtrie_test_key (&addr, len)))
+	continue;
+
+      vec_add2 (routes, r, 1);
+      r->addr = addr;
+      r->len = len;
+      hash_set (route_by_key, ip4_mtrie_test_key (&addr, len),
+		r - routes);
+    }
+
+  vec_foreach (r, routes)
+    ip4_mtrie_16_route_add (m, &r->addr, r->len, 1 + r - routes);
+
+  vlib_cli_output (vm, "%u routes added in %.2fs, %U in plys",
+		   vec_len (routes), vlib_time_now (vm) - start,
+		   format_memory_size, ip4_mtrie_16_memory_usage (m));
+
+  /* half of the lookups hit a route, the rest are random */
+  vec_validate (addrs, n_lookups - 1);
+  vec_validate (scalar, n_lookups - 1);
+  vec_validate (batch, n_lookups - 1);
+  for (i = 0; i < n_lookups; i++)
+    {
+      if (i & 1)
+	{
+	  r = &routes[1 + random_u32 (&seed) % (vec_len (routes) - 1)];
+	  addrs[i].as_u32 = r->addr.as_u32 | (random_u32 (&seed) &
+					      ~ip4_mtrie_test_mask (r->len));
+	}
+      else
+	addrs[i].as_u32 = random_u32 (&seed);
+    }
+
+  /* a frame at a time, as the data plane would */
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_lookups; i += VLIB_FRAME_SIZE)
+    CLIB_MARCH_FN_SELECT (ip4_mtrie_test_lookup_scalar)
+    (m, addrs + i, scalar + i, VLIB_FRAME_SIZE);
+  t_scalar = clib_cpu_time_now () - t0;
+
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_lookups; i += VLIB_FRAME_SIZE)
+    CLIB_MARCH_FN_SELECT (ip4_mtrie_test_lookup_batch)
+    (m, addrs + i, batch + i, VLIB_FRAME_SIZE);
+  t_batch = clib_cpu_time_now () - t0;
+
+  for (i = 0; i < n_lookups; i++)
+    if (scalar[i] != batch[i])
+      n_mismatch++;
+
+  vlib_cli_output (vm, "%u lookups, %s variant", n_lookups,
+		   CLIB_MARCH_FN_SELECT (ip4_mtrie_test_variant) ());
+  vlib_cli_output (vm, "  scalar: %.2f clocks/lookup, %.3f lookups/clock",
+		   (f64) t_scalar / n_lookups, (f64) n_lookups / t_scalar);
+  vlib_cli_output (vm, "  batch:  %.2f clocks/lookup, %.3f lookups/clock",
+		   (f64) t_batch / n_lookups, (f64) n_lookups / t_batch);
+  vlib_cli_output (vm, "  mismatches: %u", n_mismatch);
+
+  /*
+   * remove the longest prefixes first, so the cover of each is the
+   * longest remaining route that contains it
+   */
+  vec_foreach (r, routes)
+    if (r->len)
+      vec_add1 (by_len[r->len], r - routes);
+
+  for (len = 32; len > 0; len--)
+    {
+      u32 *ri;
+
+      vec_foreach (ri, by_len[len])
+	{
+	  ip4_address_t cover;
+	  u32 cover_len, cover_index = 0;
+	  uword *p;
+
+	  r = &routes[*ri];
+	  hash_unset (route_by_key, ip4_mtrie_test_key (&r->addr, len));
+
+	  for (cover_len = len - 1; cover_len > 0; cover_len--)
+	    {
+	      cover.as_u32 = r->addr.as_u32 & ip4_mtrie_test_mask (cover_len);
+	      p = hash_get (route_by_key,
+			    ip4_mtrie_test_key (&cover, cover_len));
+	      if (p)
+		{
+		  cover_index = p[0];
+		  break;
+		}
+	    }
+	  ip4_mtrie_16_route_del (m, &r->addr, len, 1 + *ri,
+				  routes[cover_index].len, 1 + cover_index);
+	}
+      vec_free (by_len[len]);
+    }
+  ip4_mtrie_16_route_del (m, &routes[0].addr, 0, 1, 0, 0);
+
+  ip4_mtrie_16_free (m);
+  clib_mem_free (m);
+  hash_free (route_by_key);
+  vec_free (routes);
+  vec_free (addrs);
+  vec_free (scalar);
+  vec_free (batch);
+
+  if (n_mismatch)
+    return clib_error_return (0, "%u batched lookups differ", n_mismatch);
+
+  return 0;
+}
+
+/*?
+ * Benchmark the ip4 mtrie lookup, scalar as done per packet and batched
+ * with gathers, against a synthetic table with the prefix length
+ * distribution of the public IPv4 routing table.
+ *
+ * @cliexpar
+ * @cliexstart{test ip4 mtrie perf routes 900000 lookups 1048576}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (test_ip4_mtrie_perf_command, static) = {
+  .path = "test ip4 mtrie perf",
+  .short_help = "test ip4 mtrie perf [routes <n>] [lookups <n>] [seed <n>]",
+  .function = ip4_mtrie_test_perf,
+};
+
+#endif /* CLIB_MARCH_VARIANT */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -67,6 +67,191 @@ VLIB_CLI_COMMAND (test_ipsec_command, static) =
 };
 /* *INDENT-ON* */
 
+static ipsec_policy_t *
+test_ipsec_spd_lookup (ipsec_spd_t *spd, u8 pr, u32 la, u32 ra, u16 lp,
+		       u16 rp)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u32 *i, *candidates, n_candidates;
+  ipsec_policy_t *p;
+
+  candidates = ipsec_spd_policy_candidates_ip4 (
+    spd, IPSEC_SPD_POLICY_IP4_OUTBOUND, la, ra, &n_candidates);
+
+  for (i = candidates; i < candidates + n_candidates; i++)
+    {
+      p = pool_elt_at_index (im->policies, *i);
+      if (p->protocol && (p->protocol != pr))
+	continue;
+      if (ra < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32) ||
+	  ra > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+	continue;
+      if (la < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32) ||
+	  la > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+	continue;
+      if (lp < p->lport.start || lp > p->lport.stop)
+	continue;
+      if (rp < p->rport.start || rp > p->rport.stop)
+	continue;
+      return p;
+    }
+  return 0;
+}
+
+static clib_error_t *
+test_ipsec_spd_perf_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				vlib_cli_command_t *cmd)
+{
+  u32 spd_id = 0x7fffffff, n_policies = 10000, n_lookups = 1000000;
+  ipsec_policy_t policy, *vp, **linear = 0, **compiled = 0;
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_spd_compiled_t *c;
+  clib_error_t *err = 0;
+  u32 *la = 0, *ra = 0, *policies;
+  u32 i, net, stat_index, n_mismatch = 0, seed = 0xdeadbeef;
+  u64 t0, t1, t2;
+  f64 rate[2];
+  ipsec_spd_t *spd;
+  uword *p;
+  int rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "policies %u", &n_policies))
+	;
+      else if (unformat (input, "lookups %u", &n_lookups))
+	;
+      else if (unformat (input, "spd %u", &spd_id))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (n_policies == 0 || n_policies > (1 << 16) || n_lookups == 0)
+    return clib_error_return (0, "policies must be 1-65536, lookups > 0");
+
+  if ((rv = ipsec_add_del_spd (vm, spd_id, 1)))
+    return clib_error_return (0, "SPD %u add failed: %d", spd_id, rv);
+  p = hash_get (im->spd_index_by_spd_id, spd_id);
+  spd = pool_elt_at_index (im->spds, p[0]);
+
+  /*
+   * One UDP policy per remote /24 in 10.0.0.0/8, each allowing a port
+   * range, with a few low priority catch-all policies behind them.
+   */
+  clib_memset (&policy, 0, sizeof (policy));
+  policy.id = spd_id;
+  policy.type = IPSEC_SPD_POLICY_IP4_OUTBOUND;
+  policy.policy = IPSEC_POLICY_ACTION_BYPASS;
+  policy.laddr.stop.ip4.as_u32 = ~0;
+  policy.lport.stop = 0xffff;
+
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_policies; i++)
+    {
+      net = (10 << 24) | (i << 8);
+      policy.priority = n_policies - i;
+      policy.protocol = IP_PROTOCOL_UDP;
+      policy.raddr.start.ip4.as_u32 = clib_host_to_net_u32 (net);
+      policy.raddr.stop.ip4.as_u32 = clib_host_to_net_u32 (net | 0xff);
+      policy.rport.start = 1000 + (i % 1000);
+      policy.rport.stop = policy.rport.start + 1000;
+
+      if (i + 4 >= n_policies)
+	{
+	  policy.protocol = 0;
+	  policy.raddr.start.ip4.as_u32 = 0;
+	  policy.raddr.stop.ip4.as_u32 = ~0;
+	  policy.rport.start = 0;
+	  policy.rport.stop = 0xffff;
+	}
+
+      if ((rv = ipsec_add_del_policy (vm, &policy, 1, &stat_index)))
+	{
+	  err = clib_error_return (0, "policy add failed: %d", rv);
+	  goto done;
+	}
+    }
+  t1 = clib_cpu_time_now ();
+
+  /* don't wait for the background compile */
+  ipsec_spd_policy_compile (spd, IPSEC_SPD_POLICY_IP4_OUTBOUND);
+  t2 = clib_cpu_time_now ();
+
+  vlib_cli_output (vm, "%u policies added in %.3f sec, compiled in %.3f sec",
+		   n_policies, (f64) (t1 - t0) * vm->clib_time.seconds_per_clock,
+		   (f64) (t2 - t1) * vm->clib_time.seconds_per_clock);
+  c = spd->compiled[IPSEC_SPD_POLICY_IP4_OUTBOUND];
+  if (c)
+    vlib_cli_output (vm, "%U", format_ipsec_spd_compiled, c);
+
+  vec_validate (la, n_lookups - 1);
+  vec_validate (ra, n_lookups - 1);
+  vec_validate (linear, n_lookups - 1);
+  vec_validate (compiled, n_lookups - 1);
+  for (i = 0; i < n_lookups; i++)
+    {
+      la[i] = random_u32 (&seed);
+      ra[i] = (10 << 24) | (random_u32 (&seed) % ((n_policies + 16) << 8));
+    }
+
+  /* the linear search is what remains with the compiled lookup hidden */
+  spd->compiled[IPSEC_SPD_POLICY_IP4_OUTBOUND] = 0;
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_lookups; i++)
+    linear[i] =
+      test_ipsec_spd_lookup (spd, IP_PROTOCOL_UDP, la[i], ra[i], 1234, 1500);
+  t1 = clib_cpu_time_now ();
+  spd->compiled[IPSEC_SPD_POLICY_IP4_OUTBOUND] = c;
+  for (i = 0; i < n_lookups; i++)
+    compiled[i] =
+      test_ipsec_spd_lookup (spd, IP_PROTOCOL_UDP, la[i], ra[i], 1234, 1500);
+  t2 = clib_cpu_time_now ();
+
+  for (i = 0; i < n_lookups; i++)
+    n_mismatch += (linear[i] != compiled[i]);
+
+  rate[0] = n_lookups / ((f64) (t1 - t0) * vm->clib_time.seconds_per_clock);
+  rate[1] = n_lookups / ((f64) (t2 - t1) * vm->clib_time.seconds_per_clock);
+
+  vlib_cli_output (vm, "linear:   %.2f clocks/lookup, %.3e lookups/sec",
+		   (f64) (t1 - t0) / n_lookups, rate[0]);
+  vlib_cli_output (vm, "compiled: %.2f clocks/lookup, %.3e lookups/sec",
+		   (f64) (t2 - t1) / n_lookups, rate[1]);
+  vlib_cli_output (vm, "speedup %.1fx, %u mismatches", rate[1] / rate[0],
+		   n_mismatch);
+
+  if (n_mismatch)
+    err = clib_error_return (0, "compiled and linear lookups differ");
+
+done:
+  /* delete the first policy each time, so it is found at once */
+  policies = spd->policies[IPSEC_SPD_POLICY_IP4_OUTBOUND];
+  while (vec_len (policies))
+    {
+      vp = pool_elt_at_index (im->policies, vec_elt (policies, 0));
+      policy = *vp;
+      ipsec_add_del_policy (vm, &policy, 0, &stat_index);
+      policies = spd->policies[IPSEC_SPD_POLICY_IP4_OUTBOUND];
+    }
+  ipsec_add_del_spd (vm, spd_id, 0);
+  vec_free (la);
+  vec_free (ra);
+  vec_free (linear);
+  vec_free (compiled);
+  return err;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_ipsec_spd_perf_command, static) = {
+  .path = "test ipsec spd-perf",
+  .short_help = "test ipsec spd-perf [policies <n>] [lookups <n>] "
+		"[spd <id>]",
+  .function = test_ipsec_spd_perf_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <plugins/lb/util.h>
+#include <plugins/lb/lbhash.h>
+#include <pthread.h>
+
+#define LB_STICKY_TEST_TIME	10000
+#define LB_STICKY_TEST_TIMEOUT	40
+#define LB_STICKY_TEST_N_AS	1024
+
+typedef struct
+{
+  /* one table per thread, or a shared one */
+  lb_hash_t **per_cpu;
+  lb_shared_hash_t *shared;
+
+  u32 *flow_hash;
+  /* AS given to each flow by the last lookup */
+  u32 *flow_as;
+  u32 n_flows;
+  u32 n_threads;
+  u32 n_lookups_per_thread;
+
+  /* new flows are balanced differently after the rebalance, as they
+   * would be once an AS was added or removed */
+  u32 epoch;
+  /* flow f is handled by thread (f + shift) % n_threads */
+  u32 shift;
+
+  u32 *n_untracked;
+} lb_sticky_test_main_t;
+
+static lb_sticky_test_main_t lb_sticky_test_main;
+
+static u32
+lb_sticky_test_new_flow_as (u32 hash, u32 epoch)
+{
+  return 1 + (hash ^ (epoch * 0x9e3779b9)) % LB_STICKY_TEST_N_AS;
+}
+
+static void *
+lb_sticky_test_thread_fn (void *arg)
+{
+  lb_sticky_test_main_t *tm = &lb_sticky_test_main;
+  u32 thread = pointer_to_uword (arg);
+  lb_hash_t *h = tm->shared ? 0 : tm->per_cpu[thread];
+  u32 n_flows = tm->n_flows / tm->n_threads;
+  u32 first = (thread + tm->n_threads - tm->shift) % tm->n_threads;
+  u32 i, f, hash, as, available_index, old_as;
+
+  for (i = 0; i < tm->n_lookups_per_thread; i++)
+    {
+      f = first + (i % n_flows) * tm->n_threads;
+      hash = tm->flow_hash[f];
+
+      if (tm->shared)
+	lb_shared_hash_get (tm->shared, hash, 0, LB_STICKY_TEST_TIME,
+			    &available_index, &as);
+      else
+	lb_hash_get (h, hash, 0, LB_STICKY_TEST_TIME, &available_index, &as);
+
+      if (as == 0)
+	{
+	  as = lb_sticky_test_new_flow_as (hash, tm->epoch);
+	  if (available_index == ~0)
+	    tm->n_untracked[thread]++;
+	  else if (!tm->shared)
+	    lb_hash_put (h, hash, as, 0, available_index,
+			 LB_STICKY_TEST_TIME);
+	  else if (!lb_shared_hash_put (tm->shared, hash, as, 0,
+					available_index, LB_STICKY_TEST_TIME,
+					&old_as))
+	    tm->n_untracked[thread]++;
+	}
+      tm->flow_as[f] = as;
+    }
+
+  return 0;
+}
+
+/* run one pass of lookups over all the flows, return the seconds taken */
+static f64
+lb_sticky_test_run (vlib_main_t *vm, lb_sticky_test_main_t *tm)
+{
+  pthread_t *threads = 0;
+  f64 before;
+  uword i;
+
+  vec_validate (threads, tm->n_threads - 1);
+  before = vlib_time_now (vm);
+
+  for (i = 0; i < tm->n_threads; i++)
+    if (pthread_create (&threads[i], NULL, lb_sticky_test_thread_fn,
+			uword_to_pointer (i, void *)))
+      clib_unix_warning ("pthread_create");
+
+  for (i = 0; i < tm->n_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  vec_free (threads);
+  return vlib_time_now (vm) - before;
+}
+
+static clib_error_t *
+lb_sticky_test_one (vlib_main_t *vm, lb_sticky_test_main_t *tm, int shared,
+		    u32 buckets)
+{
+  u32 *as_before = 0;
+  u32 i, n_lost = 0, n_untracked = 0;
+  u64 n_lookups;
+  f64 t;
+
+  if (shared)
+    tm->shared =
+      lb_shared_hash_alloc (buckets * max_pow2 (tm->n_threads),
+			    LB_STICKY_TEST_TIMEOUT);
+  else
+    for (i = 0; i < tm->n_threads; i++)
+      tm->per_cpu[i] = lb_hash_alloc (buckets, LB_STICKY_TEST_TIMEOUT);
+  vec_validate (tm->n_untracked, tm->n_threads - 1);
+  vec_zero (tm->n_untracked);
+  n_lookups = (u64) tm->n_lookups_per_thread * tm->n_threads;
+
+  tm->epoch = 0;
+  tm->shift = 0;
+  t = lb_sticky_test_run (vm, tm);
+  vlib_cli_output (vm, "%s: %u threads, %.2f Mlookups/s", shared ?
+		   "shared" : "per-cpu", tm->n_threads, n_lookups / t / 1e6);
+  as_before = vec_dup (tm->flow_as);
+
+  /* every flow moves to the next thread, as after an RSS change */
+  tm->epoch = 1;
+  tm->shift = 1;
+  t = lb_sticky_test_run (vm, tm);
+
+  for (i = 0; i < tm->n_flows; i++)
+    n_lost += as_before[i] != tm->flow_as[i];
+  for (i = 0; i < tm->n_threads; i++)
+    n_untracked += tm->n_untracked[i];
+
+  vlib_cli_output (vm, "  after rebalance %.2f Mlookups/s, %u flows lost "
+		   "their AS, %u untracked lookups", n_lookups / t / 1e6,
+		   n_lost, n_untracked);
+
+  if (shared)
+    {
+      lb_shared_hash_free (tm->shared);
+      tm->shared = 0;
+    }
+  else
+    for (i = 0; i < tm->n_threads; i++)
+      lb_hash_free (tm->per_cpu[i]);
+
+  vec_free (as_before);
+  if (shared && n_lost)
+    return clib_error_return (0, "%u flows lost their AS", n_lost);
+  return 0;
+}
+
+static clib_error_t *
+lb_sticky_test_perf (vlib_main_t *vm, unformat_input_t *input,
+		     vlib_cli_command_t *cmd)
+{
+  lb_sticky_test_main_t *tm = &lb_sticky_test_main;
+  clib_error_t *error = 0;
+  u32 n_threads = 8, n_flows = 4096, n_lookups = 1 << 20;
+  u32 buckets = 1 << 12;
+  int per_cpu = 1, shared = 1;
+  u32 i;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "threads %u", &n_threads))
+	;
+      else if (unformat (input, "flows %u", &n_flows))
+	;
+      else if (unformat (input, "lookups %u", &n_lookups))
+	;
+      else if (unformat (input, "buckets %u", &buckets))
+	;
+      else if (unformat (input, "shared"))
+	per_cpu = 0;
+      else if (unformat (input, "per-cpu"))
+	shared = 0;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (n_threads == 0 || n_flows < n_threads || !is_pow2 (buckets))
+    return clib_error_return (0, "at least one flow per thread and a "
+			      "power of 2 buckets please");
+
+  clib_memset (tm, 0, sizeof (*tm));
+  tm->n_threads = n_threads;
+  tm->n_flows = n_flows - n_flows % n_threads;
+  tm->n_lookups_per_thread = n_lookups / n_threads;
+  vec_validate (tm->per_cpu, n_threads - 1);
+  vec_validate (tm->flow_hash, tm->n_flows - 1);
+  vec_validate (tm->flow_as, tm->n_flows - 1);
+
+  for (i = 0; i < tm->n_flows; i++)
+    tm->flow_hash[i] = lb_hash_hash (0x0a000000ULL << 32 | i, 0x1f90, 0, 0,
+				     0);
+
+  if (per_cpu)
+    error = lb_sticky_test_one (vm, tm, 0 /* shared */, buckets);
+  if (!error && shared)
+    error = lb_sticky_test_one (vm, tm, 1 /* shared */, buckets);
+
+  vec_free (tm->per_cpu);
+  vec_free (tm->flow_hash);
+  vec_free (tm->flow_as);
+  vec_free (tm->n_untracked);
+  return error;
+}
+
+/*?
+ * Compare the per-cpu sticky tables of the load balancer with the
+ * shared one. Each thread looks its share of the flows up, putting
+ * the missing ones, then every flow moves to another thread while new
+ * flows get a different AS, and the flows which lost their AS are
+ * counted. Lookups run on plain threads, not the vlib workers.
+ *
+ * @cliexpar
+ * @cliexstart{test lb sticky-table perf threads 8}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (test_lb_sticky_perf_command, static) = {
+  .path = "test lb sticky-table perf",
+  .short_help = "test lb sticky-table perf [threads <n>] [flows <n>] "
+		"[lookups <n>] [buckets <n>] [shared|per-cpu]",
+  .function = lb_sticky_test_perf,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
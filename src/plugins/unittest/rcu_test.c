@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+
+typedef struct
+{
+  u32 n_run;
+  /* calls run before a worker had seen their epoch */
+  u32 n_early;
+} rcu_test_main_t;
+
+static rcu_test_main_t rcu_test_main;
+
+static void
+rcu_test_call_fn (void *args)
+{
+  rcu_test_main_t *tm = &rcu_test_main;
+  u64 *epoch = args;
+  u32 i;
+
+  tm->n_run++;
+
+  if (vlib_worker_thread_barrier_held ())
+    return;
+
+  for (i = 1; i < vlib_get_n_threads (); i++)
+    if (vlib_get_main_by_index (i)->rcu_epoch < *epoch)
+      {
+	tm->n_early++;
+	break;
+      }
+}
+
+static void
+rcu_test_call (void)
+{
+  /* the epoch the call gets */
+  u64 epoch = vlib_rcu_main.epoch + 1;
+
+  vlib_rcu_call (rcu_test_call_fn, &epoch, sizeof (epoch));
+}
+
+static clib_error_t *
+rcu_test_command_fn (vlib_main_t *vm, unformat_input_t *input,
+		     vlib_cli_command_t *cmd)
+{
+  rcu_test_main_t *tm = &rcu_test_main;
+  u32 i, n_calls = 1000;
+  f64 t0, t_barrier, t_wait, t_rcu, deadline;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "calls %u", &n_calls))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (0 == n_calls)
+    return clib_error_return (0, "at least one call please");
+
+  clib_memset (tm, 0, sizeof (*tm));
+
+  /* what an update costs the main thread each way */
+  t0 = vlib_time_now (vm);
+  for (i = 0; i < n_calls; i++)
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      vlib_worker_thread_barrier_release (vm);
+    }
+  t_barrier = vlib_time_now (vm) - t0;
+
+  t0 = vlib_time_now (vm);
+  for (i = 0; i < n_calls; i++)
+    vlib_worker_wait_one_loop ();
+  t_wait = vlib_time_now (vm) - t0;
+
+  t0 = vlib_time_now (vm);
+  for (i = 0; i < n_calls; i++)
+    rcu_test_call ();
+  t_rcu = vlib_time_now (vm) - t0;
+
+  vlib_cli_output (vm, "%u workers, main thread time per update:",
+		   vlib_get_n_threads () - 1);
+  vlib_cli_output (vm, "  barrier:       %.2fus", t_barrier / n_calls * 1e6);
+  vlib_cli_output (vm, "  wait one loop: %.2fus", t_wait / n_calls * 1e6);
+  vlib_cli_output (vm, "  rcu call:      %.2fus", t_rcu / n_calls * 1e6);
+
+  /* the main loop runs them as the workers go round */
+  deadline = vlib_time_now (vm) + 1.0;
+  while (tm->n_run < n_calls && vlib_time_now (vm) < deadline)
+    vlib_process_suspend (vm, 1e-3);
+
+  vlib_cli_output (vm, "  %u calls run from the main loop, %u early",
+		   tm->n_run, tm->n_early);
+  if (tm->n_run != n_calls || tm->n_early)
+    return clib_error_return (0, "%u of %u calls run, %u early", tm->n_run,
+			      n_calls, tm->n_early);
+
+  /* and all at once, when asked */
+  rcu_test_call ();
+  vlib_rcu_barrier ();
+  if (tm->n_run != n_calls + 1 || tm->n_early)
+    return clib_error_return (0, "call not run by the barrier");
+
+  return 0;
+}
+
+/*?
+ * Check calls deferred with vlib_rcu_call () only run once each worker
+ * has seen their epoch, and compare what they cost the main thread
+ * with holding the barrier or waiting for the workers to loop.
+ *
+ * @cliexpar
+ * @cliexstart{test rcu calls 1000}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (test_rcu_command, static) = {
+  .path = "test rcu",
+  .short_help = "test rcu [calls <n>]",
+  .function = rcu_test_command_fn,
+  .is_mp_safe = 1,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -22,6 +22,11 @@
 
 #define WG_DEFAULT_DATA_SIZE 2048
 
+/* handshakes per second a thread takes before it is under load */
+#define WG_HANDSHAKE_UNDER_LOAD_DEFAULT 1024
+/* how long the under load state persists once entered (s) */
+#define WG_UNDER_LOAD_INTERVAL 1.0
+
 extern vlib_node_registration_t wg4_input_node;
 extern vlib_node_registration_t wg6_input_node;
 extern vlib_node_registration_t wg4_output_tun_node;
@@ -33,6 +38,16 @@ typedef struct wg_per_thread_data_t_
   vnet_crypto_op_t *crypto_ops;
   vnet_crypto_async_frame_t **async_frames;
   u8 data[WG_DEFAULT_DATA_SIZE];
+
+  /* handshake load of this thread */
+  u32 handshake_window_count;
+  f64 handshake_window_start;
+  f64 under_load_until;
+
+  /* keys whose data the handshake and cookie AEADs of this thread
+   * overwrite, so that workers never add or delete crypto keys */
+  vnet_crypto_key_index_t handshake_key_index;
+  vnet_crypto_key_index_t cookie_key_index;
 } wg_per_thread_data_t;
 typedef struct
 {
@@ -55,6 +70,9 @@ typedef struct
 
   /* operation mode flags (e.g. async) */
   u8 op_mode_flags;
+
+  /* handshakes per second, per thread, before it is under load */
+  u32 handshake_under_load_threshold;
 } wg_main_t;
 
 typedef struct
@@ -113,6 +131,27 @@ STATIC_ASSERT (sizeof (wg_post_data_t) <=
   ((wg_post_data_t *) ((u8 *) ((b)->opaque) +                                 \
 		       STRUCT_OFFSET_OF (vnet_buffer_opaque_t, unused)))
 
+/**
+ * Account one handshake message on the calling thread and tell whether it
+ * is under load, in which case initiators must prove their address with a
+ * cookie and are rate limited.
+ **/
+static_always_inline bool
+wg_handshake_is_under_load (wg_main_t *wmp, wg_per_thread_data_t *ptd,
+			    f64 now)
+{
+  if (now - ptd->handshake_window_start >= 1.0)
+    {
+      ptd->handshake_window_start = now;
+      ptd->handshake_window_count = 0;
+    }
+
+  if (++ptd->handshake_window_count > wmp->handshake_under_load_threshold)
+    ptd->under_load_until = now + WG_UNDER_LOAD_INTERVAL;
+
+  return now < ptd->under_load_until;
+}
+
 #define WG_START_EVENT	1
 void wg_feature_init (wg_main_t * wmp);
 void wg_set_async_mode (u32 is_enabled);
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wireguard/wireguard.h>
+#include <wireguard/wireguard_chachapoly.h>
+#include <wireguard/blake/blake2-impl.h>
+
+bool
+wg_chacha20poly1305_calc (vlib_main_t *vm, u8 *src, u32 src_len, u8 *dst,
+			  u8 *aad, u32 aad_len, u64 nonce,
+			  vnet_crypto_op_id_t op_id,
+			  vnet_crypto_key_index_t key_index)
+{
+  vnet_crypto_op_t _op, *op = &_op;
+  u8 iv[12];
+  u8 tag_[NOISE_AUTHTAG_LEN] = {};
+  u8 src_[] = {};
+
+  clib_memset (iv, 0, 12);
+  clib_memcpy (iv + 4, &nonce, sizeof (nonce));
+
+  vnet_crypto_op_init (op, op_id);
+
+  op->tag_len = NOISE_AUTHTAG_LEN;
+  if (op_id == VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC)
+    {
+      op->tag = src + src_len - NOISE_AUTHTAG_LEN;
+      src_len -= NOISE_AUTHTAG_LEN;
+      op->flags |= VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
+    }
+  else
+    op->tag = tag_;
+
+  op->src = !src ? src_ : src;
+  op->len = src_len;
+
+  op->dst = dst;
+  op->key_index = key_index;
+  op->aad = aad;
+  op->aad_len = aad_len;
+  op->iv = iv;
+
+  vnet_crypto_process_ops (vm, op, 1);
+  if (op_id == VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC)
+    {
+      clib_memcpy (dst + src_len, op->tag, NOISE_AUTHTAG_LEN);
+    }
+
+  return (op->status == VNET_CRYPTO_OP_STATUS_COMPLETED);
+}
+
+#define HCHACHA20_QR(a, b, c, d)                                              \
+  do                                                                          \
+    {                                                                         \
+      a += b;                                                                 \
+      d = rotr32 (d ^ a, 16);                                                 \
+      c += d;                                                                 \
+      b = rotr32 (b ^ c, 20);                                                 \
+      a += b;                                                                 \
+      d = rotr32 (d ^ a, 24);                                                 \
+      c += d;                                                                 \
+      b = rotr32 (b ^ c, 25);                                                 \
+    }                                                                         \
+  while (0)
+
+/* HChaCha20 turns a 256-bit key and the first 128 bits of an XChaCha20
+ * nonce into the subkey used for the inner ChaCha20-Poly1305 operation */
+static void
+hchacha20 (u8 out[CHACHA20POLY1305_KEY_SIZE], const u8 nonce[16],
+	   const u8 key[CHACHA20POLY1305_KEY_SIZE])
+{
+  u32 x[16];
+  int i;
+
+  x[0] = 0x61707865;
+  x[1] = 0x3320646e;
+  x[2] = 0x79622d32;
+  x[3] = 0x6b206574;
+  for (i = 0; i < 8; i++)
+    x[4 + i] =
+      clib_little_to_host_u32 (clib_mem_unaligned (key + 4 * i, u32));
+  for (i = 0; i < 4; i++)
+    x[12 + i] =
+      clib_little_to_host_u32 (clib_mem_unaligned (nonce + 4 * i, u32));
+
+  for (i = 0; i < 10; i++)
+    {
+      HCHACHA20_QR (x[0], x[4], x[8], x[12]);
+      HCHACHA20_QR (x[1], x[5], x[9], x[13]);
+      HCHACHA20_QR (x[2], x[6], x[10], x[14]);
+      HCHACHA20_QR (x[3], x[7], x[11], x[15]);
+      HCHACHA20_QR (x[0], x[5], x[10], x[15]);
+      HCHACHA20_QR (x[1], x[6], x[11], x[12]);
+      HCHACHA20_QR (x[2], x[7], x[8], x[13]);
+      HCHACHA20_QR (x[3], x[4], x[9], x[14]);
+    }
+
+  for (i = 0; i < 4; i++)
+    {
+      clib_mem_unaligned (out + 4 * i, u32) = clib_host_to_little_u32 (x[i]);
+      clib_mem_unaligned (out + 16 + 4 * i, u32) =
+	clib_host_to_little_u32 (x[12 + i]);
+    }
+  secure_zero_memory (x, sizeof (x));
+}
+
+static bool
+wg_xchacha20poly1305_calc (vlib_main_t *vm, u8 *src, u32 src_len, u8 *dst,
+			   u8 *aad, u32 aad_len,
+			   u8 nonce[XCHACHA20POLY1305_NONCE_SIZE],
+			   u8 key[CHACHA20POLY1305_KEY_SIZE],
+			   vnet_crypto_op_id_t op_id)
+{
+  wg_main_t *wmp = &wg_main;
+  wg_per_thread_data_t *ptd =
+    vec_elt_at_index (wmp->per_thread_data, vm->thread_index);
+  u8 *subkey = vnet_crypto_get_key (ptd->cookie_key_index)->data;
+  u64 h_nonce;
+  bool ret;
+
+  /* cookies are made and consumed along with handshakes, on any thread,
+   * each of which writes the subkey into a key of its own */
+  clib_memcpy (&h_nonce, nonce + 16, sizeof (h_nonce));
+  hchacha20 (subkey, nonce, key);
+
+  ret = wg_chacha20poly1305_calc (vm, src, src_len, dst, aad, aad_len,
+				  h_nonce, op_id, ptd->cookie_key_index);
+
+  secure_zero_memory (subkey, CHACHA20POLY1305_KEY_SIZE);
+  return ret;
+}
+
+void
+wg_xchacha20poly1305_encrypt (vlib_main_t *vm, u8 *src, u32 src_len, u8 *dst,
+			      u8 *aad, u32 aad_len,
+			      u8 nonce[XCHACHA20POLY1305_NONCE_SIZE],
+			      u8 key[CHACHA20POLY1305_KEY_SIZE])
+{
+  wg_xchacha20poly1305_calc (vm, src, src_len, dst, aad, aad_len, nonce, key,
+			     VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC);
+}
+
+bool
+wg_xchacha20poly1305_decrypt (vlib_main_t *vm, u8 *src, u32 src_len, u8 *dst,
+			      u8 *aad, u32 aad_len,
+			      u8 nonce[XCHACHA20POLY1305_NONCE_SIZE],
+			      u8 key[CHACHA20POLY1305_KEY_SIZE])
+{
+  return wg_xchacha20poly1305_calc (vm, src, src_len, dst, aad, aad_len,
+				    nonce, key,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -390,10 +390,64 @@ VLIB_CLI_COMMAND (wg_set_async_mode_command, static) = {
   .function = wg_set_async_mode_command_fn,
 };
 
+static clib_error_t *
+wg_set_handshake_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			     vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  wg_main_t *wmp = &wg_main;
+  wg_per_thread_data_t *ptd;
+  u32 threshold = ~0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "under-load %u", &threshold))
+	;
+      else
+	return (clib_error_return (0, "unknown input '%U'",
+				   format_unformat_error, line_input));
+    }
+
+  unformat_free (line_input);
+
+  if (~0 == threshold)
+    return (clib_error_return (0, "missing under-load threshold"));
+
+  wmp->handshake_under_load_threshold = threshold;
+  vec_foreach (ptd, wmp->per_thread_data)
+    ptd->under_load_until = 0;
+
+  return (NULL);
+}
+
+/*?
+ * Set the number of handshake messages per second each thread processes
+ * before it considers itself under load. Under load, initiators
+ * are sent a cookie reply unless they already present a valid cookie, and
+ * the handshakes from each source address are rate limited. The load state
+ * lasts for one second after the threshold is exceeded; a threshold of 0
+ * treats every handshake as received under load.
+ *
+ * @cliexpar
+ * @cliexcmd{set wireguard handshake under-load 4096}
+?*/
+VLIB_CLI_COMMAND (wg_set_handshake_command, static) = {
+  .path = "set wireguard handshake",
+  .short_help = "set wireguard handshake under-load <handshakes/s>",
+  .function = wg_set_handshake_command_fn,
+};
+
 static clib_error_t *
 wg_show_mode_command_fn (vlib_main_t *vm, unformat_input_t *input,
 			 vlib_cli_command_t *cmd)
 {
+  wg_main_t *wmp = &wg_main;
+  wg_per_thread_data_t *ptd;
+  u32 n_under_load = 0;
+
   vlib_cli_output (vm, "Wireguard mode");
 
 #define _(v, f, s)                                                            \
@@ -402,7 +456,14 @@ wg_show_mode_command_fn (vlib_main_t *vm, unformat_input_t *input,
   foreach_wg_op_mode_flags
 #undef _
 
-    return (NULL);
+  vlib_cli_output (vm, "\thandshake under-load threshold: %u/s",
+		   wmp->handshake_under_load_threshold);
+  vec_foreach (ptd, wmp->per_thread_data)
+    if (vlib_time_now (vm) < ptd->under_load_until)
+      n_under_load++;
+  vlib_cli_output (vm, "\tthreads under load: %u", n_under_load);
+
+  return (NULL);
 }
 
 VLIB_CLI_COMMAND (wg_show_modemode_command, static) = {
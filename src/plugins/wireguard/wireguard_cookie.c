@@ -20,7 +20,9 @@
 #include <vlib/vlib.h>
 
 #include <wireguard/wireguard_cookie.h>
+#include <wireguard/wireguard_chachapoly.h>
 #include <wireguard/wireguard.h>
+#include <wireguard/blake/blake2-impl.h>
 
 static void cookie_precompute_key (uint8_t *,
 				   const uint8_t[COOKIE_INPUT_SIZE],
@@ -32,6 +34,9 @@ static void cookie_macs_mac2 (message_macs_t *, const void *, size_t,
 static void cookie_checker_make_cookie (vlib_main_t *vm, cookie_checker_t *,
 					uint8_t[COOKIE_COOKIE_SIZE],
 					ip46_address_t *ip, u16 udp_port);
+static void ratelimit_init (ratelimit_t *);
+static void ratelimit_deinit (ratelimit_t *);
+static bool ratelimit_allow (ratelimit_t *, u64, f64);
 
 /* Public Functions */
 void
@@ -42,6 +47,37 @@ cookie_maker_init (cookie_maker_t * cp, const uint8_t key[COOKIE_INPUT_SIZE])
   cookie_precompute_key (cp->cp_cookie_key, key, COOKIE_COOKIE_KEY_LABEL);
 }
 
+void
+cookie_checker_init (cookie_checker_t *cc)
+{
+  u32 i;
+
+  clib_memset (cc, 0, sizeof (*cc));
+  clib_rwlock_init (&cc->cc_secret_lock);
+  vec_validate (cc->cc_ratelimit_v4, vlib_get_n_threads () - 1);
+  vec_validate (cc->cc_ratelimit_v6, vlib_get_n_threads () - 1);
+  for (i = 0; i < vlib_get_n_threads (); i++)
+    {
+      ratelimit_init (&cc->cc_ratelimit_v4[i]);
+      ratelimit_init (&cc->cc_ratelimit_v6[i]);
+    }
+}
+
+void
+cookie_checker_deinit (cookie_checker_t *cc)
+{
+  u32 i;
+
+  for (i = 0; i < vec_len (cc->cc_ratelimit_v4); i++)
+    {
+      ratelimit_deinit (&cc->cc_ratelimit_v4[i]);
+      ratelimit_deinit (&cc->cc_ratelimit_v6[i]);
+    }
+  vec_free (cc->cc_ratelimit_v4);
+  vec_free (cc->cc_ratelimit_v6);
+  clib_rwlock_free (&cc->cc_secret_lock);
+}
+
 void
 cookie_checker_update (cookie_checker_t * cc, uint8_t key[COOKIE_INPUT_SIZE])
 {
@@ -57,6 +93,62 @@ cookie_checker_update (cookie_checker_t * cc, uint8_t key[COOKIE_INPUT_SIZE])
     }
 }
 
+void
+cookie_checker_create_payload (vlib_main_t *vm, cookie_checker_t *cc,
+			       message_macs_t *cm,
+			       uint8_t nonce[COOKIE_NONCE_SIZE],
+			       uint8_t ecookie[COOKIE_ENCRYPTED_SIZE],
+			       ip46_address_t *ip, u16 udp_port)
+{
+  uint8_t cookie[COOKIE_COOKIE_SIZE];
+
+  cookie_checker_make_cookie (vm, cc, cookie, ip, udp_port);
+  RAND_bytes (nonce, COOKIE_NONCE_SIZE);
+
+  wg_xchacha20poly1305_encrypt (vm, cookie, COOKIE_COOKIE_SIZE, ecookie,
+				cm->mac1, COOKIE_MAC_SIZE, nonce,
+				cc->cc_cookie_key);
+
+  secure_zero_memory (cookie, sizeof (cookie));
+}
+
+bool
+cookie_checker_ratelimit (cookie_checker_t *cc, ip46_address_t *ip, f64 now)
+{
+  u32 thread_index = vlib_get_thread_index ();
+
+  /* IPv6 sources are limited per /64, since a single host can trivially
+   * own one */
+  if (ip46_address_is_ip4 (ip))
+    return ratelimit_allow (&cc->cc_ratelimit_v4[thread_index],
+			    ip->ip4.as_u32, now);
+  return ratelimit_allow (&cc->cc_ratelimit_v6[thread_index],
+			  ip->ip6.as_u64[0], now);
+}
+
+bool
+cookie_maker_consume_payload (vlib_main_t *vm, cookie_maker_t *cp,
+			      uint8_t nonce[COOKIE_NONCE_SIZE],
+			      uint8_t ecookie[COOKIE_ENCRYPTED_SIZE])
+{
+  uint8_t cookie[COOKIE_COOKIE_SIZE];
+
+  /* a cookie reply is only acceptable in response to our last mac1 */
+  if (!cp->cp_mac1_valid)
+    return false;
+
+  if (!wg_xchacha20poly1305_decrypt (vm, ecookie, COOKIE_ENCRYPTED_SIZE,
+				     cookie, cp->cp_mac1_last, COOKIE_MAC_SIZE,
+				     nonce, cp->cp_cookie_key))
+    return false;
+
+  clib_memcpy (cp->cp_cookie, cookie, COOKIE_COOKIE_SIZE);
+  cp->cp_birthdate = vlib_time_now (vm);
+  cp->cp_mac1_valid = 0;
+
+  return true;
+}
+
 void
 cookie_maker_mac (cookie_maker_t * cp, message_macs_t * cm, void *buf,
 		  size_t len)
@@ -76,12 +168,10 @@ cookie_maker_mac (cookie_maker_t * cp, message_macs_t * cm, void *buf,
 }
 
 enum cookie_mac_state
-cookie_checker_validate_macs (vlib_main_t *vm, cookie_checker_t *cc,
-			      message_macs_t *cm, void *buf, size_t len,
-			      bool busy, ip46_address_t *ip, u16 udp_port)
+cookie_checker_validate_mac1 (cookie_checker_t *cc, message_macs_t *cm,
+			      void *buf, size_t len)
 {
   message_macs_t our_cm;
-  uint8_t cookie[COOKIE_COOKIE_SIZE];
 
   len = len - sizeof (message_macs_t);
   cookie_macs_mac1 (&our_cm, buf, len, cc->cc_mac1_key);
@@ -90,9 +180,26 @@ cookie_checker_validate_macs (vlib_main_t *vm, cookie_checker_t *cc,
   if (clib_memcmp (our_cm.mac1, cm->mac1, COOKIE_MAC_SIZE) != 0)
     return INVALID_MAC;
 
+  return VALID_MAC_BUT_NO_COOKIE;
+}
+
+enum cookie_mac_state
+cookie_checker_validate_macs (vlib_main_t *vm, cookie_checker_t *cc,
+			      message_macs_t *cm, void *buf, size_t len,
+			      bool busy, ip46_address_t *ip, u16 udp_port)
+{
+  message_macs_t our_cm;
+  uint8_t cookie[COOKIE_COOKIE_SIZE];
+
+  if (cookie_checker_validate_mac1 (cc, cm, buf, len) == INVALID_MAC)
+    return INVALID_MAC;
+
   if (!busy)
     return VALID_MAC_BUT_NO_COOKIE;
 
+  len = len - sizeof (message_macs_t);
+  clib_memcpy (our_cm.mac1, cm->mac1, COOKIE_MAC_SIZE);
+
   cookie_checker_make_cookie (vm, cc, cookie, ip, udp_port);
   cookie_macs_mac2 (&our_cm, buf, len, cookie);
 
@@ -145,15 +252,26 @@ cookie_checker_make_cookie (vlib_main_t *vm, cookie_checker_t *cc,
 {
   blake2s_state_t state;
 
+  clib_rwlock_reader_lock (&cc->cc_secret_lock);
   if (wg_birthdate_has_expired (cc->cc_secret_birthdate,
 				COOKIE_SECRET_MAX_AGE))
     {
-      cc->cc_secret_birthdate = vlib_time_now (vm);
-      RAND_bytes (cc->cc_secret, COOKIE_SECRET_SIZE);
+      clib_rwlock_reader_unlock (&cc->cc_secret_lock);
+      clib_rwlock_writer_lock (&cc->cc_secret_lock);
+      /* another thread may have replaced it meanwhile */
+      if (wg_birthdate_has_expired (cc->cc_secret_birthdate,
+				    COOKIE_SECRET_MAX_AGE))
+	{
+	  cc->cc_secret_birthdate = vlib_time_now (vm);
+	  RAND_bytes (cc->cc_secret, COOKIE_SECRET_SIZE);
+	}
+      clib_rwlock_writer_unlock (&cc->cc_secret_lock);
+      clib_rwlock_reader_lock (&cc->cc_secret_lock);
     }
 
   blake2s_init_key (&state, COOKIE_COOKIE_SIZE, cc->cc_secret,
 		    COOKIE_SECRET_SIZE);
+  clib_rwlock_reader_unlock (&cc->cc_secret_lock);
 
   if (ip46_address_is_ip4 (ip))
     {
@@ -167,6 +285,86 @@ cookie_checker_make_cookie (vlib_main_t *vm, cookie_checker_t *cc,
   blake2s_final (&state, cookie, COOKIE_COOKIE_SIZE);
 }
 
+static void
+ratelimit_init (ratelimit_t *rl)
+{
+  rl->rl_entries = NULL;
+  rl->rl_table = hash_create (0, sizeof (uword));
+  rl->rl_last_gc = 0;
+}
+
+static void
+ratelimit_deinit (ratelimit_t *rl)
+{
+  pool_free (rl->rl_entries);
+  hash_free (rl->rl_table);
+}
+
+static void
+ratelimit_gc (ratelimit_t *rl, f64 now)
+{
+  ratelimit_entry_t *r;
+  u32 *expired = NULL, *ri;
+
+  if (now - rl->rl_last_gc < ELEMENT_TIMEOUT)
+    return;
+  rl->rl_last_gc = now;
+
+  pool_foreach (r, rl->rl_entries)
+    {
+      if (now - r->r_last_time > ELEMENT_TIMEOUT)
+	vec_add1 (expired, r - rl->rl_entries);
+    }
+
+  vec_foreach (ri, expired)
+    {
+      r = pool_elt_at_index (rl->rl_entries, *ri);
+      hash_unset (rl->rl_table, r->r_key);
+      pool_put (rl->rl_entries, r);
+    }
+  vec_free (expired);
+}
+
+static bool
+ratelimit_allow (ratelimit_t *rl, u64 key, f64 now)
+{
+  ratelimit_entry_t *r;
+  uword *p;
+  u64 tokens;
+
+  ratelimit_gc (rl, now);
+
+  p = hash_get (rl->rl_table, key);
+  if (p)
+    {
+      /* refill the bucket for the time elapsed, spend one initiation */
+      r = pool_elt_at_index (rl->rl_entries, p[0]);
+      tokens = r->r_tokens + (u64) ((now - r->r_last_time) * NSEC_PER_SEC);
+      r->r_last_time = now;
+      if (tokens > TOKEN_MAX)
+	tokens = TOKEN_MAX;
+      if (tokens < INITIATION_COST)
+	{
+	  r->r_tokens = tokens;
+	  return false;
+	}
+      r->r_tokens = tokens - INITIATION_COST;
+      return true;
+    }
+
+  /* a flood from many sources must not grow the table without bound */
+  if (pool_elts (rl->rl_entries) >= RATELIMIT_SIZE_MAX)
+    return false;
+
+  pool_get (rl->rl_entries, r);
+  r->r_key = key;
+  r->r_last_time = now;
+  r->r_tokens = TOKEN_MAX - INITIATION_COST;
+  hash_set (rl->rl_table, key, r - rl->rl_entries);
+
+  return true;
+}
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
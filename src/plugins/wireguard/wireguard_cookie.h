@@ -70,19 +70,57 @@ typedef struct cookie_maker
   uint8_t cp_mac1_last[COOKIE_MAC_SIZE];
 } cookie_maker_t;
 
+typedef struct ratelimit_entry
+{
+  u64 r_key;
+  f64 r_last_time;
+  u64 r_tokens;
+} ratelimit_entry_t;
+
+typedef struct ratelimit
+{
+  /* token buckets, keyed by the masked source address */
+  ratelimit_entry_t *rl_entries;
+  uword *rl_table;
+  f64 rl_last_gc;
+} ratelimit_t;
+
 typedef struct cookie_checker
 {
   uint8_t cc_mac1_key[COOKIE_KEY_SIZE];
   uint8_t cc_cookie_key[COOKIE_KEY_SIZE];
 
+  /* the secret is read by the threads making cookies, and replaced by
+   * the first of them to find it expired */
+  clib_rwlock_t cc_secret_lock;
   f64 cc_secret_birthdate;
   uint8_t cc_secret[COOKIE_SECRET_SIZE];
+
+  /* per thread; a source's handshakes usually arrive on one thread, so
+   * it is limited to a multiple of the rate at worst */
+  ratelimit_t *cc_ratelimit_v4;
+  ratelimit_t *cc_ratelimit_v6;
 } cookie_checker_t;
 
 
 void cookie_maker_init (cookie_maker_t *, const uint8_t[COOKIE_INPUT_SIZE]);
+void cookie_checker_init (cookie_checker_t *);
+void cookie_checker_deinit (cookie_checker_t *);
 void cookie_checker_update (cookie_checker_t *, uint8_t[COOKIE_INPUT_SIZE]);
+void cookie_checker_create_payload (vlib_main_t *vm, cookie_checker_t *cc,
+				    message_macs_t *cm,
+				    uint8_t nonce[COOKIE_NONCE_SIZE],
+				    uint8_t ecookie[COOKIE_ENCRYPTED_SIZE],
+				    ip46_address_t *ip, u16 udp_port);
+bool cookie_checker_ratelimit (cookie_checker_t *cc, ip46_address_t *ip,
+			       f64 now);
+bool cookie_maker_consume_payload (vlib_main_t *vm, cookie_maker_t *cp,
+				   uint8_t nonce[COOKIE_NONCE_SIZE],
+				   uint8_t ecookie[COOKIE_ENCRYPTED_SIZE]);
 void cookie_maker_mac (cookie_maker_t *, message_macs_t *, void *, size_t);
+enum cookie_mac_state cookie_checker_validate_mac1 (cookie_checker_t *,
+						    message_macs_t *, void *,
+						    size_t);
 enum cookie_mac_state
 cookie_checker_validate_macs (vlib_main_t *vm, cookie_checker_t *,
 			      message_macs_t *, void *, size_t, bool,
@@ -84,14 +84,14 @@ wg_handoff (vlib_main_t * vm,
 
       if (PREDICT_FALSE (mode == WG_HANDOFF_HANDSHAKE))
 	{
-	  ti[0] = 0;
+	  ti[0] = wg_handshake_thread_index (&wmp->index_table, b[0],
+					     vm->thread_index);
 	}
       else if (mode == WG_HANDOFF_INP_DATA)
 	{
 	  message_data_t *data = vlib_buffer_get_current (b[0]);
-	  u32 *entry =
+	  peeri =
 	    wg_index_table_lookup (&wmp->index_table, data->receiver_index);
-	  peeri = *entry;
 	  peer = wg_peer_get (peeri);
 
 	  ti[0] = peer->input_thread_index;
@@ -88,23 +88,12 @@ wg_if_find_by_sw_if_index (u32 sw_if_index)
   return (ti);
 }
 
-static walk_rc_t
-wg_if_find_peer_by_public_key (index_t peeri, void *data)
-{
-  uint8_t *public = data;
-  wg_peer_t *peer = wg_peer_get (peeri);
-
-  if (!memcmp (peer->remote.r_public, public, NOISE_PUBLIC_KEY_LEN))
-    return (WALK_STOP);
-  return (WALK_CONTINUE);
-}
-
 static noise_remote_t *
 wg_remote_get (const uint8_t public[NOISE_PUBLIC_KEY_LEN])
 {
   index_t peeri;
 
-  peeri = wg_peer_walk (wg_if_find_peer_by_public_key, (void *) public);
+  peeri = wg_peer_find_by_public_key (public);
 
   if (INDEX_INVALID != peeri)
     return &wg_peer_get (peeri)->remote;
@@ -301,6 +290,7 @@ wg_if_create (u32 user_instance,
 
   wg_if->port = port;
   wg_if->local_idx = local - noise_local_pool;
+  cookie_checker_init (&wg_if->cookie_checker);
   cookie_checker_update (&wg_if->cookie_checker, local->l_public);
 
   hw_if_index = vnet_register_interface (vnm,
@@ -365,6 +355,7 @@ wg_if_delete (u32 sw_if_index)
   vnet_reset_interface_l3_output_node (vnm->vlib_main, sw_if_index);
   vnet_delete_hw_interface (vnm, hw->hw_if_index);
   pool_put_index (noise_local_pool, wg_if->local_idx);
+  cookie_checker_deinit (&wg_if->cookie_checker);
   pool_put (wg_if_pool, wg_if);
 
   return 0;
@@ -13,44 +13,41 @@
  * limitations under the License.
  */
 
-#include <vppinfra/hash.h>
-#include <vppinfra/pool.h>
 #include <vppinfra/random.h>
 #include <wireguard/wireguard_index_table.h>
 
+#define WG_INDEX_TABLE_N_BUCKETS (64 << 10)
+#define WG_INDEX_TABLE_MEMORY_SIZE (32 << 20)
+
+void
+wg_index_table_init (wg_index_table_t *table)
+{
+  clib_bihash_init_8_8 (&table->hash, "wireguard index table",
+			WG_INDEX_TABLE_N_BUCKETS, WG_INDEX_TABLE_MEMORY_SIZE);
+}
+
 u32
 wg_index_table_add (wg_index_table_t * table, u32 peer_pool_idx, u32 rnd_seed)
 {
-  u32 key;
+  clib_bihash_kv_8_8_t kv;
 
+  kv.value = peer_pool_idx;
   while (1)
     {
-      key = random_u32 (&rnd_seed);
-      if (hash_get (table->hash, key))
-	continue;
-
-      hash_set (table->hash, key, peer_pool_idx);
-      break;
+      kv.key = random_u32 (&rnd_seed);
+      /* add, but do not take a key another thread just handed out */
+      if (clib_bihash_add_del_8_8 (&table->hash, &kv, 2) == 0)
+	break;
     }
-  return key;
+  return kv.key;
 }
 
 void
 wg_index_table_del (wg_index_table_t * table, u32 key)
 {
-  uword *p;
-  p = hash_get (table->hash, key);
-  if (p)
-    hash_unset (table->hash, key);
-}
-
-u32 *
-wg_index_table_lookup (const wg_index_table_t * table, u32 key)
-{
-  uword *p;
+  clib_bihash_kv_8_8_t kv = { .key = key };
 
-  p = hash_get (table->hash, key);
-  return (u32 *) p;
+  clib_bihash_add_del_8_8 (&table->hash, &kv, 0);
 }
 
 /*
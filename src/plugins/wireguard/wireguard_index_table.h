@@ -17,16 +17,30 @@
 #define __included_wg_index_table_h__
 
 #include <vppinfra/types.h>
+#include <vppinfra/bihash_8_8.h>
 
+/* handshakes add and remove indices on the workers while the data path
+ * looks them up on all threads, which a bihash allows without a lock */
 typedef struct
 {
-  uword *hash;
+  clib_bihash_8_8_t hash;
 } wg_index_table_t;
 
+void wg_index_table_init (wg_index_table_t *table);
 u32 wg_index_table_add (wg_index_table_t * table, u32 peer_pool_idx,
 			u32 rnd_seed);
 void wg_index_table_del (wg_index_table_t * table, u32 key);
-u32 *wg_index_table_lookup (const wg_index_table_t * table, u32 key);
+
+/* Return the peer index the key was handed out for, or ~0 */
+static_always_inline u32
+wg_index_table_lookup (wg_index_table_t *table, u32 key)
+{
+  clib_bihash_kv_8_8_t kv = { .key = key };
+
+  if (clib_bihash_search_inline_8_8 (&table->hash, &kv))
+    return ~0;
+  return kv.value;
+}
 
 #endif //__included_wg_index_table_h__
 
@@ -21,6 +21,7 @@
 
 #include <wireguard/wireguard_send.h>
 #include <wireguard/wireguard_if.h>
+#include <vlibmemory/api.h>
 
 #define foreach_wg_input_error                                                \
   _ (NONE, "No error")                                                        \
@@ -31,6 +32,10 @@
   _ (KEEPALIVE_SEND, "Failed while sending Keepalive")                        \
   _ (HANDSHAKE_SEND, "Failed while sending Handshake")                        \
   _ (HANDSHAKE_RECEIVE, "Failed while receiving Handshake")                   \
+  _ (HANDSHAKE_RATELIMITED, "Handshake ratelimited")                          \
+  _ (COOKIE_DECRYPTION, "Failed during Cookie decryption")                    \
+  _ (COOKIE_SEND, "Failed during sending Cookie")                             \
+  _ (COOKIE_REPLY, "Handshake under load, Cookie sent")                       \
   _ (TOO_BIG, "Packet too big")                                               \
   _ (UNDEFINED, "Undefined error")                                            \
   _ (CRYPTO_ENGINE_ERROR, "crypto engine error (packet dropped)")
@@ -138,12 +143,123 @@ is_ip4_header (u8 *data)
   return (data[0] >> 4) == 0x4;
 }
 
+static_always_inline u32
+wg_handshake_message_len (message_type_t type)
+{
+  switch (type)
+    {
+    case MESSAGE_HANDSHAKE_INITIATION:
+      return sizeof (message_handshake_initiation_t);
+    case MESSAGE_HANDSHAKE_RESPONSE:
+      return sizeof (message_handshake_response_t);
+    case MESSAGE_HANDSHAKE_COOKIE:
+      return sizeof (message_handshake_cookie_t);
+    default:
+      return 0;
+    }
+}
+
+/*
+ * Cheap checks a thread does before handing a handshake message off to the
+ * thread of its peer: a flood of messages that do not even carry a valid
+ * mac1 for one of our interfaces never gets to compete for it.
+ */
+static wg_input_error_t
+wg_handshake_prefilter (vlib_buffer_t *b)
+{
+  void *current_b_data = vlib_buffer_get_current (b);
+  message_header_t *header = current_b_data;
+  udp_header_t *uhd = current_b_data - sizeof (udp_header_t);
+  message_macs_t *macs;
+  index_t *wg_ifs, *ii;
+  wg_if_t *wg_if;
+  u32 len;
+
+  len = wg_handshake_message_len (header->type);
+  if (0 == len || b->current_length < len)
+    return WG_INPUT_ERROR_HANDSHAKE_RECEIVE;
+
+  /* cookie replies carry no macs, they are authenticated on consumption */
+  if (header->type == MESSAGE_HANDSHAKE_COOKIE)
+    return WG_INPUT_ERROR_NONE;
+
+  wg_ifs = wg_if_indexes_get_by_port (clib_net_to_host_u16 (uhd->dst_port));
+  if (NULL == wg_ifs)
+    return WG_INPUT_ERROR_INTERFACE;
+
+  macs = (message_macs_t *) ((u8 *) current_b_data + len - sizeof (*macs));
+  vec_foreach (ii, wg_ifs)
+    {
+      wg_if = wg_if_get (*ii);
+      if (wg_if && cookie_checker_validate_mac1 (&wg_if->cookie_checker, macs,
+						 current_b_data,
+						 len) != INVALID_MAC)
+	return WG_INPUT_ERROR_NONE;
+    }
+
+  return WG_INPUT_ERROR_HANDSHAKE_MAC;
+}
+
+typedef struct
+{
+  u32 peer_idx;
+  u32 node_index;
+  /* local index of the handshake the session is derived from */
+  u32 local_index;
+  u8 is_responder;
+  message_handshake_response_t response;
+} wg_handshake_session_args_t;
+
+/*
+ * The handshake itself is done on the thread that received it, beginning
+ * the session adds the session's keys to the crypto engines and is left to
+ * the main thread, under the barrier.
+ */
+static void *
+wg_handshake_session_thread_fn (void *arg)
+{
+  wg_handshake_session_args_t *a = arg;
+  vlib_main_t *vm = vlib_get_main ();
+  wg_peer_t *peer;
+
+  if (pool_is_free_index (wg_peer_pool, a->peer_idx))
+    return 0;
+
+  peer = wg_peer_get (a->peer_idx);
+
+  /* the peer may have handshaken again since */
+  if (wg_peer_is_dead (peer) ||
+      peer->remote.r_handshake.hs_local_index != a->local_index)
+    return 0;
+
+  if (a->is_responder)
+    {
+      if (PREDICT_FALSE (!wg_send_handshake_response (vm, peer, &a->response)))
+	vlib_node_increment_counter (vm, a->node_index,
+				     WG_INPUT_ERROR_HANDSHAKE_SEND, 1);
+      else
+	wg_peer_update_flags (a->peer_idx, WG_PEER_ESTABLISHED, true);
+    }
+  else if (noise_remote_begin_session (vm, &peer->remote))
+    {
+      wg_timers_session_derived (peer);
+      wg_timers_handshake_complete (peer);
+      if (PREDICT_FALSE (!wg_send_keepalive (vm, peer)))
+	vlib_node_increment_counter (vm, a->node_index,
+				     WG_INPUT_ERROR_KEEPALIVE_SEND, 1);
+      else
+	wg_peer_update_flags (a->peer_idx, WG_PEER_ESTABLISHED, true);
+    }
+  return 0;
+}
+
 static wg_input_error_t
 wg_handshake_process (vlib_main_t *vm, wg_main_t *wmp, vlib_buffer_t *b,
 		      u32 node_idx, u8 is_ip4)
 {
-  ASSERT (vm->thread_index == 0);
-
+  wg_per_thread_data_t *ptd =
+    vec_elt_at_index (wmp->per_thread_data, vm->thread_index);
+  wg_handshake_session_args_t a = { .node_index = node_idx };
   enum cookie_mac_state mac_state;
   bool packet_needs_cookie;
   bool under_load;
@@ -153,18 +269,20 @@ wg_handshake_process (vlib_main_t *vm, wg_main_t *wmp, vlib_buffer_t *b,
 
   void *current_b_data = vlib_buffer_get_current (b);
 
-  ip46_address_t src_ip;
+  ip46_address_t src_ip, dst_ip;
   if (is_ip4)
     {
       ip4_header_t *iph4 =
 	current_b_data - sizeof (udp_header_t) - sizeof (ip4_header_t);
       ip46_address_set_ip4 (&src_ip, &iph4->src_address);
+      ip46_address_set_ip4 (&dst_ip, &iph4->dst_address);
     }
   else
     {
       ip6_header_t *iph6 =
 	current_b_data - sizeof (udp_header_t) - sizeof (ip6_header_t);
       ip46_address_set_ip6 (&src_ip, &iph6->src_address);
+      ip46_address_set_ip6 (&dst_ip, &iph6->dst_address);
     }
 
   udp_header_t *uhd = current_b_data - sizeof (udp_header_t);
@@ -172,27 +290,35 @@ wg_handshake_process (vlib_main_t *vm, wg_main_t *wmp, vlib_buffer_t *b,
   u16 udp_dst_port = clib_host_to_net_u16 (uhd->dst_port);;
 
   message_header_t *header = current_b_data;
-  under_load = false;
+  u32 len = wg_handshake_message_len (header->type);
+
+  if (0 == len || b->current_length < len)
+    return WG_INPUT_ERROR_HANDSHAKE_RECEIVE;
 
   if (PREDICT_FALSE (header->type == MESSAGE_HANDSHAKE_COOKIE))
     {
       message_handshake_cookie_t *packet =
 	(message_handshake_cookie_t *) current_b_data;
-      u32 *entry =
+      index_t peeri =
 	wg_index_table_lookup (&wmp->index_table, packet->receiver_index);
-      if (entry)
-	peer = wg_peer_get (*entry);
-      else
+      bool consumed;
+
+      if (INDEX_INVALID == peeri)
 	return WG_INPUT_ERROR_PEER;
+      peer = wg_peer_get (peeri);
 
-      // TODO: Implement cookie_maker_consume_payload
+      clib_spinlock_lock (&peer->remote.r_handshake_lock);
+      consumed = cookie_maker_consume_payload (
+	vm, &peer->cookie_maker, packet->nonce, packet->encrypted_cookie);
+      clib_spinlock_unlock (&peer->remote.r_handshake_lock);
+
+      if (!consumed)
+	return WG_INPUT_ERROR_COOKIE_DECRYPTION;
 
       return WG_INPUT_ERROR_NONE;
     }
 
-  u32 len = (header->type == MESSAGE_HANDSHAKE_INITIATION ?
-	     sizeof (message_handshake_initiation_t) :
-	     sizeof (message_handshake_response_t));
+  under_load = wg_handshake_is_under_load (wmp, ptd, vlib_time_now (vm));
 
   message_macs_t *macs = (message_macs_t *)
     ((u8 *) current_b_data + len - sizeof (*macs));
@@ -230,16 +356,30 @@ wg_handshake_process (vlib_main_t *vm, wg_main_t *wmp, vlib_buffer_t *b,
   else
     return WG_INPUT_ERROR_HANDSHAKE_MAC;
 
+  /* Under load the sender has to prove it owns its address before we
+   * spend any DH on it, and even then only at a bounded rate. Initiation
+   * and response both carry the sender index at the same offset. */
+  if (packet_needs_cookie)
+    {
+      message_handshake_initiation_t *message = current_b_data;
+
+      if (!wg_send_handshake_cookie (vm, message->sender_index,
+				     &wg_if->cookie_checker, macs, &dst_ip,
+				     wg_if->port, &src_ip, udp_src_port,
+				     vnet_buffer (b)->sw_if_index[VLIB_RX]))
+	return WG_INPUT_ERROR_COOKIE_SEND;
+      return WG_INPUT_ERROR_COOKIE_REPLY;
+    }
+  if (under_load && !cookie_checker_ratelimit (&wg_if->cookie_checker,
+					       &src_ip, vlib_time_now (vm)))
+    return WG_INPUT_ERROR_HANDSHAKE_RATELIMITED;
+
   switch (header->type)
     {
     case MESSAGE_HANDSHAKE_INITIATION:
       {
 	message_handshake_initiation_t *message = current_b_data;
 
-	if (packet_needs_cookie)
-	  {
-	    // TODO: Add processing
-	  }
 	noise_remote_t *rp;
 	if (noise_consume_initiation
 	    (vm, noise_local_get (wg_if->local_idx), &rp,
@@ -254,27 +394,31 @@ wg_handshake_process (vlib_main_t *vm, wg_main_t *wmp, vlib_buffer_t *b,
 	  }
 
 	// set_peer_address (peer, ip4_src, udp_src_port);
-	if (PREDICT_FALSE (!wg_send_handshake_response (vm, peer)))
+	if (PREDICT_FALSE (!wg_create_handshake_response (vm, peer,
+							  &a.response)))
 	  {
 	    vlib_node_increment_counter (vm, node_idx,
 					 WG_INPUT_ERROR_HANDSHAKE_SEND, 1);
 	  }
 	else
 	  {
-	    wg_peer_update_flags (rp->r_peer_idx, WG_PEER_ESTABLISHED, true);
+	    a.peer_idx = rp->r_peer_idx;
+	    a.local_index = a.response.sender_index;
+	    a.is_responder = 1;
+	    vl_api_rpc_call_main_thread (wg_handshake_session_thread_fn,
+					 (u8 *) &a, sizeof (a));
 	  }
 	break;
       }
     case MESSAGE_HANDSHAKE_RESPONSE:
       {
 	message_handshake_response_t *resp = current_b_data;
-	index_t peeri = INDEX_INVALID;
-	u32 *entry =
+	index_t peeri =
 	  wg_index_table_lookup (&wmp->index_table, resp->receiver_index);
+	bool consumed;
 
-	if (PREDICT_TRUE (entry != NULL))
+	if (PREDICT_TRUE (INDEX_INVALID != peeri))
 	  {
-	    peeri = *entry;
 	    peer = wg_peer_get (peeri);
 	    if (wg_peer_is_dead (peer))
 	      return WG_INPUT_ERROR_PEER;
@@ -282,34 +426,20 @@ wg_handshake_process (vlib_main_t *vm, wg_main_t *wmp, vlib_buffer_t *b,
 	else
 	  return WG_INPUT_ERROR_PEER;
 
-	if (!noise_consume_response
-	    (vm, &peer->remote, resp->sender_index,
-	     resp->receiver_index, resp->unencrypted_ephemeral,
-	     resp->encrypted_nothing))
-	  {
-	    return WG_INPUT_ERROR_PEER;
-	  }
-	if (packet_needs_cookie)
-	  {
-	    // TODO: Add processing
-	  }
+	clib_spinlock_lock (&peer->remote.r_handshake_lock);
+	consumed = noise_consume_response (
+	  vm, &peer->remote, resp->sender_index, resp->receiver_index,
+	  resp->unencrypted_ephemeral, resp->encrypted_nothing);
+	clib_spinlock_unlock (&peer->remote.r_handshake_lock);
 
-	// set_peer_address (peer, ip4_src, udp_src_port);
-	if (noise_remote_begin_session (vm, &peer->remote))
-	  {
+	if (!consumed)
+	  return WG_INPUT_ERROR_PEER;
 
-	    wg_timers_session_derived (peer);
-	    wg_timers_handshake_complete (peer);
-	    if (PREDICT_FALSE (!wg_send_keepalive (vm, peer)))
-	      {
-		vlib_node_increment_counter (vm, node_idx,
-					     WG_INPUT_ERROR_KEEPALIVE_SEND, 1);
-	      }
-	    else
-	      {
-		wg_peer_update_flags (peeri, WG_PEER_ESTABLISHED, true);
-	      }
-	  }
+	// set_peer_address (peer, ip4_src, udp_src_port);
+	a.peer_idx = peeri;
+	a.local_index = resp->receiver_index;
+	vl_api_rpc_call_main_thread (wg_handshake_session_thread_fn, (u8 *) &a,
+				     sizeof (a));
 	break;
       }
     default:
@@ -589,11 +719,11 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   f64 time = clib_time_now (&vm->clib_time) + vm->time_offset;
 
   wg_peer_t *peer = NULL;
-  u32 *last_peer_time_idx = NULL;
+  index_t last_peer_time_idx = INDEX_INVALID;
   u32 last_rec_idx = ~0;
 
   bool is_keepalive = false;
-  u32 *peer_idx = NULL;
+  index_t peer_idx = INDEX_INVALID;
 
   while (n_left_from > 0)
     {
@@ -618,21 +748,19 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  message_data_t *data = vlib_buffer_get_current (b[0]);
 	  u8 *iv_data = b[0]->pre_data;
 	  u32 buf_idx = from[b - bufs];
-	  peer_idx = wg_index_table_lookup (&wmp->index_table,
-					    data->receiver_index);
 
 	  if (data->receiver_index != last_rec_idx)
 	    {
 	      peer_idx = wg_index_table_lookup (&wmp->index_table,
 						data->receiver_index);
-	      if (PREDICT_TRUE (peer_idx != NULL))
+	      if (PREDICT_TRUE (INDEX_INVALID != peer_idx))
 		{
-		  peer = wg_peer_get (*peer_idx);
+		  peer = wg_peer_get (peer_idx);
 		}
 	      last_rec_idx = data->receiver_index;
 	    }
 
-	  if (PREDICT_FALSE (!peer_idx))
+	  if (PREDICT_FALSE (INDEX_INVALID == peer_idx))
 	    {
 	      other_next[n_other] = WG_INPUT_NEXT_ERROR;
 	      b[0]->error = node->errors[WG_INPUT_ERROR_PEER];
@@ -658,10 +786,23 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	      goto next;
 	    }
 
+	  /* the op vector describes contiguous data only, so a chained
+	   * packet has to fit in its head buffer before it can be batched */
+	  if (PREDICT_FALSE (b[0]->flags & VLIB_BUFFER_NEXT_PRESENT) &&
+	      vlib_buffer_chain_linearize (vm, b[0]) != 1)
+	    {
+	      other_next[n_other] = WG_INPUT_NEXT_ERROR;
+	      b[0]->error = node->errors[WG_INPUT_ERROR_TOO_BIG];
+	      other_bi[n_other] = buf_idx;
+	      n_other += 1;
+	      goto out;
+	    }
+
 	  u16 encr_len = b[0]->current_length - sizeof (message_data_t);
 	  u16 decr_len = encr_len - NOISE_AUTHTAG_LEN;
 	  if (PREDICT_FALSE (decr_len >= WG_DEFAULT_DATA_SIZE))
 	    {
+	      other_next[n_other] = WG_INPUT_NEXT_ERROR;
 	      b[0]->error = node->errors[WG_INPUT_ERROR_TOO_BIG];
 	      other_bi[n_other] = buf_idx;
 	      n_other += 1;
@@ -676,7 +817,7 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 
 	  if (PREDICT_FALSE (state_cr == SC_FAILED))
 	    {
-	      wg_peer_update_flags (*peer_idx, WG_PEER_ESTABLISHED, false);
+	      wg_peer_update_flags (peer_idx, WG_PEER_ESTABLISHED, false);
 	      other_next[n_other] = WG_INPUT_NEXT_ERROR;
 	      b[0]->error = node->errors[WG_INPUT_ERROR_DECRYPTION];
 	      other_bi[n_other] = buf_idx;
@@ -701,7 +842,7 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	    }
 	  else if (PREDICT_FALSE (state_cr == SC_KEEP_KEY_FRESH))
 	    {
-	      wg_send_handshake_from_mt (*peer_idx, false);
+	      wg_send_handshake_from_mt (peer_idx, false);
 	      goto next;
 	    }
 	  else if (PREDICT_TRUE (state_cr == SC_OK))
@@ -709,11 +850,22 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	}
       else
 	{
-	  peer_idx = NULL;
+	  peer_idx = INDEX_INVALID;
+	  last_rec_idx = ~0;
 
-	  /* Handshake packets should be processed in main thread */
-	  if (thread_index != 0)
+	  /* handshakes of a peer that is known go to the peer's thread */
+	  if (thread_index != wg_handshake_thread_index (&wmp->index_table,
+							 b[0], thread_index))
 	    {
+	      wg_input_error_t ret = wg_handshake_prefilter (b[0]);
+	      if (ret != WG_INPUT_ERROR_NONE)
+		{
+		  other_next[n_other] = WG_INPUT_NEXT_ERROR;
+		  b[0]->error = node->errors[ret];
+		  other_bi[n_other] = from[b - bufs];
+		  n_other += 1;
+		  goto out;
+		}
 	      other_next[n_other] = WG_INPUT_NEXT_HANDOFF_HANDSHAKE;
 	      other_bi[n_other] = from[b - bufs];
 	      n_other += 1;
@@ -744,7 +896,7 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  t->type = header_type;
 	  t->current_length = b[0]->current_length;
 	  t->is_keepalive = is_keepalive;
-	  t->peer = peer_idx ? *peer_idx : INDEX_INVALID;
+	  t->peer = peer_idx;
 	}
 
     next:
@@ -760,12 +912,12 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   b = data_bufs;
   n_left_from = n_data;
   last_rec_idx = ~0;
-  last_peer_time_idx = NULL;
+  last_peer_time_idx = INDEX_INVALID;
 
   while (n_left_from > 0)
     {
       bool is_keepalive = false;
-      u32 *peer_idx = NULL;
+      index_t peer_idx = INDEX_INVALID;
 
       if (PREDICT_FALSE (data_next[0] == WG_INPUT_NEXT_PUNT))
 	{
@@ -787,7 +939,7 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	{
 	  peer_idx =
 	    wg_index_table_lookup (&wmp->index_table, data->receiver_index);
-	  peer = wg_peer_get (*peer_idx);
+	  peer = wg_peer_get (peer_idx);
 	  last_rec_idx = data->receiver_index;
 	}
 
@@ -795,7 +947,8 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 						data, &is_keepalive) < 0))
 	goto trace;
 
-      if (PREDICT_FALSE (peer_idx && (last_peer_time_idx != peer_idx)))
+      if (PREDICT_FALSE (INDEX_INVALID != peer_idx &&
+			 (last_peer_time_idx != peer_idx)))
 	{
 	  wg_timers_any_authenticated_packet_received_opt (peer, time);
 	  wg_timers_any_authenticated_packet_traversal (peer);
@@ -810,7 +963,7 @@ wg_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  t->type = header_type;
 	  t->current_length = b[0]->current_length;
 	  t->is_keepalive = is_keepalive;
-	  t->peer = peer_idx ? *peer_idx : INDEX_INVALID;
+	  t->peer = peer_idx;
 	}
 
       b += 1;
@@ -867,8 +1020,8 @@ wg_input_post (vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
   u32 *from = vlib_frame_vector_args (frame);
   u32 n_left = frame->n_vectors;
   wg_peer_t *peer = NULL;
-  u32 *peer_idx = NULL;
-  u32 *last_peer_time_idx = NULL;
+  index_t peer_idx = INDEX_INVALID;
+  index_t last_peer_time_idx = INDEX_INVALID;
   u32 last_rec_idx = ~0;
   f64 time = clib_time_now (&vm->clib_time) + vm->time_offset;
 
@@ -898,7 +1051,7 @@ wg_input_post (vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
 	  peer_idx =
 	    wg_index_table_lookup (&wmp->index_table, data->receiver_index);
 
-	  peer = wg_peer_get (*peer_idx);
+	  peer = wg_peer_get (peer_idx);
 	  last_rec_idx = data->receiver_index;
 	}
 
@@ -914,7 +1067,8 @@ wg_input_post (vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
 	  goto trace;
 	}
 
-      if (PREDICT_FALSE (peer_idx && (last_peer_time_idx != peer_idx)))
+      if (PREDICT_FALSE (INDEX_INVALID != peer_idx &&
+			 (last_peer_time_idx != peer_idx)))
 	{
 	  wg_timers_any_authenticated_packet_received_opt (peer, time);
 	  wg_timers_any_authenticated_packet_traversal (peer);
@@ -927,7 +1081,7 @@ wg_input_post (vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
 	  wg_input_post_trace_t *t =
 	    vlib_add_trace (vm, node, b[0], sizeof (*t));
 	  t->next = next[0];
-	  t->peer = peer_idx ? *peer_idx : INDEX_INVALID;
+	  t->peer = peer_idx;
 	}
 
       b += 1;
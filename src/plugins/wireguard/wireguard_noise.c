@@ -17,6 +17,7 @@
 
 #include <openssl/hmac.h>
 #include <wireguard/wireguard.h>
+#include <wireguard/wireguard_chachapoly.h>
 
 /* This implements Noise_IKpsk2:
  *
@@ -69,6 +70,15 @@ static void noise_tai64n_now (uint8_t[NOISE_TIMESTAMP_LEN]);
 
 static void secure_zero_memory (void *v, size_t n);
 
+/* Handshakes run on any thread; each has one key whose data the
+ * handshake AEADs overwrite, see wg_feature_init */
+static_always_inline uint32_t
+noise_handshake_key_index (vlib_main_t *vm)
+{
+  return vec_elt (wg_main.per_thread_data, vm->thread_index)
+    .handshake_key_index;
+}
+
 /* Set/Get noise parameters */
 void
 noise_local_init (noise_local_t * l, struct noise_upcall *upcall)
@@ -94,6 +104,7 @@ noise_remote_init (noise_remote_t * r, uint32_t peer_pool_idx,
   clib_memset (r, 0, sizeof (*r));
   clib_memcpy (r->r_public, public, NOISE_PUBLIC_KEY_LEN);
   clib_rwlock_init (&r->r_keypair_lock);
+  clib_spinlock_init (&r->r_handshake_lock);
   r->r_peer_idx = peer_pool_idx;
   r->r_local_idx = noise_local_idx;
   r->r_handshake.hs_state = HS_ZEROED;
@@ -109,8 +120,10 @@ noise_remote_precompute (noise_remote_t * r)
   if (!curve25519_gen_shared (r->r_ss, l->l_private, r->r_public))
     clib_memset (r->r_ss, 0, NOISE_PUBLIC_KEY_LEN);
 
+  clib_spinlock_lock (&r->r_handshake_lock);
   noise_remote_handshake_index_drop (r);
   secure_zero_memory (&r->r_handshake, sizeof (r->r_handshake));
+  clib_spinlock_unlock (&r->r_handshake_lock);
 }
 
 /* Handshake functions */
@@ -122,14 +135,11 @@ noise_create_initiation (vlib_main_t * vm, noise_remote_t * r,
 {
   noise_handshake_t *hs = &r->r_handshake;
   noise_local_t *l = noise_local_get (r->r_local_idx);
-  uint8_t _key[NOISE_SYMMETRIC_KEY_LEN];
   uint32_t key_idx;
   uint8_t *key;
   int ret = false;
 
-  key_idx =
-    vnet_crypto_key_add (vm, VNET_CRYPTO_ALG_CHACHA20_POLY1305, _key,
-			 NOISE_SYMMETRIC_KEY_LEN);
+  key_idx = noise_handshake_key_index (vm);
   key = vnet_crypto_get_key (key_idx)->data;
 
   noise_param_init (hs->hs_ck, hs->hs_hash, r->r_public);
@@ -162,7 +172,6 @@ noise_create_initiation (vlib_main_t * vm, noise_remote_t * r,
   ret = true;
 error:
   secure_zero_memory (key, NOISE_SYMMETRIC_KEY_LEN);
-  vnet_crypto_key_del (vm, key_idx);
   return ret;
 }
 
@@ -177,16 +186,13 @@ noise_consume_initiation (vlib_main_t * vm, noise_local_t * l,
 {
   noise_remote_t *r;
   noise_handshake_t hs;
-  uint8_t _key[NOISE_SYMMETRIC_KEY_LEN];
   uint8_t r_public[NOISE_PUBLIC_KEY_LEN];
   uint8_t timestamp[NOISE_TIMESTAMP_LEN];
   u32 key_idx;
   uint8_t *key;
   int ret = false;
 
-  key_idx =
-    vnet_crypto_key_add (vm, VNET_CRYPTO_ALG_CHACHA20_POLY1305, _key,
-			 NOISE_SYMMETRIC_KEY_LEN);
+  key_idx = noise_handshake_key_index (vm);
   key = vnet_crypto_get_key (key_idx)->data;
 
   noise_param_init (hs.hs_ck, hs.hs_hash, l->l_public);
@@ -225,27 +231,32 @@ noise_consume_initiation (vlib_main_t * vm, noise_local_t * l,
   hs.hs_remote_index = s_idx;
   clib_memcpy (hs.hs_e, ue, NOISE_PUBLIC_KEY_LEN);
 
+  /* The remote is only known now, it may be handshaking on another
+   * thread */
+  clib_spinlock_lock (&r->r_handshake_lock);
+
   /* Replay */
   if (clib_memcmp (timestamp, r->r_timestamp, NOISE_TIMESTAMP_LEN) > 0)
     clib_memcpy (r->r_timestamp, timestamp, NOISE_TIMESTAMP_LEN);
   else
-    goto error;
+    goto unlock;
 
   /* Flood attack */
   if (wg_birthdate_has_expired (r->r_last_init, REJECT_INTERVAL))
     r->r_last_init = vlib_time_now (vm);
   else
-    goto error;
+    goto unlock;
 
   /* Ok, we're happy to accept this initiation now */
   noise_remote_handshake_index_drop (r);
   r->r_handshake = hs;
   *rp = r;
   ret = true;
+unlock:
+  clib_spinlock_unlock (&r->r_handshake_lock);
 
 error:
   secure_zero_memory (key, NOISE_SYMMETRIC_KEY_LEN);
-  vnet_crypto_key_del (vm, key_idx);
   secure_zero_memory (&hs, sizeof (hs));
   return ret;
 }
@@ -256,15 +267,12 @@ noise_create_response (vlib_main_t * vm, noise_remote_t * r, uint32_t * s_idx,
 		       uint8_t en[0 + NOISE_AUTHTAG_LEN])
 {
   noise_handshake_t *hs = &r->r_handshake;
-  uint8_t _key[NOISE_SYMMETRIC_KEY_LEN];
   uint8_t e[NOISE_PUBLIC_KEY_LEN];
   uint32_t key_idx;
   uint8_t *key;
   int ret = false;
 
-  key_idx =
-    vnet_crypto_key_add (vm, VNET_CRYPTO_ALG_CHACHA20_POLY1305, _key,
-			 NOISE_SYMMETRIC_KEY_LEN);
+  key_idx = noise_handshake_key_index (vm);
   key = vnet_crypto_get_key (key_idx)->data;
 
   if (hs->hs_state != CONSUMED_INITIATION)
@@ -298,7 +306,6 @@ noise_create_response (vlib_main_t * vm, noise_remote_t * r, uint32_t * s_idx,
   ret = true;
 error:
   secure_zero_memory (key, NOISE_SYMMETRIC_KEY_LEN);
-  vnet_crypto_key_del (vm, key_idx);
   secure_zero_memory (e, NOISE_PUBLIC_KEY_LEN);
   return ret;
 }
@@ -310,15 +317,12 @@ noise_consume_response (vlib_main_t * vm, noise_remote_t * r, uint32_t s_idx,
 {
   noise_local_t *l = noise_local_get (r->r_local_idx);
   noise_handshake_t hs;
-  uint8_t _key[NOISE_SYMMETRIC_KEY_LEN];
   uint8_t preshared_key[NOISE_PUBLIC_KEY_LEN];
   uint32_t key_idx;
   uint8_t *key;
   int ret = false;
 
-  key_idx =
-    vnet_crypto_key_add (vm, VNET_CRYPTO_ALG_CHACHA20_POLY1305, _key,
-			 NOISE_SYMMETRIC_KEY_LEN);
+  key_idx = noise_handshake_key_index (vm);
   key = vnet_crypto_get_key (key_idx)->data;
 
   hs = r->r_handshake;
@@ -360,7 +364,6 @@ noise_consume_response (vlib_main_t * vm, noise_remote_t * r, uint32_t s_idx,
 error:
   secure_zero_memory (&hs, sizeof (hs));
   secure_zero_memory (key, NOISE_SYMMETRIC_KEY_LEN);
-  vnet_crypto_key_del (vm, key_idx);
   return ret;
 }
 
@@ -452,8 +455,10 @@ noise_remote_begin_session (vlib_main_t * vm, noise_remote_t * r)
 void
 noise_remote_clear (vlib_main_t * vm, noise_remote_t * r)
 {
+  clib_spinlock_lock (&r->r_handshake_lock);
   noise_remote_handshake_index_drop (r);
   secure_zero_memory (&r->r_handshake, sizeof (r->r_handshake));
+  clib_spinlock_unlock (&r->r_handshake_lock);
 
   clib_rwlock_writer_lock (&r->r_keypair_lock);
   noise_remote_keypair_free (vm, r, &r->r_next);
@@ -495,55 +500,6 @@ noise_remote_ready (noise_remote_t * r)
   return ret;
 }
 
-static bool
-chacha20poly1305_calc (vlib_main_t * vm,
-		       u8 * src,
-		       u32 src_len,
-		       u8 * dst,
-		       u8 * aad,
-		       u32 aad_len,
-		       u64 nonce,
-		       vnet_crypto_op_id_t op_id,
-		       vnet_crypto_key_index_t key_index)
-{
-  vnet_crypto_op_t _op, *op = &_op;
-  u8 iv[12];
-  u8 tag_[NOISE_AUTHTAG_LEN] = { };
-  u8 src_[] = { };
-
-  clib_memset (iv, 0, 12);
-  clib_memcpy (iv + 4, &nonce, sizeof (nonce));
-
-  vnet_crypto_op_init (op, op_id);
-
-  op->tag_len = NOISE_AUTHTAG_LEN;
-  if (op_id == VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC)
-    {
-      op->tag = src + src_len - NOISE_AUTHTAG_LEN;
-      src_len -= NOISE_AUTHTAG_LEN;
-      op->flags |= VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
-    }
-  else
-    op->tag = tag_;
-
-  op->src = !src ? src_ : src;
-  op->len = src_len;
-
-  op->dst = dst;
-  op->key_index = key_index;
-  op->aad = aad;
-  op->aad_len = aad_len;
-  op->iv = iv;
-
-  vnet_crypto_process_ops (vm, op, 1);
-  if (op_id == VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC)
-    {
-      clib_memcpy (dst + src_len, op->tag, NOISE_AUTHTAG_LEN);
-    }
-
-  return (op->status == VNET_CRYPTO_OP_STATUS_COMPLETED);
-}
-
 enum noise_state_crypt
 noise_remote_encrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t * r_idx,
 		      uint64_t * nonce, uint8_t * src, size_t srclen,
@@ -572,9 +528,9 @@ noise_remote_encrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t * r_idx,
    * are passed back out to the caller through the provided data pointer. */
   *r_idx = kp->kp_remote_index;
 
-  chacha20poly1305_calc (vm, src, srclen, dst, NULL, 0, *nonce,
-			 VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC,
-			 kp->kp_send_index);
+  wg_chacha20poly1305_calc (vm, src, srclen, dst, NULL, 0, *nonce,
+			    VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC,
+			    kp->kp_send_index);
 
   /* If our values are still within tolerances, but we are approaching
    * the tolerances, we notify the caller with ESTALE that they should
@@ -750,8 +706,8 @@ noise_msg_encrypt (vlib_main_t * vm, uint8_t * dst, uint8_t * src,
 		   uint8_t hash[NOISE_HASH_LEN])
 {
   /* Nonce always zero for Noise_IK */
-  chacha20poly1305_calc (vm, src, src_len, dst, hash, NOISE_HASH_LEN, 0,
-			 VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC, key_idx);
+  wg_chacha20poly1305_calc (vm, src, src_len, dst, hash, NOISE_HASH_LEN, 0,
+			    VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC, key_idx);
   noise_mix_hash (hash, dst, src_len + NOISE_AUTHTAG_LEN);
 }
 
@@ -761,8 +717,9 @@ noise_msg_decrypt (vlib_main_t * vm, uint8_t * dst, uint8_t * src,
 		   uint8_t hash[NOISE_HASH_LEN])
 {
   /* Nonce always zero for Noise_IK */
-  if (!chacha20poly1305_calc (vm, src, src_len, dst, hash, NOISE_HASH_LEN, 0,
-			      VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC, key_idx))
+  if (!wg_chacha20poly1305_calc (vm, src, src_len, dst, hash, NOISE_HASH_LEN,
+				 0, VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC,
+				 key_idx))
     return false;
   noise_mix_hash (hash, src, src_len);
   return true;
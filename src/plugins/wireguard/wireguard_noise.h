@@ -103,6 +103,11 @@ typedef struct noise_remote
   uint32_t r_local_idx;
   uint8_t r_ss[NOISE_PUBLIC_KEY_LEN];
 
+  /* Handshake messages of a remote may be processed on any thread. The
+   * lock covers the handshake state, the timestamp and time of the last
+   * initiation. The create and consume functions, other than
+   * noise_consume_initiation, expect the caller to hold it. */
+  clib_spinlock_t r_handshake_lock;
   noise_handshake_t r_handshake;
   uint8_t r_psk[NOISE_SYMMETRIC_KEY_LEN];
   uint8_t r_timestamp[NOISE_TIMESTAMP_LEN];
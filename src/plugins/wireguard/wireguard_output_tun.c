@@ -414,9 +414,18 @@ wg_output_tun_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  message_data_wg = &hdr6_out->wg;
 	}
 
+      /* ops are built over contiguous data and the packet is encrypted in
+       * place, so a chained packet must first collapse into one buffer */
+      if (PREDICT_FALSE (b[0]->flags & VLIB_BUFFER_NEXT_PRESENT) &&
+	  vlib_buffer_chain_linearize (vm, b[0]) != 1)
+	{
+	  b[0]->error = node->errors[WG_OUTPUT_ERROR_TOO_BIG];
+	  goto out;
+	}
+
       iph_offset = vnet_buffer (b[0])->ip.save_rewrite_length;
       plain_data = vlib_buffer_get_current (b[0]) + iph_offset;
-      plain_data_len = vlib_buffer_length_in_chain (vm, b[0]) - iph_offset;
+      plain_data_len = b[0]->current_length - iph_offset;
       u8 *iv_data = b[0]->pre_data;
 
       size_t encrypted_packet_len = message_data_len (plain_data_len);
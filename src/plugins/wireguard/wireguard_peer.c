@@ -28,6 +28,10 @@ wg_peer_t *wg_peer_pool;
 
 index_t *wg_peer_by_adj_index;
 
+/* public key -> peer index, so that handshakes and configuration do not
+ * have to walk every peer */
+static uword *wg_peer_by_public_key;
+
 static void
 wg_peer_endpoint_reset (wg_peer_endpoint_t * ep)
 {
@@ -376,15 +380,8 @@ wg_peer_add (u32 tun_sw_if_index, const u8 public_key[NOISE_PUBLIC_KEY_LEN],
   if (!wg_if)
     return (VNET_API_ERROR_INVALID_SW_IF_INDEX);
 
-  /* *INDENT-OFF* */
-  pool_foreach (peer, wg_peer_pool)
-   {
-    if (!memcmp (peer->remote.r_public, public_key, NOISE_PUBLIC_KEY_LEN))
-    {
-      return (VNET_API_ERROR_ENTRY_ALREADY_EXISTS);
-    }
-  }
-  /* *INDENT-ON* */
+  if (INDEX_INVALID != wg_peer_find_by_public_key (public_key))
+    return (VNET_API_ERROR_ENTRY_ALREADY_EXISTS);
 
   if (pool_elts (wg_peer_pool) > MAX_PEERS)
     return (VNET_API_ERROR_LIMIT_EXCEEDED);
@@ -407,6 +404,12 @@ wg_peer_add (u32 tun_sw_if_index, const u8 public_key[NOISE_PUBLIC_KEY_LEN],
 		     wg_if->local_idx);
   cookie_maker_init (&peer->cookie_maker, public_key);
 
+  if (!wg_peer_by_public_key)
+    wg_peer_by_public_key =
+      hash_create_mem (0, NOISE_PUBLIC_KEY_LEN, sizeof (uword));
+  hash_set_mem_alloc (&wg_peer_by_public_key, peer->remote.r_public,
+		      peer - wg_peer_pool);
+
   wg_send_handshake (vm, peer, false);
   if (peer->persistent_keepalive_interval != 0)
     {
@@ -434,7 +437,9 @@ wg_peer_remove (index_t peeri)
   wgi = wg_if_get (wg_if_find_by_sw_if_index (peer->wg_sw_if_index));
   wg_if_peer_remove (wgi, peeri);
 
+  hash_unset_mem_free (&wg_peer_by_public_key, peer->remote.r_public);
   noise_remote_clear (wmp->vlib_main, &peer->remote);
+  clib_spinlock_free (&peer->remote.r_handshake_lock);
   wg_peer_clear (wmp->vlib_main, peer);
   pool_put (wg_peer_pool, peer);
 
@@ -456,6 +461,17 @@ wg_peer_walk (wg_peer_walk_cb_t fn, void *data)
   return INDEX_INVALID;
 }
 
+index_t
+wg_peer_find_by_public_key (const u8 public_key[NOISE_PUBLIC_KEY_LEN])
+{
+  uword *p;
+
+  p = hash_get_mem (wg_peer_by_public_key, public_key);
+  if (p)
+    return p[0];
+  return INDEX_INVALID;
+}
+
 static u8 *
 format_wg_peer_endpoint (u8 * s, va_list * args)
 {
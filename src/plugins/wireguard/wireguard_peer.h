@@ -134,6 +134,8 @@ int wg_peer_remove (u32 peer_index);
 
 typedef walk_rc_t (*wg_peer_walk_cb_t) (index_t peeri, void *arg);
 index_t wg_peer_walk (wg_peer_walk_cb_t fn, void *data);
+index_t
+wg_peer_find_by_public_key (const u8 public_key[NOISE_PUBLIC_KEY_LEN]);
 
 u8 *format_wg_peer (u8 * s, va_list * va);
 
@@ -181,6 +183,42 @@ wg_peer_assign_thread (u32 thread_id)
 	      1) : thread_id));
 }
 
+/*
+ * The thread a handshake message is processed on. Responses and cookie
+ * replies name their peer and go to the thread that decrypts its data, as
+ * the peer's handshakes then mostly stay on one thread. An initiation only
+ * names its peer once its static key is decrypted, so it stays on the
+ * thread it was received on.
+ */
+static_always_inline u32
+wg_handshake_thread_index (wg_index_table_t *table, vlib_buffer_t *b,
+			   u32 thread_index)
+{
+  message_header_t *header = vlib_buffer_get_current (b);
+  u32 receiver_index, peeri;
+  wg_peer_t *peer;
+
+  if (header->type == MESSAGE_HANDSHAKE_RESPONSE &&
+      b->current_length >= sizeof (message_handshake_response_t))
+    receiver_index = ((message_handshake_response_t *) header)->receiver_index;
+  else if (header->type == MESSAGE_HANDSHAKE_COOKIE &&
+	   b->current_length >= sizeof (message_handshake_cookie_t))
+    receiver_index = ((message_handshake_cookie_t *) header)->receiver_index;
+  else
+    return thread_index;
+
+  peeri = wg_index_table_lookup (table, receiver_index);
+  if (INDEX_INVALID == peeri)
+    return thread_index;
+
+  peer = wg_peer_get (peeri);
+  if (PREDICT_FALSE (~0 == peer->input_thread_index))
+    clib_atomic_cmp_and_swap (&peer->input_thread_index, ~0,
+			      wg_peer_assign_thread (thread_index));
+
+  return peer->input_thread_index;
+}
+
 static_always_inline bool
 fib_prefix_is_cover_addr_46 (const fib_prefix_t *p1, const ip46_address_t *ip)
 {
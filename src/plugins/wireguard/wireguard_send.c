@@ -106,6 +106,7 @@ wg_send_handshake (vlib_main_t * vm, wg_peer_t * peer, bool is_retry)
   ASSERT (vm->thread_index == 0);
 
   message_handshake_initiation_t packet;
+  bool created;
 
   if (!is_retry)
     peer->timer_handshake_attempts = 0;
@@ -114,25 +115,28 @@ wg_send_handshake (vlib_main_t * vm, wg_peer_t * peer, bool is_retry)
       wg_peer_is_dead (peer))
     return true;
 
-  if (noise_create_initiation (vm,
-			       &peer->remote,
-			       &packet.sender_index,
-			       packet.unencrypted_ephemeral,
-			       packet.encrypted_static,
-			       packet.encrypted_timestamp))
+  clib_spinlock_lock (&peer->remote.r_handshake_lock);
+  created = noise_create_initiation (vm, &peer->remote, &packet.sender_index,
+				     packet.unencrypted_ephemeral,
+				     packet.encrypted_static,
+				     packet.encrypted_timestamp);
+  if (created)
     {
       packet.header.type = MESSAGE_HANDSHAKE_INITIATION;
       cookie_maker_mac (&peer->cookie_maker, &packet.macs, &packet,
 			sizeof (packet));
-      wg_timers_any_authenticated_packet_sent (peer);
-      wg_timers_handshake_initiated (peer);
-      wg_timers_any_authenticated_packet_traversal (peer);
-
-      peer->last_sent_handshake = vlib_time_now (vm);
     }
-  else
+  clib_spinlock_unlock (&peer->remote.r_handshake_lock);
+
+  if (!created)
     return false;
 
+  wg_timers_any_authenticated_packet_sent (peer);
+  wg_timers_handshake_initiated (peer);
+  wg_timers_any_authenticated_packet_traversal (peer);
+
+  peer->last_sent_handshake = vlib_time_now (vm);
+
   u8 is_ip4 = ip46_address_is_ip4 (&peer->dst.addr);
   u32 bi0 = 0;
   if (!wg_create_buffer (vm, peer, (u8 *) &packet, sizeof (packet), &bi0,
@@ -227,43 +231,138 @@ out:
   return ret;
 }
 
+/* Answer the initiation the peer's handshake state holds. This is the
+ * expensive part of a response and runs on the thread the initiation was
+ * received on. */
 bool
-wg_send_handshake_response (vlib_main_t * vm, wg_peer_t * peer)
+wg_create_handshake_response (vlib_main_t *vm, wg_peer_t *peer,
+			      message_handshake_response_t *packet)
 {
-  message_handshake_response_t packet;
-
-  if (noise_create_response (vm,
-			     &peer->remote,
-			     &packet.sender_index,
-			     &packet.receiver_index,
-			     packet.unencrypted_ephemeral,
-			     packet.encrypted_nothing))
+  bool created;
+
+  clib_spinlock_lock (&peer->remote.r_handshake_lock);
+  created = noise_create_response (
+    vm, &peer->remote, &packet->sender_index, &packet->receiver_index,
+    packet->unencrypted_ephemeral, packet->encrypted_nothing);
+  if (created)
     {
-      packet.header.type = MESSAGE_HANDSHAKE_RESPONSE;
-      cookie_maker_mac (&peer->cookie_maker, &packet.macs, &packet,
-			sizeof (packet));
+      packet->header.type = MESSAGE_HANDSHAKE_RESPONSE;
+      cookie_maker_mac (&peer->cookie_maker, &packet->macs, packet,
+			sizeof (*packet));
+    }
+  clib_spinlock_unlock (&peer->remote.r_handshake_lock);
 
-      if (noise_remote_begin_session (vm, &peer->remote))
-	{
-	  wg_timers_session_derived (peer);
-	  wg_timers_any_authenticated_packet_sent (peer);
-	  wg_timers_any_authenticated_packet_traversal (peer);
-	  peer->last_sent_handshake = vlib_time_now (vm);
-
-	  u32 bi0 = 0;
-	  u8 is_ip4 = ip46_address_is_ip4 (&peer->dst.addr);
-	  if (!wg_create_buffer (vm, peer, (u8 *) &packet, sizeof (packet),
-				 &bi0, is_ip4))
-	    return false;
-
-	  ip46_enqueue_packet (vm, bi0, is_ip4);
-	  return true;
-	}
-      return false;
+  return created;
+}
+
+/* Begin the session a created response leads to and send the response.
+ * The session's keys are added to the crypto engines, so this runs on the
+ * main thread. */
+bool
+wg_send_handshake_response (vlib_main_t *vm, wg_peer_t *peer,
+			    message_handshake_response_t *packet)
+{
+  ASSERT (vm->thread_index == 0);
+
+  if (noise_remote_begin_session (vm, &peer->remote))
+    {
+      wg_timers_session_derived (peer);
+      wg_timers_any_authenticated_packet_sent (peer);
+      wg_timers_any_authenticated_packet_traversal (peer);
+      peer->last_sent_handshake = vlib_time_now (vm);
+
+      u32 bi0 = 0;
+      u8 is_ip4 = ip46_address_is_ip4 (&peer->dst.addr);
+      if (!wg_create_buffer (vm, peer, (u8 *) packet, sizeof (*packet), &bi0,
+			     is_ip4))
+	return false;
+
+      ip46_enqueue_packet (vm, bi0, is_ip4);
+      return true;
     }
   return false;
 }
 
+bool
+wg_send_handshake_cookie (vlib_main_t *vm, u32 sender_index,
+			  cookie_checker_t *cookie_checker,
+			  message_macs_t *macs, ip46_address_t *wg_if_addr,
+			  u16 wg_if_port, ip46_address_t *remote_addr,
+			  u16 remote_port, u32 rx_sw_if_index)
+{
+  message_handshake_cookie_t *packet;
+  vlib_buffer_t *b0;
+  u32 bi0;
+  u8 is_ip4 = ip46_address_is_ip4 (remote_addr);
+
+  if (!vlib_buffer_alloc (vm, &bi0, 1))
+    return false;
+
+  b0 = vlib_get_buffer (vm, bi0);
+  packet = vlib_buffer_get_current (b0);
+
+  packet->header.type = MESSAGE_HANDSHAKE_COOKIE;
+  packet->receiver_index = sender_index;
+  cookie_checker_create_payload (vm, cookie_checker, macs, packet->nonce,
+				 packet->encrypted_cookie, remote_addr,
+				 remote_port);
+  b0->current_length = sizeof (*packet);
+
+  /* there may be no peer for the sender, so reply on the path the
+   * message came in on */
+  if (is_ip4)
+    {
+      ip4_udp_header_t *hdr4;
+
+      vlib_buffer_advance (b0, -sizeof (*hdr4));
+      hdr4 = vlib_buffer_get_current (b0);
+      clib_memset (hdr4, 0, sizeof (*hdr4));
+
+      hdr4->ip4.ip_version_and_header_length = 0x45;
+      hdr4->ip4.ttl = 64;
+      hdr4->ip4.protocol = IP_PROTOCOL_UDP;
+      hdr4->ip4.src_address = wg_if_addr->ip4;
+      hdr4->ip4.dst_address = remote_addr->ip4;
+      hdr4->ip4.length = clib_host_to_net_u16 (b0->current_length);
+      hdr4->ip4.checksum = ip4_header_checksum (&hdr4->ip4);
+
+      hdr4->udp.src_port = clib_host_to_net_u16 (wg_if_port);
+      hdr4->udp.dst_port = clib_host_to_net_u16 (remote_port);
+      hdr4->udp.length =
+	clib_host_to_net_u16 (b0->current_length - sizeof (ip4_header_t));
+    }
+  else
+    {
+      ip6_udp_header_t *hdr6;
+      int bogus = 0;
+
+      vlib_buffer_advance (b0, -sizeof (*hdr6));
+      hdr6 = vlib_buffer_get_current (b0);
+      clib_memset (hdr6, 0, sizeof (*hdr6));
+
+      hdr6->ip6.ip_version_traffic_class_and_flow_label =
+	clib_host_to_net_u32 (0x6 << 28);
+      hdr6->ip6.protocol = IP_PROTOCOL_UDP;
+      hdr6->ip6.hop_limit = 64;
+      ip6_address_copy (&hdr6->ip6.src_address, &wg_if_addr->ip6);
+      ip6_address_copy (&hdr6->ip6.dst_address, &remote_addr->ip6);
+      hdr6->ip6.payload_length =
+	clib_host_to_net_u16 (b0->current_length - sizeof (ip6_header_t));
+
+      hdr6->udp.src_port = clib_host_to_net_u16 (wg_if_port);
+      hdr6->udp.dst_port = clib_host_to_net_u16 (remote_port);
+      hdr6->udp.length = hdr6->ip6.payload_length;
+      hdr6->udp.checksum =
+	ip6_tcp_udp_icmp_compute_checksum (vm, b0, &hdr6->ip6, &bogus);
+    }
+
+  vnet_buffer (b0)->sw_if_index[VLIB_RX] = rx_sw_if_index;
+  vnet_buffer (b0)->sw_if_index[VLIB_TX] = ~0;
+
+  ip46_enqueue_packet (vm, bi0, is_ip4);
+  return true;
+}
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -22,7 +22,16 @@
 bool wg_send_keepalive (vlib_main_t * vm, wg_peer_t * peer);
 bool wg_send_handshake (vlib_main_t * vm, wg_peer_t * peer, bool is_retry);
 void wg_send_handshake_from_mt (u32 peer_index, bool is_retry);
-bool wg_send_handshake_response (vlib_main_t * vm, wg_peer_t * peer);
+bool wg_create_handshake_response (vlib_main_t *vm, wg_peer_t *peer,
+				   message_handshake_response_t *packet);
+bool wg_send_handshake_response (vlib_main_t *vm, wg_peer_t *peer,
+				 message_handshake_response_t *packet);
+bool wg_send_handshake_cookie (vlib_main_t *vm, u32 sender_index,
+			       cookie_checker_t *cookie_checker,
+			       message_macs_t *macs,
+			       ip46_address_t *wg_if_addr, u16 wg_if_port,
+			       ip46_address_t *remote_addr, u16 remote_port,
+			       u32 rx_sw_if_index);
 
 always_inline void
 ip4_header_set_len_w_chksum (ip4_header_t * ip4, u16 len)
@@ -17,6 +17,7 @@
 #include <wireguard/wireguard.h>
 #include <wireguard/wireguard_send.h>
 #include <wireguard/wireguard_timer.h>
+#include <wireguard/wireguard_chachapoly.h>
 
 static u32
 get_random_u32_max (u32 max)
@@ -366,9 +367,9 @@ wg_timer_wheel_init ()
 {
   wg_main_t *wmp = &wg_main;
   tw_timer_wheel_16t_2w_512sl_t *tw = &wmp->timer_wheel;
-  tw_timer_wheel_init_16t_2w_512sl (tw,
-				    expired_timer_callback,
-				    WG_TICK /* timer period in s */ , ~0);
+  tw_timer_wheel_init_16t_2w_512sl (tw, 0 /* expired by the process */,
+				    WG_TICK /* timer period in s */,
+				    WG_TIMER_MAX_EXPIRATIONS);
 }
 
 static uword
@@ -377,6 +378,7 @@ wg_timer_mngr_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
 {
   wg_main_t *wmp = &wg_main;
   uword event_type = 0;
+  u32 *expired = 0;
 
   /* Park the process until the feature is configured */
   while (1)
@@ -403,8 +405,16 @@ wg_timer_mngr_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
       vlib_process_wait_for_event_or_clock (vm, WG_TICK);
       vlib_process_get_events (vm, NULL);
 
-      tw_timer_expire_timers_16t_2w_512sl (&wmp->timer_wheel,
-					   vlib_time_now (vm));
+      /* the wheel stops after WG_TIMER_MAX_EXPIRATIONS and catches up on
+       * the next tick, so a burst of handshake retransmits cannot keep
+       * the main thread in here for longer than it takes them to expire */
+      expired = tw_timer_expire_timers_vec_16t_2w_512sl (
+	&wmp->timer_wheel, vlib_time_now (vm), expired);
+      if (vec_len (expired))
+	{
+	  expired_timer_callback (expired);
+	  vec_reset_length (expired);
+	}
     }
 
   return 0;
@@ -436,8 +446,24 @@ VLIB_REGISTER_NODE (wg_timer_mngr_node, static) = {
 void
 wg_feature_init (wg_main_t * wmp)
 {
+  u8 zero_key[CHACHA20POLY1305_KEY_SIZE] = {};
+  wg_per_thread_data_t *ptd;
+
   if (wmp->feature_init)
     return;
+
+  /* Handshakes run on any thread, which must not add crypto keys, so
+   * each gets its keys here, before there is an interface to take any */
+  vec_foreach (ptd, wmp->per_thread_data)
+    {
+      ptd->handshake_key_index =
+	vnet_crypto_key_add (wmp->vlib_main, VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+			     zero_key, CHACHA20POLY1305_KEY_SIZE);
+      ptd->cookie_key_index =
+	vnet_crypto_key_add (wmp->vlib_main, VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+			     zero_key, CHACHA20POLY1305_KEY_SIZE);
+    }
+
   vlib_process_signal_event (wmp->vlib_main, wg_timer_mngr_node.index,
 			     WG_START_EVENT, 0);
   wmp->feature_init = 1;
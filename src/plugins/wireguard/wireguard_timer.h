@@ -28,6 +28,11 @@
   _(NEW_HANDSHAKE, "NEW HANDSHAKE")                 \
   _(KEY_ZEROING, "KEY ZEROING")                     \
 
+/** Timers expired per tick. Each expiry may cost a handshake initiation,
+ * so the wheel is allowed to fall behind rather than keep the main thread
+ * busy when thousands of peers retransmit at once */
+#define WG_TIMER_MAX_EXPIRATIONS 128
+
 typedef enum _wg_timers
 {
 #define _(sym, str) WG_TIMER_##sym,
@@ -1354,17 +1354,90 @@ send (int fd, const void *buf, size_t n, int flags)
   return size;
 }
 
+/*
+ * Moves data between two vcl sessions fifo to fifo, without copying it
+ * through user space. Blocks, until at least one byte moved, only if
+ * neither session nor the caller asked for non-blocking io.
+ */
+static ssize_t
+ldp_vls_splice (int out_fd, vls_handle_t out_vlsh, int in_fd,
+		vls_handle_t in_vlsh, size_t len, int is_nonblocking)
+{
+  u32 flags, flags_len = sizeof (flags);
+  ssize_t moved = 0;
+  struct pollfd pfd;
+  int rv = 0;
+
+  if (!is_nonblocking)
+    {
+      rv = vls_attr (in_vlsh, VPPCOM_ATTR_GET_FLAGS, &flags, &flags_len);
+      if (rv == VPPCOM_OK && !(flags & O_NONBLOCK))
+	rv = vls_attr (out_vlsh, VPPCOM_ATTR_GET_FLAGS, &flags, &flags_len);
+      if (PREDICT_FALSE (rv != VPPCOM_OK))
+	{
+	  errno = -rv;
+	  return -1;
+	}
+      is_nonblocking = (flags & O_NONBLOCK) != 0;
+    }
+
+  while (moved < len)
+    {
+      rv = vls_splice (out_vlsh, in_vlsh, clib_min (len - moved, ~0U));
+      if (rv > 0)
+	{
+	  moved += rv;
+	  continue;
+	}
+      if (rv != VPPCOM_EWOULDBLOCK && rv != VPPCOM_EAGAIN)
+	break;
+      if (moved || is_nonblocking)
+	break;
+
+      /* wait for whichever end stopped us */
+      if (vls_attr (in_vlsh, VPPCOM_ATTR_GET_NREAD, 0, 0) > 0)
+	pfd = (struct pollfd){ .fd = out_fd, .events = POLLOUT };
+      else
+	pfd = (struct pollfd){ .fd = in_fd, .events = POLLIN };
+      if (poll (&pfd, 1, -1) < 0)
+	return -1;
+    }
+
+  if (moved)
+    return moved;
+
+  if (rv < 0)
+    {
+      errno = -rv;
+      return -1;
+    }
+  /* input session closed */
+  return 0;
+}
+
 ssize_t
 sendfile (int out_fd, int in_fd, off_t * offset, size_t len)
 {
   ldp_worker_ctx_t *ldpw = ldp_worker_get_current ();
-  vls_handle_t vlsh;
+  vls_handle_t vlsh, in_vlsh;
   ssize_t size = 0;
 
   ldp_init_check ();
 
   vlsh = ldp_fd_to_vlsh (out_fd);
-  if (vlsh != VLS_INVALID_HANDLE)
+  in_vlsh = ldp_fd_to_vlsh (in_fd);
+  if (vlsh != VLS_INVALID_HANDLE && in_vlsh != VLS_INVALID_HANDLE)
+    {
+      /* sockets have no file position */
+      if (offset)
+	{
+	  errno = ESPIPE;
+	  return -1;
+	}
+      return ldp_vls_splice (out_fd, vlsh, in_fd, in_vlsh, len,
+			     0 /* is_nonblocking */);
+    }
+  else if (vlsh != VLS_INVALID_HANDLE)
     {
       int rv;
       ssize_t results = 0;
@@ -1504,6 +1577,37 @@ sendfile64 (int out_fd, int in_fd, off_t * offset, size_t len)
   return sendfile (out_fd, in_fd, offset, len);
 }
 
+ssize_t
+splice (int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len,
+	unsigned int flags)
+{
+  vls_handle_t in_vlsh, out_vlsh;
+
+  ldp_init_check ();
+
+  in_vlsh = ldp_fd_to_vlsh (fd_in);
+  out_vlsh = ldp_fd_to_vlsh (fd_out);
+  if (in_vlsh == VLS_INVALID_HANDLE && out_vlsh == VLS_INVALID_HANDLE)
+    return libc_splice (fd_in, off_in, fd_out, off_out, len, flags);
+
+  /* vcl sessions can only be spliced to each other, the kernel cannot
+   * reach their fifos */
+  if (in_vlsh == VLS_INVALID_HANDLE || out_vlsh == VLS_INVALID_HANDLE)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  if (off_in || off_out)
+    {
+      errno = ESPIPE;
+      return -1;
+    }
+
+  return ldp_vls_splice (fd_out, out_vlsh, fd_in, in_vlsh, len,
+			 flags & SPLICE_F_NONBLOCK);
+}
+
 ssize_t
 recv (int fd, void *buf, size_t n, int flags)
 {
@@ -156,6 +156,15 @@ extern ssize_t send (int __fd, const void *__buf, size_t __n, int __flags);
 extern ssize_t sendfile (int __out_fd, int __in_fd, off_t * __offset,
 			 size_t __len);
 
+/* Move LEN bytes between two file descriptors, one of which is usually a
+   pipe. Declared by <fcntl.h> only for _GNU_SOURCE.  */
+extern ssize_t splice (int __fdin, loff_t *__offin, int __fdout,
+		       loff_t *__offout, size_t __len, unsigned int __flags);
+
+#ifndef SPLICE_F_NONBLOCK
+#define SPLICE_F_NONBLOCK 2
+#endif
+
 /* Read N bytes into BUF from socket FD.
    Returns the number read or -1 for errors.
 
@@ -222,6 +222,9 @@ typedef int (*__libc_sendmsg) (int sockfd, const struct msghdr * msg,
 typedef int (*__libc_sendto) (int sockfd, const void *buf, size_t len,
 			      int flags, const struct sockaddr * dst_addr,
 			      socklen_t addrlen);
+typedef ssize_t (*__libc_splice) (int fd_in, loff_t *off_in, int fd_out,
+				  loff_t *off_out, size_t len,
+				  unsigned int flags);
 typedef int (*__libc_setsockopt) (int sockfd, int level, int optname,
 				  const void *optval, socklen_t optlen);
 #ifdef HAVE_SIGNALFD
@@ -326,6 +329,7 @@ struct swrap_libc_symbols
   SWRAP_SYMBOL_ENTRY (sendmsg);
   SWRAP_SYMBOL_ENTRY (sendto);
   SWRAP_SYMBOL_ENTRY (setsockopt);
+  SWRAP_SYMBOL_ENTRY (splice);
 #ifdef HAVE_SIGNALFD
   SWRAP_SYMBOL_ENTRY (signalfd);
 #endif
@@ -681,6 +685,16 @@ libc_sendfile (int out_fd, int in_fd, off_t * offset, size_t len)
   return swrap.libc.symbols._libc_sendfile.f (out_fd, in_fd, offset, len);
 }
 
+ssize_t
+libc_splice (int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+	     size_t len, unsigned int flags)
+{
+  swrap_bind_symbol_libc (splice);
+
+  return swrap.libc.symbols._libc_splice.f (fd_in, off_in, fd_out, off_out,
+					    len, flags);
+}
+
 int
 libc_sendmsg (int sockfd, const struct msghdr *msg, int flags)
 {
@@ -156,6 +156,9 @@ int libc_send (int sockfd, const void *buf, size_t len, int flags);
 
 ssize_t libc_sendfile (int out_fd, int in_fd, off_t * offset, size_t len);
 
+ssize_t libc_splice (int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+		     size_t len, unsigned int flags);
+
 int libc_sendmsg (int sockfd, const struct msghdr *msg, int flags);
 
 int
@@ -1215,6 +1215,86 @@ vls_recvfrom (vls_handle_t vlsh, void *buffer, uint32_t buflen, int flags,
   return rv;
 }
 
+static int
+vls_mt_session_migrate_vlsh (vls_handle_t vlsh)
+{
+  vcl_locked_session_t *vls;
+
+  if (!(vls = vls_get_w_dlock (vlsh)))
+    return VPPCOM_EBADFD;
+  if (vls_mt_session_should_migrate (vls))
+    {
+      vls = vls_mt_session_migrate (vls);
+      if (PREDICT_FALSE (!vls))
+	return VPPCOM_EBADFD;
+    }
+  vls_dunlock (vls);
+  return 0;
+}
+
+int
+vls_splice (vls_handle_t out_vlsh, vls_handle_t in_vlsh, uint32_t max_bytes)
+{
+  vcl_locked_session_t *lo_vls, *hi_vls, *in_vls, *out_vls;
+  vls_handle_t lo_vlsh, hi_vlsh;
+  vcl_session_handle_t in_sh, out_sh;
+  int rv;
+
+  /* the session would be locked twice */
+  if (in_vlsh == out_vlsh)
+    return VPPCOM_EINVAL;
+
+  vls_mt_detect ();
+
+  /* lock in handle order, otherwise splices in opposite directions
+   * between the same two sessions can deadlock */
+  lo_vlsh = clib_min (in_vlsh, out_vlsh);
+  hi_vlsh = clib_max (in_vlsh, out_vlsh);
+
+again:
+  vls_mt_pool_rlock ();
+  if (!(lo_vls = vls_get_and_lock (lo_vlsh)))
+    {
+      vls_mt_pool_runlock ();
+      return VPPCOM_EBADFD;
+    }
+  if (!(hi_vls = vls_get_and_lock (hi_vlsh)))
+    {
+      vls_unlock (lo_vls);
+      vls_mt_pool_runlock ();
+      return VPPCOM_EBADFD;
+    }
+
+  if (vls_mt_session_should_migrate (lo_vls) ||
+      vls_mt_session_should_migrate (hi_vls))
+    {
+      /* migration drops and retakes the session lock, so it can't run
+       * with the other session held. Migrate them one at a time and
+       * take both locks again */
+      vls_unlock (hi_vls);
+      vls_unlock (lo_vls);
+      vls_mt_pool_runlock ();
+      if (vls_mt_session_migrate_vlsh (lo_vlsh) ||
+	  vls_mt_session_migrate_vlsh (hi_vlsh))
+	return VPPCOM_EBADFD;
+      goto again;
+    }
+
+  in_vls = in_vlsh == lo_vlsh ? lo_vls : hi_vls;
+  out_vls = out_vlsh == lo_vlsh ? lo_vls : hi_vls;
+  in_sh = vls_to_sh (in_vls);
+  out_sh = vls_to_sh (out_vls);
+  vls_mt_pool_runlock ();
+
+  rv = vppcom_session_splice (out_sh, in_sh, max_bytes);
+
+  vls_mt_pool_rlock ();
+  vls_unlock (vls_get (hi_vlsh));
+  vls_unlock (vls_get (lo_vlsh));
+  vls_mt_pool_runlock ();
+  return rv;
+}
+
 int
 vls_attr (vls_handle_t vlsh, uint32_t op, void *buffer, uint32_t * buflen)
 {
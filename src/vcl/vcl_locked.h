@@ -39,6 +39,8 @@ int vls_write (vls_handle_t vlsh, void *buf, size_t nbytes);
 int vls_write_msg (vls_handle_t vlsh, void *buf, size_t nbytes);
 int vls_sendto (vls_handle_t vlsh, void *buf, int buflen, int flags,
 		vppcom_endpt_t * ep);
+int vls_splice (vls_handle_t out_vlsh, vls_handle_t in_vlsh,
+		uint32_t max_bytes);
 int vls_attr (vls_handle_t vlsh, uint32_t op, void *buffer,
 	      uint32_t * buflen);
 vls_handle_t vls_epoll_create (void);
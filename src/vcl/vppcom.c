@@ -2163,6 +2163,110 @@ vcl_fifo_is_writeable (svm_fifo_t * f, u32 len, u8 is_dgram)
     return max_enq > 0;
 }
 
+/*
+ * Moves up to max_bytes from the rx fifo of one stream session to the tx fifo
+ * of another. Data goes fifo to fifo, through the rx fifo's chunks, and never
+ * through a user buffer. Never blocks: returns VPPCOM_EWOULDBLOCK if the rx
+ * fifo is empty or the tx fifo full, 0 if the input session was closed.
+ */
+int
+vppcom_session_splice (uint32_t out_session_handle,
+		       uint32_t in_session_handle, uint32_t max_bytes)
+{
+  vcl_worker_t *wrk = vcl_worker_get_current ();
+  vcl_session_t *in_s, *out_s;
+  svm_fifo_t *rx_fifo, *tx_fifo;
+  svm_fifo_seg_t segs[2];
+  u32 n_segs = 2, n_bytes;
+  int n_read, n_write;
+
+  in_s = vcl_session_get_w_handle (wrk, in_session_handle);
+  out_s = vcl_session_get_w_handle (wrk, out_session_handle);
+  if (PREDICT_FALSE (!in_s || !out_s || (in_s->flags & VCL_SESSION_F_IS_VEP)
+		     || (out_s->flags & VCL_SESSION_F_IS_VEP)))
+    return VPPCOM_EBADFD;
+
+  /* no datagram boundaries and no segments still held by the app */
+  if (PREDICT_FALSE (in_s->is_dgram || out_s->is_dgram
+		     || in_s->rx_bytes_pending))
+    return VPPCOM_EINVAL;
+
+  if (PREDICT_FALSE (!vcl_session_is_open (in_s)))
+    return vcl_session_closed_error (in_s);
+  if (PREDICT_FALSE (!vcl_session_is_open (out_s)))
+    return vcl_session_closed_error (out_s);
+  if (PREDICT_FALSE (out_s->flags & VCL_SESSION_F_WR_SHUTDOWN))
+    return VPPCOM_EPIPE;
+
+  rx_fifo = vcl_session_is_ct (in_s) ? in_s->ct_rx_fifo : in_s->rx_fifo;
+  tx_fifo = vcl_session_is_ct (out_s) ? out_s->ct_tx_fifo : out_s->tx_fifo;
+  in_s->flags &= ~VCL_SESSION_F_HAS_RX_EVT;
+
+  if (svm_fifo_is_empty_cons (rx_fifo))
+    {
+      if (vcl_session_is_closing (in_s)
+	  || (in_s->flags & VCL_SESSION_F_RD_SHUTDOWN))
+	return vcl_session_closing_error (in_s);
+      if (vcl_session_is_ct (in_s))
+	svm_fifo_unset_event (in_s->rx_fifo);
+      svm_fifo_unset_event (rx_fifo);
+      return VPPCOM_EWOULDBLOCK;
+    }
+
+  n_bytes = clib_min (max_bytes, svm_fifo_max_enqueue_prod (tx_fifo));
+  if (!n_bytes)
+    {
+      svm_fifo_add_want_deq_ntf (tx_fifo, SVM_FIFO_WANT_DEQ_NOTIF);
+      return VPPCOM_EWOULDBLOCK;
+    }
+
+  n_read = svm_fifo_segments (rx_fifo, 0, segs, &n_segs, n_bytes);
+  if (PREDICT_FALSE (n_read <= 0))
+    return VPPCOM_EWOULDBLOCK;
+
+  /* only what made it into the tx fifo is consumed from the rx fifo */
+  n_write = svm_fifo_enqueue_segments (tx_fifo, segs, n_segs,
+				       1 /* allow partial */);
+  if (PREDICT_FALSE (n_write <= 0))
+    return VPPCOM_EAGAIN;
+
+  svm_fifo_dequeue_drop (rx_fifo, n_write);
+
+  if (svm_fifo_set_event (out_s->tx_fifo))
+    app_send_io_evt_to_vpp (out_s->vpp_evt_q,
+			    out_s->tx_fifo->shr->master_session_index,
+			    SESSION_IO_EVT_TX, SVM_Q_WAIT);
+
+  if (svm_fifo_is_empty_cons (rx_fifo))
+    {
+      if (vcl_session_is_ct (in_s))
+	svm_fifo_unset_event (in_s->rx_fifo);
+      svm_fifo_unset_event (rx_fifo);
+      if (!svm_fifo_is_empty_cons (rx_fifo) && svm_fifo_set_event (rx_fifo)
+	  && vcl_session_has_attr (in_s, VCL_SESS_ATTR_NONBLOCK))
+	{
+	  session_event_t *e;
+	  vec_add2 (wrk->unhandled_evts_vector, e, 1);
+	  e->event_type = SESSION_IO_EVT_RX;
+	  e->session_index = in_s->session_index;
+	}
+    }
+
+  if (PREDICT_FALSE (svm_fifo_needs_deq_ntf (rx_fifo, n_write)))
+    {
+      svm_fifo_clear_deq_ntf (rx_fifo);
+      app_send_io_evt_to_vpp (in_s->vpp_evt_q,
+			      in_s->rx_fifo->shr->master_session_index,
+			      SESSION_IO_EVT_RX, SVM_Q_WAIT);
+    }
+
+  VDBG (2, "session %u [0x%llx]: spliced %d bytes to session %u [0x%llx]",
+	in_s->session_index, in_s->vpp_handle, n_write, out_s->session_index,
+	out_s->vpp_handle);
+
+  return n_write;
+}
+
 always_inline int
 vppcom_session_write_inline (vcl_worker_t * wrk, vcl_session_t * s, void *buf,
 			     size_t n, u8 is_flush, u8 is_dgram)
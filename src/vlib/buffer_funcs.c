@@ -206,14 +206,30 @@ vlib_buffer_enqueue_to_thread_inline (vlib_main_t *vm,
 {
   u32 drop_list[VLIB_FRAME_SIZE], n_drop = 0;
   vlib_frame_bitmap_t mask, used_elts = {};
+  vlib_frame_queue_per_thread_t *pt;
   vlib_frame_queue_elt_t *hf = 0;
   u16 thread_index;
   u32 n_comp, off = 0, n_left = n_packets;
 
+  pt = vec_elt_at_index (fqm->per_thread, vm->thread_index);
   thread_index = thread_indices[0];
 
 more:
   clib_mask_compare_u16 (thread_index, thread_indices, mask, n_packets);
+
+  if (PREDICT_FALSE (pt->stages != 0))
+    {
+      /* batching, the buffers are held back until there are enough */
+      u32 buffers[VLIB_FRAME_SIZE];
+
+      n_comp = clib_compress_u32 (buffers, buffer_indices, mask, n_packets);
+      n_drop += vlib_frame_queue_stage (
+	vm, fqm, thread_index, buffers, n_comp,
+	node->flags & VLIB_NODE_FLAG_TRACE, drop_on_congestion,
+	drop_list + n_drop);
+      goto next;
+    }
+
   hf = vlib_get_frame_queue_elt (fqm, thread_index, drop_on_congestion);
 
   n_comp = clib_compress_u32 (hf ? hf->buffer_index : drop_list + n_drop,
@@ -226,10 +242,17 @@ more:
       hf->n_vectors = n_comp;
       __atomic_store_n (&hf->valid, 1, __ATOMIC_RELEASE);
       vlib_get_main_by_index (thread_index)->check_frame_queues = 1;
+      pt->n_elts++;
+      pt->n_buffers += n_comp;
     }
   else
-    n_drop += n_comp;
+    {
+      n_drop += n_comp;
+      pt->n_congested++;
+      pt->n_dropped += n_comp;
+    }
 
+next:
   n_left -= n_comp;
 
   if (n_left)
@@ -303,6 +326,14 @@ CLIB_MULTIARCH_FN (vlib_frame_queue_dequeue_fn)
 
   if (PREDICT_FALSE (fqm->node_index == ~0))
     return 0;
+
+  if (fq->head != fq->tail)
+    {
+      u64 n_in_use = fq->tail - fq->head;
+      fq->occupancy[clib_min (min_log2 (n_in_use),
+			      VLIB_FRAME_QUEUE_OCCUPANCY_N_BUCKETS - 1)]++;
+    }
+
   /*
    * Gather trace data for frame queues
    */
@@ -413,6 +444,219 @@ CLIB_MARCH_FN_REGISTRATION (vlib_frame_queue_dequeue_fn);
 #ifndef CLIB_MARCH_VARIANT
 vlib_buffer_func_main_t vlib_buffer_func_main;
 
+/* hand an elt of the staged buffers over, 0 if the ring is full */
+static int
+vlib_frame_queue_stage_flush (vlib_frame_queue_main_t *fqm,
+			      vlib_frame_queue_per_thread_t *pt,
+			      u32 thread_index, int dont_wait)
+{
+  vlib_frame_queue_stage_t *st = vec_elt_at_index (pt->stages, thread_index);
+  vlib_frame_queue_elt_t *hf;
+  u32 n;
+
+  hf = vlib_get_frame_queue_elt (fqm, thread_index, dont_wait);
+
+  if (!hf)
+    {
+      if (!st->congested && fqm->push_back)
+	pt->n_pushed_back++;
+      else if (!st->congested)
+	pt->n_congested++;
+      st->congested = 1;
+      return 0;
+    }
+
+  n = clib_min (vec_len (st->buffer_index), VLIB_FRAME_SIZE);
+  vlib_buffer_copy_indices (hf->buffer_index, st->buffer_index, n);
+  hf->maybe_trace = st->maybe_trace;
+  hf->n_vectors = n;
+  __atomic_store_n (&hf->valid, 1, __ATOMIC_RELEASE);
+  vlib_get_main_by_index (thread_index)->check_frame_queues = 1;
+
+  pt->n_elts++;
+  pt->n_buffers += n;
+  vec_delete (st->buffer_index, n, 0);
+  st->congested = 0;
+  clib_bitmap_zero (st->input_nodes);
+
+  if (vec_len (st->buffer_index) == 0)
+    {
+      pt->n_staged--;
+      st->maybe_trace = 0;
+    }
+  return 1;
+}
+
+/*
+ * A partial elt goes when the destination has nothing else queued, so
+ * an idle thread isn't kept waiting, or once it has waited long enough.
+ * While the destination is busy the elt keeps filling up.
+ */
+static int
+vlib_frame_queue_stage_ready (vlib_frame_queue_main_t *fqm,
+			      vlib_frame_queue_stage_t *st, u32 thread_index,
+			      u64 now)
+{
+  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[thread_index];
+
+  if (vec_len (st->buffer_index) == 0)
+    return 0;
+
+  if (vec_len (st->buffer_index) >= VLIB_FRAME_SIZE || fq->head == fq->tail)
+    return 1;
+
+  return now - st->cpu_time_staged >= fqm->coalesce_clocks;
+}
+
+/*
+ * Add buffers to what the thread has staged for another one, handing
+ * them over once there are enough. A full elt is staged, or with
+ * push-back a few, while the ring is full: what does not fit is handed
+ * over as without batching, waiting for the ring or copied to
+ * drop_list. Returns the number of buffers dropped.
+ */
+u32
+vlib_frame_queue_stage (vlib_main_t *vm, vlib_frame_queue_main_t *fqm,
+			u32 thread_index, u32 *buffers, u32 n_buffers,
+			int maybe_trace, int drop_on_congestion,
+			u32 *drop_list)
+{
+  vlib_frame_queue_per_thread_t *pt;
+  vlib_frame_queue_stage_t *st;
+  u64 now = clib_cpu_time_now ();
+  u32 n, n_staged, n_drop = 0, max;
+
+  pt = vec_elt_at_index (fqm->per_thread, vm->thread_index);
+  st = vec_elt_at_index (pt->stages, thread_index);
+  max = fqm->push_back ? VLIB_FRAME_QUEUE_PUSH_BACK_BUFFERS : VLIB_FRAME_SIZE;
+
+  while (n_buffers)
+    {
+      n_staged = vec_len (st->buffer_index);
+      if (n_staged == 0)
+	{
+	  st->cpu_time_staged = now;
+	  pt->n_staged++;
+	}
+
+      n = n_staged < max ? clib_min (n_buffers, max - n_staged) : 0;
+      vec_add (st->buffer_index, buffers, n);
+      st->maybe_trace |= maybe_trace;
+      buffers += n;
+      n_buffers -= n;
+
+      if (n_buffers == 0)
+	break;
+
+      /* the stage is full, make room */
+      if (vlib_frame_queue_stage_flush (fqm, pt, thread_index,
+					drop_on_congestion))
+	continue;
+
+      vlib_buffer_copy_indices (drop_list, buffers, n_buffers);
+      pt->n_dropped += n_buffers;
+      n_drop = n_buffers;
+      break;
+    }
+
+  while (vlib_frame_queue_stage_ready (fqm, st, thread_index, now) &&
+	 vlib_frame_queue_stage_flush (fqm, pt, thread_index, 1))
+    ;
+
+  if (pt->n_staged)
+    vm->frame_queue_staged = 1;
+
+  /* hold back the input nodes the buffers came in from */
+  if (st->congested && fqm->push_back)
+    {
+      st->input_nodes =
+	clib_bitmap_or (st->input_nodes, vm->frame_queue_input_active);
+      vm->frame_queue_push_back =
+	clib_bitmap_or (vm->frame_queue_push_back, st->input_nodes);
+    }
+
+  return n_drop;
+}
+
+/*
+ * From the top of the loop, as long as the thread has buffers staged:
+ * hand over those which are ready, and keep the input nodes which fed
+ * a full ring held back until it drains.
+ */
+void
+vlib_frame_queue_flush_staged (vlib_main_t *vm)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_per_thread_t *pt;
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_stage_t *st;
+  u64 now = clib_cpu_time_now ();
+  u8 staged = 0;
+  u32 i;
+
+  clib_bitmap_zero (vm->frame_queue_push_back);
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+    {
+      pt = vec_elt_at_index (fqm->per_thread, vm->thread_index);
+
+      if (pt->n_staged == 0)
+	continue;
+
+      vec_foreach_index (i, pt->stages)
+	{
+	  st = pt->stages + i;
+
+	  while (vlib_frame_queue_stage_ready (fqm, st, i, now) &&
+		 vlib_frame_queue_stage_flush (fqm, pt, i, 1))
+	    ;
+
+	  if (st->congested && fqm->push_back)
+	    vm->frame_queue_push_back =
+	      clib_bitmap_or (vm->frame_queue_push_back, st->input_nodes);
+	}
+
+      staged |= pt->n_staged != 0;
+    }
+
+  vm->frame_queue_staged = staged;
+}
+
+/*
+ * Hand over, or free when the ring is full, what the threads hold back
+ * before batching is turned off. With the workers at the barrier.
+ */
+void
+vlib_frame_queue_drain_staged (vlib_main_t *vm, vlib_frame_queue_main_t *fqm)
+{
+  vlib_frame_queue_per_thread_t *pt;
+  vlib_frame_queue_stage_t *st;
+  u32 i;
+
+  vec_foreach (pt, fqm->per_thread)
+    {
+      vec_foreach_index (i, pt->stages)
+	{
+	  st = pt->stages + i;
+
+	  while (vec_len (st->buffer_index) &&
+		 vlib_frame_queue_stage_flush (fqm, pt, i, 1))
+	    ;
+
+	  if (vec_len (st->buffer_index))
+	    {
+	      vlib_buffer_free (vm, st->buffer_index,
+				vec_len (st->buffer_index));
+	      pt->n_dropped += vec_len (st->buffer_index);
+	      pt->n_staged--;
+	    }
+	  vec_free (st->buffer_index);
+	  clib_bitmap_free (st->input_nodes);
+	}
+      vec_free (pt->stages);
+    }
+}
+
 static clib_error_t *
 vlib_buffer_funcs_init (vlib_main_t *vm)
 {
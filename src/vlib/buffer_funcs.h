@@ -78,6 +78,14 @@ typedef struct
 
 extern vlib_buffer_func_main_t vlib_buffer_func_main;
 
+u32 vlib_frame_queue_stage (vlib_main_t *vm, vlib_frame_queue_main_t *fqm,
+			    u32 thread_index, u32 *buffers, u32 n_buffers,
+			    int maybe_trace, int drop_on_congestion,
+			    u32 *drop_list);
+void vlib_frame_queue_flush_staged (vlib_main_t *vm);
+void vlib_frame_queue_drain_staged (vlib_main_t *vm,
+				    vlib_frame_queue_main_t *fqm);
+
 always_inline void
 vlib_buffer_validate (vlib_main_t * vm, vlib_buffer_t * b)
 {
@@ -1452,6 +1452,38 @@ dispatch_suspended_process (vlib_main_t * vm,
   return t;
 }
 
+/*
+ * Polls the input nodes when a handoff queue may push back on them:
+ * those feeding a full ring are skipped, and those which bring packets
+ * in are noted, for vlib_frame_queue_stage to hold back.
+ */
+static_always_inline u64
+dispatch_input_nodes_push_back (vlib_main_t *vm, u64 cpu_time_now)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_node_runtime_t *n;
+  u32 i, n_vectors;
+
+  clib_bitmap_zero (vm->frame_queue_input_active);
+
+  vec_foreach_index (i, nm->nodes_by_type[VLIB_NODE_TYPE_INPUT])
+    {
+      if (clib_bitmap_get (vm->frame_queue_push_back, i))
+	continue;
+
+      n = vec_elt_at_index (nm->nodes_by_type[VLIB_NODE_TYPE_INPUT], i);
+      n_vectors = vm->main_loop_vectors_processed;
+      cpu_time_now = dispatch_node (vm, n, VLIB_NODE_TYPE_INPUT,
+				    VLIB_NODE_STATE_POLLING,
+				    /* frame */ 0, cpu_time_now);
+      if (vm->main_loop_vectors_processed != n_vectors)
+	vm->frame_queue_input_active =
+	  clib_bitmap_set (vm->frame_queue_input_active, i, 1);
+    }
+
+  return cpu_time_now;
+}
+
 void vl_api_send_pending_rpc_requests (vlib_main_t *) __attribute__ ((weak));
 void
 vl_api_send_pending_rpc_requests (vlib_main_t * vm)
@@ -1527,7 +1559,10 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	}
 
       if (!is_main)
-	vlib_worker_thread_barrier_check ();
+	{
+	  vlib_worker_thread_barrier_check ();
+	  vlib_rcu_quiescent (vm);
+	}
 
       if (PREDICT_FALSE (vm->check_frame_queues + frame_queue_check_counter))
 	{
@@ -1551,6 +1586,9 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	    frame_queue_check_counter--;
 	}
 
+      if (PREDICT_FALSE (vm->frame_queue_staged))
+	vlib_frame_queue_flush_staged (vm);
+
       if (PREDICT_FALSE (vec_len (vm->worker_thread_main_loop_callbacks)))
 	clib_call_callbacks (vm->worker_thread_main_loop_callbacks, vm,
 			     cpu_time_now);
@@ -1564,13 +1602,17 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 				      /* frame */ 0,
 				      cpu_time_now);
 
-      /* Next process input nodes. */
-      vec_foreach (n, nm->nodes_by_type[VLIB_NODE_TYPE_INPUT])
-	cpu_time_now = dispatch_node (vm, n,
-				      VLIB_NODE_TYPE_INPUT,
-				      VLIB_NODE_STATE_POLLING,
-				      /* frame */ 0,
-				      cpu_time_now);
+      /* Next process input nodes, but for those a full handoff ring
+         pushes back on: what they have not taken waits in the device. */
+      if (PREDICT_FALSE (vm->frame_queue_push_back_enabled))
+	cpu_time_now = dispatch_input_nodes_push_back (vm, cpu_time_now);
+      else
+	vec_foreach (n, nm->nodes_by_type[VLIB_NODE_TYPE_INPUT])
+	  cpu_time_now = dispatch_node (vm, n,
+					VLIB_NODE_TYPE_INPUT,
+					VLIB_NODE_STATE_POLLING,
+					/* frame */ 0,
+					cpu_time_now);
 
       if (PREDICT_TRUE (is_main && vm->queue_signal_pending == 0))
 	vm->queue_signal_callback (vm);
@@ -1578,19 +1620,38 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
       if (__atomic_load_n (nm->pending_interrupts, __ATOMIC_ACQUIRE))
 	{
 	  int int_num = -1;
+	  int held_back = 0;
+	  u32 n_vectors;
 	  *nm->pending_interrupts = 0;
 
 	  while ((int_num =
 		    clib_interrupt_get_next (nm->interrupts, int_num)) != -1)
 	    {
 	      vlib_node_runtime_t *n;
+
+	      /* left pending until the handoff ring drains */
+	      if (PREDICT_FALSE (
+		    clib_bitmap_get (vm->frame_queue_push_back, int_num)))
+		{
+		  held_back = 1;
+		  continue;
+		}
+
 	      clib_interrupt_clear (nm->interrupts, int_num);
 	      n = vec_elt_at_index (nm->nodes_by_type[VLIB_NODE_TYPE_INPUT],
 				    int_num);
+	      n_vectors = vm->main_loop_vectors_processed;
 	      cpu_time_now = dispatch_node (vm, n, VLIB_NODE_TYPE_INPUT,
 					    VLIB_NODE_STATE_INTERRUPT,
 					    /* frame */ 0, cpu_time_now);
+	      if (PREDICT_FALSE (vm->frame_queue_push_back_enabled) &&
+		  vm->main_loop_vectors_processed != n_vectors)
+		vm->frame_queue_input_active =
+		  clib_bitmap_set (vm->frame_queue_input_active, int_num, 1);
 	    }
+
+	  if (held_back)
+	    *nm->pending_interrupts = 1;
 	}
 
       /* Input nodes may have added work to the pending vector.
@@ -1689,6 +1750,10 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	    }
 	}
       vlib_increment_main_loop_counter (vm);
+
+      if (is_main && PREDICT_FALSE (vec_len (vlib_rcu_main.pending)))
+	vlib_rcu_poll (vm);
+
       /* Record time stamp in case there are no enabled nodes and above
          calls do not update time stamp. */
       cpu_time_now = clib_cpu_time_now ();
@@ -117,6 +117,9 @@ typedef struct vlib_main_t
   /* Incremented once for each main loop. */
   volatile u32 main_loop_count;
 
+  /* Last rcu epoch seen at the top of the loop, see vlib/rcu.h */
+  volatile u64 rcu_epoch;
+
   /* Count of vectors processed this main loop. */
   u32 main_loop_vectors_processed;
   u32 main_loop_nodes_processed;
@@ -258,6 +261,18 @@ typedef struct vlib_main_t
   /* Need to check the frame queues */
   volatile uword check_frame_queues;
 
+  /* handoff buffers staged for other threads, see
+   * vlib_frame_queue_main_t */
+  u8 frame_queue_staged;
+
+  /* a handoff queue pushes back on a full ring: the input nodes, by
+   * index in nodes_by_type[VLIB_NODE_TYPE_INPUT], which brought packets
+   * in on this turn of the loop, and those held back until the ring
+   * they fed drains */
+  u8 frame_queue_push_back_enabled;
+  uword *frame_queue_input_active;
+  uword *frame_queue_push_back;
+
   /* RPC requests, main thread only */
   uword *pending_rpc_requests;
   uword *processing_rpc_requests;
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vlib/vlib.h>
+
+vlib_rcu_main_t vlib_rcu_main;
+
+/* with no workers running, or all of them at the barrier, nothing
+ * unpublished can be referenced */
+static int
+vlib_rcu_workers_quiescent (void)
+{
+  return (vlib_get_n_threads () < 2 || vlib_worker_thread_barrier_held ());
+}
+
+/* the oldest epoch a worker may still hold references from */
+static u64
+vlib_rcu_min_epoch (void)
+{
+  u64 epoch, min = ~0ULL;
+  u32 i;
+
+  /* the unpublish and the epoch bump are seen before the workers' epochs
+   * are read, see vlib_rcu_idle_exit () */
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+  for (i = 1; i < vlib_get_n_threads (); i++)
+    {
+      epoch = clib_atomic_load_acq_n (&vlib_get_main_by_index (i)->rcu_epoch);
+      min = clib_min (min, epoch);
+    }
+
+  return min;
+}
+
+static void
+vlib_rcu_run (vlib_rcu_main_t *rm, vlib_rcu_call_t *c, f64 now)
+{
+  void *oldheap;
+  f64 grace;
+
+  oldheap = clib_mem_set_heap (c->heap);
+  c->fn (c->args);
+  clib_mem_set_heap (oldheap);
+
+  grace = now - c->time_deferred;
+  rm->n_completed++;
+  rm->grace_time_total += grace;
+  rm->grace_time_max = clib_max (rm->grace_time_max, grace);
+}
+
+void
+vlib_rcu_call (vlib_rcu_fn_t *fn, void *args, u32 args_size)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  vlib_rcu_call_t c = {
+    .fn = fn,
+    .heap = clib_mem_get_heap (),
+  };
+
+  ASSERT (vlib_get_thread_index () == 0);
+  ASSERT (args_size <= sizeof (c.args));
+
+  clib_memcpy_fast (c.args, args, args_size);
+  rm->n_deferred++;
+
+  if (vlib_rcu_workers_quiescent ())
+    {
+      rm->n_immediate++;
+      rm->n_completed++;
+      fn (c.args);
+      return;
+    }
+
+  /* single writer, the release orders the unpublish before the epoch
+   * the workers compare against */
+  c.epoch = rm->epoch + 1;
+  c.time_deferred = vlib_time_now (vlib_get_main ());
+  clib_atomic_store_rel_n (&rm->epoch, c.epoch);
+
+  vec_add1 (rm->pending, c);
+  rm->max_pending = clib_max (rm->max_pending, vec_len (rm->pending));
+}
+
+static void
+vlib_rcu_vec_free_fn (void *args)
+{
+  void **v = args;
+
+  vec_free (*v);
+}
+
+void
+vlib_rcu_vec_free (void *v)
+{
+  if (v)
+    vlib_rcu_call (vlib_rcu_vec_free_fn, &v, sizeof (v));
+}
+
+/*
+ * Run the calls the workers have all gone past. From the main loop,
+ * each time round, as long as some are pending.
+ */
+void
+vlib_rcu_poll (vlib_main_t *vm)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  vlib_rcu_call_t c;
+  u64 min_epoch;
+  f64 now;
+  u32 i, n;
+
+  if (vlib_rcu_workers_quiescent ())
+    min_epoch = ~0ULL;
+  else
+    min_epoch = vlib_rcu_min_epoch ();
+
+  for (n = 0; n < vec_len (rm->pending); n++)
+    if (rm->pending[n].epoch > min_epoch)
+      break;
+
+  if (0 == n)
+    return;
+
+  now = vlib_time_now (vm);
+
+  /* the calls may defer more, which are appended */
+  for (i = 0; i < n; i++)
+    {
+      c = rm->pending[i];
+      vlib_rcu_run (rm, &c, now);
+    }
+
+  vec_delete (rm->pending, n, 0);
+}
+
+void
+vlib_rcu_barrier (void)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  vlib_main_t *vm = vlib_get_main ();
+  u64 epoch = rm->epoch;
+  f64 deadline;
+  u32 i;
+
+  ASSERT (vlib_get_thread_index () == 0);
+
+  if (0 == vec_len (rm->pending))
+    return;
+
+  rm->n_barriers++;
+
+  if (vlib_rcu_workers_quiescent ())
+    goto run;
+
+  /* sleeping workers report themselves idle, only busy ones are waited
+   * for, and those are back at the top of their loop soon */
+  deadline = vlib_time_now (vm) + VLIB_RCU_BARRIER_TIMEOUT;
+  while (vlib_rcu_min_epoch () < epoch)
+    {
+      if (vlib_time_now (vm) < deadline)
+	{
+	  CLIB_PAUSE ();
+	  continue;
+	}
+
+      rm->n_barrier_timeouts++;
+      for (i = 1; i < vlib_get_n_threads (); i++)
+	if (vlib_get_main_by_index (i)->rcu_epoch < epoch)
+	  clib_warning ("rcu barrier: thread %u (%s) stuck at epoch %llu "
+			"for %.1fs, waiting for %llu; running the calls "
+			"under the worker barrier",
+			i, vlib_worker_threads[i].name,
+			vlib_get_main_by_index (i)->rcu_epoch,
+			VLIB_RCU_BARRIER_TIMEOUT, epoch);
+
+      vlib_worker_thread_barrier_sync (vm);
+      vlib_rcu_poll (vm);
+      vlib_worker_thread_barrier_release (vm);
+      return;
+    }
+
+run:
+  vlib_rcu_poll (vm);
+}
+
+static clib_error_t *
+show_rcu_command_fn (vlib_main_t *vm, unformat_input_t *input,
+		     vlib_cli_command_t *cmd)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  u64 n_waited = rm->n_completed - rm->n_immediate;
+  u32 i;
+
+  vlib_cli_output (vm, "epoch %llu, %u calls pending, at most %u",
+		   rm->epoch, vec_len (rm->pending), rm->max_pending);
+  vlib_cli_output (vm, "%llu calls deferred, %llu run without workers to "
+		   "wait for, %llu completed, %llu barriers, %llu timed out",
+		   rm->n_deferred, rm->n_immediate, rm->n_completed,
+		   rm->n_barriers, rm->n_barrier_timeouts);
+  vlib_cli_output (vm, "grace period: average %.2fus, max %.2fus",
+		   n_waited ? rm->grace_time_total / n_waited * 1e6 : 0.0,
+		   rm->grace_time_max * 1e6);
+  vlib_cli_output (vm, "main thread wait avoided: %.6fs",
+		   rm->grace_time_total);
+
+  for (i = 1; i < vlib_get_n_threads (); i++)
+    {
+      u64 epoch = vlib_get_main_by_index (i)->rcu_epoch;
+
+      if (VLIB_RCU_EPOCH_IDLE == epoch)
+	vlib_cli_output (vm, "  thread %u: idle", i);
+      else
+	vlib_cli_output (vm, "  thread %u: epoch %llu", i, epoch);
+    }
+
+  return 0;
+}
+
+/*?
+ * Show the calls deferred until the workers are done with what they
+ * free, how long the workers took to get there, i.e. how long the
+ * main thread would have held the barrier or waited for them, and the
+ * epoch each worker last reported from the top of its loop.
+ *
+ * @cliexpar
+ * @cliexstart{show rcu}
+ * epoch 1203, 0 calls pending, at most 4
+ * 1203 calls deferred, 0 run without workers to wait for, 1203 completed, 1 barriers, 0 timed out
+ * grace period: average 31.04us, max 102.11us
+ * main thread wait avoided: 0.037341s
+ *   thread 1: epoch 1203
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (show_rcu_command, static) = {
+  .path = "show rcu",
+  .short_help = "show rcu",
+  .function = show_rcu_command_fn,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Deferred calls for the main thread, run once every worker has been
+ * through the top of its dispatch loop, where it holds no reference to
+ * data shared with the control plane.
+ *
+ * The control plane unpublishes an object, e.g. swaps a pointer, then
+ * hands its free to vlib_rcu_call () rather than holding the barrier or
+ * spinning in vlib_worker_wait_one_loop () until the workers are done
+ * with it. Each call bumps a global epoch which the workers copy at the
+ * top of their loop; the call runs, from the main loop, once all of them
+ * have copied an epoch at least as recent as its own. A worker about to
+ * sleep, e.g. in interrupt mode, holds no references either, and reports
+ * an idle epoch until it wakes, rather than holding the calls up.
+ */
+
+#ifndef included_vlib_rcu_h
+#define included_vlib_rcu_h
+
+typedef void (vlib_rcu_fn_t) (void *args);
+
+/* the args are kept in the call, enough for a pointer and some indices */
+#define VLIB_RCU_ARGS_SIZE 32
+
+/* epoch of a sleeping worker, more recent than any call */
+#define VLIB_RCU_EPOCH_IDLE (~0ULL)
+
+/* how long vlib_rcu_barrier () waits for the workers before stopping
+ * them with the worker barrier instead */
+#define VLIB_RCU_BARRIER_TIMEOUT 1.0
+
+typedef struct
+{
+  vlib_rcu_fn_t *fn;
+  u64 args[VLIB_RCU_ARGS_SIZE / sizeof (u64)];
+
+  /* heap the call was deferred from, it runs on it */
+  void *heap;
+
+  /* runs once each worker has seen this epoch */
+  u64 epoch;
+  f64 time_deferred;
+} vlib_rcu_call_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* read by the workers at the top of each loop */
+  volatile u64 epoch;
+
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+
+  /* waiting on the workers, oldest first */
+  vlib_rcu_call_t *pending;
+
+  /* calls deferred, and run straight away since there were no workers
+   * running to wait for */
+  u64 n_deferred;
+  u64 n_immediate;
+  u64 n_completed;
+
+  /* vlib_rcu_barrier () waits, and those which gave up on a worker */
+  u64 n_barriers;
+  u64 n_barrier_timeouts;
+  u32 max_pending;
+
+  /* time from deferral to completion; the main thread would have spent
+   * it holding the barrier or waiting for the workers */
+  f64 grace_time_total;
+  f64 grace_time_max;
+} vlib_rcu_main_t;
+
+extern vlib_rcu_main_t vlib_rcu_main;
+
+/**
+ * Run fn with a copy of the args once the workers no longer reference
+ * anything unpublished before the call. Main thread only.
+ */
+void vlib_rcu_call (vlib_rcu_fn_t *fn, void *args, u32 args_size);
+
+/**
+ * vec_free () the vector once the workers are done with it.
+ */
+void vlib_rcu_vec_free (void *v);
+
+/**
+ * Run all the deferred calls, waiting for the workers if needed, e.g.
+ * before destroying the heap they free into. A worker which hasn't moved
+ * within VLIB_RCU_BARRIER_TIMEOUT is reported, and the calls run under
+ * the worker barrier.
+ */
+void vlib_rcu_barrier (void);
+
+void vlib_rcu_poll (vlib_main_t *vm);
+
+/**
+ * Called by the workers where they hold no references, at the top of
+ * their loop.
+ */
+always_inline void
+vlib_rcu_quiescent (vlib_main_t *vm)
+{
+  u64 epoch = clib_atomic_load_acq_n (&vlib_rcu_main.epoch);
+
+  /* loads of the previous loop are done before this is seen */
+  if (PREDICT_FALSE (epoch != vm->rcu_epoch))
+    clib_atomic_store_rel_n (&vm->rcu_epoch, epoch);
+}
+
+/**
+ * Called by a worker before it sleeps, where it holds no references.
+ */
+always_inline void
+vlib_rcu_idle_enter (vlib_main_t *vm)
+{
+  clib_atomic_store_rel_n (&vm->rcu_epoch, VLIB_RCU_EPOCH_IDLE);
+}
+
+/**
+ * Called by a worker once it is awake, before it looks at anything
+ * shared again.
+ */
+always_inline void
+vlib_rcu_idle_exit (vlib_main_t *vm)
+{
+  /*
+   * the main thread unpublishes, bumps the epoch, then reads ours: with
+   * full barriers on both sides, either it sees we are back and waits for
+   * us, or whatever we load next is already unpublished
+   */
+  __atomic_store_n (&vm->rcu_epoch,
+		    clib_atomic_load_acq_n (&vlib_rcu_main.epoch),
+		    __ATOMIC_SEQ_CST);
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+#endif /* included_vlib_rcu_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -135,6 +135,67 @@ barrier_trace_release (f64 t_entry, f64 t_closed_total, f64 t_update_main)
   vlib_worker_threads[0].barrier_context = NULL;
 }
 
+/*
+ * Always-on barrier timings, by caller. Main thread only, outside of
+ * the time the barrier is held.
+ */
+static_always_inline u32
+barrier_stats_bucket (f64 t)
+{
+  u64 us = t * 1e6;
+
+  if (us == 0)
+    return 0;
+  return clib_min (min_log2 (us) + 1, VLIB_BARRIER_HIST_N_BUCKETS - 1);
+}
+
+static void
+barrier_stats_sync (f64 t_open, f64 t_close)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_barrier_caller_stats_t *bs;
+  const char *caller;
+  uword *p;
+
+  /* the API message the barrier is taken for, rather than its handler */
+  caller = vlib_worker_threads[0].barrier_context;
+  if (caller == NULL)
+    caller = vlib_worker_threads[0].barrier_caller;
+
+  p = hash_get (tm->barrier_stats_by_caller, pointer_to_uword (caller));
+  if (p)
+    bs = vec_elt_at_index (tm->barrier_stats, p[0]);
+  else
+    {
+      vec_add2 (tm->barrier_stats, bs, 1);
+      bs->caller = caller;
+      hash_set (tm->barrier_stats_by_caller, pointer_to_uword (caller),
+		bs - tm->barrier_stats);
+    }
+
+  bs->count++;
+  bs->hist[VLIB_BARRIER_HIST_OPEN][barrier_stats_bucket (t_open)]++;
+  bs->hist[VLIB_BARRIER_HIST_CLOSE][barrier_stats_bucket (t_close)]++;
+
+  tm->barrier_stats_index = bs - tm->barrier_stats;
+  tm->barrier_t_close = t_close;
+}
+
+static void
+barrier_stats_release (f64 t_closed_total)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_barrier_caller_stats_t *bs;
+  f64 t_hold = t_closed_total - tm->barrier_t_close;
+
+  bs = vec_elt_at_index (tm->barrier_stats, tm->barrier_stats_index);
+  bs->hist[VLIB_BARRIER_HIST_HOLD][barrier_stats_bucket (t_hold)]++;
+  bs->hold_total += t_hold;
+  bs->hold_max = clib_max (bs->hold_max, t_hold);
+
+  vlib_worker_threads[0].barrier_context = NULL;
+}
+
 uword
 os_get_nthreads (void)
 {
@@ -1354,6 +1415,7 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm, const char *func_name)
   t_closed = now - vm->barrier_epoch;
 
   barrier_trace_sync (t_entry, t_open, t_closed);
+  barrier_stats_sync (t_open, t_closed);
 
 }
 
@@ -1461,6 +1523,7 @@ vlib_worker_thread_barrier_release (vlib_main_t * vm)
   vm->barrier_epoch = now;
 
   barrier_trace_release (t_entry, t_closed_total, t_update_main);
+  barrier_stats_release (t_closed_total);
 
   if (PREDICT_FALSE (vec_len (vm->barrier_perf_callbacks) != 0))
     clib_call_callbacks (vm->barrier_perf_callbacks, vm,
@@ -1565,10 +1628,58 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
       fq = vlib_frame_queue_alloc (frame_queue_nelts);
       vec_add1 (fqm->vlib_frame_queues, fq);
     }
+  vec_validate_aligned (fqm->per_thread, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
 
   return (fqm - tm->frame_queue_mains);
 }
 
+/*
+ * Let the threads handing buffers over on the queue hold partially
+ * filled elts back for up to max_latency seconds, and keep their
+ * buffers and stop taking more in on a full ring rather than drop.
+ */
+int
+vlib_frame_queue_set_batching (u32 frame_queue_index, f64 max_latency,
+			       int push_back)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_main_t *vm = vlib_get_main ();
+  vlib_frame_queue_per_thread_t *pt;
+  vlib_frame_queue_main_t *fqm;
+  u8 enabled = 0;
+
+  ASSERT (vlib_get_n_threads () < 2 || vlib_worker_thread_barrier_held ());
+
+  if (frame_queue_index >= vec_len (tm->frame_queue_mains) ||
+      max_latency < 0)
+    return -1;
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  fqm->coalesce_clocks = max_latency * vm->clib_time.clocks_per_second;
+  fqm->push_back = push_back != 0;
+
+  if (fqm->coalesce_clocks == 0 && !fqm->push_back)
+    vlib_frame_queue_drain_staged (vm, fqm);
+  else
+    vec_foreach (pt, fqm->per_thread)
+      vec_validate (pt->stages, tm->n_vlib_mains - 1);
+
+  /* the threads only watch their input nodes while some queue may push
+   * back on them */
+  vec_foreach (fqm, tm->frame_queue_mains)
+    enabled |= fqm->push_back;
+
+  foreach_vlib_main ()
+    {
+      this_vlib_main->frame_queue_push_back_enabled = enabled;
+      if (!enabled)
+	clib_bitmap_zero (this_vlib_main->frame_queue_push_back);
+    }
+
+  return 0;
+}
+
 void
 vlib_process_signal_event_mt_helper (vlib_process_signal_event_mt_args_t *
 				     args)
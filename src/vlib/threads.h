@@ -78,6 +78,35 @@ typedef struct
 }
 vlib_frame_queue_elt_t;
 
+/*
+ * Barrier timings, per function taking the barrier or API message it
+ * was taken for, in log2 microsecond buckets: [0] under 1us, [i] under
+ * 2^i us, the last one anything longer.
+ */
+#define VLIB_BARRIER_HIST_N_BUCKETS 24
+
+#define foreach_vlib_barrier_hist                                             \
+  _ (OPEN, open, "open before the sync")                                      \
+  _ (CLOSE, close, "workers stopping")                                        \
+  _ (HOLD, hold, "held until released")
+
+typedef enum
+{
+#define _(E, n, s) VLIB_BARRIER_HIST_##E,
+  foreach_vlib_barrier_hist
+#undef _
+    VLIB_BARRIER_N_HIST,
+} vlib_barrier_hist_t;
+
+typedef struct
+{
+  const char *caller;
+  u64 count;
+  f64 hold_total;
+  f64 hold_max;
+  u64 hist[VLIB_BARRIER_N_HIST][VLIB_BARRIER_HIST_N_BUCKETS];
+} vlib_barrier_caller_stats_t;
+
 typedef struct
 {
   /* First cache line */
@@ -111,6 +140,8 @@ typedef struct
 
 extern vlib_worker_thread_t *vlib_worker_threads;
 
+#define VLIB_FRAME_QUEUE_OCCUPANCY_N_BUCKETS 16
+
 typedef struct
 {
   /* static data */
@@ -127,9 +158,48 @@ typedef struct
   /* modified by dequeue side  */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
   volatile u64 head;
+
+  /* elts waiting each time the queue is found non-empty: [0] one,
+   * [i] 2^i to 2^(i+1) - 1 */
+  u64 occupancy[VLIB_FRAME_QUEUE_OCCUPANCY_N_BUCKETS];
 }
 vlib_frame_queue_t;
 
+/* buffers a thread holds for another one while it pushes back */
+#define VLIB_FRAME_QUEUE_PUSH_BACK_BUFFERS (4 * VLIB_FRAME_SIZE)
+
+/*
+ * Buffers a thread has for another one, held back until they fill an
+ * elt, the destination ring drains or they have waited long enough.
+ */
+typedef struct
+{
+  u32 *buffer_index;
+  u8 maybe_trace;
+  /* the last attempt to hand them over found the ring full */
+  u8 congested;
+  u64 cpu_time_staged;
+  /* input nodes held back until the ring drains, see vlib_main_t */
+  uword *input_nodes;
+} vlib_frame_queue_stage_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* one per destination thread, when batching */
+  vlib_frame_queue_stage_t *stages;
+  u32 n_staged;
+
+  /* enqueue side counters of the sending thread: a full ring is counted
+   * once each time it is found so, as congestion or push-back */
+  u64 n_elts;
+  u64 n_buffers;
+  u64 n_congested;
+  u64 n_pushed_back;
+  u64 n_dropped;
+} vlib_frame_queue_per_thread_t;
+
 typedef struct
 {
   u32 node_index;
@@ -137,6 +207,17 @@ typedef struct
 
   vlib_frame_queue_t **vlib_frame_queues;
 
+  /* hold partially filled elts back for up to this many clocks, 0 to
+   * hand each enqueue over as is */
+  u64 coalesce_clocks;
+
+  /* on a full ring keep the buffers and stop the input nodes which fed
+   * them on the sending thread until it drains, rather than dropping */
+  u8 push_back;
+
+  /* per sending thread */
+  vlib_frame_queue_per_thread_t *per_thread;
+
   /* for frame queue tracing */
   frame_queue_trace_t *frame_queue_traces;
   frame_queue_nelt_counter_t *frame_queue_histogram;
@@ -159,6 +240,8 @@ void vlib_create_worker_threads (vlib_main_t * vm, int n,
 
 void vlib_worker_thread_init (vlib_worker_thread_t * w);
 u32 vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts);
+int vlib_frame_queue_set_batching (u32 frame_queue_index, f64 max_latency,
+				   int push_back);
 
 /* Check for a barrier sync request every 30ms */
 #define BARRIER_SYNC_DELAY (0.030000)
@@ -289,6 +372,14 @@ typedef struct
   /* NUMA-bound heap size */
   uword numa_heap_size;
 
+  /* barrier timings by caller, keyed by the caller string address */
+  vlib_barrier_caller_stats_t *barrier_stats;
+  uword *barrier_stats_by_caller;
+
+  /* the sync being timed, and how long it took to close */
+  u32 barrier_stats_index;
+  f64 barrier_t_close;
+
 } vlib_thread_main_t;
 
 extern vlib_thread_main_t vlib_thread_main;
@@ -92,6 +92,102 @@ VLIB_CLI_COMMAND (show_threads_command, static) = {
 };
 /* *INDENT-ON* */
 
+/* upper bound of the bucket holding the given share of the samples */
+static u64
+barrier_hist_percentile_us (u64 *hist, u64 count, f64 share)
+{
+  u64 seen = 0;
+  int i;
+
+  for (i = 0; i < VLIB_BARRIER_HIST_N_BUCKETS; i++)
+    {
+      seen += hist[i];
+      if (seen >= share * count)
+	break;
+    }
+  return 1ULL << clib_min (i, VLIB_BARRIER_HIST_N_BUCKETS - 1);
+}
+
+static int
+barrier_stats_cmp_hold (void *a1, void *a2)
+{
+  vlib_barrier_caller_stats_t *s1 = a1, *s2 = a2;
+
+  return (s1->hold_total < s2->hold_total) - (s1->hold_total > s2->hold_total);
+}
+
+static clib_error_t *
+show_barrier_fn (vlib_main_t *vm, unformat_input_t *input,
+		 vlib_cli_command_t *cmd)
+{
+  static char *hist_names[] = {
+#define _(E, n, str) str,
+    foreach_vlib_barrier_hist
+#undef _
+  };
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_barrier_caller_stats_t *stats, *bs;
+  u64 *h;
+  int verbose = 0, i, j;
+  u8 *s = 0;
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
+
+  /* sorted copy, the barrier stats keep their indices */
+  stats = vec_dup (tm->barrier_stats);
+  vec_sort_with_function (stats, barrier_stats_cmp_hold);
+
+  /* the percentiles are bucket bounds */
+  vlib_cli_output (vm, "%-40s%10s%14s%12s%12s%12s%12s", "Caller", "Syncs",
+		   "Held total", "Avg held", "Max held", "p50 <us", "p99 <us");
+
+  vec_foreach (bs, stats)
+    {
+      h = bs->hist[VLIB_BARRIER_HIST_HOLD];
+      vlib_cli_output (vm, "%-40s%10llu%12.3fms%10.2fus%10.2fus%12llu%12llu",
+		       bs->caller, bs->count, bs->hold_total * 1e3,
+		       bs->hold_total / bs->count * 1e6, bs->hold_max * 1e6,
+		       barrier_hist_percentile_us (h, bs->count, 0.5),
+		       barrier_hist_percentile_us (h, bs->count, 0.99));
+
+      if (!verbose)
+	continue;
+
+      for (i = 0; i < VLIB_BARRIER_N_HIST; i++)
+	{
+	  vec_reset_length (s);
+	  for (j = 0; j < VLIB_BARRIER_HIST_N_BUCKETS; j++)
+	    if (bs->hist[i][j])
+	      s = format (s, " <%lluus:%llu", 1ULL << j, bs->hist[i][j]);
+	  vlib_cli_output (vm, "  %-24s%v", hist_names[i], s);
+	}
+    }
+
+  vec_free (stats);
+  vec_free (s);
+  return 0;
+}
+
+/*?
+ * Show how long the barrier was held for each function which took it,
+ * or API message it was taken for, slowest first. The same histograms
+ * are exported in the stats segment under /sys/barrier.
+ *
+ * @cliexpar
+ * @cliexstart{show barrier}
+ * Caller                                       Syncs    Held total    Avg held    Max held     p50 <us     p99 <us
+ * sw_interface_add_del_address                    12       3.104ms    258.63us    901.44us         512        1024
+ * vlib_cli_dispatch_sub_commands                   4        .212ms     53.05us     91.27us          64         128
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (show_barrier_command, static) = {
+  .path = "show barrier",
+  .short_help = "show barrier [verbose]",
+  .function = show_barrier_fn,
+  .is_mp_safe = 1,
+};
+
 /*
  * Trigger threads to grab frame queue trace data
  */
@@ -378,6 +474,175 @@ VLIB_CLI_COMMAND (cmd_show_frame_queue_histogram,static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+show_frame_queue_occupancy (vlib_main_t *vm, unformat_input_t *input,
+			    vlib_cli_command_t *cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_per_thread_t *pt;
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_t *fq;
+  u32 i, b, index = ~0;
+  u64 n_elts;
+  u8 *s = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "index %u", &index))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+    {
+      if (index != ~0 && index != fqm - tm->frame_queue_mains)
+	continue;
+
+      /* unless asked for, only the queues which have been used */
+      n_elts = 0;
+      vec_foreach (pt, fqm->per_thread)
+	n_elts += pt->n_elts + pt->n_dropped;
+      if (index == ~0 && n_elts == 0)
+	continue;
+
+      vlib_cli_output (
+	vm, "Worker handoff queue index %u (next node '%U'): coalesce %.2fus, "
+	"on congestion %s",
+	fqm - tm->frame_queue_mains, format_vlib_node_name, vm,
+	fqm->node_index,
+	fqm->coalesce_clocks / vm->clib_time.clocks_per_second * 1e6,
+	fqm->push_back ? "push-back" : "drop");
+
+      vlib_cli_output (vm, "  %-8s%12s%14s%10s%12s%12s%12s%8s", "sender",
+		       "elts", "buffers", "per elt", "congested", "push-back",
+		       "dropped", "staged");
+      vec_foreach (pt, fqm->per_thread)
+	{
+	  if (pt->n_elts == 0 && pt->n_dropped == 0)
+	    continue;
+	  vlib_cli_output (
+	    vm, "  %-8u%12llu%14llu%10.2f%12llu%12llu%12llu%8u",
+	    pt - fqm->per_thread, pt->n_elts, pt->n_buffers,
+	    pt->n_elts ? (f64) pt->n_buffers / pt->n_elts : 0.0,
+	    pt->n_congested, pt->n_pushed_back, pt->n_dropped, pt->n_staged);
+	}
+
+      vlib_cli_output (vm, "  elts queued when the receiver looks:");
+      vec_foreach_index (i, fqm->vlib_frame_queues)
+	{
+	  fq = fqm->vlib_frame_queues[i];
+	  vec_reset_length (s);
+	  for (b = 0; b < VLIB_FRAME_QUEUE_OCCUPANCY_N_BUCKETS; b++)
+	    {
+	      if (fq->occupancy[b] == 0)
+		continue;
+	      if (b == 0)
+		s = format (s, "  1: %llu", fq->occupancy[b]);
+	      else
+		s = format (s, "  %u-%u: %llu", 1 << b, (2 << b) - 1,
+			    fq->occupancy[b]);
+	    }
+	  if (vec_len (s))
+	    vlib_cli_output (vm, "  %-8u%v", i, s);
+	}
+    }
+
+  vec_free (s);
+  return 0;
+}
+
+/*?
+ * Show, for each worker handoff queue used so far or the one given, how
+ * many elts each thread handed over and how full they were, how often it
+ * found the ring of a destination full, counted as congestion when
+ * dropping and as push-back otherwise, what it dropped and how many
+ * destinations it still holds buffers back for, and a log2 histogram of
+ * the elts waiting on each thread's ring when it goes to dequeue them.
+ *
+ * @cliexpar
+ * @cliexstart{show frame-queue occupancy}
+ * Worker handoff queue index 0 (next node 'ethernet-input'): coalesce 50.00us, on congestion push-back
+ *   sender          elts       buffers   per elt   congested   push-back     dropped  staged
+ *   1              31021       7923408    255.42           0          12           0       1
+ *   2              30880       7891112    255.54           0           9           0       0
+ *   elts queued when the receiver looks:
+ *   1         1: 20311  2-3: 9120  4-7: 1410  8-15: 63
+ *   2         1: 20127  2-3: 9354  4-7: 1377  8-15: 41
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (cmd_show_frame_queue_occupancy, static) = {
+  .path = "show frame-queue occupancy",
+  .short_help = "show frame-queue occupancy [index <n>]",
+  .function = show_frame_queue_occupancy,
+};
+
+static clib_error_t *
+set_frame_queue_batching (vlib_main_t *vm, unformat_input_t *input,
+			  vlib_cli_command_t *cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  u32 index = ~0, node_index = ~0, push_back = 0;
+  f64 usec = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "index %u", &index))
+	;
+      else if (unformat (input, "node %U", unformat_vlib_node, vm,
+			 &node_index))
+	;
+      else if (unformat (input, "coalesce %f", &usec))
+	;
+      else if (unformat (input, "push-back"))
+	push_back = 1;
+      else if (unformat (input, "drop"))
+	push_back = 0;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (index != ~0 && index >= vec_len (tm->frame_queue_mains))
+    return clib_error_return (0, "expecting valid worker handoff queue index");
+
+  if (usec < 0)
+    return clib_error_return (0, "expecting a positive latency");
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+    if ((index == ~0 || index == fqm - tm->frame_queue_mains) &&
+	(node_index == ~0 || node_index == fqm->node_index))
+      vlib_frame_queue_set_batching (fqm - tm->frame_queue_mains, usec * 1e-6,
+				     push_back);
+
+  return 0;
+}
+
+/*?
+ * Batch the buffers threads hand over on a worker handoff queue, all
+ * of them unless an index, or the node the queue feeds, is given. With coalesce, a thread holds a
+ * partially filled elt back for up to the given number of microseconds
+ * while the destination has others queued, filling it from the next
+ * frames. With push-back, a thread which finds the ring full keeps its
+ * buffers and stops polling the input nodes they came in from until the
+ * ring drains, so packets wait in the device instead of being dropped.
+ * Its other input nodes, and other destinations, carry on. Without either
+ * option each enqueue is handed over at once, and dropped on a full
+ * ring.
+ *
+ * @cliexpar
+ * @cliexstart{set frame-queue node ethernet-input coalesce 50 push-back}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (cmd_set_frame_queue_batching, static) = {
+  .path = "set frame-queue",
+  .short_help = "set frame-queue [index <n>|node <name>] "
+		"[coalesce <usec>] [push-back|drop]",
+  .function = set_frame_queue_batching,
+};
+
 
 /*
  * Modify the number of elements on the frame_queues
@@ -212,6 +212,10 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	node->input_main_loops_per_call = 1024;
       }
 
+    /* nothing shared is referenced from here, don't hold up rcu calls */
+    if (!is_main && timeout_ms)
+      vlib_rcu_idle_enter (vm);
+
     /* Allow any signal to wakeup our sleep. */
     if (is_main || em->epoll_fd != -1)
       {
@@ -251,11 +255,15 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		  ts = tsrem;
 		if (*vlib_worker_threads->wait_at_barrier ||
 		    *nm->pending_interrupts)
-		  goto done;
+		  break;
 	      }
+	    vlib_rcu_idle_exit (vm);
 	  }
 	goto done;
       }
+
+    if (!is_main && timeout_ms)
+      vlib_rcu_idle_exit (vm);
   }
 
   if (n_fds_ready < 0)
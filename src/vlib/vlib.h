@@ -69,6 +69,7 @@ typedef u32 vlib_log_class_t;
 
 /* Inline/extern function declarations. */
 #include <vlib/threads.h>
+#include <vlib/rcu.h>
 #include <vlib/physmem_funcs.h>
 #include <vlib/buffer_funcs.h>
 #include <vlib/error_funcs.h>
@@ -176,6 +176,9 @@ vnet_classify_delete_table_index (vnet_classify_main_t * cm,
     /* Recursively delete the entire chain */
     vnet_classify_delete_table_index (cm, t->next_table_index, del_chain);
 
+  /* deferred frees of the table's prefilters go first */
+  vlib_rcu_barrier ();
+
   vec_free (t->buckets);
   clib_mem_destroy_heap (t->mheap);
   pool_put (cm->tables, t);
@@ -414,6 +417,138 @@ vnet_classify_entry_release_resource (vnet_classify_entry_t * e)
     }
 }
 
+static void
+vnet_classify_prefilter_set (vnet_classify_table_t *t,
+			     vnet_classify_prefilter_t pf, u64 hash)
+{
+  u64 *bits = (u64 *) ((u8 *) clib_mem_get_heap_base (t->mheap) + pf.offset);
+  u32 b0, b1;
+
+  vnet_classify_prefilter_bits (hash, pf.log2_bits, &b0, &b1);
+  bits[b0 / 64] |= 1ULL << (b0 % 64);
+  bits[b1 / 64] |= 1ULL << (b1 % 64);
+}
+
+typedef struct
+{
+  u32 table_index;
+  vnet_classify_prefilter_t pf;
+} vnet_classify_prefilter_free_args_t;
+
+static void
+vnet_classify_prefilter_free_bits_rcu (void *args)
+{
+  vnet_classify_prefilter_free_args_t *a = args;
+  vnet_classify_table_t *t;
+  void *oldheap;
+
+  /* tables wait for their deferred frees before going away */
+  t = pool_elt_at_index (vnet_classify_main.tables, a->table_index);
+
+  clib_spinlock_lock (&t->writer_lock);
+  oldheap = clib_mem_set_heap (t->mheap);
+  clib_mem_free ((u8 *) clib_mem_get_heap_base (t->mheap) + a->pf.offset);
+  clib_mem_set_heap (oldheap);
+  clib_spinlock_unlock (&t->writer_lock);
+}
+
+static void
+vnet_classify_prefilter_free_bits (vnet_classify_table_t *t,
+				   vnet_classify_prefilter_t pf)
+{
+  vnet_classify_prefilter_free_args_t a = {
+    .table_index = t - vnet_classify_main.tables,
+    .pf = pf,
+  };
+
+  if (pf.offset == 0)
+    return;
+
+  /* once the workers are done with any lookup which loaded the filter */
+  vlib_rcu_call (vnet_classify_prefilter_free_bits_rcu, &a, sizeof (a));
+}
+
+/*
+ * (Re)build a table's prefilter from the sessions it holds, sized for
+ * them, and publish it in place of the current one. Main thread only.
+ */
+static int
+vnet_classify_prefilter_build (vnet_classify_table_t *t)
+{
+  vnet_classify_prefilter_t pf, old;
+  vnet_classify_bucket_t *b;
+  vnet_classify_entry_t *v;
+  u32 log2_bits, i, n_entries;
+  u8 *key_minus_skip;
+  void *oldheap;
+  u64 *bits;
+
+  ASSERT (vlib_get_thread_index () == 0);
+
+  clib_spinlock_lock (&t->writer_lock);
+
+  log2_bits = max_log2 ((uword) t->active_elements *
+			VNET_CLASSIFY_PREFILTER_BITS_PER_ENTRY);
+  log2_bits = clib_max (log2_bits, VNET_CLASSIFY_PREFILTER_MIN_LOG2_BITS);
+  log2_bits = clib_min (log2_bits, VNET_CLASSIFY_PREFILTER_MAX_LOG2_BITS);
+
+  oldheap = clib_mem_set_heap (t->mheap);
+  bits = clib_mem_alloc_aligned_or_null (1 << (log2_bits - 3),
+					 CLIB_CACHE_LINE_BYTES);
+  clib_mem_set_heap (oldheap);
+
+  if (bits == 0)
+    {
+      clib_spinlock_unlock (&t->writer_lock);
+      return VNET_API_ERROR_TABLE_TOO_BIG;
+    }
+
+  clib_memset (bits, 0, 1 << (log2_bits - 3));
+  pf.as_u64 = 0;
+  pf.offset = (u8 *) bits - (u8 *) clib_mem_get_heap_base (t->mheap);
+  pf.log2_bits = log2_bits;
+
+  vec_foreach (b, t->buckets)
+    {
+      if (b->offset == 0)
+	continue;
+
+      v = vnet_classify_get_entry (t, b->offset);
+      n_entries = t->entries_per_page << b->log2_pages;
+
+      for (i = 0; i < n_entries; i++)
+	{
+	  if (vnet_classify_entry_is_busy (v))
+	    {
+	      key_minus_skip = (u8 *) v->key;
+	      key_minus_skip -= t->skip_n_vectors * sizeof (u32x4);
+	      vnet_classify_prefilter_set (
+		t, pf, vnet_classify_hash_packet (t, key_minus_skip));
+	    }
+	  v = vnet_classify_entry_at_index (t, v, 1);
+	}
+    }
+
+  old.as_u64 = t->prefilter.as_u64;
+  CLIB_MEMORY_STORE_BARRIER ();
+  t->prefilter.as_u64 = pf.as_u64;
+
+  clib_spinlock_unlock (&t->writer_lock);
+
+  vnet_classify_prefilter_free_bits (t, old);
+  return 0;
+}
+
+static void
+vnet_classify_prefilter_disable (vnet_classify_table_t *t)
+{
+  vnet_classify_prefilter_t old;
+
+  old.as_u64 = t->prefilter.as_u64;
+  t->prefilter.as_u64 = 0;
+  vnet_classify_prefilter_free_bits (t, old);
+}
+
 static int
 vnet_classify_add_del (vnet_classify_table_t *t, vnet_classify_entry_t *add_v,
 		       int is_add)
@@ -431,6 +566,7 @@ vnet_classify_add_del (vnet_classify_table_t *t, vnet_classify_entry_t *add_v,
   u8 *key_minus_skip;
   int resplit_once = 0;
   int mark_bucket_linear;
+  vnet_classify_prefilter_t prefilter;
 
   ASSERT ((add_v->flags & VNET_CLASSIFY_ENTRY_FREE) == 0);
 
@@ -442,10 +578,15 @@ vnet_classify_add_del (vnet_classify_table_t *t, vnet_classify_entry_t *add_v,
   bucket_index = hash & (t->nbuckets - 1);
   b = &t->buckets[bucket_index];
 
-  hash >>= t->log2_nbuckets;
-
   clib_spinlock_lock (&t->writer_lock);
 
+  /* set the filter bits before the session can be found */
+  prefilter.as_u64 = t->prefilter.as_u64;
+  if (is_add && prefilter.offset)
+    vnet_classify_prefilter_set (t, prefilter, hash);
+
+  hash >>= t->log2_nbuckets;
+
   /* First elt in the bucket? */
   if (b->offset == 0)
     {
@@ -637,6 +778,15 @@ expand_ok:
 
 unlock:
   clib_spinlock_unlock (&t->writer_lock);
+
+  /* grow the filter once the table outgrows it */
+  if (rv == 0 && is_add && prefilter.offset &&
+      prefilter.log2_bits < VNET_CLASSIFY_PREFILTER_MAX_LOG2_BITS &&
+      (u64) t->active_elements * VNET_CLASSIFY_PREFILTER_MIN_BITS_PER_ENTRY >
+	1ULL << prefilter.log2_bits &&
+      vlib_get_thread_index () == 0)
+    vnet_classify_prefilter_build (t);
+
   return rv;
 }
 
@@ -1716,6 +1866,49 @@ classify_sort_table_chain (vnet_classify_main_t * cm, u32 table_index)
   return table_index;
 }
 
+/*
+ * Compile the chain of tables starting with table_index, giving each
+ * table a prefilter of its sessions so that a lookup only probes the
+ * tables which may hold a match. Unlike sorting, the chain order is
+ * kept: it decides which match wins. The tables' lookup counters are
+ * cleared. With is_add == 0 the prefilters are removed.
+ */
+int
+classify_compile_table_chain (vnet_classify_main_t *cm, u32 table_index,
+			      int is_add)
+{
+  vnet_classify_table_t *t;
+  u32 cti, n_tables = 0;
+  int i, rv;
+
+  for (cti = table_index; cti != ~0; cti = t->next_table_index)
+    {
+      if (pool_is_free_index (cm->tables, cti))
+	return VNET_API_ERROR_NO_SUCH_TABLE;
+      /* a looped chain */
+      if (++n_tables > pool_elts (cm->tables))
+	return VNET_API_ERROR_INVALID_VALUE;
+
+      t = pool_elt_at_index (cm->tables, cti);
+      if (!is_add)
+	{
+	  vnet_classify_prefilter_disable (t);
+	  continue;
+	}
+
+      for (i = 0; i < VNET_CLASSIFY_TABLE_N_COUNTERS; i++)
+	{
+	  vlib_validate_simple_counter (&cm->table_counters[i], cti);
+	  vlib_zero_simple_counter (&cm->table_counters[i], cti);
+	}
+
+      if ((rv = vnet_classify_prefilter_build (t)))
+	return rv;
+    }
+
+  return 0;
+}
+
 
 u32
 classify_get_trace_chain (void)
@@ -2233,6 +2426,8 @@ format_vnet_classify_table (u8 *s, va_list *args)
   s = format (s, "\n  mask %U", format_hex_bytes, t->mask,
 	      t->match_n_vectors * sizeof (u32x4));
   s = format (s, "\n  linear-search buckets %d\n", t->linear_buckets);
+  if (t->prefilter.offset)
+    s = format (s, "  prefilter %u bits\n", 1 << t->prefilter.log2_bits);
 
   if (verbose == 0)
     return s;
@@ -2300,6 +2495,137 @@ VLIB_CLI_COMMAND (show_classify_table_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+classify_chain_compile_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				   vlib_cli_command_t *cmd)
+{
+  vnet_classify_main_t *cm = &vnet_classify_main;
+  u32 table_index = ~0;
+  int is_add = 1;
+  int rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "table %d", &table_index))
+	;
+      else if (unformat (input, "del"))
+	is_add = 0;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (table_index == ~0)
+    return clib_error_return (0, "table index required");
+
+  rv = classify_compile_table_chain (cm, table_index, is_add);
+  if (rv)
+    return clib_error_return (0, "classify_compile_table_chain returned %d",
+			      rv);
+  return 0;
+}
+
+/*?
+ * Compile the chain of classifier tables starting with the given table:
+ * each table gets a prefilter of the sessions it holds, so a lookup
+ * skips the tables which cannot match without reading their buckets.
+ * The order of the chain is unchanged. The prefilters follow sessions
+ * added later; 'del' removes them.
+ *
+ * @cliexpar
+ * @cliexcmd{classify chain compile table 0}
+?*/
+VLIB_CLI_COMMAND (classify_chain_compile_command, static) = {
+  .path = "classify chain compile",
+  .short_help = "classify chain compile table <nn> [del]",
+  .function = classify_chain_compile_command_fn,
+};
+
+static u64
+classify_table_counter_get (vnet_classify_main_t *cm, u32 table_index,
+			    vnet_classify_table_counter_t counter)
+{
+  vlib_simple_counter_main_t *scm = &cm->table_counters[counter];
+
+  if (table_index >= vlib_simple_counter_n_counters (scm))
+    return 0;
+  return vlib_get_simple_counter (scm, table_index);
+}
+
+static clib_error_t *
+show_classify_chain_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				vlib_cli_command_t *cmd)
+{
+  vnet_classify_main_t *cm = &vnet_classify_main;
+  vnet_classify_table_t *t;
+  u32 table_index = ~0, cti, pos = 0;
+  u64 lookups, filtered, hits;
+  u64 n_lookups = 0, n_probes = 0, n_filtered = 0, n_hits = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "table %d", &table_index))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (table_index == ~0 || pool_is_free_index (cm->tables, table_index))
+    return clib_error_return (0, "valid table index required");
+
+  vlib_cli_output (vm, "%4s%10s%10s%10s%12s%12s%12s", "Pos", "TableIdx",
+		   "Sessions", "Filter", "Lookups", "Filtered", "Hits");
+
+  for (cti = table_index; cti != ~0; cti = t->next_table_index)
+    {
+      if (pool_is_free_index (cm->tables, cti) ||
+	  pos >= pool_elts (cm->tables))
+	break;
+      t = pool_elt_at_index (cm->tables, cti);
+
+      if (t->prefilter.offset)
+	{
+	  lookups = classify_table_counter_get (
+	    cm, cti, VNET_CLASSIFY_TABLE_COUNTER_LOOKUPS);
+	  filtered = classify_table_counter_get (
+	    cm, cti, VNET_CLASSIFY_TABLE_COUNTER_FILTERED);
+	  hits =
+	    classify_table_counter_get (cm, cti, VNET_CLASSIFY_TABLE_COUNTER_HITS);
+	  vlib_cli_output (vm, "%4u%10u%10u%10u%12llu%12llu%12llu", pos, cti,
+			   t->active_elements, 1 << t->prefilter.log2_bits,
+			   lookups, filtered, hits);
+	  if (pos == 0)
+	    n_lookups = lookups;
+	  n_probes += lookups;
+	  n_filtered += filtered;
+	  n_hits += hits;
+	}
+      else
+	vlib_cli_output (vm, "%4u%10u%10u%10s%12s%12s%12s", pos, cti,
+			 t->active_elements, "-", "-", "-", "-");
+      pos++;
+    }
+
+  vlib_cli_output (vm, "%llu lookups, %llu hits, %llu of %llu table probes "
+		   "filtered", n_lookups, n_hits, n_filtered, n_probes);
+  return 0;
+}
+
+/*?
+ * Show the tables of a compiled classifier chain in order, with the size
+ * of each table's prefilter, how many lookups reached the table, how
+ * many of those the prefilter skipped and how many matched a session.
+ *
+ * @cliexpar
+ * @cliexcmd{show classify chain table 0}
+?*/
+VLIB_CLI_COMMAND (show_classify_chain_command, static) = {
+  .path = "show classify chain",
+  .short_help = "show classify chain table <nn>",
+  .function = show_classify_chain_command_fn,
+};
+
 uword
 unformat_l4_match (unformat_input_t * input, va_list * args)
 {
@@ -3018,6 +3344,7 @@ static clib_error_t *
 vnet_classify_init (vlib_main_t * vm)
 {
   vnet_classify_main_t *cm = &vnet_classify_main;
+  int i;
 
   cm->vlib_main = vm;
   cm->vnet_main = vnet_get_main ();
@@ -3037,6 +3364,19 @@ vnet_classify_init (vlib_main_t * vm)
 
   vlib_global_main.trace_filter.classify_table_index = ~0;
 
+#define _(E, n, s)                                                            \
+  cm->table_counters[VNET_CLASSIFY_TABLE_COUNTER_##E].name = s;               \
+  cm->table_counters[VNET_CLASSIFY_TABLE_COUNTER_##E].stat_segment_name =     \
+    "/classify/table/" #n;
+  foreach_vnet_classify_table_counter
+#undef _
+
+  for (i = 0; i < VNET_CLASSIFY_TABLE_N_COUNTERS; i++)
+    {
+      vlib_validate_simple_counter (&cm->table_counters[i], 0);
+      vlib_zero_simple_counter (&cm->table_counters[i], 0);
+    }
+
   return 0;
 }
 
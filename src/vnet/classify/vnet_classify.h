@@ -144,6 +144,47 @@ typedef struct
   };
 } vnet_classify_bucket_t;
 
+/*
+ * Bloom filter over the hashes of the sessions in a table, built when
+ * the table's chain is compiled. Lets a lookup skip a table which
+ * cannot match without touching its buckets or entries. Sessions which
+ * are deleted leave their bits set, which is harmless; a filter is
+ * rebuilt larger as the table grows past its sizing.
+ */
+typedef struct
+{
+  union
+  {
+    struct
+    {
+      /* Offset of the bit array in the table's heap, 0 when disabled */
+      u32 offset;
+      u8 log2_bits;
+      u8 pad[3];
+    };
+    u64 as_u64;
+  };
+} vnet_classify_prefilter_t;
+
+#define VNET_CLASSIFY_PREFILTER_BITS_PER_ENTRY 16
+/* grow once it falls below half of the bits per entry */
+#define VNET_CLASSIFY_PREFILTER_MIN_BITS_PER_ENTRY 8
+#define VNET_CLASSIFY_PREFILTER_MIN_LOG2_BITS 9
+#define VNET_CLASSIFY_PREFILTER_MAX_LOG2_BITS 22
+
+#define foreach_vnet_classify_table_counter                                   \
+  _ (LOOKUPS, lookups, "lookups")                                             \
+  _ (FILTERED, filtered, "filtered")                                          \
+  _ (HITS, hits, "hits")
+
+typedef enum
+{
+#define _(E, n, s) VNET_CLASSIFY_TABLE_COUNTER_##E,
+  foreach_vnet_classify_table_counter
+#undef _
+    VNET_CLASSIFY_TABLE_N_COUNTERS,
+} vnet_classify_table_counter_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -154,8 +195,8 @@ typedef struct
    * where the entries are stored. */
   void *mheap;
 
-  /* User/client data associated with the table */
-  uword user_ctx;
+  /* Chain compiled prefilter, 0 when the table isn't compiled */
+  vnet_classify_prefilter_t prefilter;
 
   u32 nbuckets;
   u32 log2_nbuckets;
@@ -178,6 +219,9 @@ typedef struct
    */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
 
+  /* User/client data associated with the table */
+  uword user_ctx;
+
   /* Config parameters */
   u32 linear_buckets;
   u32 active_elements;
@@ -232,6 +276,9 @@ struct _vnet_classify_main
   /* Per-interface filter table.  [0] is used for pcap */
   u32 *classify_table_index_by_sw_if_index;
 
+  /* Per-table lookup counters, kept for compiled tables only */
+  vlib_simple_counter_main_t table_counters[VNET_CLASSIFY_TABLE_N_COUNTERS];
+
   /* convenience variables */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -527,17 +574,62 @@ vnet_classify_entry_is_equal (vnet_classify_entry_t *v, const u8 *d, u8 *m,
   return 0;
 }
 
+/* the two filter bits of a hash, from rotations of its low 32 bits so
+ * that they aren't just the bucket index */
+static_always_inline void
+vnet_classify_prefilter_bits (u64 hash, u8 log2_bits, u32 *b0, u32 *b1)
+{
+  u32 h = hash, mask = pow2_mask (log2_bits);
+
+  *b0 = ((h >> 11) | (h << 21)) & mask;
+  *b1 = ((h >> 22) | (h << 10)) & mask;
+}
+
+static_always_inline int
+vnet_classify_prefilter_may_match (vnet_classify_table_t *t,
+				   vnet_classify_prefilter_t pf, u64 hash)
+{
+  u64 *bits = (u64 *) ((u8 *) clib_mem_get_heap_base (t->mheap) + pf.offset);
+  u32 b0, b1;
+
+  vnet_classify_prefilter_bits (hash, pf.log2_bits, &b0, &b1);
+  return (bits[b0 / 64] >> (b0 % 64)) & (bits[b1 / 64] >> (b1 % 64)) & 1;
+}
+
+static_always_inline void
+vnet_classify_table_counter_inc (vnet_classify_table_t *t,
+				 vnet_classify_table_counter_t counter)
+{
+  vnet_classify_main_t *cm = &vnet_classify_main;
+
+  vlib_increment_simple_counter (&cm->table_counters[counter],
+				 vlib_get_thread_index (), t - cm->tables, 1);
+}
+
 static inline vnet_classify_entry_t *
 vnet_classify_find_entry_inline (vnet_classify_table_t *t, const u8 *h,
 				 u64 hash, f64 now)
 {
   vnet_classify_entry_t *v;
   vnet_classify_bucket_t *b;
+  vnet_classify_prefilter_t pf;
   u32 bucket_index, limit, pages, match_n_vectors = t->match_n_vectors;
   u16 load_mask = t->load_mask;
   u8 *mask = (u8 *) t->mask;
   int i;
 
+  pf.as_u64 = t->prefilter.as_u64;
+  if (PREDICT_FALSE (pf.offset != 0))
+    {
+      vnet_classify_table_counter_inc (t, VNET_CLASSIFY_TABLE_COUNTER_LOOKUPS);
+      if (!vnet_classify_prefilter_may_match (t, pf, hash))
+	{
+	  vnet_classify_table_counter_inc (t,
+					   VNET_CLASSIFY_TABLE_COUNTER_FILTERED);
+	  return 0;
+	}
+    }
+
   bucket_index = hash & (t->nbuckets - 1);
   b = &t->buckets[bucket_index];
 
@@ -570,6 +662,9 @@ vnet_classify_find_entry_inline (vnet_classify_table_t *t, const u8 *h,
 	      v->hits++;
 	      v->last_heard = now;
 	    }
+	  if (PREDICT_FALSE (pf.offset != 0))
+	    vnet_classify_table_counter_inc (t,
+					     VNET_CLASSIFY_TABLE_COUNTER_HITS);
 	  return (v);
 	}
       v = vnet_classify_entry_at_index (t, v, 1);
@@ -635,6 +730,8 @@ u32 classify_get_trace_chain (void);
 void classify_set_trace_chain (vnet_classify_main_t * cm, u32 table_index);
 
 u32 classify_sort_table_chain (vnet_classify_main_t * cm, u32 table_index);
+int classify_compile_table_chain (vnet_classify_main_t *cm, u32 table_index,
+				  int is_add);
 u32 classify_lookup_chain (u32 table_index,
 			   u8 * mask, u32 n_skip, u32 n_match);
 
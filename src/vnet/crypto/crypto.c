@@ -481,6 +481,23 @@ vnet_crypto_key_del (vlib_main_t * vm, vnet_crypto_key_index_t index)
   pool_put (cm->keys, key);
 }
 
+/* Replace the data of a key, keeping its index and length. */
+void
+vnet_crypto_key_update (vlib_main_t *vm, vnet_crypto_key_index_t index,
+			u8 *data)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_engine_t *engine;
+  vnet_crypto_key_t *key = pool_elt_at_index (cm->keys, index);
+
+  ASSERT (key->type == VNET_CRYPTO_KEY_TYPE_DATA);
+
+  clib_memcpy (key->data, data, vec_len (key->data));
+  vec_foreach (engine, cm->engines)
+    if (engine->key_op_handler)
+      engine->key_op_handler (vm, VNET_CRYPTO_KEY_OP_MODIFY, index);
+}
+
 vnet_crypto_async_alg_t
 vnet_crypto_link_algs (vnet_crypto_alg_t crypto_alg,
 		       vnet_crypto_alg_t integ_alg)
@@ -313,4 +313,22 @@ ip4_fib_forwarding_lookup_x4 (u32 fib_index0,
 
 #endif
 
+/**
+ * @brief Lookup n addresses in the same table.
+ * On CPUs with gather instructions the mtrie is walked for 8 (AVX2) or
+ * 16 (AVX-512) addresses at once.
+ */
+static_always_inline void
+ip4_fib_forwarding_lookup_n (u32 fib_index,
+                             const ip4_address_t * addrs,
+                             index_t *lbs,
+                             u32 n)
+{
+#ifdef VPP_IP_FIB_MTRIE_16
+    ip4_mtrie_16_lookup_n (&ip4_fib_get(fib_index)->mtrie, addrs, lbs, n);
+#else
+    ip4_mtrie_8_lookup_n (&ip4_fib_get(fib_index)->mtrie, addrs, lbs, n);
+#endif
+}
+
 #endif
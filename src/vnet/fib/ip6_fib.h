@@ -111,9 +111,46 @@ extern void ip6_fib_table_walk(u32 fib_index,
                                fib_table_walk_fn_t fn,
                                void *ctx);
 
+/**
+ * @brief Forwarding lookups by binary search on prefix lengths.
+ *
+ * The per-length lookup probes the forwarding hash once for every prefix
+ * length in use in any table. A table can instead search only its own
+ * lengths, as a binary search (Waldvogel et al.): each prefix adds a marker
+ * at the shorter lengths the search visits on the way to it, and each
+ * entry holds the load-balance of the longest prefix matching its key, so
+ * a hit means "remember this and look longer", a miss "look shorter", and a
+ * lookup needs at most log2(#lengths)+1 probes.
+ *
+ * The entries share the forwarding hash, distinguished by IP6_FIB_BSL_KEY
+ * in the length word. They are compiled by a process once the table has
+ * settled after a change; in between, the table uses the per-length lookup.
+ */
+#define IP6_FIB_BSL_KEY (1 << 8)
+
+typedef struct ip6_fib_bsl_t_
+{
+    /** The prefix lengths in the table, ascending, excluding /0 */
+    u8 *lengths;
+
+    /** Load-balance of the default route, the result when nothing matches */
+    u32 default_lbi;
+
+    /** The prefixes and markers added to the hash, to remove on rebuild */
+    clib_bihash_kv_24_8_t *keys;
+
+    u32 n_prefixes;
+    u32 n_markers;
+
+    /** How long the compile took */
+    f64 build_time;
+} ip6_fib_bsl_t;
+
+extern void ip6_fib_table_set_bsl(u32 fib_index, int enable);
+
 always_inline u32
-ip6_fib_table_fwding_lookup (u32 fib_index,
-                             const ip6_address_t * dst)
+ip6_fib_table_fwding_lookup_by_length (u32 fib_index,
+                                       const ip6_address_t * dst)
 {
     ip6_fib_table_instance_t *table;
     clib_bihash_kv_24_8_t kv, value;
@@ -149,6 +186,63 @@ ip6_fib_table_fwding_lookup (u32 fib_index,
     return 0;
 }
 
+always_inline u32
+ip6_fib_table_fwding_lookup_bsl (const ip6_fib_bsl_t *bsl,
+                                 u32 fib_index,
+                                 const ip6_address_t * dst)
+{
+    ip6_fib_table_instance_t *table;
+    clib_bihash_kv_24_8_t kv, value;
+    int lo, hi, mid;
+    u32 lbi;
+    u64 fib;
+
+    table = &ip6_fib_table[IP6_FIB_TABLE_FWDING];
+    fib = ((u64)((fib_index))<<32) | IP6_FIB_BSL_KEY;
+    lbi = bsl->default_lbi;
+    lo = 0;
+    hi = vec_len (bsl->lengths) - 1;
+
+    while (lo <= hi)
+    {
+	int dst_address_length;
+	ip6_address_t * mask;
+
+	mid = (lo + hi) / 2;
+	dst_address_length = bsl->lengths[mid];
+	mask = &ip6_main.fib_masks[dst_address_length];
+
+	kv.key[0] = dst->as_u64[0] & mask->as_u64[0];
+	kv.key[1] = dst->as_u64[1] & mask->as_u64[1];
+	kv.key[2] = fib | dst_address_length;
+
+	if (0 == clib_bihash_search_inline_2_24_8(&table->ip6_hash,
+                                                  &kv, &value))
+	{
+	    lbi = value.value;
+	    lo = mid + 1;
+	}
+	else
+	    hi = mid - 1;
+    }
+
+    return lbi;
+}
+
+always_inline u32
+ip6_fib_table_fwding_lookup (u32 fib_index,
+                             const ip6_address_t * dst)
+{
+    const ip6_fib_bsl_t *bsl;
+
+    bsl = clib_atomic_load_acq_n (&ip6_main.v6_fibs[fib_index].bsl);
+
+    if (bsl)
+	return ip6_fib_table_fwding_lookup_bsl(bsl, fib_index, dst);
+
+    return ip6_fib_table_fwding_lookup_by_length(fib_index, dst);
+}
+
 /**
  * @brief Walk all entries in a sub-tree of the FIB table
  * N.B: This is NOT safe to deletes. If you need to delete walk the whole
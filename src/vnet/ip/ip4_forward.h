@@ -52,6 +52,39 @@
  * This file contains the source code for IPv4 forwarding.
  */
 
+#ifdef CLIB_HAVE_VEC256
+/**
+ * @brief Resolve a whole frame in one batch, so the mtrie is walked with
+ * gathers, when all of its packets are looked up in the same table.
+ */
+static_always_inline int
+ip4_lookup_batch (ip4_main_t *im, vlib_buffer_t **b, u32 n, index_t *lbs)
+{
+  ip4_address_t dsts[VLIB_FRAME_SIZE];
+  u32 i, fib_index, mixed = 0;
+  ip4_header_t *ip;
+
+  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[0]);
+  fib_index = vnet_buffer (b[0])->ip.fib_index;
+  ip = vlib_buffer_get_current (b[0]);
+  dsts[0] = ip->dst_address;
+
+  for (i = 1; i < n; i++)
+    {
+      ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[i]);
+      mixed |= vnet_buffer (b[i])->ip.fib_index ^ fib_index;
+      ip = vlib_buffer_get_current (b[i]);
+      dsts[i] = ip->dst_address;
+    }
+
+  if (mixed)
+    return 0;
+
+  ip4_fib_forwarding_lookup_n (fib_index, dsts, lbs, n);
+  return 1;
+}
+#endif
+
 always_inline uword
 ip4_lookup_inline (vlib_main_t * vm,
 		   vlib_node_runtime_t * node, vlib_frame_t * frame)
@@ -63,12 +96,20 @@ ip4_lookup_inline (vlib_main_t * vm,
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE];
   vlib_buffer_t **b = bufs;
   u16 nexts[VLIB_FRAME_SIZE], *next;
+  index_t *lbs = 0;
 
   from = vlib_frame_vector_args (frame);
   n_left = frame->n_vectors;
   next = nexts;
   vlib_get_buffers (vm, from, bufs, n_left);
 
+#ifdef CLIB_HAVE_VEC256
+  index_t lb_indices[VLIB_FRAME_SIZE];
+
+  if (n_left >= 8 && ip4_lookup_batch (im, bufs, n_left, lb_indices))
+    lbs = lb_indices;
+#endif
+
 #if (CLIB_N_PREFETCHES >= 8)
   while (n_left >= 4)
     {
@@ -110,11 +151,20 @@ ip4_lookup_inline (vlib_main_t * vm,
       ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[2]);
       ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[3]);
 
-      ip4_fib_forwarding_lookup_x4 (
-	vnet_buffer (b[0])->ip.fib_index, vnet_buffer (b[1])->ip.fib_index,
-	vnet_buffer (b[2])->ip.fib_index, vnet_buffer (b[3])->ip.fib_index,
-	dst_addr0, dst_addr1, dst_addr2, dst_addr3, &lb_index0, &lb_index1,
-	&lb_index2, &lb_index3);
+      if (lbs)
+	{
+	  lb_index0 = lbs[0];
+	  lb_index1 = lbs[1];
+	  lb_index2 = lbs[2];
+	  lb_index3 = lbs[3];
+	  lbs += 4;
+	}
+      else
+	ip4_fib_forwarding_lookup_x4 (
+	  vnet_buffer (b[0])->ip.fib_index, vnet_buffer (b[1])->ip.fib_index,
+	  vnet_buffer (b[2])->ip.fib_index, vnet_buffer (b[3])->ip.fib_index,
+	  dst_addr0, dst_addr1, dst_addr2, dst_addr3, &lb_index0, &lb_index1,
+	  &lb_index2, &lb_index3);
 
       ASSERT (lb_index0 && lb_index1 && lb_index2 && lb_index3);
       lb0 = load_balance_get (lb_index0);
@@ -248,9 +298,16 @@ ip4_lookup_inline (vlib_main_t * vm,
       ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[0]);
       ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[1]);
 
-      ip4_fib_forwarding_lookup_x2 (
-	vnet_buffer (b[0])->ip.fib_index, vnet_buffer (b[1])->ip.fib_index,
-	dst_addr0, dst_addr1, &lb_index0, &lb_index1);
+      if (lbs)
+	{
+	  lb_index0 = lbs[0];
+	  lb_index1 = lbs[1];
+	  lbs += 2;
+	}
+      else
+	ip4_fib_forwarding_lookup_x2 (
+	  vnet_buffer (b[0])->ip.fib_index, vnet_buffer (b[1])->ip.fib_index,
+	  dst_addr0, dst_addr1, &lb_index0, &lb_index1);
 
       ASSERT (lb_index0 && lb_index1);
       lb0 = load_balance_get (lb_index0);
@@ -324,8 +381,11 @@ ip4_lookup_inline (vlib_main_t * vm,
       dst_addr0 = &ip0->dst_address;
       ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[0]);
 
-      lbi0 = ip4_fib_forwarding_lookup (vnet_buffer (b[0])->ip.fib_index,
-					dst_addr0);
+      if (lbs)
+	lbi0 = *lbs++;
+      else
+	lbi0 = ip4_fib_forwarding_lookup (vnet_buffer (b[0])->ip.fib_index,
+					  dst_addr0);
 
       ASSERT (lbi0);
       lb0 = load_balance_get (lbi0);
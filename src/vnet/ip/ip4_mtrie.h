@@ -104,6 +104,7 @@ typedef struct ip4_mtrie_8_ply_t_
 
 STATIC_ASSERT (0 == sizeof (ip4_mtrie_8_ply_t) % CLIB_CACHE_LINE_BYTES,
 	       "IP4 Mtrie ply cache line");
+STATIC_ASSERT_OFFSET_OF (ip4_mtrie_8_ply_t, leaves, 0);
 
 /**
  * @brief The mutiway-TRIE with a 16-8-8 stride.
@@ -263,6 +264,177 @@ ip4_mtrie_8_lookup_step_one (const ip4_mtrie_8_t *m,
   return next_leaf;
 }
 
+/*
+ * Batched lookups. The leaves of each ply are fetched for 8 or 16
+ * addresses at once with gathers; the index of each gather is the offset,
+ * in leaves, from the start of the ply pool. Since those indices are
+ * signed 32 bit values the pool must be small enough for all of its
+ * leaves to be addressed, else the scalar lookup is used.
+ */
+#define IP4_MTRIE_PLY_N_LEAVES                                                \
+  ((u32) (sizeof (ip4_mtrie_8_ply_t) / sizeof (ip4_mtrie_leaf_t)))
+#define IP4_MTRIE_GATHER_MAX_PLYS ((1ULL << 31) / IP4_MTRIE_PLY_N_LEAVES)
+
+#ifdef CLIB_HAVE_VEC256
+/**
+ * @brief Lookup step for 8 addresses. Processes the byte of each address
+ * at the given bit shift.
+ */
+static_always_inline u32x8
+ip4_mtrie_lookup_step_x8 (u32x8 leaf, u32x8 dst, u32 shift)
+{
+  u32x8 is_ply, idx;
+
+  is_ply = (u32x8) ((leaf & 1) == 0);
+  if (u32x8_is_all_zero (is_ply))
+    return leaf;
+
+  idx = (leaf >> 1) * IP4_MTRIE_PLY_N_LEAVES + ((dst >> shift) & 0xff);
+  return u32x8_mask_gather_u32 (leaf, (u32 *) ip4_ply_pool, idx, is_ply);
+}
+
+always_inline u32x8
+ip4_mtrie_16_lookup_x8 (const ip4_mtrie_16_t *m, u32x8 dst)
+{
+  u32x8 leaf;
+
+  leaf = u32x8_gather_u32 (m->root_ply.leaves, dst & 0xffff);
+  leaf = ip4_mtrie_lookup_step_x8 (leaf, dst, 16);
+  leaf = ip4_mtrie_lookup_step_x8 (leaf, dst, 24);
+
+  return leaf >> 1;
+}
+
+always_inline u32x8
+ip4_mtrie_8_lookup_x8 (const ip4_mtrie_8_t *m, u32x8 dst)
+{
+  ip4_mtrie_8_ply_t *ply;
+  u32x8 leaf;
+
+  ply = pool_elt_at_index (ip4_ply_pool, m->root_ply);
+  leaf = u32x8_gather_u32 (ply->leaves, dst & 0xff);
+  leaf = ip4_mtrie_lookup_step_x8 (leaf, dst, 8);
+  leaf = ip4_mtrie_lookup_step_x8 (leaf, dst, 16);
+  leaf = ip4_mtrie_lookup_step_x8 (leaf, dst, 24);
+
+  return leaf >> 1;
+}
+#endif
+
+#ifdef CLIB_HAVE_VEC512
+/**
+ * @brief Lookup step for 16 addresses.
+ */
+static_always_inline u32x16
+ip4_mtrie_lookup_step_x16 (u32x16 leaf, u32x16 dst, u32 shift)
+{
+  u32x16 idx;
+  u16 is_ply;
+
+  /* a bit for each lane that is not terminal */
+  is_ply = u32x16_is_zero_mask (~leaf & 1);
+  if (is_ply == 0)
+    return leaf;
+
+  idx = (leaf >> 1) * IP4_MTRIE_PLY_N_LEAVES + ((dst >> shift) & 0xff);
+  return u32x16_mask_gather_u32 (leaf, (u32 *) ip4_ply_pool, idx, is_ply);
+}
+
+always_inline u32x16
+ip4_mtrie_16_lookup_x16 (const ip4_mtrie_16_t *m, u32x16 dst)
+{
+  u32x16 leaf;
+
+  leaf = u32x16_gather_u32 (m->root_ply.leaves, dst & 0xffff);
+  leaf = ip4_mtrie_lookup_step_x16 (leaf, dst, 16);
+  leaf = ip4_mtrie_lookup_step_x16 (leaf, dst, 24);
+
+  return leaf >> 1;
+}
+
+always_inline u32x16
+ip4_mtrie_8_lookup_x16 (const ip4_mtrie_8_t *m, u32x16 dst)
+{
+  ip4_mtrie_8_ply_t *ply;
+  u32x16 leaf;
+
+  ply = pool_elt_at_index (ip4_ply_pool, m->root_ply);
+  leaf = u32x16_gather_u32 (ply->leaves, dst & 0xff);
+  leaf = ip4_mtrie_lookup_step_x16 (leaf, dst, 8);
+  leaf = ip4_mtrie_lookup_step_x16 (leaf, dst, 16);
+  leaf = ip4_mtrie_lookup_step_x16 (leaf, dst, 24);
+
+  return leaf >> 1;
+}
+#endif
+
+/**
+ * @brief Lookup n addresses in the same mtrie, with gathers where
+ * the CPU has them.
+ */
+always_inline void
+ip4_mtrie_16_lookup_n (const ip4_mtrie_16_t *m, const ip4_address_t *dst,
+		       u32 *adj_indices, u32 n)
+{
+  ip4_mtrie_leaf_t leaf;
+
+#if defined(CLIB_HAVE_VEC256)
+  if (PREDICT_TRUE (vec_len (ip4_ply_pool) < IP4_MTRIE_GATHER_MAX_PLYS))
+    {
+#if defined(CLIB_HAVE_VEC512)
+      for (; n >= 16; n -= 16, dst += 16, adj_indices += 16)
+	u32x16_store_unaligned (
+	  ip4_mtrie_16_lookup_x16 (m, u32x16_load_unaligned ((void *) dst)),
+	  adj_indices);
+#endif
+      for (; n >= 8; n -= 8, dst += 8, adj_indices += 8)
+	u32x8_store_unaligned (
+	  ip4_mtrie_16_lookup_x8 (m, u32x8_load_unaligned ((void *) dst)),
+	  adj_indices);
+    }
+#endif
+
+  for (; n > 0; n--, dst++, adj_indices++)
+    {
+      leaf = ip4_mtrie_16_lookup_step_one (m, dst);
+      leaf = ip4_mtrie_16_lookup_step (leaf, dst, 2);
+      leaf = ip4_mtrie_16_lookup_step (leaf, dst, 3);
+      adj_indices[0] = ip4_mtrie_leaf_get_adj_index (leaf);
+    }
+}
+
+always_inline void
+ip4_mtrie_8_lookup_n (const ip4_mtrie_8_t *m, const ip4_address_t *dst,
+		      u32 *adj_indices, u32 n)
+{
+  ip4_mtrie_leaf_t leaf;
+
+#if defined(CLIB_HAVE_VEC256)
+  if (PREDICT_TRUE (vec_len (ip4_ply_pool) < IP4_MTRIE_GATHER_MAX_PLYS))
+    {
+#if defined(CLIB_HAVE_VEC512)
+      for (; n >= 16; n -= 16, dst += 16, adj_indices += 16)
+	u32x16_store_unaligned (
+	  ip4_mtrie_8_lookup_x16 (m, u32x16_load_unaligned ((void *) dst)),
+	  adj_indices);
+#endif
+      for (; n >= 8; n -= 8, dst += 8, adj_indices += 8)
+	u32x8_store_unaligned (
+	  ip4_mtrie_8_lookup_x8 (m, u32x8_load_unaligned ((void *) dst)),
+	  adj_indices);
+    }
+#endif
+
+  for (; n > 0; n--, dst++, adj_indices++)
+    {
+      leaf = ip4_mtrie_8_lookup_step_one (m, dst);
+      leaf = ip4_mtrie_8_lookup_step (leaf, dst, 1);
+      leaf = ip4_mtrie_8_lookup_step (leaf, dst, 2);
+      leaf = ip4_mtrie_8_lookup_step (leaf, dst, 3);
+      adj_indices[0] = ip4_mtrie_leaf_get_adj_index (leaf);
+    }
+}
+
 #endif /* included_ip_ip4_fib_h */
 
 /*
@@ -68,6 +68,14 @@ typedef struct
 
   /* Index into FIB vector. */
   u32 index;
+
+  /* Forwarding lookups by binary search on prefix lengths, if enabled for
+     this table and compiled; see ip6_fib.h */
+  u8 bsl_enabled;
+  struct ip6_fib_bsl_t_ *bsl;
+
+  /* Number of forwarding entries of each prefix length in this FIB. */
+  u32 dst_address_length_refcounts[129];
 } ip6_fib_t;
 
 typedef struct ip6_mfib_t
@@ -31,6 +31,12 @@
  */
 #define IPSEC4_OUT_SPD_DEFAULT_HASH_NUM_BUCKETS (1 << 22)
 
+/* Inbound flow caches are allocated per SPD, so default to a smaller size
+ * that holds 16k flows with the same load factor.
+ */
+#define IPSEC4_IN_SPD_DEFAULT_HASH_NUM_BUCKETS (1 << 16)
+#define IPSEC6_IN_SPD_DEFAULT_HASH_NUM_BUCKETS (1 << 16)
+
 ipsec_main_t ipsec_main;
 esp_async_post_next_t esp_encrypt_async_next;
 esp_async_post_next_t esp_decrypt_async_next;
@@ -560,6 +566,11 @@ ipsec_init (vlib_main_t * vm)
   im->ipsec4_out_spd_hash_num_buckets =
     IPSEC4_OUT_SPD_DEFAULT_HASH_NUM_BUCKETS;
 
+  im->input4_flow_cache_flag = 0;
+  im->input6_flow_cache_flag = 0;
+  im->ipsec4_in_spd_hash_num_buckets = IPSEC4_IN_SPD_DEFAULT_HASH_NUM_BUCKETS;
+  im->ipsec6_in_spd_hash_num_buckets = IPSEC6_IN_SPD_DEFAULT_HASH_NUM_BUCKETS;
+
   return 0;
 }
 
@@ -571,6 +582,7 @@ ipsec_config (vlib_main_t *vm, unformat_input_t *input)
   ipsec_main_t *im = &ipsec_main;
   unformat_input_t sub_input;
   u32 ipsec4_out_spd_hash_num_buckets;
+  u32 ipsec_in_spd_hash_num_buckets;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -585,6 +597,22 @@ ipsec_config (vlib_main_t *vm, unformat_input_t *input)
 	  im->ipsec4_out_spd_hash_num_buckets =
 	    1ULL << max_log2 (ipsec4_out_spd_hash_num_buckets);
 	}
+      else if (unformat (input, "ipv4-inbound-spd-flow-cache on"))
+	im->input4_flow_cache_flag = 1;
+      else if (unformat (input, "ipv4-inbound-spd-flow-cache off"))
+	im->input4_flow_cache_flag = 0;
+      else if (unformat (input, "ipv4-inbound-spd-hash-buckets %d",
+			 &ipsec_in_spd_hash_num_buckets))
+	im->ipsec4_in_spd_hash_num_buckets =
+	  1ULL << max_log2 (ipsec_in_spd_hash_num_buckets);
+      else if (unformat (input, "ipv6-inbound-spd-flow-cache on"))
+	im->input6_flow_cache_flag = 1;
+      else if (unformat (input, "ipv6-inbound-spd-flow-cache off"))
+	im->input6_flow_cache_flag = 0;
+      else if (unformat (input, "ipv6-inbound-spd-hash-buckets %d",
+			 &ipsec_in_spd_hash_num_buckets))
+	im->ipsec6_in_spd_hash_num_buckets =
+	  1ULL << max_log2 (ipsec_in_spd_hash_num_buckets);
       else if (unformat (input, "ip4 %U", unformat_vlib_cli_sub_input,
 			 &sub_input))
 	{
@@ -34,14 +34,6 @@ typedef clib_error_t *(*add_del_sa_sess_cb_t) (u32 sa_index, u8 is_add);
 typedef clib_error_t *(*check_support_cb_t) (ipsec_sa_t * sa);
 typedef clib_error_t *(*enable_disable_cb_t) (int is_enable);
 
-typedef struct
-{
-  u64 key[2];
-  u64 value;
-  i32 bucket_lock;
-  u32 un_used;
-} ipsec4_hash_kv_16_8_t;
-
 typedef union
 {
   struct
@@ -54,6 +46,32 @@ typedef union
   ipsec4_hash_kv_16_8_t kv_16_8;
 } ipsec4_spd_5tuple_t;
 
+typedef union
+{
+  struct
+  {
+    ip4_address_t ip4_src_addr;
+    ip4_address_t ip4_dst_addr;
+    u32 spi;
+    u8 policy_type;
+    u8 pad[3];
+  };
+  ipsec4_hash_kv_16_8_t kv_16_8;
+} ipsec4_inbound_spd_tuple_t;
+
+typedef union
+{
+  struct
+  {
+    ip6_address_t ip6_src_addr;
+    ip6_address_t ip6_dst_addr;
+    u32 spi;
+    u8 policy_type;
+    u8 pad[3];
+  };
+  ipsec6_hash_kv_40_8_t kv_40_8;
+} ipsec6_inbound_spd_tuple_t;
+
 typedef struct
 {
   u8 *name;
@@ -226,6 +244,12 @@ typedef struct
   u8 async_mode;
   u16 msg_id_base;
   u8 flow_cache_flag;
+
+  /* Number of buckets for each SPD's inbound flow cache */
+  u32 ipsec4_in_spd_hash_num_buckets;
+  u32 ipsec6_in_spd_hash_num_buckets;
+  u8 input4_flow_cache_flag;
+  u8 input6_flow_cache_flag;
 } ipsec_main_t;
 
 typedef enum ipsec_format_flags_t_
@@ -288,6 +312,24 @@ ipsec4_hash_key_compare_16_8 (u64 *a, u64 *b)
 #endif
 }
 
+static_always_inline u64
+ipsec6_hash_40_8 (ipsec6_hash_kv_40_8_t *v)
+{
+#ifdef clib_crc32c_uses_intrinsics
+  return clib_crc32c ((u8 *) v->key, 40);
+#else
+  u64 tmp = v->key[0] ^ v->key[1] ^ v->key[2] ^ v->key[3] ^ v->key[4];
+  return clib_xxhash (tmp);
+#endif
+}
+
+static_always_inline int
+ipsec6_hash_key_compare_40_8 (u64 *a, u64 *b)
+{
+  return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]) |
+	  (a[4] ^ b[4])) == 0;
+}
+
 /* clib_spinlock_lock is not used to save another memory indirection */
 static_always_inline void
 ipsec_spinlock_lock (i32 *lock)
@@ -762,9 +762,13 @@ clear_ipsec_counters_command_fn (vlib_main_t * vm,
 				 unformat_input_t * input,
 				 vlib_cli_command_t * cmd)
 {
+  u32 i;
+
   vlib_clear_combined_counters (&ipsec_spd_policy_counters);
   vlib_clear_combined_counters (&ipsec_sa_counters);
   vlib_clear_simple_counters (&ipsec_sa_lost_counters);
+  for (i = 0; i < IPSEC_SPD_FLOW_CACHE_N_COUNTERS; i++)
+    vlib_clear_simple_counters (&ipsec_spd_flow_cache_counters[i]);
 
   return (NULL);
 }
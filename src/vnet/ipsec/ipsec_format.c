@@ -220,6 +220,9 @@ format_ipsec_spd (u8 * s, va_list * args)
 
 #define _(v, n)                                                 \
   s = format (s, "\n %s:", n);                                  \
+  if (spd->compiled[IPSEC_SPD_POLICY_##v])                      \
+    s = format (s, "\n  %U", format_ipsec_spd_compiled,         \
+		spd->compiled[IPSEC_SPD_POLICY_##v]);             \
   vec_foreach(i, spd->policies[IPSEC_SPD_POLICY_##v])           \
   {                                                             \
     s = format (s, "\n %U", format_ipsec_policy, *i);           \
@@ -227,6 +230,22 @@ format_ipsec_spd (u8 * s, va_list * args)
   foreach_ipsec_spd_policy_type;
 #undef _
 
+  if (im->input4_flow_cache_flag || im->input6_flow_cache_flag)
+    {
+      s = format (s, "\n inbound-flow-cache:");
+      if (im->input4_flow_cache_flag)
+	s = format (s, "\n  ip4-entries: %u", spd->ip4_in_flow_cache_entries);
+      if (im->input6_flow_cache_flag)
+	s = format (s, "\n  ip6-entries: %u", spd->ip6_in_flow_cache_entries);
+#define _(v, n)                                                               \
+  s = format (s, "\n  %s: %Lu", n,                                            \
+	      vlib_get_simple_counter (                                       \
+		&ipsec_spd_flow_cache_counters[IPSEC_SPD_FLOW_CACHE_COUNTER_##v], \
+		si));
+      foreach_ipsec_spd_flow_cache_counter;
+#undef _
+    }
+
 done:
   return (s);
 }
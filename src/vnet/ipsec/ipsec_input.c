@@ -71,32 +71,213 @@ format_ipsec_input_trace (u8 * s, va_list * args)
   return s;
 }
 
+always_inline void
+ipsec4_in_spd_add_flow_cache_entry (ipsec_spd_t *spd, u32 sa, u32 da,
+				    u32 spi, ipsec_spd_policy_type_t policy_type,
+				    u32 pol_id)
+{
+  ipsec4_hash_kv_16_8_t *kv;
+  u32 epoch = spd->in_epoch_count;
+  u8 live, collision = 0;
+  u64 hash;
+  ipsec4_inbound_spd_tuple_t ip4_tuple = {
+    .ip4_src_addr = (ip4_address_t) sa,
+    .ip4_dst_addr = (ip4_address_t) da,
+    .spi = spi,
+    .policy_type = policy_type,
+  };
+
+  ip4_tuple.kv_16_8.value = (((u64) pol_id) << 32) | ((u64) epoch);
+
+  hash = ipsec4_hash_16_8 (&ip4_tuple.kv_16_8);
+  hash &= (vec_len (spd->ip4_in_flow_cache) - 1);
+  kv = &spd->ip4_in_flow_cache[hash];
+
+  ipsec_spinlock_lock (&kv->bucket_lock);
+  /* An entry from the current epoch is live; replacing a live entry for a
+     different flow is a collision and does not change the entry count */
+  live = (epoch == ((u32) (kv->value & 0xFFFFFFFF)));
+  if (live)
+    collision = !ipsec4_hash_key_compare_16_8 (kv->key, ip4_tuple.kv_16_8.key);
+  kv->key[0] = ip4_tuple.kv_16_8.key[0];
+  kv->key[1] = ip4_tuple.kv_16_8.key[1];
+  kv->value = ip4_tuple.kv_16_8.value;
+  ipsec_spinlock_unlock (&kv->bucket_lock);
+
+  if (!live)
+    clib_atomic_fetch_add_relax (&spd->ip4_in_flow_cache_entries, 1);
+  else if (collision)
+    vlib_increment_simple_counter (
+      &ipsec_spd_flow_cache_counters[IPSEC_SPD_FLOW_CACHE_COUNTER_COLLISION],
+      vlib_get_thread_index (), spd - ipsec_main.spds, 1);
+}
+
+/*
+ * Returns non-zero when the cache holds a result for the flow. The result
+ * may be a cached miss, in which case *p is set to NULL.
+ */
+always_inline int
+ipsec4_in_spd_find_flow_cache_entry (ipsec_spd_t *spd, u32 sa, u32 da,
+				     u32 spi,
+				     ipsec_spd_policy_type_t policy_type,
+				     ipsec_policy_t **p)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec4_hash_kv_16_8_t kv_result, *kv;
+  u32 pol_id, counter;
+  int found = 0;
+  u64 hash;
+  ipsec4_inbound_spd_tuple_t ip4_tuple = {
+    .ip4_src_addr = (ip4_address_t) sa,
+    .ip4_dst_addr = (ip4_address_t) da,
+    .spi = spi,
+    .policy_type = policy_type,
+  };
+
+  hash = ipsec4_hash_16_8 (&ip4_tuple.kv_16_8);
+  hash &= (vec_len (spd->ip4_in_flow_cache) - 1);
+  kv = &spd->ip4_in_flow_cache[hash];
+
+  ipsec_spinlock_lock (&kv->bucket_lock);
+  kv_result = *kv;
+  ipsec_spinlock_unlock (&kv->bucket_lock);
+
+  if (ipsec4_hash_key_compare_16_8 ((u64 *) &ip4_tuple.kv_16_8,
+				    (u64 *) &kv_result) &&
+      spd->in_epoch_count == ((u32) (kv_result.value & 0xFFFFFFFF)))
+    {
+      pol_id = (u32) (kv_result.value >> 32);
+      *p = (pol_id == ~0) ? NULL : pool_elt_at_index (im->policies, pol_id);
+      found = 1;
+    }
+
+  counter = found ? IPSEC_SPD_FLOW_CACHE_COUNTER_HIT :
+		    IPSEC_SPD_FLOW_CACHE_COUNTER_MISS;
+  vlib_increment_simple_counter (&ipsec_spd_flow_cache_counters[counter],
+				 vlib_get_thread_index (), spd - im->spds, 1);
+
+  return found;
+}
+
+always_inline void
+ipsec6_in_spd_add_flow_cache_entry (ipsec_spd_t *spd, ip6_address_t *sa,
+				    ip6_address_t *da, u32 spi,
+				    ipsec_spd_policy_type_t policy_type,
+				    u32 pol_id)
+{
+  ipsec6_hash_kv_40_8_t *kv;
+  u32 epoch = spd->in_epoch_count;
+  u8 live, collision = 0;
+  u64 hash;
+  ipsec6_inbound_spd_tuple_t ip6_tuple = {
+    .ip6_src_addr = *sa,
+    .ip6_dst_addr = *da,
+    .spi = spi,
+    .policy_type = policy_type,
+  };
+
+  ip6_tuple.kv_40_8.value = (((u64) pol_id) << 32) | ((u64) epoch);
+
+  hash = ipsec6_hash_40_8 (&ip6_tuple.kv_40_8);
+  hash &= (vec_len (spd->ip6_in_flow_cache) - 1);
+  kv = &spd->ip6_in_flow_cache[hash];
+
+  ipsec_spinlock_lock (&kv->bucket_lock);
+  live = (epoch == ((u32) (kv->value & 0xFFFFFFFF)));
+  if (live)
+    collision = !ipsec6_hash_key_compare_40_8 (kv->key, ip6_tuple.kv_40_8.key);
+  clib_memcpy_fast (kv->key, ip6_tuple.kv_40_8.key, sizeof (kv->key));
+  kv->value = ip6_tuple.kv_40_8.value;
+  ipsec_spinlock_unlock (&kv->bucket_lock);
+
+  if (!live)
+    clib_atomic_fetch_add_relax (&spd->ip6_in_flow_cache_entries, 1);
+  else if (collision)
+    vlib_increment_simple_counter (
+      &ipsec_spd_flow_cache_counters[IPSEC_SPD_FLOW_CACHE_COUNTER_COLLISION],
+      vlib_get_thread_index (), spd - ipsec_main.spds, 1);
+}
+
+always_inline int
+ipsec6_in_spd_find_flow_cache_entry (ipsec_spd_t *spd, ip6_address_t *sa,
+				     ip6_address_t *da, u32 spi,
+				     ipsec_spd_policy_type_t policy_type,
+				     ipsec_policy_t **p)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec6_hash_kv_40_8_t kv_result, *kv;
+  u32 pol_id, counter;
+  int found = 0;
+  u64 hash;
+  ipsec6_inbound_spd_tuple_t ip6_tuple = {
+    .ip6_src_addr = *sa,
+    .ip6_dst_addr = *da,
+    .spi = spi,
+    .policy_type = policy_type,
+  };
+
+  hash = ipsec6_hash_40_8 (&ip6_tuple.kv_40_8);
+  hash &= (vec_len (spd->ip6_in_flow_cache) - 1);
+  kv = &spd->ip6_in_flow_cache[hash];
+
+  ipsec_spinlock_lock (&kv->bucket_lock);
+  kv_result = *kv;
+  ipsec_spinlock_unlock (&kv->bucket_lock);
+
+  if (ipsec6_hash_key_compare_40_8 (ip6_tuple.kv_40_8.key, kv_result.key) &&
+      spd->in_epoch_count == ((u32) (kv_result.value & 0xFFFFFFFF)))
+    {
+      pol_id = (u32) (kv_result.value >> 32);
+      *p = (pol_id == ~0) ? NULL : pool_elt_at_index (im->policies, pol_id);
+      found = 1;
+    }
+
+  counter = found ? IPSEC_SPD_FLOW_CACHE_COUNTER_HIT :
+		    IPSEC_SPD_FLOW_CACHE_COUNTER_MISS;
+  vlib_increment_simple_counter (&ipsec_spd_flow_cache_counters[counter],
+				 vlib_get_thread_index (), spd - im->spds, 1);
+
+  return found;
+}
+
 always_inline ipsec_policy_t *
 ipsec_input_policy_match (ipsec_spd_t * spd, u32 sa, u32 da,
 			  ipsec_spd_policy_type_t policy_type)
 {
   ipsec_main_t *im = &ipsec_main;
   ipsec_policy_t *p;
-  u32 *i;
+  u32 *i, *candidates, n_candidates;
 
-  vec_foreach (i, spd->policies[policy_type])
-  {
-    p = pool_elt_at_index (im->policies, *i);
+  if (im->input4_flow_cache_flag &&
+      ipsec4_in_spd_find_flow_cache_entry (spd, sa, da, 0, policy_type, &p))
+    return p;
 
-    if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
-      continue;
+  candidates = ipsec_spd_policy_candidates_ip4 (spd, policy_type, da, sa,
+						&n_candidates);
 
-    if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
-      continue;
+  for (i = candidates; i < candidates + n_candidates; i++)
+    {
+      p = pool_elt_at_index (im->policies, *i);
 
-    if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
-      continue;
+      if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+	continue;
 
-    if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
-      continue;
+      if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+	continue;
 
-    return p;
-  }
+      if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+	continue;
+
+      if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+	continue;
+
+      if (im->input4_flow_cache_flag)
+	ipsec4_in_spd_add_flow_cache_entry (spd, sa, da, 0, policy_type, *i);
+      return p;
+    }
+
+  if (im->input4_flow_cache_flag)
+    ipsec4_in_spd_add_flow_cache_entry (spd, sa, da, 0, policy_type, ~0);
   return 0;
 }
 
@@ -106,41 +287,57 @@ ipsec_input_protect_policy_match (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
   ipsec_main_t *im = &ipsec_main;
   ipsec_policy_t *p;
   ipsec_sa_t *s;
-  u32 *i;
+  u32 *i, *candidates, n_candidates;
 
-  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT])
-  {
-    p = pool_elt_at_index (im->policies, *i);
-    s = ipsec_sa_get (p->sa_index);
+  if (im->input4_flow_cache_flag &&
+      ipsec4_in_spd_find_flow_cache_entry (
+	spd, sa, da, spi, IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT, &p))
+    return p;
+
+  candidates = ipsec_spd_policy_candidates_ip4 (
+    spd, IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT, da, sa, &n_candidates);
 
-    if (spi != s->spi)
-      continue;
+  for (i = candidates; i < candidates + n_candidates; i++)
+    {
+      p = pool_elt_at_index (im->policies, *i);
+      s = ipsec_sa_get (p->sa_index);
 
-    if (ipsec_sa_is_set_IS_TUNNEL (s))
-      {
-	if (da != clib_net_to_host_u32 (s->tunnel.t_dst.ip.ip4.as_u32))
-	  continue;
+      if (spi != s->spi)
+	continue;
 
-	if (sa != clib_net_to_host_u32 (s->tunnel.t_src.ip.ip4.as_u32))
-	  continue;
+      if (ipsec_sa_is_set_IS_TUNNEL (s))
+	{
+	  if (da != clib_net_to_host_u32 (s->tunnel.t_dst.ip.ip4.as_u32))
+	    continue;
 
-	return p;
-      }
+	  if (sa != clib_net_to_host_u32 (s->tunnel.t_src.ip.ip4.as_u32))
+	    continue;
 
-    if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
-      continue;
+	  goto match;
+	}
 
-    if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
-      continue;
+      if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+	continue;
 
-    if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
-      continue;
+      if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+	continue;
 
-    if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
-      continue;
+      if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+	continue;
 
-    return p;
-  }
+      if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+	continue;
+
+    match:
+      if (im->input4_flow_cache_flag)
+	ipsec4_in_spd_add_flow_cache_entry (
+	  spd, sa, da, spi, IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT, *i);
+      return p;
+    }
+
+  if (im->input4_flow_cache_flag)
+    ipsec4_in_spd_add_flow_cache_entry (
+      spd, sa, da, spi, IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT, ~0);
   return 0;
 }
 
@@ -162,35 +359,51 @@ ipsec6_input_protect_policy_match (ipsec_spd_t * spd,
   ipsec_main_t *im = &ipsec_main;
   ipsec_policy_t *p;
   ipsec_sa_t *s;
-  u32 *i;
+  u32 *i, *candidates, n_candidates;
+
+  if (im->input6_flow_cache_flag &&
+      ipsec6_in_spd_find_flow_cache_entry (
+	spd, sa, da, spi, IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT, &p))
+    return p;
+
+  candidates = ipsec_spd_policy_candidates_ip6 (
+    spd, IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT, da, sa, &n_candidates);
 
-  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT])
-  {
-    p = pool_elt_at_index (im->policies, *i);
-    s = ipsec_sa_get (p->sa_index);
+  for (i = candidates; i < candidates + n_candidates; i++)
+    {
+      p = pool_elt_at_index (im->policies, *i);
+      s = ipsec_sa_get (p->sa_index);
+
+      if (spi != s->spi)
+	continue;
 
-    if (spi != s->spi)
-      continue;
+      if (ipsec_sa_is_set_IS_TUNNEL (s))
+	{
+	  if (!ip6_address_is_equal (sa, &s->tunnel.t_src.ip.ip6))
+	    continue;
 
-    if (ipsec_sa_is_set_IS_TUNNEL (s))
-      {
-	if (!ip6_address_is_equal (sa, &s->tunnel.t_src.ip.ip6))
-	  continue;
+	  if (!ip6_address_is_equal (da, &s->tunnel.t_dst.ip.ip6))
+	    continue;
 
-	if (!ip6_address_is_equal (da, &s->tunnel.t_dst.ip.ip6))
-	  continue;
+	  goto match;
+	}
 
-	return p;
-      }
+      if (!ip6_addr_match_range (sa, &p->raddr.start.ip6, &p->raddr.stop.ip6))
+	continue;
 
-    if (!ip6_addr_match_range (sa, &p->raddr.start.ip6, &p->raddr.stop.ip6))
-      continue;
+      if (!ip6_addr_match_range (da, &p->laddr.start.ip6, &p->laddr.stop.ip6))
+	continue;
 
-    if (!ip6_addr_match_range (da, &p->laddr.start.ip6, &p->laddr.stop.ip6))
-      continue;
+    match:
+      if (im->input6_flow_cache_flag)
+	ipsec6_in_spd_add_flow_cache_entry (
+	  spd, sa, da, spi, IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT, *i);
+      return p;
+    }
 
-    return p;
-  }
+  if (im->input6_flow_cache_flag)
+    ipsec6_in_spd_add_flow_cache_entry (
+      spd, sa, da, spi, IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT, ~0);
   return 0;
 }
 
@@ -150,60 +150,63 @@ ipsec_output_policy_match (ipsec_spd_t *spd, u8 pr, u32 la, u32 ra, u16 lp,
 {
   ipsec_main_t *im = &ipsec_main;
   ipsec_policy_t *p;
-  u32 *i;
+  u32 *i, *candidates, n_candidates;
 
   if (!spd)
     return 0;
 
-  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP4_OUTBOUND])
-  {
-    p = pool_elt_at_index (im->policies, *i);
-    if (PREDICT_FALSE (p->protocol && (p->protocol != pr)))
-      continue;
+  candidates = ipsec_spd_policy_candidates_ip4 (
+    spd, IPSEC_SPD_POLICY_IP4_OUTBOUND, la, ra, &n_candidates);
 
-    if (ra < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
-      continue;
+  for (i = candidates; i < candidates + n_candidates; i++)
+    {
+      p = pool_elt_at_index (im->policies, *i);
+      if (PREDICT_FALSE (p->protocol && (p->protocol != pr)))
+	continue;
 
-    if (ra > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
-      continue;
+      if (ra < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+	continue;
 
-    if (la < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
-      continue;
+      if (ra > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+	continue;
 
-    if (la > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
-      continue;
+      if (la < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+	continue;
 
-    if (PREDICT_FALSE ((pr != IP_PROTOCOL_TCP) && (pr != IP_PROTOCOL_UDP) &&
-		       (pr != IP_PROTOCOL_SCTP)))
-      {
-	lp = 0;
-	rp = 0;
-	goto add_flow_cache;
-      }
+      if (la > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+	continue;
 
-    if (lp < p->lport.start)
-      continue;
+      if (PREDICT_FALSE ((pr != IP_PROTOCOL_TCP) && (pr != IP_PROTOCOL_UDP) &&
+			 (pr != IP_PROTOCOL_SCTP)))
+	{
+	  lp = 0;
+	  rp = 0;
+	  goto add_flow_cache;
+	}
 
-    if (lp > p->lport.stop)
-      continue;
+      if (lp < p->lport.start)
+	continue;
 
-    if (rp < p->rport.start)
-      continue;
+      if (lp > p->lport.stop)
+	continue;
 
-    if (rp > p->rport.stop)
-      continue;
+      if (rp < p->rport.start)
+	continue;
 
-  add_flow_cache:
-    if (flow_cache_enabled)
-      {
-	/* Add an Entry in Flow cache */
-	ipsec4_out_spd_add_flow_cache_entry (
-	  im, pr, clib_host_to_net_u32 (la), clib_host_to_net_u32 (ra),
-	  clib_host_to_net_u16 (lp), clib_host_to_net_u16 (rp), *i);
-      }
+      if (rp > p->rport.stop)
+	continue;
 
-    return p;
-  }
+    add_flow_cache:
+      if (flow_cache_enabled)
+	{
+	  /* Add an Entry in Flow cache */
+	  ipsec4_out_spd_add_flow_cache_entry (
+	    im, pr, clib_host_to_net_u32 (la), clib_host_to_net_u32 (ra),
+	    clib_host_to_net_u16 (lp), clib_host_to_net_u16 (rp), *i);
+	}
+
+      return p;
+    }
   return 0;
 }
 
@@ -224,42 +227,45 @@ ipsec6_output_policy_match (ipsec_spd_t * spd,
 {
   ipsec_main_t *im = &ipsec_main;
   ipsec_policy_t *p;
-  u32 *i;
+  u32 *i, *candidates, n_candidates;
 
   if (!spd)
     return 0;
 
-  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP6_OUTBOUND])
-  {
-    p = pool_elt_at_index (im->policies, *i);
-    if (PREDICT_FALSE (p->protocol && (p->protocol != pr)))
-      continue;
+  candidates = ipsec_spd_policy_candidates_ip6 (
+    spd, IPSEC_SPD_POLICY_IP6_OUTBOUND, la, ra, &n_candidates);
 
-    if (!ip6_addr_match_range (ra, &p->raddr.start.ip6, &p->raddr.stop.ip6))
-      continue;
+  for (i = candidates; i < candidates + n_candidates; i++)
+    {
+      p = pool_elt_at_index (im->policies, *i);
+      if (PREDICT_FALSE (p->protocol && (p->protocol != pr)))
+	continue;
 
-    if (!ip6_addr_match_range (la, &p->laddr.start.ip6, &p->laddr.stop.ip6))
-      continue;
+      if (!ip6_addr_match_range (ra, &p->raddr.start.ip6, &p->raddr.stop.ip6))
+	continue;
 
-    if (PREDICT_FALSE
-	((pr != IP_PROTOCOL_TCP) && (pr != IP_PROTOCOL_UDP)
-	 && (pr != IP_PROTOCOL_SCTP)))
-      return p;
+      if (!ip6_addr_match_range (la, &p->laddr.start.ip6, &p->laddr.stop.ip6))
+	continue;
 
-    if (lp < p->lport.start)
-      continue;
+      if (PREDICT_FALSE
+	  ((pr != IP_PROTOCOL_TCP) && (pr != IP_PROTOCOL_UDP)
+	   && (pr != IP_PROTOCOL_SCTP)))
+	return p;
 
-    if (lp > p->lport.stop)
-      continue;
+      if (lp < p->lport.start)
+	continue;
 
-    if (rp < p->rport.start)
-      continue;
+      if (lp > p->lport.stop)
+	continue;
 
-    if (rp > p->rport.stop)
-      continue;
+      if (rp < p->rport.start)
+	continue;
 
-    return p;
-  }
+      if (rp > p->rport.stop)
+	continue;
+
+      return p;
+    }
 
   return 0;
 }
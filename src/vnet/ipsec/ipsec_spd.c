@@ -16,6 +16,42 @@
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_io.h>
 
+vlib_simple_counter_main_t
+  ipsec_spd_flow_cache_counters[IPSEC_SPD_FLOW_CACHE_N_COUNTERS] = {
+#define _(s, n)                                                               \
+  [IPSEC_SPD_FLOW_CACHE_COUNTER_##s] = {                                      \
+    .name = "spd-flow-cache-" n,                                              \
+    .stat_segment_name = "/net/ipsec/spd/flow-cache/" n,                      \
+  },
+    foreach_ipsec_spd_flow_cache_counter
+#undef _
+  };
+
+void
+ipsec_spd_in_flow_cache_flush (ipsec_spd_t *spd)
+{
+  /*
+   * Entries are valid only while their epoch matches the SPD's. When the
+   * epoch wraps, old entries could become valid again, so wipe the tables.
+   * Epoch 0 is never used, so that zeroed buckets are never valid.
+   */
+  if (spd->in_epoch_count == 0xFFFFFFFF)
+    {
+      if (spd->ip4_in_flow_cache)
+	clib_memset_u8 (spd->ip4_in_flow_cache, 0,
+			vec_bytes (spd->ip4_in_flow_cache));
+      if (spd->ip6_in_flow_cache)
+	clib_memset_u8 (spd->ip6_in_flow_cache, 0,
+			vec_bytes (spd->ip6_in_flow_cache));
+      clib_atomic_store_relax_n (&spd->in_epoch_count, 1);
+    }
+  else
+    clib_atomic_fetch_add_relax (&spd->in_epoch_count, 1);
+
+  clib_atomic_store_relax_n (&spd->ip4_in_flow_cache_entries, 0);
+  clib_atomic_store_relax_n (&spd->ip6_in_flow_cache_entries, 0);
+}
+
 int
 ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
 {
@@ -46,7 +82,11 @@ ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
 #define _(s,v) vec_free(spd->policies[IPSEC_SPD_POLICY_##s]);
       foreach_ipsec_spd_policy_type
 #undef _
-	pool_put (im->spds, spd);
+      FOR_EACH_IPSEC_SPD_POLICY_TYPE (k)
+	ipsec_spd_policy_compiled_free (spd, k);
+      vec_free (spd->ip4_in_flow_cache);
+      vec_free (spd->ip6_in_flow_cache);
+      pool_put (im->spds, spd);
     }
   else				/* create new SPD */
     {
@@ -54,7 +94,23 @@ ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
       clib_memset (spd, 0, sizeof (*spd));
       spd_index = spd - im->spds;
       spd->id = spd_id;
+      spd->in_epoch_count = 1;
       hash_set (im->spd_index_by_spd_id, spd_id, spd_index);
+
+      if (im->input4_flow_cache_flag)
+	vec_validate (spd->ip4_in_flow_cache,
+		      im->ipsec4_in_spd_hash_num_buckets - 1);
+      if (im->input6_flow_cache_flag)
+	vec_validate (spd->ip6_in_flow_cache,
+		      im->ipsec6_in_spd_hash_num_buckets - 1);
+
+      for (k = 0; k < IPSEC_SPD_FLOW_CACHE_N_COUNTERS; k++)
+	{
+	  vlib_validate_simple_counter (&ipsec_spd_flow_cache_counters[k],
+					spd_index);
+	  vlib_zero_simple_counter (&ipsec_spd_flow_cache_counters[k],
+				    spd_index);
+	}
     }
   return 0;
 }
@@ -40,6 +40,42 @@ typedef enum ipsec_spd_policy_t_
 
 extern u8 *format_ipsec_policy_type (u8 * s, va_list * args);
 
+typedef struct
+{
+  u64 key[2];
+  u64 value;
+  i32 bucket_lock;
+  u32 un_used;
+} ipsec4_hash_kv_16_8_t;
+
+typedef struct
+{
+  u64 key[5];
+  u64 value;
+  i32 bucket_lock;
+  u32 un_used;
+} ipsec6_hash_kv_40_8_t;
+
+#define foreach_ipsec_spd_flow_cache_counter                                  \
+  _ (HIT, "hit")                                                              \
+  _ (MISS, "miss")                                                            \
+  _ (COLLISION, "collision")
+
+typedef enum ipsec_spd_flow_cache_counter_t_
+{
+#define _(s, n) IPSEC_SPD_FLOW_CACHE_COUNTER_##s,
+  foreach_ipsec_spd_flow_cache_counter
+#undef _
+    IPSEC_SPD_FLOW_CACHE_N_COUNTERS,
+} ipsec_spd_flow_cache_counter_t;
+
+/**
+ * @brief
+ * Per-SPD inbound flow cache counters, indexed by SPD pool index
+ */
+extern vlib_simple_counter_main_t
+  ipsec_spd_flow_cache_counters[IPSEC_SPD_FLOW_CACHE_N_COUNTERS];
+
 /**
  * @brief A Secruity Policy Database
  */
@@ -49,6 +85,18 @@ typedef struct
   u32 id;
   /** vectors for each of the policy types */
   u32 *policies[IPSEC_SPD_POLICY_N_TYPES];
+  /** compiled lookup per policy type, NULL when linear search is used */
+  struct ipsec_spd_compiled_t_ *compiled[IPSEC_SPD_POLICY_N_TYPES];
+  /** bitmap of the policy types waiting to be compiled */
+  u32 compile_pending;
+  /** inbound flow caches, allocated only when enabled in the config */
+  ipsec4_hash_kv_16_8_t *ip4_in_flow_cache;
+  ipsec6_hash_kv_40_8_t *ip6_in_flow_cache;
+  /** number of live entries in the inbound flow caches */
+  u32 ip4_in_flow_cache_entries;
+  u32 ip6_in_flow_cache_entries;
+  /** inbound flow cache entries from an older epoch are stale */
+  u32 in_epoch_count;
 } ipsec_spd_t;
 
 /**
@@ -66,6 +114,11 @@ extern u8 *format_ipsec_spd (u8 * s, va_list * args);
 
 extern u8 *format_ipsec_spd_flow_cache (u8 *s, va_list *args);
 
+/**
+ * @brief Invalidate the inbound flow caches of a SPD
+ */
+extern void ipsec_spd_in_flow_cache_flush (ipsec_spd_t *spd);
+
 #endif /* __IPSEC_SPD_H__ */
 
 /*
@@ -136,6 +136,317 @@ ipsec_policy_mk_type (bool is_outbound,
   return (-1);
 }
 
+/*
+ * Policy types with fewer policies than this are searched linearly, the
+ * compiled lookup only pays off once the list no longer fits a few lines.
+ */
+#define IPSEC_SPD_COMPILE_MIN_POLICIES 16
+
+/*
+ * Overlapping ranges are listed in every interval they cover. Give up on
+ * a selector if that would need more than this many entries per policy.
+ */
+#define IPSEC_SPD_COMPILE_MAX_EXPANSION 64
+
+/* Policy changes closer together than this are compiled once. */
+#define IPSEC_SPD_COMPILE_HOLD_DOWN 10e-3
+
+typedef enum
+{
+  IPSEC_SPD_COMPILE_EVENT_SCHEDULE = 1,
+} ipsec_spd_compile_event_t;
+
+vlib_node_registration_t ipsec_spd_compile_node;
+
+static u128
+ipsec_spd_addr_to_u128 (const ip46_address_t *a, u8 is_ipv6)
+{
+  if (is_ipv6)
+    return ipsec_ip6_address_to_u128 (&a->ip6);
+  return clib_net_to_host_u32 (a->ip4.as_u32);
+}
+
+static void
+ipsec_spd_policy_get_range (const ipsec_policy_t *p,
+			    ipsec_spd_policy_type_t type, u8 is_ipv6,
+			    u8 is_remote, u128 *start, u128 *stop)
+{
+  const ip46_address_range_t *r;
+
+  /* tunnel mode protect policies match on the SA's endpoints */
+  if (type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT ||
+      type == IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT)
+    {
+      ipsec_sa_t *sa = ipsec_sa_get (p->sa_index);
+
+      if (ipsec_sa_is_set_IS_TUNNEL (sa))
+	{
+	  *start = ipsec_spd_addr_to_u128 (
+	    is_remote ? &sa->tunnel.t_src.ip : &sa->tunnel.t_dst.ip, is_ipv6);
+	  *stop = *start;
+	  return;
+	}
+    }
+
+  r = is_remote ? &p->raddr : &p->laddr;
+  *start = ipsec_spd_addr_to_u128 (&r->start, is_ipv6);
+  *stop = ipsec_spd_addr_to_u128 (&r->stop, is_ipv6);
+}
+
+static int
+ipsec_spd_u128_sort (void *a1, void *a2)
+{
+  u128 *v1 = a1, *v2 = a2;
+
+  return (*v1 > *v2) - (*v1 < *v2);
+}
+
+/* index of the last bound that is <= key */
+static u32
+ipsec_spd_bound_search (u128 *bounds, u128 key)
+{
+  u32 lo = 0, hi = vec_len (bounds), mid;
+
+  while (hi - lo > 1)
+    {
+      mid = (lo + hi) >> 1;
+      if (bounds[mid] <= key)
+	lo = mid;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+static ipsec_spd_compiled_t *
+ipsec_spd_policy_compile_one (ipsec_spd_t *spd, ipsec_spd_policy_type_t type,
+			      u8 is_ipv6, u8 is_remote)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u32 *policies = spd->policies[type];
+  u32 n_policies = vec_len (policies);
+  u128 max = is_ipv6 ? ~((u128) 0) : 0xffffffff;
+  u32 *first = 0, *last = 0, *cursor = 0;
+  u128 *bounds = 0, start, stop;
+  ipsec_spd_compiled_t *c = 0;
+  u32 i, j, n_bounds, n_total = 0;
+  i32 *delta = 0, n;
+
+  /* every range starts an interval and ends one, where it stops */
+  vec_add1 (bounds, 0);
+  for (i = 0; i < n_policies; i++)
+    {
+      ipsec_spd_policy_get_range (
+	pool_elt_at_index (im->policies, policies[i]), type, is_ipv6,
+	is_remote, &start, &stop);
+      vec_add1 (bounds, start);
+      if (stop < max)
+	vec_add1 (bounds, stop + 1);
+    }
+  vec_sort_with_function (bounds, ipsec_spd_u128_sort);
+  for (i = 1, n_bounds = 1; i < vec_len (bounds); i++)
+    if (bounds[i] != bounds[n_bounds - 1])
+      bounds[n_bounds++] = bounds[i];
+  vec_set_len (bounds, n_bounds);
+
+  /* the run of intervals each policy covers */
+  vec_validate (first, n_policies - 1);
+  vec_validate (last, n_policies - 1);
+  vec_validate (delta, n_bounds);
+  for (i = 0; i < n_policies; i++)
+    {
+      ipsec_spd_policy_get_range (
+	pool_elt_at_index (im->policies, policies[i]), type, is_ipv6,
+	is_remote, &start, &stop);
+      if (start > stop)
+	{
+	  /* an empty range matches nothing, list it nowhere */
+	  first[i] = 1;
+	  last[i] = 0;
+	  continue;
+	}
+      first[i] = ipsec_spd_bound_search (bounds, start);
+      last[i] = ipsec_spd_bound_search (bounds, stop);
+      n_total += last[i] - first[i] + 1;
+      if (n_total > IPSEC_SPD_COMPILE_MAX_EXPANSION * n_policies)
+	goto done;
+      delta[first[i]] += 1;
+      delta[last[i] + 1] -= 1;
+    }
+
+  c = clib_mem_alloc (sizeof (*c));
+  clib_memset (c, 0, sizeof (*c));
+  c->is_remote = is_remote;
+
+  vec_validate (c->offsets, n_bounds);
+  for (i = 0, j = 0, n = 0; i < n_bounds; i++)
+    {
+      /* n is the number of ranges covering interval i */
+      n += delta[i];
+      c->offsets[i] = j;
+      j += n;
+    }
+  c->offsets[n_bounds] = j;
+  vec_validate (c->candidates, n_total ? n_total - 1 : 0);
+  vec_set_len (c->candidates, n_total);
+
+  /* walking the policies in priority order keeps each list sorted */
+  vec_validate (cursor, n_bounds - 1);
+  clib_memcpy_fast (cursor, c->offsets, n_bounds * sizeof (cursor[0]));
+  for (i = 0; i < n_policies; i++)
+    for (j = first[i]; j <= last[i]; j++)
+      c->candidates[cursor[j]++] = policies[i];
+
+  if (is_ipv6)
+    {
+      vec_validate_aligned (c->ip6_bounds, n_bounds - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      clib_memcpy_fast (c->ip6_bounds, bounds, n_bounds * sizeof (u128));
+    }
+  else
+    {
+      vec_validate (c->ip4_bounds, n_bounds - 1);
+      for (i = 0; i < n_bounds; i++)
+	c->ip4_bounds[i] = (u32) bounds[i];
+    }
+
+done:
+  vec_free (bounds);
+  vec_free (first);
+  vec_free (last);
+  vec_free (delta);
+  vec_free (cursor);
+  return c;
+}
+
+static void
+ipsec_spd_compiled_destroy (ipsec_spd_compiled_t *c)
+{
+  vec_free (c->ip4_bounds);
+  vec_free (c->ip6_bounds);
+  vec_free (c->offsets);
+  vec_free (c->candidates);
+  clib_mem_free (c);
+}
+
+void
+ipsec_spd_policy_compiled_free (ipsec_spd_t *spd, ipsec_spd_policy_type_t type)
+{
+  if (spd->compiled[type])
+    ipsec_spd_compiled_destroy (spd->compiled[type]);
+  spd->compiled[type] = NULL;
+}
+
+/* mean length of the candidate lists, scaled to compare without division */
+static_always_inline u64
+ipsec_spd_compiled_cost (ipsec_spd_compiled_t *c, ipsec_spd_compiled_t *other)
+{
+  return (u64) vec_len (c->candidates) * (vec_len (other->offsets) - 1);
+}
+
+void
+ipsec_spd_policy_compile (ipsec_spd_t *spd, ipsec_spd_policy_type_t type)
+{
+  ipsec_spd_compiled_t *local, *remote;
+  u8 is_ipv6;
+
+  ipsec_spd_policy_compiled_free (spd, type);
+
+  if (vec_len (spd->policies[type]) < IPSEC_SPD_COMPILE_MIN_POLICIES)
+    return;
+
+  is_ipv6 = (type == IPSEC_SPD_POLICY_IP6_OUTBOUND ||
+	     type == IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT ||
+	     type == IPSEC_SPD_POLICY_IP6_INBOUND_BYPASS ||
+	     type == IPSEC_SPD_POLICY_IP6_INBOUND_DISCARD);
+
+  /* partition on whichever address gives the shorter lists */
+  local = ipsec_spd_policy_compile_one (spd, type, is_ipv6, 0);
+  remote = ipsec_spd_policy_compile_one (spd, type, is_ipv6, 1);
+
+  if (local && remote)
+    {
+      if (ipsec_spd_compiled_cost (remote, local) <
+	  ipsec_spd_compiled_cost (local, remote))
+	{
+	  ipsec_spd_compiled_destroy (local);
+	  local = NULL;
+	}
+      else
+	{
+	  ipsec_spd_compiled_destroy (remote);
+	  remote = NULL;
+	}
+    }
+
+  /* workers may be running, publish the lists before the pointer */
+  clib_atomic_store_rel_n (&spd->compiled[type], local ? local : remote);
+}
+
+void
+ipsec_spd_policy_compile_schedule (ipsec_spd_t *spd,
+				   ipsec_spd_policy_type_t type)
+{
+  ipsec_spd_policy_compiled_free (spd, type);
+  spd->compile_pending |= 1 << type;
+  vlib_process_signal_event (vlib_get_main (), ipsec_spd_compile_node.index,
+			     IPSEC_SPD_COMPILE_EVENT_SCHEDULE, 0);
+}
+
+static uword
+ipsec_spd_compile_process (vlib_main_t *vm, vlib_node_runtime_t *rt,
+			   vlib_frame_t *f)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_spd_policy_type_t type;
+  uword *event_data = 0;
+  ipsec_spd_t *spd;
+
+  while (1)
+    {
+      vlib_process_wait_for_event (vm);
+
+      /* wait until no change has been made for the hold-down time */
+      do
+	{
+	  vec_reset_length (event_data);
+	  vlib_process_wait_for_event_or_clock (vm,
+						IPSEC_SPD_COMPILE_HOLD_DOWN);
+	}
+      while (vlib_process_get_events (vm, &event_data) != ~0);
+
+      pool_foreach (spd, im->spds)
+	{
+	  FOR_EACH_IPSEC_SPD_POLICY_TYPE (type)
+	    {
+	      /* skip types compiled since, the workers may be using them */
+	      if ((spd->compile_pending & (1 << type)) && !spd->compiled[type])
+		ipsec_spd_policy_compile (spd, type);
+	    }
+	  spd->compile_pending = 0;
+	}
+    }
+  return 0;
+}
+
+VLIB_REGISTER_NODE (ipsec_spd_compile_node) = {
+  .function = ipsec_spd_compile_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "ipsec-spd-compile-process",
+};
+
+u8 *
+format_ipsec_spd_compiled (u8 *s, va_list *args)
+{
+  ipsec_spd_compiled_t *c = va_arg (*args, ipsec_spd_compiled_t *);
+  u32 n_intervals = vec_len (c->offsets) - 1;
+
+  s = format (s, "compiled: %u intervals on %s address, %u entries",
+	      n_intervals, c->is_remote ? "remote" : "local",
+	      vec_len (c->candidates));
+  return (s);
+}
+
 int
 ipsec_add_del_policy (vlib_main_t * vm,
 		      ipsec_policy_t * policy, int is_add, u32 * stat_index)
@@ -179,6 +490,17 @@ ipsec_add_del_policy (vlib_main_t * vm,
       clib_atomic_store_relax_n (&im->ipsec4_out_spd_flow_cache_entries, 0);
     }
 
+  if ((im->input4_flow_cache_flag || im->input6_flow_cache_flag) &&
+      policy->type != IPSEC_SPD_POLICY_IP4_OUTBOUND &&
+      policy->type != IPSEC_SPD_POLICY_IP6_OUTBOUND)
+    {
+      /*
+       * Inbound flow cache entries also record misses of the protect and
+       * bypass lookups, so any inbound policy change invalidates them.
+       */
+      ipsec_spd_in_flow_cache_flush (spd);
+    }
+
   if (is_add)
     {
       u32 policy_index;
@@ -205,6 +527,7 @@ ipsec_add_del_policy (vlib_main_t * vm,
       vec_add1 (spd->policies[policy->type], policy_index);
       vec_sort_with_function (spd->policies[policy->type],
 			      ipsec_spd_entry_sort);
+      ipsec_spd_policy_compile_schedule (spd, policy->type);
       *stat_index = policy_index;
     }
   else
@@ -218,6 +541,7 @@ ipsec_add_del_policy (vlib_main_t * vm,
 	if (ipsec_policy_is_equal (vp, policy))
 	  {
 	    vec_delete (spd->policies[policy->type], 1, ii);
+	    ipsec_spd_policy_compile_schedule (spd, policy->type);
 	    ipsec_sa_unlock (vp->sa_index);
 	    pool_put (im->policies, vp);
 	    break;
@@ -73,6 +73,28 @@ typedef struct ipsec_policy_t_
   u32 sa_index;
 } ipsec_policy_t;
 
+/**
+ * @brief A compiled lookup structure for one policy type of a SPD.
+ *
+ * The address space of one selector, local or remote, whichever splits
+ * the policies best, is cut into elementary intervals. Each interval
+ * lists, in priority order, the policies whose range covers it. A lookup
+ * is then a binary search for the interval and a scan of its short list,
+ * rather than a scan of all the policies.
+ */
+typedef struct ipsec_spd_compiled_t_
+{
+  /** the intervals are over the remote, rather than local, address */
+  u8 is_remote;
+  /** lower bound of each interval, in host byte order */
+  u32 *ip4_bounds;
+  u128 *ip6_bounds;
+  /** start of each interval's list in candidates, plus one end marker */
+  u32 *offsets;
+  /** policy indices, grouped by interval */
+  u32 *candidates;
+} ipsec_spd_compiled_t;
+
 /**
  * @brief Add/Delete a SPD
  */
@@ -91,6 +113,101 @@ extern int ipsec_policy_mk_type (bool is_outbound,
 				 ipsec_policy_action_t action,
 				 ipsec_spd_policy_type_t * type);
 
+/**
+ * @brief Build the compiled lookup for one policy type of a SPD.
+ * Policy types with few policies, or whose ranges overlap too much
+ * to be partitioned, are left to a linear search. Replacing an existing
+ * compiled lookup requires the worker barrier.
+ */
+extern void ipsec_spd_policy_compile (ipsec_spd_t *spd,
+				      ipsec_spd_policy_type_t type);
+/**
+ * @brief Drop the compiled lookup of a policy type that has changed and
+ * have it rebuilt in the background once changes settle. Until then the
+ * type is searched linearly. Called with the worker barrier held.
+ */
+extern void ipsec_spd_policy_compile_schedule (ipsec_spd_t *spd,
+					       ipsec_spd_policy_type_t type);
+extern void ipsec_spd_policy_compiled_free (ipsec_spd_t *spd,
+					    ipsec_spd_policy_type_t type);
+extern u8 *format_ipsec_spd_compiled (u8 *s, va_list *args);
+
+static_always_inline u128
+ipsec_ip6_address_to_u128 (const ip6_address_t *a)
+{
+  return (((u128) clib_net_to_host_u64 (a->as_u64[0])) << 64) |
+	 clib_net_to_host_u64 (a->as_u64[1]);
+}
+
+/**
+ * @brief The policies, in priority order, that a packet must be matched
+ * against. Addresses are in host byte order.
+ */
+static_always_inline u32 *
+ipsec_spd_policy_candidates_ip4 (ipsec_spd_t *spd,
+				 ipsec_spd_policy_type_t type, u32 la, u32 ra,
+				 u32 *n_candidates)
+{
+  ipsec_spd_compiled_t *c = spd->compiled[type];
+  u32 key, lo, hi, mid;
+
+  if (!c)
+    {
+      *n_candidates = vec_len (spd->policies[type]);
+      return spd->policies[type];
+    }
+
+  key = c->is_remote ? ra : la;
+
+  /* the first interval starts at 0, find the last that starts <= key */
+  lo = 0;
+  hi = vec_len (c->ip4_bounds);
+  while (hi - lo > 1)
+    {
+      mid = (lo + hi) >> 1;
+      if (c->ip4_bounds[mid] <= key)
+	lo = mid;
+      else
+	hi = mid;
+    }
+
+  *n_candidates = c->offsets[lo + 1] - c->offsets[lo];
+  return c->candidates + c->offsets[lo];
+}
+
+static_always_inline u32 *
+ipsec_spd_policy_candidates_ip6 (ipsec_spd_t *spd,
+				 ipsec_spd_policy_type_t type,
+				 const ip6_address_t *la,
+				 const ip6_address_t *ra, u32 *n_candidates)
+{
+  ipsec_spd_compiled_t *c = spd->compiled[type];
+  u32 lo, hi, mid;
+  u128 key;
+
+  if (!c)
+    {
+      *n_candidates = vec_len (spd->policies[type]);
+      return spd->policies[type];
+    }
+
+  key = ipsec_ip6_address_to_u128 (c->is_remote ? ra : la);
+
+  lo = 0;
+  hi = vec_len (c->ip6_bounds);
+  while (hi - lo > 1)
+    {
+      mid = (lo + hi) >> 1;
+      if (c->ip6_bounds[mid] <= key)
+	lo = mid;
+      else
+	hi = mid;
+    }
+
+  *n_candidates = c->offsets[lo + 1] - c->offsets[lo];
+  return c->candidates + c->offsets[lo];
+}
+
 #endif /* __IPSEC_SPD_POLICY_H__ */
 
 /*
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Flow offload for packet-generator interfaces. pg-input matches the
+ * flows in software and sets the buffer's flow_id as a NIC would from
+ * the mark, so features which use flow marks can be tested without
+ * hardware. Only the mark action on ipv4 and ipv4 n-tuple flows is
+ * supported.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/pg/pg.h>
+#include <vnet/flow/flow.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip4_packet.h>
+#include <vnet/udp/udp_packet.h>
+
+int
+pg_flow_ops_fn (vnet_main_t *vnm, vnet_flow_dev_op_t op, u32 dev_instance,
+		u32 flow_index, uword *private_data)
+{
+  pg_main_t *pg = &pg_main;
+  pg_interface_t *pi = pool_elt_at_index (pg->interfaces, dev_instance);
+  vnet_flow_t *flow = vnet_get_flow (flow_index);
+  u32 i;
+
+  switch (op)
+    {
+    case VNET_FLOW_DEV_OP_ADD_FLOW:
+      if (flow->actions != VNET_FLOW_ACTION_MARK)
+	return VNET_FLOW_ERROR_NOT_SUPPORTED;
+      if (flow->type != VNET_FLOW_TYPE_IP4 &&
+	  flow->type != VNET_FLOW_TYPE_IP4_N_TUPLE)
+	return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+      vec_add1 (pi->flows, flow_index);
+      *private_data = 0;
+      return 0;
+
+    case VNET_FLOW_DEV_OP_DEL_FLOW:
+      i = vec_search (pi->flows, flow_index);
+      if (~0 == i)
+	return VNET_FLOW_ERROR_NO_SUCH_ENTRY;
+
+      vec_del1 (pi->flows, i);
+      return 0;
+
+    default:
+      return VNET_FLOW_ERROR_NOT_SUPPORTED;
+    }
+}
+
+static int
+pg_flow_match_ip4 (const vnet_flow_t *f, const ip4_header_t *ip)
+{
+  const vnet_flow_ip4_t *f4 = &f->ip4;
+  const udp_header_t *udp;
+
+  if ((ip->src_address.as_u32 ^ f4->src_addr.addr.as_u32) &
+      f4->src_addr.mask.as_u32)
+    return 0;
+  if ((ip->dst_address.as_u32 ^ f4->dst_addr.addr.as_u32) &
+      f4->dst_addr.mask.as_u32)
+    return 0;
+  if ((ip->protocol ^ f4->protocol.prot) & f4->protocol.mask)
+    return 0;
+
+  if (f->type != VNET_FLOW_TYPE_IP4_N_TUPLE)
+    return 1;
+
+  if (ip->protocol != IP_PROTOCOL_TCP && ip->protocol != IP_PROTOCOL_UDP)
+    return 0;
+
+  /* tcp and udp ports are at the same offsets */
+  udp = ip4_next_header ((ip4_header_t *) ip);
+  if ((clib_net_to_host_u16 (udp->src_port) ^ f->ip4_n_tuple.src_port.port) &
+      f->ip4_n_tuple.src_port.mask)
+    return 0;
+  if ((clib_net_to_host_u16 (udp->dst_port) ^ f->ip4_n_tuple.dst_port.port) &
+      f->ip4_n_tuple.dst_port.mask)
+    return 0;
+
+  return 1;
+}
+
+void
+pg_flow_mark_buffers (vlib_main_t *vm, pg_interface_t *pi, u32 *buffers,
+		      u32 n_buffers)
+{
+  ethernet_header_t *e;
+  ip4_header_t *ip;
+  vlib_buffer_t *b;
+  vnet_flow_t *f;
+  u32 *fi;
+
+  while (n_buffers--)
+    {
+      b = vlib_get_buffer (vm, buffers[0]);
+      buffers++;
+      b->flow_id = 0;
+
+      switch (pi->mode)
+	{
+	case PG_MODE_ETHERNET:
+	  e = vlib_buffer_get_current (b);
+	  if (e->type != clib_host_to_net_u16 (ETHERNET_TYPE_IP4))
+	    continue;
+	  ip = (ip4_header_t *) (e + 1);
+	  break;
+	case PG_MODE_IP4:
+	  ip = vlib_buffer_get_current (b);
+	  break;
+	default:
+	  continue;
+	}
+
+      vec_foreach (fi, pi->flows)
+	{
+	  f = vnet_get_flow (*fi);
+	  if (f && pg_flow_match_ip4 (f, ip))
+	    {
+	      b->flow_id = f->mark_flow_id;
+	      break;
+	    }
+	}
+    }
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -1721,6 +1721,9 @@ pg_generate_packets (vlib_node_runtime_t * node,
 	    vnet_buffer (b)->feature_arc_index = feature_arc_index;
 	  }
 
+      if (PREDICT_FALSE (vec_len (pi->flows)))
+	pg_flow_mark_buffers (vm, pi, to_next, n_this_frame);
+
       if (pi->gso_enabled || (s->buffer_flags & VNET_BUFFER_F_OFFLOAD))
 	{
 	  fill_buffer_offload_flags (vm, to_next, n_this_frame,
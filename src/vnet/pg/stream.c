@@ -179,6 +179,7 @@ VNET_DEVICE_CLASS (pg_dev_class) = {
   .format_tx_trace = format_pg_output_trace,
   .admin_up_down_function = pg_interface_admin_up_down,
   .mac_addr_add_del_function = pg_add_del_mac_address,
+  .flow_ops_function = pg_flow_ops_fn,
 };
 /* *INDENT-ON* */
 
@@ -66,6 +66,12 @@ typedef enum
 // The lock field should be used for a spin-lock on the struct. Alternatively,
 // a thread index field is provided so that policed packets may be handed
 // off to a single worker thread.
+//
+// A third option is to distribute the policer: each thread then polices
+// against its own copy of the struct, whose rate and limits are that
+// thread's share of the configured ones. The shares are rebalanced
+// periodically by the control plane according to the per-thread demand,
+// so no state is written by more than one thread.
 
 #define POLICER_TICKS_PER_PERIOD_SHIFT 17
 #define POLICER_TICKS_PER_PERIOD       (1 << POLICER_TICKS_PER_PERIOD_SHIFT)
@@ -96,7 +102,7 @@ typedef struct
 
   u64 last_update_time;		// MOD
   u32 thread_index;		// Tie policer to a thread, rather than lock
-  u32 pad32;
+  u32 distributed_index;	// ~0, or index of the per-thread distribution
 
 } policer_t;
 
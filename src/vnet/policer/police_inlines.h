@@ -72,7 +72,15 @@ vnet_policer_police (vlib_main_t *vm, vlib_buffer_t *b, u32 policer_index,
 
   pol = &pm->policers[policer_index];
 
-  if (handoff)
+  if (PREDICT_FALSE (pol->distributed_index != ~0))
+    /*
+     * Police against this thread's share of the rate. The per-thread
+     * copy is only ever written by this thread, so neither a lock nor
+     * a handoff is required.
+     */
+    pol = vec_elt_at_index (pm->thread_policers[vm->thread_index],
+			    policer_index);
+  else if (handoff)
     {
       if (PREDICT_FALSE (pol->thread_index == ~0))
 	/*
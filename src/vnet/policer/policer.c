@@ -49,6 +49,159 @@ vlib_combined_counter_main_t policer_counters[] = {
   },
 };
 
+static u64
+policer_thread_bytes (u32 thread_index, u32 policer_index)
+{
+  u64 bytes = 0;
+  int result;
+
+  for (result = 0; result < NUM_POLICE_RESULTS; result++)
+    bytes +=
+      policer_counters[result].counters[thread_index][policer_index].bytes;
+
+  return bytes;
+}
+
+/*
+ * Program each thread's copy of a distributed policer with its share of
+ * the rate and limits. The buckets and last update time are left alone,
+ * they belong to the owning thread; a bucket above its new limit is
+ * clamped by that thread on its next packet.
+ *
+ * The tokens are split on the running sum of the shares, so the rounding
+ * of one thread is carried to the next and the per-thread rates add up
+ * to the configured one. Limits are kept to at least a full sized frame,
+ * so a thread with a small share can still pass a packet.
+ *
+ * The owning thread may be policing meanwhile. Each field is stored
+ * whole, and a packet policed against a mix of old and new values sees
+ * a valid rate and limit either way.
+ */
+static void
+policer_distributed_apply (vnet_policer_main_t *pm, policer_distributed_t *d)
+{
+  policer_t *pol, *tpol;
+  f64 sum = 0;
+  u32 ti, cir, pir, cir_prev = 0, pir_prev = 0, min_cur, min_ext;
+  u64 min_limit;
+
+  pol = &pm->policers[d->policer_index];
+  min_limit = (u64) POLICER_DISTRIBUTED_MIN_LIMIT << pol->scale;
+  min_cur = clib_min (min_limit, pol->current_limit);
+  min_ext = clib_min (min_limit, pol->extended_limit);
+
+  vec_foreach_index (ti, d->shares)
+    {
+      f64 share = d->shares[ti];
+
+      sum = ti == vec_len (d->shares) - 1 ? 1 : clib_min (sum + share, 1);
+      cir = flt_round_nearest (pol->cir_tokens_per_period * sum);
+      pir = flt_round_nearest (pol->pir_tokens_per_period * sum);
+
+      tpol = vec_elt_at_index (pm->thread_policers[ti], d->policer_index);
+      clib_atomic_store_relax_n (&tpol->cir_tokens_per_period,
+				 cir - cir_prev);
+      clib_atomic_store_relax_n (&tpol->pir_tokens_per_period,
+				 pir - pir_prev);
+      clib_atomic_store_relax_n (
+	&tpol->current_limit,
+	clib_max (flt_round_nearest (pol->current_limit * share), min_cur));
+      clib_atomic_store_relax_n (
+	&tpol->extended_limit,
+	clib_max (flt_round_nearest (pol->extended_limit * share), min_ext));
+
+      cir_prev = cir;
+      pir_prev = pir;
+    }
+}
+
+static void
+policer_distributed_rebalance (vnet_policer_main_t *pm,
+			       policer_distributed_t *d)
+{
+  f64 total_offered = 0, total_demand = 0, error = 0, floor;
+  u32 ti, n_threads = vec_len (d->shares);
+  u64 bytes;
+
+  vec_foreach_index (ti, d->shares)
+    {
+      bytes = policer_thread_bytes (ti, d->policer_index);
+      /* the counters may have been cleared since the last pass */
+      d->offered[ti] =
+	bytes >= d->last_bytes[ti] ? bytes - d->last_bytes[ti] : bytes;
+      d->last_bytes[ti] = bytes;
+      d->demand[ti] = (d->demand[ti] + d->offered[ti]) / 2;
+
+      total_offered += d->offered[ti];
+      total_demand += d->demand[ti];
+    }
+
+  if (total_offered > 0)
+    {
+      vec_foreach_index (ti, d->shares)
+	error += clib_abs (d->shares[ti] - d->offered[ti] / total_offered);
+      d->error = error / 2;
+    }
+
+  /* nothing to go on, keep the current split */
+  if (total_demand == 0)
+    return;
+
+  floor = d->max_error / n_threads;
+
+  vec_foreach_index (ti, d->shares)
+    d->shares[ti] =
+      floor + (1 - d->max_error) * d->demand[ti] / total_demand;
+
+  policer_distributed_apply (pm, d);
+  d->n_rebalances++;
+}
+
+static uword
+policer_rebalance_process (vlib_main_t *vm, vlib_node_runtime_t *rt,
+			   vlib_frame_t *f)
+{
+  vnet_policer_main_t *pm = &vnet_policer_main;
+  policer_distributed_t *d;
+
+  while (1)
+    {
+      if (pool_elts (pm->distributed))
+	vlib_process_wait_for_event_or_clock (
+	  vm, POLICER_DISTRIBUTED_REBALANCE_INTERVAL);
+      else
+	vlib_process_wait_for_event (vm);
+
+      vlib_process_get_events (vm, NULL);
+
+      pool_foreach (d, pm->distributed)
+	policer_distributed_rebalance (pm, d);
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (policer_rebalance_node) = {
+  .function = policer_rebalance_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "policer-rebalance-process",
+};
+
+static void
+policer_distributed_free (vnet_policer_main_t *pm, policer_t *policer)
+{
+  policer_distributed_t *d;
+
+  d = pool_elt_at_index (pm->distributed, policer->distributed_index);
+  policer->distributed_index = ~0;
+
+  vec_free (d->shares);
+  vec_free (d->demand);
+  vec_free (d->offered);
+  vec_free (d->last_bytes);
+  pool_put (pm->distributed, d);
+}
+
 clib_error_t *
 policer_add_del (vlib_main_t *vm, u8 *name, qos_pol_cfg_params_st *cfg,
 		 u32 *policer_index, u8 is_add)
@@ -81,6 +234,9 @@ policer_add_del (vlib_main_t *vm, u8 *name, qos_pol_cfg_params_st *cfg,
 	  vec_free (name);
 	  return clib_error_return (0, "No such policer");
 	}
+      policer = &pm->policers[p[0]];
+      if (policer->distributed_index != ~0)
+	policer_distributed_free (pm, policer);
       pool_put_index (pm->policers, p[0]);
       hash_unset_mem (pm->policer_index_by_name, name);
 
@@ -118,6 +274,7 @@ policer_add_del (vlib_main_t *vm, u8 *name, qos_pol_cfg_params_st *cfg,
       hash_set_mem (pm->policer_index_by_name, name, pi);
       *policer_index = pi;
       policer->thread_index = ~0;
+      policer->distributed_index = ~0;
 
       for (i = 0; i < NUM_POLICE_RESULTS; i++)
 	{
@@ -165,6 +322,75 @@ policer_bind_worker (u8 *name, u32 worker, bool bind)
   return 0;
 }
 
+int
+policer_distribute (u8 *name, f64 max_error, bool enable)
+{
+  vnet_policer_main_t *pm = &vnet_policer_main;
+  policer_distributed_t *d;
+  policer_t *policer, *tpol;
+  u32 ti, n_threads;
+  uword *p;
+
+  p = hash_get_mem (pm->policer_index_by_name, name);
+  if (p == 0)
+    {
+      return VNET_API_ERROR_NO_SUCH_ENTRY;
+    }
+
+  policer = &pm->policers[p[0]];
+
+  if (!enable)
+    {
+      if (policer->distributed_index != ~0)
+	policer_distributed_free (pm, policer);
+      return 0;
+    }
+
+  if (max_error < 0 || max_error > 1)
+    {
+      return VNET_API_ERROR_INVALID_VALUE;
+    }
+
+  if (policer->distributed_index != ~0)
+    {
+      d = pool_elt_at_index (pm->distributed, policer->distributed_index);
+      d->max_error = max_error;
+      return 0;
+    }
+
+  n_threads = vlib_get_n_threads ();
+  vec_validate (pm->thread_policers, n_threads - 1);
+
+  pool_get_zero (pm->distributed, d);
+  d->policer_index = p[0];
+  d->max_error = max_error;
+  vec_validate (d->shares, n_threads - 1);
+  vec_validate (d->demand, n_threads - 1);
+  vec_validate (d->offered, n_threads - 1);
+  vec_validate (d->last_bytes, n_threads - 1);
+
+  /* start with an even split, and each thread with its share of tokens */
+  for (ti = 0; ti < n_threads; ti++)
+    {
+      vec_validate_aligned (pm->thread_policers[ti], p[0],
+			    CLIB_CACHE_LINE_BYTES);
+      tpol = vec_elt_at_index (pm->thread_policers[ti], p[0]);
+      tpol[0] = policer[0];
+      tpol->current_bucket = policer->current_bucket / n_threads;
+      tpol->extended_bucket = policer->extended_bucket / n_threads;
+
+      d->shares[ti] = 1.0 / n_threads;
+      d->last_bytes[ti] = policer_thread_bytes (ti, p[0]);
+    }
+
+  policer_distributed_apply (pm, d);
+  policer->distributed_index = d - pm->distributed;
+
+  vlib_process_signal_event (vlib_get_main (), policer_rebalance_node.index,
+			     0, 0);
+  return 0;
+}
+
 int
 policer_input (u8 *name, u32 sw_if_index, bool apply)
 {
@@ -229,6 +455,31 @@ format_policer_instance (u8 * s, va_list * va)
   return s;
 }
 
+static u8 *
+format_policer_distributed (u8 *s, va_list *va)
+{
+  vnet_policer_main_t *pm = &vnet_policer_main;
+  policer_t *policer = va_arg (*va, policer_t *);
+  policer_distributed_t *d;
+  policer_t *tpol;
+  u32 ti;
+
+  d = pool_elt_at_index (pm->distributed, policer->distributed_index);
+
+  s = format (s, "distributed: max-error %.2f%%, rate error %.2f%%, "
+	      "rebalances %llu\n",
+	      d->max_error * 100, d->error * 100, d->n_rebalances);
+  vec_foreach_index (ti, d->shares)
+    {
+      tpol = vec_elt_at_index (pm->thread_policers[ti], d->policer_index);
+      s = format (s, "  thread %u: share %.2f%%, demand %.0f bytes, "
+		  "cur bkt %u, ext bkt %u\n",
+		  ti, d->shares[ti] * 100, d->demand[ti],
+		  tpol->current_bucket, tpol->extended_bucket);
+    }
+  return s;
+}
+
 static u8 *
 format_policer_round_type (u8 * s, va_list * va)
 {
@@ -628,6 +879,49 @@ done:
   return error;
 }
 
+static clib_error_t *
+policer_distribute_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			       vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  clib_error_t *error = NULL;
+  f64 max_error = POLICER_DISTRIBUTED_DEFAULT_MAX_ERROR * 100;
+  u8 enable, *name = 0;
+  int rv;
+
+  enable = 1;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "name %s", &name))
+	;
+      else if (unformat (line_input, "undistribute"))
+	enable = 0;
+      else if (unformat (line_input, "max-error %f", &max_error))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  rv = policer_distribute (name, max_error / 100, enable);
+
+  if (rv)
+    error = clib_error_return (0, "failed: `%d'", rv);
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
 static clib_error_t *
 policer_input_command_fn (vlib_main_t *vm, unformat_input_t *input,
 			  vlib_cli_command_t *cmd)
@@ -702,6 +996,12 @@ VLIB_CLI_COMMAND (policer_bind_command, static) = {
   .short_help = "policer bind [unbind] name <name> <worker>",
   .function = policer_bind_command_fn,
 };
+VLIB_CLI_COMMAND (policer_distribute_command, static) = {
+  .path = "policer distribute",
+  .short_help = "policer distribute [undistribute] name <name> "
+		"[max-error <percent>]",
+  .function = policer_distribute_command_fn,
+};
 VLIB_CLI_COMMAND (policer_input_command, static) = {
   .path = "policer input",
   .short_help = "policer input [unapply] name <name> <interfac>",
@@ -741,6 +1041,9 @@ show_policer_command_fn (vlib_main_t * vm,
 	  {
 	    vlib_cli_output (vm, "Template %U", format_policer_instance, templ,
 			     pi[0]);
+	    if (pm->policers[pi[0]].distributed_index != ~0)
+	      vlib_cli_output (vm, "%U", format_policer_distributed,
+			       &pm->policers[pi[0]]);
 	  }
 	else
 	  {
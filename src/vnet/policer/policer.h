@@ -23,6 +23,47 @@
 #include <vnet/policer/xlate.h>
 #include <vnet/policer/police.h>
 
+/* Default share of the rate that may be left idle on threads without demand */
+#define POLICER_DISTRIBUTED_DEFAULT_MAX_ERROR 0.05
+
+/* Smallest per-thread burst of a distributed policer, a full sized frame */
+#define POLICER_DISTRIBUTED_MIN_LIMIT 1514
+
+/* How often the per-thread shares of a distributed policer are rebalanced */
+#define POLICER_DISTRIBUTED_REBALANCE_INTERVAL 1e-3
+
+/*
+ * State for a policer distributed across threads. Each thread is given
+ * max_error / n_threads of the rate unconditionally and the remainder is
+ * split according to the smoothed per-thread demand, so at most max_error
+ * of the rate can be stranded on threads that do not need it.
+ */
+typedef struct
+{
+  /* index of the distributed policer */
+  u32 policer_index;
+
+  /* bound on the fraction of the rate held by idle threads */
+  f64 max_error;
+
+  /* per-thread share of the rate, these sum to 1 */
+  f64 *shares;
+
+  /* per-thread smoothed demand, in bytes per rebalance interval */
+  f64 *demand;
+
+  /* per-thread bytes offered during the last rebalance interval */
+  f64 *offered;
+
+  /* per-thread policed byte count at the last rebalance */
+  u64 *last_bytes;
+
+  /* fraction of the rate misallocated during the last interval */
+  f64 error;
+
+  u64 n_rebalances;
+} policer_distributed_t;
+
 typedef struct
 {
   /* policer pool, aligned */
@@ -41,6 +82,12 @@ typedef struct
   /* Policer by sw_if_index vector */
   u32 *policer_index_by_sw_if_index;
 
+  /* per-thread copies of distributed policers, parallel to the pool */
+  policer_t **thread_policers;
+
+  /* distributed policer pool */
+  policer_distributed_t *distributed;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -71,6 +118,7 @@ clib_error_t *policer_add_del (vlib_main_t *vm, u8 *name,
 			       qos_pol_cfg_params_st *cfg, u32 *policer_index,
 			       u8 is_add);
 int policer_bind_worker (u8 *name, u32 worker, bool bind);
+int policer_distribute (u8 *name, f64 max_error, bool enable);
 int policer_input (u8 *name, u32 sw_if_index, bool apply);
 
 #endif /* __included_policer_h__ */
@@ -103,6 +103,21 @@ vl_api_policer_bind_t_handler (vl_api_policer_bind_t *mp)
   REPLY_MACRO (VL_API_POLICER_BIND_REPLY);
 }
 
+static void
+vl_api_policer_distribute_t_handler (vl_api_policer_distribute_t *mp)
+{
+  vl_api_policer_distribute_reply_t *rmp;
+  u8 *name;
+  int rv;
+
+  name = format (0, "%s", mp->name);
+  vec_terminate_c_string (name);
+
+  rv = policer_distribute (name, mp->max_error_pct / 100.0, mp->enable);
+  vec_free (name);
+  REPLY_MACRO (VL_API_POLICER_DISTRIBUTE_REPLY);
+}
+
 static void
 vl_api_policer_input_t_handler (vl_api_policer_input_t *mp)
 {
@@ -972,6 +972,9 @@ tcp_set_attribute (tcp_connection_t *tc, transport_endpt_attr_t *attr)
       tcp_cc_cleanup (tc);
       tc->cc_algo = tcp_cc_algo_get (attr->cc_algo);
       tcp_cc_init (tc);
+      /* Algo may rely on rate samples, e.g., bbr */
+      if ((tc->cfg_flags & TCP_CFG_F_RATE_SAMPLE) && !tc->bt)
+	tcp_bt_init (tc);
       break;
     default:
       rv = -1;
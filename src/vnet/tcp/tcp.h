@@ -159,6 +159,9 @@ typedef struct tcp_configuration_
   /** Set if csum offloading is enabled */
   u8 csum_offload;
 
+  /** Coalesce in order rx segments of a connection before tcp input */
+  u8 rx_gro;
+
   /** Default congestion control algorithm type */
   tcp_cc_algorithm_type_e cc_algo;
 
@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) 2026 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * BBR congestion control, draft-cardwell-iccrg-bbr-congestion-control-00
+ *
+ * Builds a model of the path out of the max delivery rate measured over the
+ * last 10 rounds and the min rtt measured over the last 10 seconds. The pacer
+ * sends at gain * max_bw and cwnd caps inflight at about 2 * bdp. Needs the
+ * byte tracker (tcp_bt.c) for delivery rate samples, so it enables rate
+ * sampling on every connection it is used on.
+ */
+
+#include <vnet/tcp/tcp.h>
+#include <vnet/tcp/tcp_inlines.h>
+
+#define BBR_HIGH_GAIN		2.885	/* 2/ln(2), doubles rate per round */
+#define BBR_DRAIN_GAIN		(1 / BBR_HIGH_GAIN)
+#define BBR_CWND_GAIN		2.0
+#define BBR_PACING_MARGIN	0.99	/* pace a bit below bw to drain queues */
+#define BBR_CYCLE_LEN		8
+#define BBR_BW_ROUNDS		10	/* max bw filter window in rounds */
+#define BBR_MIN_RTT_WIN		(10 * THZ)
+#define BBR_PROBE_RTT_TIME	(THZ / 5)
+#define BBR_FULL_BW_THRESH	1.25
+#define BBR_FULL_BW_ROUNDS	3
+#define BBR_MIN_CWND_SEGS	4
+
+static const f64 bbr_pacing_gain[BBR_CYCLE_LEN] = {
+  1.25, 0.75, 1, 1, 1, 1, 1, 1
+};
+
+typedef enum bbr_mode_
+{
+  BBR_STARTUP,
+  BBR_DRAIN,
+  BBR_PROBE_BW,
+  BBR_PROBE_RTT,
+} bbr_mode_e;
+
+typedef enum bbr_flag_
+{
+  BBR_F_ROUND_START = 1 << 0,
+  BBR_F_FULL_BW_REACHED = 1 << 1,
+  BBR_F_IDLE_RESTART = 1 << 2,
+  BBR_F_PROBE_RTT_ROUND_DONE = 1 << 3,
+  BBR_F_PACKET_CONSERVATION = 1 << 4,
+  BBR_F_RESTORE_CWND = 1 << 5,
+} bbr_flag_e;
+
+typedef struct bbr_bw_sample_
+{
+  u64 bw;			/**< Delivery rate in bytes/s */
+  u32 round;			/**< Round the sample was taken in */
+} __clib_packed bbr_bw_sample_t;
+
+typedef struct bbr_data_
+{
+  /** Windowed max filter of delivery rate samples. Best, 2nd and 3rd
+   *  best in disjoint subwindows of the last @ref BBR_BW_ROUNDS rounds */
+  bbr_bw_sample_t max_bw[3];
+
+  /** Delivered bytes that end the current round */
+  u64 next_round_delivered;
+
+  /** Max bw at last 25% growth, to detect a full pipe in startup */
+  u64 full_bw;
+
+  u32 min_rtt;			/**< Min rtt over last 10s (us) */
+  u32 min_rtt_stamp;		/**< When min_rtt was taken (us) */
+  u32 probe_rtt_done_stamp;	/**< When probe rtt may end (us) */
+  u32 cycle_stamp;		/**< Start of current gain cycle phase (us) */
+  u32 round_count;		/**< Number of rounds so far */
+  u32 prior_cwnd;		/**< cwnd before recovery or probe rtt */
+  u8 mode;			/**< See @ref bbr_mode_e */
+  u8 cycle_idx;			/**< Index in @ref bbr_pacing_gain */
+  u8 full_bw_cnt;		/**< Rounds without 25% bw growth */
+  u8 flags;			/**< See @ref bbr_flag_e */
+} __clib_packed bbr_data_t;
+
+STATIC_ASSERT (sizeof (bbr_data_t) <= TCP_CC_DATA_SZ, "bbr data len");
+
+/* Wrapping us timestamp, compared with u32 arithmetic */
+static inline u32
+bbr_time_now (tcp_connection_t *tc)
+{
+  return (u64) (tcp_time_now_us (tc->c_thread_index) * THZ);
+}
+
+static inline u64
+bbr_max_bw (bbr_data_t *bd)
+{
+  return bd->max_bw[0].bw;
+}
+
+static void
+bbr_max_bw_reset (bbr_data_t *bd, u64 bw)
+{
+  bd->max_bw[0].bw = bd->max_bw[1].bw = bd->max_bw[2].bw = bw;
+  bd->max_bw[0].round = bd->max_bw[1].round = bd->max_bw[2].round =
+    bd->round_count;
+}
+
+/**
+ * Kathleen Nichols' windowed max filter, as used by the Linux implementation
+ */
+static void
+bbr_max_bw_update (bbr_data_t *bd, u64 bw)
+{
+  bbr_bw_sample_t *s = bd->max_bw, val = { .bw = bw,
+					   .round = bd->round_count };
+  u32 dt;
+
+  /* New max or nothing left in the window */
+  if (bw >= s[0].bw || val.round - s[2].round > BBR_BW_ROUNDS)
+    {
+      bbr_max_bw_reset (bd, bw);
+      return;
+    }
+
+  if (bw >= s[1].bw)
+    s[2] = s[1] = val;
+  else if (bw >= s[2].bw)
+    s[2] = val;
+
+  /* Age out the best sample once it leaves the window and make sure the
+   * other two come from later subwindows */
+  dt = val.round - s[0].round;
+  if (dt > BBR_BW_ROUNDS)
+    {
+      s[0] = s[1];
+      s[1] = s[2];
+      s[2] = val;
+      if (val.round - s[0].round > BBR_BW_ROUNDS)
+	{
+	  s[0] = s[1];
+	  s[1] = s[2];
+	}
+    }
+  else if (s[1].round == s[0].round && dt > BBR_BW_ROUNDS / 4)
+    s[2] = s[1] = val;
+  else if (s[2].round == s[1].round && dt > BBR_BW_ROUNDS / 2)
+    s[2] = val;
+}
+
+static f64
+bbr_current_pacing_gain (bbr_data_t *bd)
+{
+  switch (bd->mode)
+    {
+    case BBR_STARTUP:
+      return BBR_HIGH_GAIN;
+    case BBR_DRAIN:
+      return BBR_DRAIN_GAIN;
+    case BBR_PROBE_BW:
+      return bbr_pacing_gain[bd->cycle_idx];
+    default:
+      return 1;
+    }
+}
+
+static f64
+bbr_current_cwnd_gain (bbr_data_t *bd)
+{
+  switch (bd->mode)
+    {
+    case BBR_STARTUP:
+    case BBR_DRAIN:
+      return BBR_HIGH_GAIN;
+    case BBR_PROBE_BW:
+      return BBR_CWND_GAIN;
+    default:
+      return 1;
+    }
+}
+
+/**
+ * Inflight needed to sustain bw * gain, plus headroom for segments that are
+ * held back by delayed acks or sent in bursts
+ */
+static u32
+bbr_inflight (tcp_connection_t *tc, bbr_data_t *bd, f64 gain)
+{
+  u64 bdp;
+
+  /* No rtt sample yet */
+  if (bd->min_rtt == ~0)
+    return tcp_initial_cwnd (tc);
+
+  bdp = gain * bbr_max_bw (bd) * bd->min_rtt * TCP_TICK;
+  return clib_min (bdp + 3 * tc->snd_mss, 0x7FFFFFFFU);
+}
+
+static void
+bbr_save_cwnd (tcp_connection_t *tc, bbr_data_t *bd)
+{
+  if (!(bd->flags & BBR_F_RESTORE_CWND) && bd->mode != BBR_PROBE_RTT)
+    bd->prior_cwnd = tc->cwnd;
+  else
+    bd->prior_cwnd = clib_max (bd->prior_cwnd, tc->cwnd);
+}
+
+static void
+bbr_restore_cwnd (tcp_connection_t *tc, bbr_data_t *bd)
+{
+  tc->cwnd = clib_max (tc->cwnd, bd->prior_cwnd);
+  bd->flags &= ~(BBR_F_RESTORE_CWND | BBR_F_PACKET_CONSERVATION);
+}
+
+static void
+bbr_advance_cycle_phase (tcp_connection_t *tc, bbr_data_t *bd)
+{
+  bd->cycle_idx = (bd->cycle_idx + 1) % BBR_CYCLE_LEN;
+  bd->cycle_stamp = bbr_time_now (tc);
+}
+
+static void
+bbr_enter_probe_bw (tcp_connection_t *tc, bbr_data_t *bd)
+{
+  bd->mode = BBR_PROBE_BW;
+  /* Start anywhere but in the drain phase, so that flows that start
+   * together do not probe in lockstep. The iss is random per connection */
+  bd->cycle_idx = BBR_CYCLE_LEN - 1 - tc->iss % (BBR_CYCLE_LEN - 1);
+  bbr_advance_cycle_phase (tc, bd);
+}
+
+static void
+bbr_reset_mode (tcp_connection_t *tc, bbr_data_t *bd)
+{
+  if (!(bd->flags & BBR_F_FULL_BW_REACHED))
+    bd->mode = BBR_STARTUP;
+  else
+    bbr_enter_probe_bw (tc, bd);
+}
+
+static void
+bbr_update_bw (tcp_connection_t *tc, bbr_data_t *bd, tcp_rate_sample_t *rs)
+{
+  u64 bw;
+
+  bd->flags &= ~BBR_F_ROUND_START;
+  if (!rs->delivered || rs->interval_time <= 0)
+    return;
+
+  /* A round ends when data sent after its start is delivered */
+  if (rs->prior_delivered >= bd->next_round_delivered)
+    {
+      bd->next_round_delivered = tc->delivered;
+      bd->round_count++;
+      bd->flags |= BBR_F_ROUND_START;
+      bd->flags &= ~BBR_F_PACKET_CONSERVATION;
+    }
+
+  /* App limited samples underestimate the bw, so only use them if they
+   * raise the estimate */
+  bw = rs->delivered / rs->interval_time;
+  if (!(rs->flags & TCP_BTS_IS_APP_LIMITED) || bw >= bbr_max_bw (bd))
+    bbr_max_bw_update (bd, bw);
+}
+
+static void
+bbr_update_cycle_phase (tcp_connection_t *tc, bbr_data_t *bd,
+			tcp_rate_sample_t *rs)
+{
+  u32 inflight;
+  f64 gain;
+  u8 full_length;
+
+  if (bd->mode != BBR_PROBE_BW)
+    return;
+
+  full_length = bbr_time_now (tc) - bd->cycle_stamp > bd->min_rtt;
+  gain = bbr_pacing_gain[bd->cycle_idx];
+  inflight = tcp_flight_size (tc) + rs->acked_and_sacked;
+
+  /* Probe up until the queue built or something got lost, drain until the
+   * queue is gone and cruise for one min rtt in all other phases */
+  if (gain > 1)
+    {
+      if (full_length
+	  && (rs->last_lost || inflight >= bbr_inflight (tc, bd, gain)))
+	bbr_advance_cycle_phase (tc, bd);
+    }
+  else if (gain < 1)
+    {
+      if (full_length || inflight <= bbr_inflight (tc, bd, 1))
+	bbr_advance_cycle_phase (tc, bd);
+    }
+  else if (full_length)
+    bbr_advance_cycle_phase (tc, bd);
+}
+
+static void
+bbr_check_full_bw_reached (bbr_data_t *bd, tcp_rate_sample_t *rs)
+{
+  if ((bd->flags & BBR_F_FULL_BW_REACHED)
+      || !(bd->flags & BBR_F_ROUND_START)
+      || (rs->flags & TCP_BTS_IS_APP_LIMITED))
+    return;
+
+  if (bbr_max_bw (bd) >= bd->full_bw * BBR_FULL_BW_THRESH)
+    {
+      bd->full_bw = bbr_max_bw (bd);
+      bd->full_bw_cnt = 0;
+      return;
+    }
+
+  if (++bd->full_bw_cnt >= BBR_FULL_BW_ROUNDS)
+    bd->flags |= BBR_F_FULL_BW_REACHED;
+}
+
+static void
+bbr_check_drain (tcp_connection_t *tc, bbr_data_t *bd)
+{
+  if (bd->mode == BBR_STARTUP && (bd->flags & BBR_F_FULL_BW_REACHED))
+    {
+      bd->mode = BBR_DRAIN;
+      tc->ssthresh = bbr_inflight (tc, bd, 1);
+    }
+
+  if (bd->mode == BBR_DRAIN
+      && tcp_flight_size (tc) <= bbr_inflight (tc, bd, 1))
+    bbr_enter_probe_bw (tc, bd);
+}
+
+static void
+bbr_update_min_rtt (tcp_connection_t *tc, bbr_data_t *bd,
+		    tcp_rate_sample_t *rs)
+{
+  u32 now = bbr_time_now (tc), rtt;
+  u8 expired;
+
+  expired = now - bd->min_rtt_stamp > BBR_MIN_RTT_WIN;
+
+  /* Retransmitted bytes give ambiguous rtt samples */
+  if (rs->rtt_time > 0 && !(rs->flags & TCP_BTS_IS_RXT))
+    {
+      rtt = clib_max ((u32) (rs->rtt_time * THZ), 1);
+      if (rtt < bd->min_rtt || expired)
+	{
+	  bd->min_rtt = rtt;
+	  bd->min_rtt_stamp = now;
+	}
+    }
+
+  if (expired && !(bd->flags & BBR_F_IDLE_RESTART)
+      && bd->mode != BBR_PROBE_RTT)
+    {
+      bbr_save_cwnd (tc, bd);
+      bd->mode = BBR_PROBE_RTT;
+      bd->probe_rtt_done_stamp = 0;
+    }
+
+  if (bd->mode == BBR_PROBE_RTT)
+    {
+      /* Bw samples taken while draining the pipe are app limited */
+      tc->app_limited = tc->delivered + tcp_flight_size (tc) ? : 1;
+
+      /* Hold inflight at the minimum for 200ms and one round */
+      if (!bd->probe_rtt_done_stamp
+	  && tcp_flight_size (tc) <= BBR_MIN_CWND_SEGS * tc->snd_mss)
+	{
+	  bd->probe_rtt_done_stamp = (now + BBR_PROBE_RTT_TIME) ? : 1;
+	  bd->flags &= ~BBR_F_PROBE_RTT_ROUND_DONE;
+	  bd->next_round_delivered = tc->delivered;
+	}
+      else if (bd->probe_rtt_done_stamp)
+	{
+	  if (bd->flags & BBR_F_ROUND_START)
+	    bd->flags |= BBR_F_PROBE_RTT_ROUND_DONE;
+	  if ((bd->flags & BBR_F_PROBE_RTT_ROUND_DONE)
+	      && (i32) (now - bd->probe_rtt_done_stamp) >= 0)
+	    {
+	      bd->min_rtt_stamp = now;
+	      tc->cwnd = clib_max (tc->cwnd, bd->prior_cwnd);
+	      bbr_reset_mode (tc, bd);
+	    }
+	}
+    }
+
+  if (rs->delivered)
+    bd->flags &= ~BBR_F_IDLE_RESTART;
+}
+
+static void
+bbr_set_cwnd (tcp_connection_t *tc, bbr_data_t *bd, tcp_rate_sample_t *rs)
+{
+  u32 acked = rs->acked_and_sacked, target, min_cwnd;
+
+  min_cwnd = BBR_MIN_CWND_SEGS * tc->snd_mss;
+
+  /* Recovery ended, go back to the cwnd we had before it */
+  if ((bd->flags & BBR_F_RESTORE_CWND) && !tcp_in_cong_recovery (tc))
+    bbr_restore_cwnd (tc, bd);
+
+  /* First round of fast recovery, only send what was delivered */
+  if (bd->flags & BBR_F_PACKET_CONSERVATION)
+    {
+      tc->cwnd = clib_max (tc->cwnd, tcp_flight_size (tc) + acked);
+      goto done;
+    }
+
+  target = bbr_inflight (tc, bd, bbr_current_cwnd_gain (bd));
+  if (bd->flags & BBR_F_FULL_BW_REACHED)
+    tc->cwnd = clib_min (tc->cwnd + acked, target);
+  else if (tc->cwnd < target || tc->delivered < tcp_initial_cwnd (tc))
+    tc->cwnd += acked;
+
+done:
+  tc->cwnd = clib_max (tc->cwnd, min_cwnd);
+  if (bd->mode == BBR_PROBE_RTT)
+    tc->cwnd = clib_min (tc->cwnd, min_cwnd);
+  tc->cwnd = clib_min (tc->cwnd, tc->tx_fifo_size);
+
+  /* Proportional rate reduction uses ssthresh as target for inflight */
+  if (tcp_in_fastrecovery (tc))
+    tc->ssthresh = tc->cwnd;
+}
+
+static void
+bbr_update (tcp_connection_t *tc, tcp_rate_sample_t *rs)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  bbr_update_bw (tc, bd, rs);
+  bbr_update_cycle_phase (tc, bd, rs);
+  bbr_check_full_bw_reached (bd, rs);
+  bbr_check_drain (tc, bd);
+  bbr_update_min_rtt (tc, bd, rs);
+  bbr_set_cwnd (tc, bd, rs);
+}
+
+static void
+bbr_rcv_ack (tcp_connection_t *tc, tcp_rate_sample_t *rs)
+{
+  bbr_update (tc, rs);
+}
+
+static void
+bbr_rcv_cong_ack (tcp_connection_t *tc, tcp_cc_ack_t ack_type,
+		  tcp_rate_sample_t *rs)
+{
+  /* The model is updated on every ack, in or out of recovery */
+  bbr_update (tc, rs);
+}
+
+static void
+bbr_congestion (tcp_connection_t *tc)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  /* Unlike loss based algorithms, no multiplicative decrease. Start a round
+   * of packet conservation and restore the cwnd once recovered */
+  bbr_save_cwnd (tc, bd);
+  bd->flags |= BBR_F_RESTORE_CWND | BBR_F_PACKET_CONSERVATION;
+  bd->next_round_delivered = tc->delivered;
+  tc->cwnd = clib_max (tcp_loss_wnd (tc), BBR_MIN_CWND_SEGS * tc->snd_mss);
+  tc->ssthresh = tc->cwnd;
+}
+
+static void
+bbr_loss (tcp_connection_t *tc)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  bbr_save_cwnd (tc, bd);
+  bd->flags |= BBR_F_RESTORE_CWND;
+  bd->flags &= ~BBR_F_PACKET_CONSERVATION;
+  bd->full_bw = 0;
+  tc->cwnd = tcp_loss_wnd (tc);
+}
+
+static void
+bbr_recovered (tcp_connection_t *tc)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  bbr_restore_cwnd (tc, bd);
+  tc->ssthresh = tc->prev_ssthresh;
+}
+
+static void
+bbr_undo_recovery (tcp_connection_t *tc)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  /* Spurious retransmit, cwnd and ssthresh already restored */
+  bd->flags &= ~(BBR_F_RESTORE_CWND | BBR_F_PACKET_CONSERVATION);
+  bd->full_bw = 0;
+  bd->full_bw_cnt = 0;
+}
+
+static void
+bbr_event (tcp_connection_t *tc, tcp_cc_event_t evt)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  if (evt != TCP_CC_EVT_START_TX || !tc->app_limited)
+    return;
+
+  /* Restarting after idle. Do not probe rtt on the first acks, they
+   * would find the pipe empty anyway */
+  bd->flags |= BBR_F_IDLE_RESTART;
+}
+
+static u64
+bbr_get_pacing_rate (tcp_connection_t *tc)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+  f64 srtt;
+  u64 rate;
+
+  /* No bw sample yet, pace the initial window over one srtt */
+  if (!bbr_max_bw (bd))
+    {
+      srtt = clib_min ((f64) tc->srtt * TCP_TICK, tc->mrtt_us);
+      return clib_max (BBR_HIGH_GAIN * tc->cwnd / srtt, tc->snd_mss);
+    }
+
+  rate = bbr_current_pacing_gain (bd) * bbr_max_bw (bd) * BBR_PACING_MARGIN;
+
+  /* Until the pipe is full, only ever speed up */
+  if (!(bd->flags & BBR_F_FULL_BW_REACHED)
+      && transport_connection_is_tx_paced (&tc->connection))
+    rate = clib_max (rate,
+		     transport_connection_tx_pacer_rate (&tc->connection));
+
+  return clib_max (rate, tc->snd_mss);
+}
+
+static void
+bbr_conn_init (tcp_connection_t *tc)
+{
+  bbr_data_t *bd = (bbr_data_t *) tcp_cc_data (tc);
+
+  clib_memset (bd, 0, sizeof (*bd));
+  bd->min_rtt = ~0;
+  bd->min_rtt_stamp = bbr_time_now (tc);
+  bd->next_round_delivered = tc->delivered;
+  bd->mode = BBR_STARTUP;
+
+  tc->ssthresh = 0x7FFFFFFFU;
+  tc->cwnd = tcp_initial_cwnd (tc);
+
+  /* Model is built out of delivery rate samples */
+  tc->cfg_flags |= TCP_CFG_F_RATE_SAMPLE;
+}
+
+const static tcp_cc_algorithm_t tcp_bbr = {
+  .name = "bbr",
+  .congestion = bbr_congestion,
+  .loss = bbr_loss,
+  .recovered = bbr_recovered,
+  .undo_recovery = bbr_undo_recovery,
+  .rcv_ack = bbr_rcv_ack,
+  .rcv_cong_ack = bbr_rcv_cong_ack,
+  .event = bbr_event,
+  .get_pacing_rate = bbr_get_pacing_rate,
+  .init = bbr_conn_init,
+};
+
+clib_error_t *
+bbr_init (vlib_main_t *vm)
+{
+  clib_error_t *error = 0;
+
+  tcp_cc_algo_register (TCP_CC_BBR, &tcp_bbr);
+
+  return error;
+}
+
+VLIB_INIT_FUNCTION (bbr_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -19,6 +19,7 @@
 #include <vnet/tcp/tcp.h>
 #include <vnet/tcp/tcp_inlines.h>
 #include <vnet/session/session.h>
+#include <vnet/gso/gro_func.h>
 #include <math.h>
 
 static vlib_error_desc_t tcp_input_error_counters[] = {
@@ -2868,6 +2869,175 @@ tcp_input_trace_frame (vlib_main_t * vm, vlib_node_runtime_t * node,
     }
 }
 
+static_always_inline tcp_header_t *
+tcp_input_gro_tcp_hdr (vlib_buffer_t *b, u8 is_ip4)
+{
+  if (is_ip4)
+    return ip4_next_header (vlib_buffer_get_current (b));
+  return ip6_next_header (vlib_buffer_get_current (b));
+}
+
+/**
+ * Payload length of segment if it can be coalesced by rx gro, 0 otherwise.
+ * Only unchained segments that carry data and have nothing but ack and
+ * possibly psh set qualify.
+ */
+static_always_inline u32
+tcp_input_gro_data_len (vlib_buffer_t *b, u8 is_ip4)
+{
+  u32 ip_len, hdr_len;
+  tcp_header_t *tcp;
+
+  if (b->flags & (VLIB_BUFFER_NEXT_PRESENT | VLIB_BUFFER_IS_TRACED
+		  | VNET_BUFFER_F_GSO))
+    return 0;
+
+  if (is_ip4)
+    {
+      ip4_header_t *ip4 = vlib_buffer_get_current (b);
+      tcp = ip4_next_header (ip4);
+      ip_len = clib_net_to_host_u16 (ip4->length);
+      hdr_len = ip4_header_bytes (ip4);
+    }
+  else
+    {
+      ip6_header_t *ip6 = vlib_buffer_get_current (b);
+      if (ip6->protocol != IP_PROTOCOL_TCP)
+	return 0;
+      tcp = ip6_next_header (ip6);
+      ip_len = clib_net_to_host_u16 (ip6->payload_length) + sizeof (*ip6);
+      hdr_len = sizeof (*ip6);
+    }
+
+  hdr_len += tcp_header_bytes (tcp);
+  if (ip_len != b->current_length || ip_len <= hdr_len
+      || (tcp->flags & ~TCP_FLAG_PSH) != TCP_FLAG_ACK)
+    return 0;
+
+  return ip_len - hdr_len;
+}
+
+/**
+ * Check if segment @a b continues the burst that starts with @a h, i.e.,
+ * it belongs to the same connection, its seq is @a seq_end and it has
+ * the same ack, window and options. A burst ends with psh.
+ */
+static_always_inline int
+tcp_input_gro_match (vlib_buffer_t *h, vlib_buffer_t *b, u32 seq_end,
+		     u8 is_ip4)
+{
+  tcp_header_t *th, *tb;
+
+  if (vnet_buffer (b)->ip.fib_index != vnet_buffer (h)->ip.fib_index
+      || vnet_buffer (b)->ip.rx_sw_if_index
+	   != vnet_buffer (h)->ip.rx_sw_if_index)
+    return 0;
+
+  if (is_ip4)
+    {
+      ip4_header_t *ih = vlib_buffer_get_current (h);
+      ip4_header_t *ib = vlib_buffer_get_current (b);
+      if (ih->src_address.as_u32 != ib->src_address.as_u32
+	  || ih->dst_address.as_u32 != ib->dst_address.as_u32)
+	return 0;
+      th = ip4_next_header (ih);
+      tb = ip4_next_header (ib);
+    }
+  else
+    {
+      ip6_header_t *ih = vlib_buffer_get_current (h);
+      ip6_header_t *ib = vlib_buffer_get_current (b);
+      if (!ip6_address_is_equal (&ih->src_address, &ib->src_address)
+	  || !ip6_address_is_equal (&ih->dst_address, &ib->dst_address))
+	return 0;
+      th = ip6_next_header (ih);
+      tb = ip6_next_header (ib);
+    }
+
+  return (th->src_port == tb->src_port && th->dst_port == tb->dst_port
+	  && clib_net_to_host_u32 (tb->seq_number) == seq_end
+	  && th->ack_number == tb->ack_number && th->window == tb->window
+	  && !(th->flags & TCP_FLAG_PSH)
+	  && th->data_offset_and_reserved == tb->data_offset_and_reserved
+	  && !memcmp (th + 1, tb + 1, tcp_header_bytes (tb) - sizeof (*tb)));
+}
+
+/**
+ * Update ip length of coalesced segment @a h to @a len
+ */
+static_always_inline void
+tcp_input_gro_fixup (vlib_buffer_t *h, u32 len, u8 is_ip4)
+{
+  if (is_ip4)
+    {
+      ip4_header_t *ip4 = vlib_buffer_get_current (h);
+      ip4->length = clib_host_to_net_u16 (len);
+      ip4->checksum = ip4_header_checksum (ip4);
+    }
+  else
+    {
+      ip6_header_t *ip6 = vlib_buffer_get_current (h);
+      ip6->payload_length = clib_host_to_net_u16 (len - sizeof (*ip6));
+    }
+}
+
+/**
+ * Rx gro. Appends in order data segments of a connection, found back to
+ * back in the frame, to the first segment of their burst. Tcp input then
+ * handles the burst as one segment, so rx fifo enqueue, ack processing
+ * and app notification happen once per burst instead of once per
+ * segment. Checksums were already validated by ip4/6-local.
+ *
+ * @return number of buffers left in @a bis and @a bufs
+ */
+static u32
+tcp_input_gro (vlib_main_t *vm, u32 *bis, vlib_buffer_t **bufs, u32 n_bufs,
+	       u8 is_ip4)
+{
+  u32 i, n_left = 0, data_len, h_len = 0, h_seq_end = 0;
+  vlib_buffer_t *h = 0, *b;
+  tcp_header_t *th = 0;
+  u8 flags;
+
+  for (i = 0; i < n_bufs; i++)
+    {
+      b = bufs[i];
+      data_len = tcp_input_gro_data_len (b, is_ip4);
+
+      if (h && data_len && h_len + data_len < TCP_MAX_GSO_SZ
+	  && tcp_input_gro_match (h, b, h_seq_end, is_ip4))
+	{
+	  flags = tcp_input_gro_tcp_hdr (b, is_ip4)->flags;
+	  gro_merge_buffers (vm, h, b, bis[i], data_len,
+			     b->current_length - data_len);
+	  th->flags |= flags;
+	  h_len += data_len;
+	  h_seq_end += data_len;
+	  continue;
+	}
+
+      if (h && h_len != h->current_length)
+	tcp_input_gro_fixup (h, h_len, is_ip4);
+
+      h = data_len ? b : 0;
+      if (h)
+	{
+	  th = tcp_input_gro_tcp_hdr (h, is_ip4);
+	  h_len = h->current_length;
+	  h_seq_end = clib_net_to_host_u32 (th->seq_number) + data_len;
+	}
+
+      bis[n_left] = bis[i];
+      bufs[n_left] = b;
+      n_left += 1;
+    }
+
+  if (h && h_len != h->current_length)
+    tcp_input_gro_fixup (h, h_len, is_ip4);
+
+  return n_left;
+}
+
 static void
 tcp_input_set_error_next (tcp_main_t * tm, u16 * next, u32 * error, u8 is_ip4)
 {
@@ -2924,10 +3094,11 @@ always_inline uword
 tcp46_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		    vlib_frame_t * frame, int is_ip4, u8 is_nolookup)
 {
-  u32 n_left_from, *from, thread_index = vm->thread_index;
+  u32 n_left_from, *from, thread_index = vm->thread_index, n_bufs;
   tcp_main_t *tm = vnet_get_tcp_main ();
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
   u16 nexts[VLIB_FRAME_SIZE], *next;
+  u32 bis[VLIB_FRAME_SIZE];
 
   tcp_update_time_now (tcp_get_worker (thread_index));
 
@@ -2935,6 +3106,16 @@ tcp46_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   n_left_from = frame->n_vectors;
   vlib_get_buffers (vm, from, bufs, n_left_from);
 
+  if (tcp_cfg.rx_gro && !is_nolookup && n_left_from > 1)
+    {
+      clib_memcpy_fast (bis, from, n_left_from * sizeof (u32));
+      from = bis;
+      n_left_from = tcp_input_gro (vm, bis, bufs, n_left_from, is_ip4);
+      vlib_node_increment_counter (vm, node->node_index, TCP_ERROR_GRO,
+				   frame->n_vectors - n_left_from);
+    }
+  n_bufs = n_left_from;
+
   b = bufs;
   next = nexts;
 
@@ -3032,9 +3213,9 @@ tcp46_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
     }
 
   if (PREDICT_FALSE (node->flags & VLIB_NODE_FLAG_TRACE))
-    tcp_input_trace_frame (vm, node, bufs, frame->n_vectors, is_ip4);
+    tcp_input_trace_frame (vm, node, bufs, n_bufs, is_ip4);
 
-  vlib_buffer_enqueue_to_next (vm, node, from, nexts, frame->n_vectors);
+  vlib_buffer_enqueue_to_next (vm, node, from, nexts, n_bufs);
   return frame->n_vectors;
 }
 
@@ -1373,6 +1373,11 @@ tcp_timer_retransmit_handler (tcp_connection_t * tc)
       /* Update send congestion to make sure that rxt has data to send */
       tc->snd_congestion = tc->snd_nxt;
 
+      /* All outstanding data, including previous retransmits, is now
+       * considered lost. Do not count the retransmits as in flight */
+      tc->snd_rxt_bytes = 0;
+      tc->rxt_delivered = 0;
+
       /* Send the first unacked segment. If we're short on buffers, return
        * as soon as possible */
       n_bytes = clib_min (tc->snd_mss, tc->snd_nxt - tc->snd_una);
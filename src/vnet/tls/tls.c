@@ -16,6 +16,7 @@
 #include <vnet/session/application_interface.h>
 #include <vppinfra/lock.h>
 #include <vnet/tls/tls.h>
+#include <vnet/tls/tls_record.h>
 
 static tls_main_t tls_main;
 static tls_engine_vft_t *tls_vfts;
@@ -1137,6 +1138,22 @@ tls_enable (vlib_main_t * vm, u8 is_en)
   tm->app_index = a->app_index;
   vec_free (a->name);
 
+  if (tm->record_offload)
+    tls_record_enable (vm);
+
+  return 0;
+}
+
+static int
+tls_app_rx_evt (transport_connection_t *tc)
+{
+  tls_ctx_t *ctx = (tls_ctx_t *) tc;
+  session_t *ts;
+
+  /* App dequeued from a rx fifo that was too full for the next record */
+  ts = session_get_from_handle_if_valid (ctx->tls_session_handle);
+  if (ts)
+    tls_add_vpp_q_builtin_rx_evt (ts);
   return 0;
 }
 
@@ -1151,6 +1168,7 @@ static const transport_proto_vft_t tls_proto = {
   .get_half_open = tls_half_open_get,
   .cleanup_ho = tls_cleanup_ho,
   .custom_tx = tls_custom_tx_callback,
+  .app_rx_evt = tls_app_rx_evt,
   .format_connection = format_tls_connection,
   .format_half_open = format_tls_half_open,
   .format_listener = format_tls_listener,
@@ -1358,6 +1376,8 @@ tls_config_fn (vlib_main_t * vm, unformat_input_t * input)
 	    }
 	  tm->fifo_size = tmp;
 	}
+      else if (unformat (input, "record-offload"))
+	tm->record_offload = 1;
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
@@ -0,0 +1,867 @@
+/*
+ * Copyright (c) 2026 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/tls/tls_record.h>
+
+tls_record_main_t tls_record_main;
+
+#define TLS_HS_TYPE_KEY_UPDATE 24
+
+static inline u8
+tls_record_hash_len (clib_sha2_type_t hash)
+{
+  return hash == CLIB_SHA2_384 ? SHA384_DIGEST_SIZE : SHA256_DIGEST_SIZE;
+}
+
+/*
+ * HKDF-Expand-Label from RFC 8446 with an empty context
+ */
+static void
+tls_record_hkdf_expand_label (clib_sha2_type_t hash, const u8 *secret,
+			      u8 secret_len, const char *label, u8 *out,
+			      u8 out_len)
+{
+  u8 info[64], buf[SHA2_MAX_DIGEST_SIZE + sizeof (info) + 1];
+  u8 t[SHA2_MAX_DIGEST_SIZE], hash_len = tls_record_hash_len (hash);
+  u32 label_len = strlen (label), info_len, len, done = 0, n = 0;
+
+  ASSERT (label_len + 10 <= sizeof (info));
+
+  info[0] = 0;
+  info[1] = out_len;
+  info[2] = 6 + label_len;
+  clib_memcpy_fast (info + 3, "tls13 ", 6);
+  clib_memcpy_fast (info + 9, label, label_len);
+  info[9 + label_len] = 0;
+  info_len = 10 + label_len;
+
+  /* T(i) = HMAC (secret, T(i-1) | info | i) */
+  while (done < out_len)
+    {
+      len = n ? hash_len : 0;
+      clib_memcpy_fast (buf, t, len);
+      clib_memcpy_fast (buf + len, info, info_len);
+      len += info_len;
+      buf[len++] = ++n;
+      clib_hmac_sha2 (hash, secret, secret_len, buf, len, t);
+      len = clib_min (hash_len, out_len - done);
+      clib_memcpy_fast (out + done, t, len);
+      done += len;
+    }
+}
+
+/*
+ * TLS 1.2 PRF from RFC 5246, seed is label | seed1 | seed2
+ */
+static void
+tls_record_prf (clib_sha2_type_t hash, const u8 *secret, u8 secret_len,
+		const char *label, const u8 *seed1, const u8 *seed2, u8 *out,
+		u8 out_len)
+{
+  u8 seed[13 + 64], a[SHA2_MAX_DIGEST_SIZE + sizeof (seed)];
+  u8 t[SHA2_MAX_DIGEST_SIZE], hash_len = tls_record_hash_len (hash);
+  u32 label_len = strlen (label), seed_len, len, done = 0;
+
+  ASSERT (label_len <= 13);
+
+  clib_memcpy_fast (seed, label, label_len);
+  clib_memcpy_fast (seed + label_len, seed1, 32);
+  clib_memcpy_fast (seed + label_len + 32, seed2, 32);
+  seed_len = label_len + 64;
+
+  /* A(1) = HMAC (secret, seed), out += HMAC (secret, A(i) | seed) */
+  clib_hmac_sha2 (hash, secret, secret_len, seed, seed_len, a);
+  while (done < out_len)
+    {
+      clib_memcpy_fast (a + hash_len, seed, seed_len);
+      clib_hmac_sha2 (hash, secret, secret_len, a, hash_len + seed_len, t);
+      len = clib_min (hash_len, out_len - done);
+      clib_memcpy_fast (out + done, t, len);
+      done += len;
+      clib_hmac_sha2 (hash, secret, secret_len, a, hash_len, a);
+    }
+}
+
+static void
+tls_record_tls13_derive (tls_record_t *r, tls_record_keys_t *k)
+{
+  tls_record_hkdf_expand_label (r->hash, k->secret, r->secret_len, "key",
+				k->key, r->key_len);
+  tls_record_hkdf_expand_label (r->hash, k->secret, r->secret_len, "iv",
+				k->iv, sizeof (k->iv));
+  k->seq = 0;
+  k->key_pending = 1;
+}
+
+static void
+tls_record_tls13_update (tls_record_t *r, tls_record_keys_t *k)
+{
+  u8 secret[TLS_RECORD_MAX_SECRET];
+
+  tls_record_hkdf_expand_label (r->hash, k->secret, r->secret_len,
+				"traffic upd", secret, r->secret_len);
+  clib_memcpy_fast (k->secret, secret, r->secret_len);
+  tls_record_tls13_derive (r, k);
+}
+
+static void
+tls_record_init_alg (tls_record_t *r, vnet_crypto_alg_t alg,
+		     clib_sha2_type_t hash)
+{
+  if (alg == VNET_CRYPTO_ALG_AES_128_GCM)
+    {
+      r->enc_op = VNET_CRYPTO_OP_AES_128_GCM_ENC;
+      r->dec_op = VNET_CRYPTO_OP_AES_128_GCM_DEC;
+      r->key_len = 16;
+    }
+  else
+    {
+      r->enc_op = VNET_CRYPTO_OP_AES_256_GCM_ENC;
+      r->dec_op = VNET_CRYPTO_OP_AES_256_GCM_DEC;
+      r->key_len = 32;
+    }
+  r->hash = hash;
+  r->tx.key_index = r->rx.key_index = ~0;
+  r->id = clib_atomic_add_fetch (&tls_record_main.record_id, 1);
+}
+
+int
+tls_record_alg_is_supported (vnet_crypto_alg_t alg)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  tls_record_t r;
+
+  if (!tls_record_main.wrk)
+    return 0;
+  if (alg != VNET_CRYPTO_ALG_AES_128_GCM && alg != VNET_CRYPTO_ALG_AES_256_GCM)
+    return 0;
+
+  tls_record_init_alg (&r, alg, CLIB_SHA2_256);
+  if (r.dec_op >= vec_len (cm->chained_ops_handlers))
+    return 0;
+
+  return cm->chained_ops_handlers[r.enc_op] != 0 &&
+	 cm->chained_ops_handlers[r.dec_op] != 0;
+}
+
+int
+tls_record_init_tls13 (tls_record_t *r, vnet_crypto_alg_t alg,
+		       clib_sha2_type_t hash, const u8 *tx_secret,
+		       const u8 *rx_secret, u8 secret_len)
+{
+  if (!tls_record_alg_is_supported (alg))
+    return -1;
+  if (secret_len != tls_record_hash_len (hash))
+    return -1;
+
+  tls_record_init_alg (r, alg, hash);
+  r->is_tls13 = 1;
+  r->secret_len = secret_len;
+  clib_memcpy_fast (r->tx.secret, tx_secret, secret_len);
+  clib_memcpy_fast (r->rx.secret, rx_secret, secret_len);
+  tls_record_tls13_derive (r, &r->tx);
+  tls_record_tls13_derive (r, &r->rx);
+  r->is_active = 1;
+
+  return 0;
+}
+
+int
+tls_record_init_tls12 (tls_record_t *r, vnet_crypto_alg_t alg,
+		       clib_sha2_type_t hash, const u8 *master_secret,
+		       const u8 *client_random, const u8 *server_random,
+		       u8 is_server)
+{
+  tls_record_keys_t *ck, *sk;
+  u8 key_block[2 * 32 + 2 * 4];
+
+  if (!tls_record_alg_is_supported (alg))
+    return -1;
+
+  tls_record_init_alg (r, alg, hash);
+
+  /* client key, server key, client salt, server salt */
+  tls_record_prf (hash, master_secret, 48, "key expansion", server_random,
+		  client_random, key_block, 2 * r->key_len + 2 * 4);
+
+  ck = is_server ? &r->rx : &r->tx;
+  sk = is_server ? &r->tx : &r->rx;
+  clib_memcpy_fast (ck->key, key_block, r->key_len);
+  clib_memcpy_fast (sk->key, key_block + r->key_len, r->key_len);
+  clib_memcpy_fast (ck->iv, key_block + 2 * r->key_len, 4);
+  clib_memcpy_fast (sk->iv, key_block + 2 * r->key_len + 4, 4);
+  clib_memset (key_block, 0, sizeof (key_block));
+
+  /* Finished messages used sequence number 0 */
+  r->tx.seq = r->rx.seq = 1;
+  r->tx.key_pending = r->rx.key_pending = 1;
+  r->is_active = 1;
+
+  return 0;
+}
+
+static void
+tls_record_key_add (vlib_main_t *vm, tls_record_t *r, tls_record_keys_t *k)
+{
+  vnet_crypto_alg_t alg = r->key_len == 16 ? VNET_CRYPTO_ALG_AES_128_GCM :
+					     VNET_CRYPTO_ALG_AES_256_GCM;
+
+  if (!k->key_pending)
+    return;
+
+  if (k->key_index == ~0)
+    {
+      k->key_index = vnet_crypto_key_add (vm, alg, k->key, r->key_len);
+      if (k->key_index == ~0)
+	return;
+      tls_record_main.n_keys += 1;
+    }
+  else
+    vnet_crypto_key_update (vm, k->key_index, k->key);
+
+  k->key_pending = 0;
+}
+
+void
+tls_record_keys_add (vlib_main_t *vm, tls_record_t *r)
+{
+  ASSERT (vlib_get_thread_index () == 0);
+
+  tls_record_key_add (vm, r, &r->tx);
+  tls_record_key_add (vm, r, &r->rx);
+}
+
+static void
+tls_record_keys_del_rpc (void *args)
+{
+  u32 *key_index = args;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    if (key_index[i] != ~0)
+      {
+	vnet_crypto_key_del (vlib_get_main (), key_index[i]);
+	tls_record_main.n_keys -= 1;
+      }
+}
+
+void
+tls_record_free (tls_record_t *r)
+{
+  u32 key_index[2] = { r->tx.key_index, r->rx.key_index };
+
+  if (r->is_active && (key_index[0] != ~0 || key_index[1] != ~0))
+    vlib_rpc_call_main_thread (tls_record_keys_del_rpc, (u8 *) key_index,
+			       sizeof (key_index));
+
+  clib_memset (r, 0, sizeof (*r));
+}
+
+static_always_inline void
+tls_record_segs_seek (svm_fifo_seg_t *segs, u32 offset, u32 *si, u32 *so)
+{
+  u32 i = 0;
+
+  while (offset >= segs[i].len)
+    offset -= segs[i++].len;
+
+  *si = i;
+  *so = offset;
+}
+
+static void
+tls_record_segs_copy (svm_fifo_seg_t *segs, u32 offset, u8 *data, u32 len,
+		      u8 is_write)
+{
+  u32 si, so, n;
+
+  if (!len)
+    return;
+
+  tls_record_segs_seek (segs, offset, &si, &so);
+  while (len)
+    {
+      n = clib_min (len, segs[si].len - so);
+      if (is_write)
+	clib_memcpy_fast (segs[si].data + so, data, n);
+      else
+	clib_memcpy_fast (data, segs[si].data + so, n);
+      data += n;
+      len -= n;
+      si += 1;
+      so = 0;
+    }
+}
+
+/*
+ * Add crypto op chunks that map len bytes of src segments, starting at
+ * src_offset, onto dst segments starting at dst_offset. A new chunk is
+ * started whenever either side crosses a fifo chunk boundary.
+ */
+static u32
+tls_record_add_chunks (vnet_crypto_op_chunk_t **chunks, svm_fifo_seg_t *src,
+		       u32 src_offset, svm_fifo_seg_t *dst, u32 dst_offset,
+		       u32 len)
+{
+  u32 si, so, di, dof, n, n_chunks = 0;
+  vnet_crypto_op_chunk_t *ch;
+
+  if (!len)
+    return 0;
+
+  tls_record_segs_seek (src, src_offset, &si, &so);
+  tls_record_segs_seek (dst, dst_offset, &di, &dof);
+
+  while (len)
+    {
+      n = clib_min (len, clib_min (src[si].len - so, dst[di].len - dof));
+      vec_add2 (*chunks, ch, 1);
+      ch->src = src[si].data + so;
+      ch->dst = dst[di].data + dof;
+      ch->len = n;
+      n_chunks += 1;
+
+      len -= n;
+      so += n;
+      dof += n;
+      if (so == src[si].len)
+	{
+	  si += 1;
+	  so = 0;
+	}
+      if (dof == dst[di].len)
+	{
+	  di += 1;
+	  dof = 0;
+	}
+    }
+
+  return n_chunks;
+}
+
+static_always_inline void
+tls_record_build_iv (tls_record_t *r, tls_record_keys_t *k, u64 seq, u8 *iv)
+{
+  u64 seq_be = clib_host_to_net_u64 (seq);
+
+  clib_memcpy_fast (iv, k->iv, 4);
+  if (r->is_tls13)
+    {
+      *(u64u *) (iv + 4) = *(u64u *) (k->iv + 4) ^ seq_be;
+    }
+  else
+    {
+      /* explicit nonce is the sequence number */
+      *(u64u *) (iv + 4) = seq_be;
+    }
+}
+
+static_always_inline void
+tls_record_build_hdr (u8 *hdr, u8 type, u16 len)
+{
+  hdr[0] = type;
+  hdr[1] = 3;
+  hdr[2] = 3;
+  hdr[3] = len >> 8;
+  hdr[4] = len;
+}
+
+/*
+ * Encrypt src_len bytes of src segments into records of the given type
+ * appended to the transport's tx fifo. Returns number of src bytes that
+ * fit into records.
+ */
+static int
+tls_record_encrypt (tls_record_t *r, tls_record_per_thread_t *ptd,
+		    svm_fifo_seg_t *src, u32 src_len, u8 type,
+		    svm_fifo_t *ts_f)
+{
+  u32 expl = r->is_tls13 ? 0 : TLS_RECORD_TLS12_NONCE_LEN;
+  u32 ovh = TLS_RECORD_HDR_LEN + expl + r->is_tls13 + TLS_RECORD_TAG_LEN;
+  u32 space, dst_len = 0, src_off = 0, dst_off = 0, len, rec_len, n = 0;
+  u32 max_recs, i;
+  svm_fifo_seg_t dst[TLS_RECORD_MAX_SEGS];
+  vnet_crypto_op_chunk_t *ch;
+  tls_record_op_data_t *od;
+  u8 hdr[TLS_RECORD_HDR_LEN];
+  vnet_crypto_op_t *op;
+  int n_dst;
+
+  max_recs = clib_min (TLS_RECORD_BATCH,
+		       (src_len + TLS_RECORD_MAX_PLAINTEXT - 1) /
+			 TLS_RECORD_MAX_PLAINTEXT);
+  space = svm_fifo_max_enqueue_prod (ts_f);
+  space = clib_min (space, src_len + max_recs * ovh);
+  if (space <= ovh)
+    return 0;
+
+  n_dst = svm_fifo_provision_chunks (ts_f, dst, TLS_RECORD_MAX_SEGS, space);
+  if (n_dst <= 0)
+    return 0;
+
+  for (i = 0; i < n_dst; i++)
+    dst_len += dst[i].len;
+
+  vec_reset_length (ptd->chunks);
+
+  while (src_off < src_len && n < TLS_RECORD_BATCH && dst_off + ovh < dst_len)
+    {
+      len = clib_min (src_len - src_off, TLS_RECORD_MAX_PLAINTEXT);
+      len = clib_min (len, dst_len - dst_off - ovh);
+      rec_len = len + ovh - TLS_RECORD_HDR_LEN;
+      od = &ptd->op_data[n];
+      op = &ptd->ops[n];
+
+      tls_record_build_iv (r, &r->tx, r->tx.seq, od->iv);
+      if (r->is_tls13)
+	{
+	  tls_record_build_hdr (od->aad, TLS_RECORD_TYPE_APP_DATA, rec_len);
+	  tls_record_segs_copy (dst, dst_off, od->aad, TLS_RECORD_HDR_LEN, 1);
+	  op->aad_len = TLS_RECORD_HDR_LEN;
+	}
+      else
+	{
+	  clib_memcpy_fast (od->aad, od->iv + 4, 8);
+	  tls_record_build_hdr (od->aad + 8, type, len);
+	  tls_record_build_hdr (hdr, type, rec_len);
+	  tls_record_segs_copy (dst, dst_off, hdr, TLS_RECORD_HDR_LEN, 1);
+	  tls_record_segs_copy (dst, dst_off + TLS_RECORD_HDR_LEN, od->iv + 4,
+				expl, 1);
+	  op->aad_len = 13;
+	}
+      r->tx.seq += 1;
+
+      vnet_crypto_op_init (op, r->enc_op);
+      op->flags |= VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS;
+      op->key_index = r->tx.key_index;
+      op->iv = od->iv;
+      op->aad = od->aad;
+      op->tag = od->tag;
+      op->tag_len = TLS_RECORD_TAG_LEN;
+      op->chunk_index = vec_len (ptd->chunks);
+      op->n_chunks =
+	tls_record_add_chunks (&ptd->chunks, src, src_off, dst,
+			       dst_off + TLS_RECORD_HDR_LEN + expl, len);
+      if (r->is_tls13)
+	{
+	  od->type[0] = type;
+	  vec_add2 (ptd->chunks, ch, 1);
+	  ch->src = &od->type[0];
+	  ch->dst = &od->type[1];
+	  ch->len = 1;
+	  op->n_chunks += 1;
+	}
+      od->dst_offset = dst_off + TLS_RECORD_HDR_LEN + expl + len;
+
+      src_off += len;
+      dst_off += TLS_RECORD_HDR_LEN + rec_len;
+      n += 1;
+    }
+
+  if (!n)
+    return 0;
+
+  vnet_crypto_process_chained_ops (vlib_get_main (), ptd->ops, ptd->chunks,
+				   n);
+
+  for (i = 0; i < n; i++)
+    {
+      od = &ptd->op_data[i];
+      if (PREDICT_FALSE (ptd->ops[i].status != VNET_CRYPTO_OP_STATUS_COMPLETED))
+	{
+	  ptd->n_crypto_errors += 1;
+	  return -1;
+	}
+      if (r->is_tls13)
+	tls_record_segs_copy (dst, od->dst_offset++, &od->type[1], 1, 1);
+      tls_record_segs_copy (dst, od->dst_offset, od->tag, TLS_RECORD_TAG_LEN,
+			    1);
+    }
+
+  svm_fifo_enqueue_nocopy (ts_f, dst_off);
+  ptd->n_records_encrypted += n;
+
+  return src_off;
+}
+
+static int
+tls_record_write_ctrl (tls_record_t *r, tls_record_per_thread_t *ptd,
+		       svm_fifo_t *ts_f, u8 type, u8 *data, u32 len)
+{
+  svm_fifo_seg_t seg = { data, len };
+  u32 ovh = TLS_RECORD_HDR_LEN + TLS_RECORD_TLS12_NONCE_LEN +
+	    TLS_RECORD_TAG_LEN;
+
+  if (r->tx.key_pending || svm_fifo_max_enqueue_prod (ts_f) < len + ovh)
+    return -1;
+
+  return tls_record_encrypt (r, ptd, &seg, len, type, ts_f) == len ? 0 : -1;
+}
+
+int
+tls_record_write_close_notify (tls_record_t *r, svm_fifo_t *ts_f)
+{
+  tls_record_per_thread_t *ptd;
+  u8 alert[2] = { 1 /* warning */, 0 /* close_notify */ };
+
+  ptd = vec_elt_at_index (tls_record_main.wrk, vlib_get_thread_index ());
+  return tls_record_write_ctrl (r, ptd, ts_f, TLS_RECORD_TYPE_ALERT, alert,
+				sizeof (alert));
+}
+
+int
+tls_record_write (tls_record_t *r, svm_fifo_t *app_f, svm_fifo_t *ts_f,
+		  u32 max_bytes)
+{
+  u8 key_update[5] = { TLS_HS_TYPE_KEY_UPDATE, 0, 0, 1, 0 };
+  svm_fifo_seg_t src[TLS_RECORD_MAX_SEGS];
+  u32 n_src = TLS_RECORD_MAX_SEGS;
+  tls_record_per_thread_t *ptd;
+  int len, rv;
+
+  ptd = vec_elt_at_index (tls_record_main.wrk, vlib_get_thread_index ());
+
+  if (PREDICT_FALSE (r->tx.key_pending))
+    return 0;
+
+  /* Peer updated its keys and asked us to do the same. Records that
+   * follow wait for the new key */
+  if (PREDICT_FALSE (r->key_update_pending))
+    {
+      if (tls_record_write_ctrl (r, ptd, ts_f, TLS_RECORD_TYPE_HANDSHAKE,
+				 key_update, sizeof (key_update)))
+	return 0;
+      tls_record_tls13_update (r, &r->tx);
+      r->key_update_pending = 0;
+      return 0;
+    }
+
+  len = svm_fifo_segments (app_f, 0, src, &n_src, max_bytes);
+  if (len <= 0)
+    return 0;
+
+  rv = tls_record_encrypt (r, ptd, src, len, TLS_RECORD_TYPE_APP_DATA, ts_f);
+  if (rv > 0)
+    svm_fifo_dequeue_drop (app_f, rv);
+
+  return rv;
+}
+
+static int
+tls_record_handle_ctrl (tls_record_t *r, u8 type, svm_fifo_seg_t *segs,
+			u32 offset, u32 len)
+{
+  u8 msg[5];
+
+  switch (type)
+    {
+    case TLS_RECORD_TYPE_ALERT:
+      if (len != 2)
+	return -1;
+      tls_record_segs_copy (segs, offset, msg, 2, 0 /* is_write */);
+      /* close_notify is followed by transport close, anything else is
+       * fatal for us */
+      return msg[1] == 0 ? 0 : -1;
+    case TLS_RECORD_TYPE_HANDSHAKE:
+      tls_record_segs_copy (segs, offset, msg, clib_min (len, sizeof (msg)),
+			    0 /* is_write */);
+      if (r->is_tls13 && len >= sizeof (msg) &&
+	  msg[0] == TLS_HS_TYPE_KEY_UPDATE)
+	{
+	  tls_record_tls13_update (r, &r->rx);
+	  r->key_update_pending = msg[4] == 1;
+	}
+      /* Tickets are not used and renegotiation is not supported */
+      return 0;
+    default:
+      return -1;
+    }
+}
+
+int
+tls_record_read (tls_record_t *r, svm_fifo_t *ts_f, svm_fifo_t *app_f)
+{
+  u32 expl = r->is_tls13 ? 0 : TLS_RECORD_TLS12_NONCE_LEN;
+  u32 ovh = expl + r->is_tls13 + TLS_RECORD_TAG_LEN;
+  u32 n_src, src_len, dst_len, src_off, dst_off, len, pt_len, n, i;
+  u32 enq, deq, si, so;
+  svm_fifo_seg_t src[TLS_RECORD_MAX_SEGS], dst[TLS_RECORD_MAX_SEGS];
+  int n_enq = 0, n_dst, rv;
+  tls_record_per_thread_t *ptd;
+  vnet_crypto_op_chunk_t *ch;
+  tls_record_op_data_t *od;
+  u8 hdr[TLS_RECORD_HDR_LEN];
+  vnet_crypto_op_t *op;
+  u8 type, stop;
+
+  ptd = vec_elt_at_index (tls_record_main.wrk, vlib_get_thread_index ());
+
+again:
+
+  if (PREDICT_FALSE (r->rx.key_pending))
+    return n_enq;
+
+  n_src = TLS_RECORD_MAX_SEGS;
+  rv = svm_fifo_segments (ts_f, 0, src, &n_src, ~0);
+  if (rv < TLS_RECORD_HDR_LEN)
+    return n_enq;
+  src_len = rv;
+
+  dst_len = clib_min (svm_fifo_max_enqueue_prod (app_f), src_len);
+  if (!dst_len)
+    return n_enq;
+  n_dst = svm_fifo_provision_chunks (app_f, dst, TLS_RECORD_MAX_SEGS, dst_len);
+  if (n_dst <= 0)
+    return n_enq;
+  for (i = 0, dst_len = 0; i < n_dst; i++)
+    dst_len += dst[i].len;
+
+  vec_reset_length (ptd->chunks);
+  src_off = dst_off = n = 0;
+
+  while (n < TLS_RECORD_BATCH && src_off + TLS_RECORD_HDR_LEN <= src_len)
+    {
+      tls_record_segs_copy (src, src_off, hdr, TLS_RECORD_HDR_LEN, 0);
+      len = (hdr[3] << 8) | hdr[4];
+      if (hdr[1] != 3 || len < ovh || len > TLS_RECORD_MAX_PLAINTEXT + 256)
+	return -1;
+      if (r->is_tls13 ? hdr[0] != TLS_RECORD_TYPE_APP_DATA :
+			(hdr[0] < TLS_RECORD_TYPE_ALERT ||
+			 hdr[0] > TLS_RECORD_TYPE_APP_DATA))
+	return -1;
+      if (src_off + TLS_RECORD_HDR_LEN + len > src_len)
+	break;
+      pt_len = len - ovh;
+      if (dst_off + pt_len > dst_len)
+	break;
+
+      od = &ptd->op_data[n];
+      op = &ptd->ops[n];
+
+      if (r->is_tls13)
+	{
+	  tls_record_build_iv (r, &r->rx, r->rx.seq + n, od->iv);
+	  clib_memcpy_fast (od->aad, hdr, TLS_RECORD_HDR_LEN);
+	  op->aad_len = TLS_RECORD_HDR_LEN;
+	}
+      else
+	{
+	  clib_memcpy_fast (od->iv, r->rx.iv, 4);
+	  tls_record_segs_copy (src, src_off + TLS_RECORD_HDR_LEN, od->iv + 4,
+				expl, 0);
+	  *(u64u *) od->aad = clib_host_to_net_u64 (r->rx.seq + n);
+	  tls_record_build_hdr (od->aad + 8, hdr[0], pt_len);
+	  op->aad_len = 13;
+	}
+      tls_record_segs_copy (src, src_off + TLS_RECORD_HDR_LEN + len -
+				   TLS_RECORD_TAG_LEN,
+			    od->tag, TLS_RECORD_TAG_LEN, 0);
+
+      vnet_crypto_op_init (op, r->dec_op);
+      op->flags |= VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS;
+      op->key_index = r->rx.key_index;
+      op->iv = od->iv;
+      op->aad = od->aad;
+      op->tag = od->tag;
+      op->tag_len = TLS_RECORD_TAG_LEN;
+      op->chunk_index = vec_len (ptd->chunks);
+      op->n_chunks = tls_record_add_chunks (&ptd->chunks, src,
+					    src_off + TLS_RECORD_HDR_LEN + expl,
+					    dst, dst_off, pt_len);
+      if (r->is_tls13)
+	{
+	  /* Inner content type is decrypted out of the app fifo, so records
+	   * can be laid out back to back */
+	  tls_record_segs_seek (src, src_off + TLS_RECORD_HDR_LEN + pt_len,
+				&si, &so);
+	  vec_add2 (ptd->chunks, ch, 1);
+	  ch->src = src[si].data + so;
+	  ch->dst = &od->type[1];
+	  ch->len = 1;
+	  op->n_chunks += 1;
+	}
+      od->type[0] = hdr[0];
+      od->len = pt_len;
+      od->rec_len = TLS_RECORD_HDR_LEN + len;
+      od->dst_offset = dst_off;
+
+      src_off += TLS_RECORD_HDR_LEN + len;
+      dst_off += pt_len;
+      n += 1;
+    }
+
+  if (!n)
+    return n_enq;
+
+  vnet_crypto_process_chained_ops (vlib_get_main (), ptd->ops, ptd->chunks,
+				   n);
+
+  enq = deq = stop = 0;
+  for (i = 0; i < n; i++)
+    {
+      od = &ptd->op_data[i];
+      if (PREDICT_FALSE (ptd->ops[i].status != VNET_CRYPTO_OP_STATUS_COMPLETED))
+	{
+	  ptd->n_crypto_errors += 1;
+	  return -1;
+	}
+
+      type = od->type[0];
+      len = od->len;
+      if (r->is_tls13)
+	{
+	  type = od->type[1];
+	  if (PREDICT_FALSE (!type))
+	    {
+	      /* Padded record. Content type is somewhere in the app fifo
+	       * and following records were decrypted at the wrong offset,
+	       * so handle it first in a batch of its own */
+	      if (i)
+		{
+		  stop = 1;
+		  break;
+		}
+	      while (len && !type)
+		tls_record_segs_copy (dst, od->dst_offset + --len, &type, 1,
+				      0 /* is_write */);
+	      if (!type)
+		return -1;
+	      stop = 1;
+	    }
+	}
+
+      r->rx.seq += 1;
+      deq += od->rec_len;
+      ptd->n_records_decrypted += 1;
+
+      if (PREDICT_TRUE (type == TLS_RECORD_TYPE_APP_DATA))
+	{
+	  enq += len;
+	  if (stop)
+	    break;
+	  continue;
+	}
+
+      /* Control record may change keys, restart batch after it */
+      if (tls_record_handle_ctrl (r, type, dst, od->dst_offset, len))
+	return -1;
+      stop = 1;
+      break;
+    }
+
+  if (enq)
+    svm_fifo_enqueue_nocopy (app_f, enq);
+  svm_fifo_dequeue_drop (ts_f, deq);
+  n_enq += enq;
+
+  if (stop || n == TLS_RECORD_BATCH)
+    goto again;
+
+  return n_enq;
+}
+
+int
+tls_record_rx_pending (tls_record_t *r, svm_fifo_t *ts_f, svm_fifo_t *app_f)
+{
+  u32 expl = r->is_tls13 ? 0 : TLS_RECORD_TLS12_NONCE_LEN;
+  u32 ovh = expl + r->is_tls13 + TLS_RECORD_TAG_LEN;
+  u8 hdr[TLS_RECORD_HDR_LEN];
+  u32 max_deq, len;
+
+  /* the rpc that adds the key brings the ctx back */
+  if (r->rx.key_pending)
+    return 0;
+
+  max_deq = svm_fifo_max_dequeue_cons (ts_f);
+  if (max_deq < TLS_RECORD_HDR_LEN)
+    return 0;
+
+  svm_fifo_peek (ts_f, 0, TLS_RECORD_HDR_LEN, hdr);
+  len = (hdr[3] << 8) | hdr[4];
+  if (max_deq < TLS_RECORD_HDR_LEN + len)
+    return 0;
+
+  if (len > ovh && svm_fifo_max_enqueue_prod (app_f) < len - ovh)
+    return -1;
+  return 1;
+}
+
+void
+tls_record_enable (vlib_main_t *vm)
+{
+  vlib_thread_main_t *vtm = vlib_get_thread_main ();
+  tls_record_main_t *trm = &tls_record_main;
+
+  if (trm->wrk)
+    return;
+
+  vec_validate_aligned (trm->wrk, vtm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+}
+
+static clib_error_t *
+show_tls_record_offload_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				    vlib_cli_command_t *cmd)
+{
+  tls_record_main_t *trm = &tls_record_main;
+  u64 n_enc = 0, n_dec = 0, n_err = 0;
+  tls_record_per_thread_t *ptd;
+
+  if (!trm->wrk)
+    {
+      vlib_cli_output (vm, "record offload not enabled");
+      return 0;
+    }
+
+  vec_foreach (ptd, trm->wrk)
+    {
+      n_enc += ptd->n_records_encrypted;
+      n_dec += ptd->n_records_decrypted;
+      n_err += ptd->n_crypto_errors;
+    }
+
+  vlib_cli_output (vm, "records encrypted: %lu", n_enc);
+  vlib_cli_output (vm, "records decrypted: %lu", n_dec);
+  vlib_cli_output (vm, "crypto errors: %lu", n_err);
+  vlib_cli_output (vm, "crypto keys: %u", trm->n_keys);
+
+  return 0;
+}
+
+/*?
+ * Show the records tls record offload encrypted and decrypted through
+ * vnet crypto, and the per connection crypto keys in use.
+ *
+ * @cliexpar
+ * @cliexstart{show tls record-offload}
+ * records encrypted: 6401
+ * records decrypted: 6401
+ * crypto errors: 0
+ * crypto keys: 4
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (show_tls_record_offload_command, static) = {
+  .path = "show tls record-offload",
+  .short_help = "show tls record-offload",
+  .function = show_tls_record_offload_command_fn,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VNET_TLS_TLS_RECORD_H_
+#define SRC_VNET_TLS_TLS_RECORD_H_
+
+#include <vnet/crypto/crypto.h>
+#include <svm/svm_fifo.h>
+#include <vppinfra/sha2.h>
+
+/*
+ * TLS record offload
+ *
+ * Once an engine finishes the handshake it hands the negotiated traffic
+ * secrets to the record layer, which from then on frames, encrypts and
+ * decrypts application data records itself. Records are built directly
+ * from the app's tx fifo into the transport's tx fifo, and decrypted from
+ * the transport's rx fifo into the app's rx fifo, with vnet crypto chained
+ * AES-GCM ops whose chunks point at the fifo chunks. All records that fit
+ * in one read or write call are handed to vnet crypto as one batch.
+ *
+ * Each ctx has its own crypto keys, for tx and rx. Keys can only be added
+ * or changed on the main thread, so the engine asks for them with an rpc
+ * when the handshake completes and records wait until they are in. The
+ * same goes for tls 1.3 key updates.
+ *
+ * Only TLS 1.2 and TLS 1.3 with AES-128-GCM or AES-256-GCM are supported.
+ */
+
+#define TLS_RECORD_HDR_LEN		5
+#define TLS_RECORD_TAG_LEN		16
+#define TLS_RECORD_TLS12_NONCE_LEN	8
+#define TLS_RECORD_MAX_PLAINTEXT	(1 << 14)
+#define TLS_RECORD_MAX_SECRET		SHA384_DIGEST_SIZE
+#define TLS_RECORD_BATCH		32
+#define TLS_RECORD_MAX_SEGS		64
+
+typedef enum tls_record_type_
+{
+  TLS_RECORD_TYPE_CCS = 20,
+  TLS_RECORD_TYPE_ALERT = 21,
+  TLS_RECORD_TYPE_HANDSHAKE = 22,
+  TLS_RECORD_TYPE_APP_DATA = 23,
+} tls_record_type_t;
+
+typedef struct tls_record_keys_
+{
+  u8 key[32];
+  /* static iv for tls 1.3, implicit salt in first 4 bytes for tls 1.2 */
+  u8 iv[12];
+  /* tls 1.3 traffic secret, needed for key updates */
+  u8 secret[TLS_RECORD_MAX_SECRET];
+  u64 seq;
+  /* vnet crypto key, ~0 until added on the main thread */
+  u32 key_index;
+  /* key material changed, the crypto key must be added or updated */
+  u8 key_pending;
+} tls_record_keys_t;
+
+typedef struct tls_record_
+{
+  tls_record_keys_t tx;
+  tls_record_keys_t rx;
+  vnet_crypto_op_id_t enc_op:16;
+  vnet_crypto_op_id_t dec_op:16;
+  clib_sha2_type_t hash:8;
+  u8 key_len;
+  u8 secret_len;
+  u8 is_tls13;
+  u8 is_active;
+  u8 key_update_pending;
+  /* the engine asked the main thread for the pending keys */
+  u8 keys_requested;
+  /* unique id, tells a stale keys rpc from the ctx's own */
+  u64 id;
+} tls_record_t;
+
+typedef struct tls_record_op_data_
+{
+  u8 iv[12];
+  u8 aad[13];
+  /* tls 1.3 inner content type, plaintext and ciphertext */
+  u8 type[2];
+  u8 tag[TLS_RECORD_TAG_LEN];
+  u32 len;
+  u32 rec_len;
+  u32 dst_offset;
+} tls_record_op_data_t;
+
+typedef struct tls_record_per_thread_
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  vnet_crypto_op_t ops[TLS_RECORD_BATCH];
+  tls_record_op_data_t op_data[TLS_RECORD_BATCH];
+  vnet_crypto_op_chunk_t *chunks;
+  u64 n_records_encrypted;
+  u64 n_records_decrypted;
+  u64 n_crypto_errors;
+} tls_record_per_thread_t;
+
+typedef struct tls_record_main_
+{
+  tls_record_per_thread_t *wrk;
+  u64 record_id;
+  /* crypto keys in use */
+  u32 n_keys;
+} tls_record_main_t;
+
+extern tls_record_main_t tls_record_main;
+
+/**
+ * Allocate per thread crypto state. Called on the main thread when tls is
+ * enabled with record offload configured.
+ */
+void tls_record_enable (vlib_main_t *vm);
+
+/**
+ * Check if vnet crypto can serve record offload for a cipher
+ *
+ * @param alg	aead algorithm, AES-128-GCM or AES-256-GCM
+ * @return	1 if chained encrypt and decrypt handlers are available
+ */
+int tls_record_alg_is_supported (vnet_crypto_alg_t alg);
+
+/**
+ * Init tls 1.3 record state from the application traffic secrets
+ */
+int tls_record_init_tls13 (tls_record_t *r, vnet_crypto_alg_t alg,
+			   clib_sha2_type_t hash, const u8 *tx_secret,
+			   const u8 *rx_secret, u8 secret_len);
+
+/**
+ * Init tls 1.2 record state from the master secret and hello randoms
+ */
+int tls_record_init_tls12 (tls_record_t *r, vnet_crypto_alg_t alg,
+			   clib_sha2_type_t hash, const u8 *master_secret,
+			   const u8 *client_random, const u8 *server_random,
+			   u8 is_server);
+
+/**
+ * Check if the record waits for crypto keys from the main thread
+ */
+static inline int
+tls_record_keys_pending (tls_record_t *r)
+{
+  return r->tx.key_pending || r->rx.key_pending;
+}
+
+/**
+ * Add or update the crypto keys of a record. Called on the main thread,
+ * with the workers at the barrier.
+ */
+void tls_record_keys_add (vlib_main_t *vm, tls_record_t *r);
+
+/**
+ * Wipe record state key material and free its crypto keys
+ */
+void tls_record_free (tls_record_t *r);
+
+/**
+ * Encrypt app data into records
+ *
+ * @param r		record state
+ * @param app_f		app tx fifo, data is dequeued from it
+ * @param ts_f		transport tx fifo, records are enqueued into it
+ * @param max_bytes	max app bytes to dequeue
+ * @return		app bytes dequeued or negative on error
+ */
+int tls_record_write (tls_record_t *r, svm_fifo_t *app_f, svm_fifo_t *ts_f,
+		      u32 max_bytes);
+
+/**
+ * Decrypt records into app data
+ *
+ * Decrypts all full records in the transport's rx fifo that fit into the
+ * app's rx fifo. Alerts and post-handshake messages are consumed.
+ *
+ * @param r		record state
+ * @param ts_f		transport rx fifo, records are dequeued from it
+ * @param app_f		app rx fifo, app data is enqueued into it
+ * @return		app bytes enqueued or negative on error
+ */
+int tls_record_read (tls_record_t *r, svm_fifo_t *ts_f, svm_fifo_t *app_f);
+
+/**
+ * Check if a full record is waiting in the transport's rx fifo and its
+ * plaintext fits in the app's rx fifo
+ *
+ * @return		1 if the record can be decrypted, -1 if it waits
+ *			for room in the app's rx fifo, 0 otherwise
+ */
+int tls_record_rx_pending (tls_record_t *r, svm_fifo_t *ts_f,
+			   svm_fifo_t *app_f);
+
+/**
+ * Enqueue a close_notify alert into the transport's tx fifo
+ */
+int tls_record_write_close_notify (tls_record_t *r, svm_fifo_t *ts_f);
+
+#endif /* SRC_VNET_TLS_TLS_RECORD_H_ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -773,6 +773,53 @@ update_node_counters (stat_segment_main_t * sm)
   vec_free (stat_vms);
 }
 
+/*
+ * Barrier timings by caller, see vlib_barrier_caller_stats_t:
+ * open, close, hold [caller][log2 microseconds]
+ */
+static void
+update_barrier_histograms (stat_segment_main_t *sm)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_barrier_caller_stats_t *bs;
+  u32 n_callers = vec_len (tm->barrier_stats);
+  counter_t **counters;
+  u32 i;
+
+  if (n_callers > vec_len (sm->barrier_callers))
+    {
+      void *oldheap = clib_mem_set_heap (sm->heap);
+      vlib_stat_segment_lock ();
+
+#define _(E, t, name, p)                                                      \
+  stat_validate_counter_vector2 (&sm->directory_vector[STAT_COUNTER_##E],    \
+				 n_callers - 1,                              \
+				 VLIB_BARRIER_HIST_N_BUCKETS - 1);
+      foreach_stat_segment_barrier_counter_name
+#undef _
+
+	for (i = vec_len (sm->barrier_callers); i < n_callers; i++)
+	  vec_add1 (sm->barrier_callers,
+		    format (0, "%s%c", tm->barrier_stats[i].caller, 0));
+      sm->directory_vector[STAT_COUNTER_BARRIER_NAMES].data =
+	sm->barrier_callers;
+
+      vlib_stat_segment_unlock ();
+      clib_mem_set_heap (oldheap);
+    }
+
+  vec_foreach_index (i, tm->barrier_stats)
+    {
+      bs = vec_elt_at_index (tm->barrier_stats, i);
+#define _(E, n, s)                                                            \
+  counters = sm->directory_vector[STAT_COUNTER_BARRIER_##E].data;            \
+  clib_memcpy_fast (counters[i], bs->hist[VLIB_BARRIER_HIST_##E],            \
+		    sizeof (bs->hist[0]));
+      foreach_vlib_barrier_hist
+#undef _
+    }
+}
+
 static void
 do_stat_segment_updates (vlib_main_t *vm, stat_segment_main_t *sm)
 {
@@ -811,6 +858,8 @@ do_stat_segment_updates (vlib_main_t *vm, stat_segment_main_t *sm)
   if (sm->node_counters_enabled)
     update_node_counters (sm);
 
+  update_barrier_histograms (sm);
+
   /* *INDENT-OFF* */
   stat_segment_gauges_pool_t *g;
   pool_foreach (g, sm->gauges)
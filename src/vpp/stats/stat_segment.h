@@ -33,6 +33,10 @@ typedef enum
   STAT_COUNTER_NODE_SUSPENDS,
   STAT_COUNTER_INTERFACE_NAMES,
   STAT_COUNTER_NODE_NAMES,
+  STAT_COUNTER_BARRIER_OPEN,
+  STAT_COUNTER_BARRIER_CLOSE,
+  STAT_COUNTER_BARRIER_HOLD,
+  STAT_COUNTER_BARRIER_NAMES,
   STAT_COUNTERS
 } stat_segment_counter_t;
 
@@ -43,6 +47,12 @@ typedef enum
   _ (NODE_CALLS, COUNTER_VECTOR_SIMPLE, calls, /sys/node)                     \
   _ (NODE_SUSPENDS, COUNTER_VECTOR_SIMPLE, suspends, /sys/node)
 
+/* [caller][log2 microseconds], see foreach_vlib_barrier_hist */
+#define foreach_stat_segment_barrier_counter_name                             \
+  _ (BARRIER_OPEN, COUNTER_VECTOR_SIMPLE, open, /sys/barrier)                 \
+  _ (BARRIER_CLOSE, COUNTER_VECTOR_SIMPLE, close, /sys/barrier)               \
+  _ (BARRIER_HOLD, COUNTER_VECTOR_SIMPLE, hold, /sys/barrier)
+
 #define foreach_stat_segment_counter_name                                     \
   _ (NUM_WORKER_THREADS, SCALAR_INDEX, num_worker_threads, /sys)              \
   _ (INPUT_RATE, SCALAR_INDEX, input_rate, /sys)                              \
@@ -51,7 +61,9 @@ typedef enum
   _ (HEARTBEAT, SCALAR_INDEX, heartbeat, /sys)                                \
   _ (INTERFACE_NAMES, NAME_VECTOR, names, /if)                                \
   _ (NODE_NAMES, NAME_VECTOR, names, /sys/node)                               \
-  foreach_stat_segment_node_counter_name
+  _ (BARRIER_NAMES, NAME_VECTOR, names, /sys/barrier)                         \
+  foreach_stat_segment_node_counter_name                                      \
+  foreach_stat_segment_barrier_counter_name
 /* clang-format on */
 
 /* Default stat segment 32m */
@@ -81,6 +93,7 @@ typedef struct
   volatile u64 **error_vector;
   u8 **interfaces;
   u8 **nodes;
+  u8 **barrier_callers;
 
   /* Update interval */
   f64 update_interval;
@@ -133,6 +133,17 @@ static inline void *BV (alloc_aligned) (BVT (clib_bihash) * h, uword nbytes)
   return (void *) (uword) (rv + alloc_arena (h));
 }
 
+static void BV (clib_bihash_thread_caches_init) (BVT (clib_bihash) * h,
+						 u32 n_threads)
+{
+  BVT (clib_bihash_thread_cache) * tc;
+
+  /* plus the one shared by the other threads */
+  vec_validate_aligned (h->thread_caches, n_threads, CLIB_CACHE_LINE_BYTES);
+  vec_foreach (tc, h->thread_caches)
+    tc->working_copy_length = -1;
+}
+
 static void BV (clib_bihash_instantiate) (BVT (clib_bihash) * h)
 {
   uword bucket_size;
@@ -184,6 +195,7 @@ static void BV (clib_bihash_instantiate) (BVT (clib_bihash) * h)
 			 sizeof (BVT (clib_bihash_kv))));
 	}
     }
+  BV (clib_bihash_thread_caches_init) (h, os_get_nthreads ());
   CLIB_MEMORY_STORE_BARRIER ();
   h->instantiated = 1;
 }
@@ -333,6 +345,8 @@ void BV (clib_bihash_initiator_init_svm)
     (u64) BV (clib_bihash_get_offset) (h, freelist_vh->vector_data);
   h->freelists = (void *) (freelist_vh->vector_data);
 
+  BV (clib_bihash_thread_caches_init) (h, 0);
+
   h->fmt_fn = BV (format_bihash);
   h->kvp_fmt_fn = NULL;
   h->instantiated = 1;
@@ -384,6 +398,7 @@ void BV (clib_bihash_responder_init_svm)
 
   h->alloc_lock = BV (clib_bihash_get_value) (h, h->sh->alloc_lock_as_u64);
   h->freelists = BV (clib_bihash_get_value) (h, h->sh->freelists_as_u64);
+  BV (clib_bihash_thread_caches_init) (h, 0);
   h->fmt_fn = BV (format_bihash);
   h->kvp_fmt_fn = NULL;
 }
@@ -424,8 +439,7 @@ void BV (clib_bihash_free) (BVT (clib_bihash) * h)
       clib_mem_set_heap (oldheap);
     }
 
-  vec_free (h->working_copies);
-  vec_free (h->working_copy_lengths);
+  vec_free (h->thread_caches);
   clib_mem_free ((void *) h->alloc_lock);
 #if BIHASH_32_64_SVM == 0
   vec_free (h->freelists);
@@ -455,9 +469,53 @@ never_initialized:
 		(u64) (uword) h);
 }
 
+static inline BVT (clib_bihash_thread_cache) *
+BV (clib_bihash_get_thread_cache) (BVT (clib_bihash) * h)
+{
+  uword n_threads = vec_len (h->thread_caches) - 1;
+  uword thread_index = os_get_thread_index ();
+
+  return h->thread_caches + clib_min (thread_index, n_threads);
+}
+
+static inline int
+BV (thread_cache_is_shared) (BVT (clib_bihash) * h,
+			     BVT (clib_bihash_thread_cache) * tc)
+{
+  return tc == vec_end (h->thread_caches) - 1;
+}
+
+/* The shared thread cache is only used under the alloc_lock */
+static inline void
+BV (thread_cache_lock) (BVT (clib_bihash) * h,
+			BVT (clib_bihash_thread_cache) * tc)
+{
+  if (BV (thread_cache_is_shared) (h, tc))
+    BV (clib_bihash_alloc_lock) (h);
+}
+
+static inline void
+BV (thread_cache_unlock) (BVT (clib_bihash) * h,
+			  BVT (clib_bihash_thread_cache) * tc)
+{
+  if (BV (thread_cache_is_shared) (h, tc))
+    BV (clib_bihash_alloc_unlock) (h);
+}
+
+static inline int
+BV (thread_cache_holds) (u32 log2_pages)
+{
+  if (log2_pages >= BIHASH_THREAD_CACHE_N_LOG2_PAGES)
+    return 0;
+  /* those are heap chunks of their own, given back to the heap on free */
+  if (BIHASH_USE_HEAP && log2_pages >= BIIHASH_MIN_ALLOC_LOG2_PAGES)
+    return 0;
+  return 1;
+}
+
 static
 BVT (clib_bihash_value) *
-BV (value_alloc) (BVT (clib_bihash) * h, u32 log2_pages)
+BV (freelist_alloc) (BVT (clib_bihash) * h, u32 log2_pages)
 {
   BVT (clib_bihash_value) * rv = 0;
 
@@ -488,8 +546,8 @@ initialize:
 }
 
 static void
-BV (value_free) (BVT (clib_bihash) * h, BVT (clib_bihash_value) * v,
-		 u32 log2_pages)
+BV (freelist_free) (BVT (clib_bihash) * h, BVT (clib_bihash_value) * v,
+		    u32 log2_pages)
 {
   ASSERT (h->alloc_lock[0]);
 
@@ -524,32 +582,150 @@ BV (value_free) (BVT (clib_bihash) * h, BVT (clib_bihash_value) * v,
   h->freelists[log2_pages] = (u64) BV (clib_bihash_get_offset) (h, v);
 }
 
+static void
+BV (thread_cache_refill) (BVT (clib_bihash) * h,
+			  BVT (clib_bihash_thread_cache) * tc, u32 log2_pages)
+{
+  BVT (clib_bihash_value) * v;
+  uword stride;
+  u32 i, n = clib_max (BIHASH_THREAD_CACHE_REFILL >> log2_pages, 1);
+
+  BV (clib_bihash_alloc_lock) (h);
+
+  vec_validate_init_empty (h->freelists, log2_pages, 0);
+
+  /* take pages freed by the other threads first */
+  while (h->freelists[log2_pages] && tc->n_free[log2_pages] < n)
+    {
+      v = BV (clib_bihash_get_value) (h, h->freelists[log2_pages]);
+      h->freelists[log2_pages] = v->next_free_as_u64;
+      v->next_free_as_u64 = tc->freelists[log2_pages];
+      tc->freelists[log2_pages] = BV (clib_bihash_get_offset) (h, v);
+      tc->n_free[log2_pages]++;
+    }
+
+  if (tc->n_free[log2_pages] == 0)
+    {
+      /* same layout as n separate allocations */
+      stride = round_pow2 (sizeof (*v) << log2_pages, CLIB_CACHE_LINE_BYTES);
+      v = BV (alloc_aligned) (h, stride * n);
+      for (i = 0; i < n; i++)
+	{
+	  v->next_free_as_u64 = tc->freelists[log2_pages];
+	  tc->freelists[log2_pages] = BV (clib_bihash_get_offset) (h, v);
+	  v = (void *) ((u8 *) v + stride);
+	}
+      tc->n_free[log2_pages] = n;
+    }
+
+  BV (clib_bihash_alloc_unlock) (h);
+}
+
+static void
+BV (thread_cache_flush) (BVT (clib_bihash) * h,
+			 BVT (clib_bihash_thread_cache) * tc, u32 log2_pages,
+			 u32 n)
+{
+  BVT (clib_bihash_value) * v;
+
+  BV (clib_bihash_alloc_lock) (h);
+
+  vec_validate_init_empty (h->freelists, log2_pages, 0);
+
+  while (n--)
+    {
+      v = BV (clib_bihash_get_value) (h, tc->freelists[log2_pages]);
+      tc->freelists[log2_pages] = v->next_free_as_u64;
+      tc->n_free[log2_pages]--;
+      v->next_free_as_u64 = h->freelists[log2_pages];
+      h->freelists[log2_pages] = BV (clib_bihash_get_offset) (h, v);
+    }
+
+  BV (clib_bihash_alloc_unlock) (h);
+}
+
+static
+BVT (clib_bihash_value) *
+BV (value_alloc) (BVT (clib_bihash) * h, BVT (clib_bihash_thread_cache) * tc,
+		  u32 log2_pages)
+{
+  BVT (clib_bihash_value) * rv;
+
+  if (BV (thread_cache_is_shared) (h, tc))
+    return BV (freelist_alloc) (h, log2_pages);
+
+  if (!BV (thread_cache_holds) (log2_pages))
+    {
+      BV (clib_bihash_alloc_lock) (h);
+      rv = BV (freelist_alloc) (h, log2_pages);
+      BV (clib_bihash_alloc_unlock) (h);
+      return rv;
+    }
+
+  if (tc->n_free[log2_pages] == 0)
+    BV (thread_cache_refill) (h, tc, log2_pages);
+
+  rv = BV (clib_bihash_get_value) (h, tc->freelists[log2_pages]);
+  tc->freelists[log2_pages] = rv->next_free_as_u64;
+  tc->n_free[log2_pages]--;
+
+  clib_memset_u8 (rv, 0xff, sizeof (*rv) * (1 << log2_pages));
+  return rv;
+}
+
+static void
+BV (value_free) (BVT (clib_bihash) * h, BVT (clib_bihash_thread_cache) * tc,
+		 BVT (clib_bihash_value) * v, u32 log2_pages)
+{
+  u32 n = clib_max (BIHASH_THREAD_CACHE_REFILL >> log2_pages, 1);
+
+  if (BV (thread_cache_is_shared) (h, tc))
+    {
+      BV (freelist_free) (h, v, log2_pages);
+      return;
+    }
+
+  if (!BV (thread_cache_holds) (log2_pages))
+    {
+      BV (clib_bihash_alloc_lock) (h);
+      BV (freelist_free) (h, v, log2_pages);
+      BV (clib_bihash_alloc_unlock) (h);
+      return;
+    }
+
+  if (CLIB_DEBUG > 0)
+    clib_memset_u8 (v, 0xFE, sizeof (*v) * (1 << log2_pages));
+
+  v->next_free_as_u64 = tc->freelists[log2_pages];
+  tc->freelists[log2_pages] = BV (clib_bihash_get_offset) (h, v);
+  tc->n_free[log2_pages]++;
+
+  /* a thread which mostly deletes gives pages back to the others */
+  if (tc->n_free[log2_pages] >= 2 * n)
+    BV (thread_cache_flush) (h, tc, log2_pages, n);
+}
+
 static inline void
-BV (make_working_copy) (BVT (clib_bihash) * h, BVT (clib_bihash_bucket) * b)
+BV (make_working_copy) (BVT (clib_bihash) * h,
+			BVT (clib_bihash_thread_cache) * tc,
+			BVT (clib_bihash_bucket) * b)
 {
   BVT (clib_bihash_value) * v;
   BVT (clib_bihash_bucket) working_bucket __attribute__ ((aligned (8)));
   BVT (clib_bihash_value) * working_copy;
-  u32 thread_index = os_get_thread_index ();
   int log2_working_copy_length;
 
-  ASSERT (h->alloc_lock[0]);
-
-  if (thread_index >= vec_len (h->working_copies))
-    {
-      vec_validate (h->working_copies, thread_index);
-      vec_validate_init_empty (h->working_copy_lengths, thread_index, ~0);
-    }
+  ASSERT (!BV (thread_cache_is_shared) (h, tc) || h->alloc_lock[0]);
 
   /*
    * working_copies are per-cpu so that near-simultaneous
    * updates from multiple threads will not result in sporadic, spurious
    * lookup failures.
    */
-  working_copy = h->working_copies[thread_index];
-  log2_working_copy_length = h->working_copy_lengths[thread_index];
+  working_copy = tc->working_copy;
+  log2_working_copy_length = tc->working_copy_length;
 
-  h->saved_bucket.as_u64 = b->as_u64;
+  tc->saved_bucket.as_u64 = b->as_u64;
 
   if (b->log2_pages > log2_working_copy_length)
     {
@@ -558,10 +734,14 @@ BV (make_working_copy) (BVT (clib_bihash) * h, BVT (clib_bihash_bucket) * b)
        *   if (working_copy)
        *     clib_mem_free (working_copy);
        */
+      if (!BV (thread_cache_is_shared) (h, tc))
+	BV (clib_bihash_alloc_lock) (h);
       working_copy = BV (alloc_aligned)
 	(h, sizeof (working_copy[0]) * (1 << b->log2_pages));
-      h->working_copy_lengths[thread_index] = b->log2_pages;
-      h->working_copies[thread_index] = working_copy;
+      if (!BV (thread_cache_is_shared) (h, tc))
+	BV (clib_bihash_alloc_unlock) (h);
+      tc->working_copy_length = b->log2_pages;
+      tc->working_copy = working_copy;
 
       BV (clib_bihash_increment_stat) (h, BIHASH_STAT_working_copy_lost,
 				       1ULL << b->log2_pages);
@@ -574,22 +754,21 @@ BV (make_working_copy) (BVT (clib_bihash) * h, BVT (clib_bihash_bucket) * b)
   working_bucket.offset = BV (clib_bihash_get_offset) (h, working_copy);
   CLIB_MEMORY_STORE_BARRIER ();
   b->as_u64 = working_bucket.as_u64;
-  h->working_copies[thread_index] = working_copy;
 }
 
 static
 BVT (clib_bihash_value) *
 BV (split_and_rehash)
-  (BVT (clib_bihash) * h,
+  (BVT (clib_bihash) * h, BVT (clib_bihash_thread_cache) * tc,
    BVT (clib_bihash_value) * old_values, u32 old_log2_pages,
    u32 new_log2_pages)
 {
   BVT (clib_bihash_value) * new_values, *new_v;
   int i, j, length_in_kvs;
 
-  ASSERT (h->alloc_lock[0]);
+  ASSERT (!BV (thread_cache_is_shared) (h, tc) || h->alloc_lock[0]);
 
-  new_values = BV (value_alloc) (h, new_log2_pages);
+  new_values = BV (value_alloc) (h, tc, new_log2_pages);
   length_in_kvs = (1 << old_log2_pages) * BIHASH_KVP_PER_PAGE;
 
   for (i = 0; i < length_in_kvs; i++)
@@ -617,7 +796,7 @@ BV (split_and_rehash)
 	    }
 	}
       /* Crap. Tell caller to try again */
-      BV (value_free) (h, new_values, new_log2_pages);
+      BV (value_free) (h, tc, new_values, new_log2_pages);
       return 0;
     doublebreak:;
     }
@@ -628,16 +807,16 @@ BV (split_and_rehash)
 static
 BVT (clib_bihash_value) *
 BV (split_and_rehash_linear)
-  (BVT (clib_bihash) * h,
+  (BVT (clib_bihash) * h, BVT (clib_bihash_thread_cache) * tc,
    BVT (clib_bihash_value) * old_values, u32 old_log2_pages,
    u32 new_log2_pages)
 {
   BVT (clib_bihash_value) * new_values;
   int i, j, new_length, old_length;
 
-  ASSERT (h->alloc_lock[0]);
+  ASSERT (!BV (thread_cache_is_shared) (h, tc) || h->alloc_lock[0]);
 
-  new_values = BV (value_alloc) (h, new_log2_pages);
+  new_values = BV (value_alloc) (h, tc, new_log2_pages);
   new_length = (1 << new_log2_pages) * BIHASH_KVP_PER_PAGE;
   old_length = (1 << old_log2_pages) * BIHASH_KVP_PER_PAGE;
 
@@ -664,7 +843,7 @@ BV (split_and_rehash_linear)
 	}
       /* This should never happen... */
       clib_warning ("BUG: linear rehash failed!");
-      BV (value_free) (h, new_values, new_log2_pages);
+      BV (value_free) (h, tc, new_values, new_log2_pages);
       return 0;
 
     doublebreak:;
@@ -678,10 +857,10 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
 {
   BVT (clib_bihash_bucket) * b, tmp_b;
   BVT (clib_bihash_value) * v, *new_v, *save_new_v, *working_copy;
+  BVT (clib_bihash_thread_cache) * tc;
   int i, limit;
   u64 new_hash;
   u32 new_log2_pages, old_log2_pages;
-  u32 thread_index = os_get_thread_index ();
   int mark_bucket_linear;
   int resplit_once;
 
@@ -712,6 +891,7 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
   ASSERT (h->instantiated != 0);
 #endif
 
+  tc = BV (clib_bihash_get_thread_cache) (h);
   b = BV (clib_bihash_get_bucket) (h, hash);
 
   BV (clib_bihash_lock_bucket) (b);
@@ -725,9 +905,9 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
 	  return (-1);
 	}
 
-      BV (clib_bihash_alloc_lock) (h);
-      v = BV (value_alloc) (h, 0);
-      BV (clib_bihash_alloc_unlock) (h);
+      BV (thread_cache_lock) (h, tc);
+      v = BV (value_alloc) (h, tc, 0);
+      BV (thread_cache_unlock) (h, tc);
 
       *v->kvp = *add_v;
       tmp_b.as_u64 = 0;		/* clears bucket lock */
@@ -869,11 +1049,11 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
 
 		free_backing_store:
 		  /* And free the backing storage */
-		  BV (clib_bihash_alloc_lock) (h);
+		  BV (thread_cache_lock) (h, tc);
 		  /* Note: v currently points into the middle of the bucket */
 		  v = BV (clib_bihash_get_value) (h, tmp_b.offset);
-		  BV (value_free) (h, v, tmp_b.log2_pages);
-		  BV (clib_bihash_alloc_unlock) (h);
+		  BV (value_free) (h, tc, v, tmp_b.log2_pages);
+		  BV (thread_cache_unlock) (h, tc);
 		  BV (clib_bihash_increment_stat) (h, BIHASH_STAT_del_free,
 						   1);
 		  return (0);
@@ -886,22 +1066,22 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
     }
 
   /* Move readers to a (locked) temp copy of the bucket */
-  BV (clib_bihash_alloc_lock) (h);
-  BV (make_working_copy) (h, b);
+  BV (thread_cache_lock) (h, tc);
+  BV (make_working_copy) (h, tc, b);
 
-  v = BV (clib_bihash_get_value) (h, h->saved_bucket.offset);
+  v = BV (clib_bihash_get_value) (h, tc->saved_bucket.offset);
 
-  old_log2_pages = h->saved_bucket.log2_pages;
+  old_log2_pages = tc->saved_bucket.log2_pages;
   new_log2_pages = old_log2_pages + 1;
   mark_bucket_linear = 0;
   BV (clib_bihash_increment_stat) (h, BIHASH_STAT_split_add, 1);
   BV (clib_bihash_increment_stat) (h, BIHASH_STAT_splits, old_log2_pages);
 
-  working_copy = h->working_copies[thread_index];
+  working_copy = tc->working_copy;
   resplit_once = 0;
   BV (clib_bihash_increment_stat) (h, BIHASH_STAT_splits, 1);
 
-  new_v = BV (split_and_rehash) (h, working_copy, old_log2_pages,
+  new_v = BV (split_and_rehash) (h, tc, working_copy, old_log2_pages,
 				 new_log2_pages);
   if (new_v == 0)
     {
@@ -909,7 +1089,7 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
       resplit_once = 1;
       new_log2_pages++;
       /* Try re-splitting. If that fails, fall back to linear search */
-      new_v = BV (split_and_rehash) (h, working_copy, old_log2_pages,
+      new_v = BV (split_and_rehash) (h, tc, working_copy, old_log2_pages,
 				     new_log2_pages);
       if (new_v == 0)
 	{
@@ -917,7 +1097,7 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
 	  new_log2_pages--;
 	  /* pinned collisions, use linear search */
 	  new_v =
-	    BV (split_and_rehash_linear) (h, working_copy, old_log2_pages,
+	    BV (split_and_rehash_linear) (h, tc, working_copy, old_log2_pages,
 					  new_log2_pages);
 	  mark_bucket_linear = 1;
 	  BV (clib_bihash_increment_stat) (h, BIHASH_STAT_linear, 1);
@@ -946,7 +1126,7 @@ static_always_inline int BV (clib_bihash_add_del_inline_with_hash)
     }
 
   /* Crap. Try again */
-  BV (value_free) (h, save_new_v, new_log2_pages);
+  BV (value_free) (h, tc, save_new_v, new_log2_pages);
   /*
    * If we've already doubled the size of the bucket once,
    * fall back to linear search now.
@@ -964,27 +1144,27 @@ expand_ok:
   /* Compensate for permanent refcount bump at the bucket level */
   if (new_log2_pages > 0)
 #endif
-    tmp_b.refcnt = h->saved_bucket.refcnt + 1;
+    tmp_b.refcnt = tc->saved_bucket.refcnt + 1;
   ASSERT (tmp_b.refcnt > 0);
   tmp_b.lock = 0;
   CLIB_MEMORY_STORE_BARRIER ();
   b->as_u64 = tmp_b.as_u64;
 
 #if BIHASH_KVP_AT_BUCKET_LEVEL
-  if (h->saved_bucket.log2_pages > 0)
+  if (tc->saved_bucket.log2_pages > 0)
     {
 #endif
 
       /* free the old bucket, except at the bucket level if so configured */
-      v = BV (clib_bihash_get_value) (h, h->saved_bucket.offset);
-      BV (value_free) (h, v, h->saved_bucket.log2_pages);
+      v = BV (clib_bihash_get_value) (h, tc->saved_bucket.offset);
+      BV (value_free) (h, tc, v, tc->saved_bucket.log2_pages);
 
 #if BIHASH_KVP_AT_BUCKET_LEVEL
     }
 #endif
 
 
-  BV (clib_bihash_alloc_unlock) (h);
+  BV (thread_cache_unlock) (h, tc);
   return (0);
 }
 
@@ -1111,6 +1291,18 @@ u8 *BV (format_bihash) (u8 * s, va_list * args)
 	s = format (s, "       [len %d] %u free elts\n", 1 << i, nfree);
     }
 
+  if (vec_len (h->thread_caches) > 1)
+    {
+      BVT (clib_bihash_thread_cache) * tc;
+      u64 ncached = 0;
+
+      vec_foreach (tc, h->thread_caches)
+	for (i = 0; i < BIHASH_THREAD_CACHE_N_LOG2_PAGES; i++)
+	  ncached += (u64) tc->n_free[i] << i;
+      s = format (s, "    %lld pages in %d thread caches\n", ncached,
+		  vec_len (h->thread_caches) - 1);
+    }
+
   s = format (s, "    %lld linear search buckets\n", linear_buckets);
   if (BIHASH_USE_HEAP)
     {
@@ -48,6 +48,15 @@
 #define BIHASH_LOG2_HUGEPAGE_SIZE 21
 #endif
 
+/* batched search: the bucket of the key this many keys ahead is
+   prefetched, and the data of the key half as many keys ahead */
+#ifndef BIHASH_SEARCH_BATCH_PREFETCH_STRIDE
+#define BIHASH_SEARCH_BATCH_PREFETCH_STRIDE 8
+#endif
+
+/* batched search without hashes: keys hashed per chunk of this size */
+#define BIHASH_SEARCH_BATCH_CHUNK 32
+
 #define _bv(a,b) a##b
 #define __bv(a,b) _bv(a,b)
 #define BV(a) __bv(a,BIHASH_TYPE)
@@ -141,15 +150,42 @@ BVS (clib_bihash_alloc_chunk)
 
 } BVT (clib_bihash_alloc_chunk);
 
+#ifndef BIHASH_THREAD_CACHE_N_LOG2_PAGES
+/* kvp pages of up to 2^(n-1) pages are cached per thread */
+#define BIHASH_THREAD_CACHE_N_LOG2_PAGES 8
+#endif
+
+#ifndef BIHASH_THREAD_CACHE_REFILL
+/* single pages moved at once between a thread cache and the freelists */
+#define BIHASH_THREAD_CACHE_REFILL 16
+#endif
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* free kvp pages of each size, linked through next_free_as_u64 */
+  u64 freelists[BIHASH_THREAD_CACHE_N_LOG2_PAGES];
+  u32 n_free[BIHASH_THREAD_CACHE_N_LOG2_PAGES];
+
+  /* copy of the bucket being split, which readers use meanwhile */
+  BVT (clib_bihash_value) * working_copy;
+  int working_copy_length;
+  BVT (clib_bihash_bucket) saved_bucket;
+} BVT (clib_bihash_thread_cache);
+
 typedef
 BVS (clib_bihash)
 {
   BVT (clib_bihash_bucket) * buckets;
   volatile u32 *alloc_lock;
 
-  BVT (clib_bihash_value) ** working_copies;
-  int *working_copy_lengths;
-  BVT (clib_bihash_bucket) saved_bucket;
+  /*
+   * Per-thread kvp page caches and working copies, so that writers
+   * on different buckets don't take the alloc_lock. Threads past the
+   * end share the last one, under the alloc_lock.
+   */
+  BVT (clib_bihash_thread_cache) * thread_caches;
 
   u32 nbuckets;
   u32 log2_nbuckets;
@@ -568,6 +604,77 @@ static inline int BV (clib_bihash_search_inline_2)
 						     valuep);
 }
 
+/**
+ * Search for a batch of keys with precomputed hashes.
+ *
+ * Bucket and data prefetches are issued ahead of the searches, so the
+ * caller only provides the hashes, e.g. computed while parsing a frame.
+ * Like clib_bihash_search_inline_with_hash, each key is overwritten with
+ * the key/value pair found.
+ *
+ * @param h - the bihash table
+ * @param hashes - key hashes, from clib_bihash_hash
+ * @param key_results - keys to search, overwritten with the results
+ * @param rv - per key result, 0 if found, -1 otherwise
+ * @param n_keys - number of keys
+ * @returns number of keys found
+ */
+static inline u32 BV (clib_bihash_search_batch_with_hash)
+  (BVT (clib_bihash) * h, u64 * hashes, BVT (clib_bihash_kv) * key_results,
+   int *rv, u32 n_keys)
+{
+  const u32 bucket_stride = BIHASH_SEARCH_BATCH_PREFETCH_STRIDE;
+  const u32 data_stride = BIHASH_SEARCH_BATCH_PREFETCH_STRIDE / 2;
+  u32 i, n_found = 0;
+
+  /* prime the pipeline, the first data prefetches wait for their bucket */
+  for (i = 0; i < clib_min (n_keys, bucket_stride); i++)
+    BV (clib_bihash_prefetch_bucket) (h, hashes[i]);
+  for (i = 0; i < clib_min (n_keys, data_stride); i++)
+    BV (clib_bihash_prefetch_data) (h, hashes[i]);
+
+  for (i = 0; i < n_keys; i++)
+    {
+      if (i + bucket_stride < n_keys)
+	BV (clib_bihash_prefetch_bucket) (h, hashes[i + bucket_stride]);
+      if (i + data_stride < n_keys)
+	BV (clib_bihash_prefetch_data) (h, hashes[i + data_stride]);
+
+      rv[i] = BV (clib_bihash_search_inline_with_hash) (h, hashes[i],
+							key_results + i);
+      n_found += rv[i] == 0;
+    }
+
+  return n_found;
+}
+
+/**
+ * Search for a batch of keys, see clib_bihash_search_batch_with_hash.
+ * Hashes are computed a chunk of keys at a time, before the searches.
+ */
+static inline u32 BV (clib_bihash_search_batch)
+  (BVT (clib_bihash) * h, BVT (clib_bihash_kv) * key_results, int *rv,
+   u32 n_keys)
+{
+  u64 hashes[BIHASH_SEARCH_BATCH_CHUNK];
+  u32 i, n, n_found = 0;
+
+  while (n_keys)
+    {
+      n = clib_min (n_keys, BIHASH_SEARCH_BATCH_CHUNK);
+      for (i = 0; i < n; i++)
+	hashes[i] = BV (clib_bihash_hash) (key_results + i);
+
+      n_found += BV (clib_bihash_search_batch_with_hash) (h, hashes,
+							   key_results, rv, n);
+      key_results += n;
+      rv += n;
+      n_keys -= n;
+    }
+
+  return n_found;
+}
+
 
 #endif /* __included_bihash_template_h__ */
 
@@ -29,12 +29,14 @@ typedef struct
   volatile u32 thread_barrier;
   volatile u32 threads_running;
   volatile u64 sequence_number;
+  volatile u32 n_errors;
   u64 seed;
   u32 nbuckets;
   u32 nitems;
   u32 ncycles;
   u32 report_every_n;
   u32 search_iter;
+  u32 batch_size;
   u32 noverwritten;
   int careful_delete_tests;
   int verbose;
@@ -53,6 +55,13 @@ typedef struct
 
 test_main_t test_main;
 
+/* give each test thread its own bihash thread cache */
+uword
+os_get_nthreads (void)
+{
+  return clib_max (test_main.nthreads, 1);
+}
+
 uword
 vl (void *v)
 {
@@ -146,6 +155,105 @@ test_bihash_stale_overwrite (test_main_t * tm)
   return 0;
 }
 
+static clib_error_t *
+test_bihash_batch (test_main_t * tm)
+{
+  BVT (clib_bihash) * h;
+  BVT (clib_bihash_kv) kv, *kvs = 0;
+  u64 *hashes = 0, t0, t_single = 0, t_batch = 0, total_searches;
+  u32 *order = 0, i, j, k, n, n_errors = 0;
+  int *rv = 0;
+
+  if (tm->batch_size == 0)
+    return clib_error_return (0, "batch size must be non-zero");
+
+  h = &tm->hash;
+  BV (clib_bihash_init) (h, "test", tm->nbuckets, tm->hash_memory_size);
+
+  fformat (stdout, "Add %d random keys to %d buckets...\n", tm->nitems,
+	   tm->nbuckets);
+  for (i = 0; i < tm->nitems; i++)
+    {
+      do
+	kv.key = random_u64 (&tm->seed);
+      while (hash_get (tm->key_hash, kv.key));
+      hash_set (tm->key_hash, kv.key, i + 1);
+      vec_add1 (tm->keys, kv.key);
+      kv.value = i + 1;
+      BV (clib_bihash_add_del) (h, &kv, 1 /* is_add */ );
+    }
+
+  /* search in random order, so that the table doesn't stay in cache */
+  vec_validate (order, tm->nitems - 1);
+  for (i = 0; i < tm->nitems; i++)
+    order[i] = random_u64 (&tm->seed) % tm->nitems;
+
+  vec_validate (kvs, tm->batch_size - 1);
+  vec_validate (hashes, tm->batch_size - 1);
+  vec_validate (rv, tm->batch_size - 1);
+
+  fformat (stdout, "Search for items %d times, batches of %d...\n",
+	   tm->search_iter, tm->batch_size);
+
+  /* separate passes, so that neither finds the table in cache */
+  for (j = 0; j < tm->search_iter; j++)
+    {
+      for (i = 0; i < tm->nitems; i += n)
+	{
+	  n = clib_min (tm->batch_size, tm->nitems - i);
+
+	  /* hashes are precomputed for both, as a caller would */
+	  for (k = 0; k < n; k++)
+	    {
+	      kvs[k].key = tm->keys[order[i + k]];
+	      hashes[k] = BV (clib_bihash_hash) (&kvs[k]);
+	    }
+
+	  t0 = clib_cpu_time_now ();
+	  for (k = 0; k < n; k++)
+	    rv[k] = BV (clib_bihash_search_inline_with_hash) (h, hashes[k],
+							      &kvs[k]);
+	  t_single += clib_cpu_time_now () - t0;
+	}
+
+      for (i = 0; i < tm->nitems; i += n)
+	{
+	  n = clib_min (tm->batch_size, tm->nitems - i);
+
+	  for (k = 0; k < n; k++)
+	    {
+	      kvs[k].key = tm->keys[order[i + k]];
+	      hashes[k] = BV (clib_bihash_hash) (&kvs[k]);
+	    }
+
+	  t0 = clib_cpu_time_now ();
+	  BV (clib_bihash_search_batch_with_hash) (h, hashes, kvs, rv, n);
+	  t_batch += clib_cpu_time_now () - t0;
+
+	  for (k = 0; k < n; k++)
+	    if (rv[k] || kvs[k].value != order[i + k] + 1)
+	      n_errors++;
+	}
+    }
+
+  total_searches = (u64) tm->search_iter * tm->nitems;
+  fformat (stdout, "single: %.2f clocks/lookup\n",
+	   (f64) t_single / total_searches);
+  fformat (stdout, "batch:  %.2f clocks/lookup\n",
+	   (f64) t_batch / total_searches);
+
+  BV (clib_bihash_free) (h);
+  vec_free (kvs);
+  vec_free (hashes);
+  vec_free (rv);
+  vec_free (order);
+
+  if (n_errors)
+    return clib_error_return (0, "%u batched searches failed", n_errors);
+
+  return 0;
+}
+
 void *
 test_bihash_thread_fn (void *arg)
 {
@@ -247,6 +355,128 @@ test_bihash_threads (test_main_t * tm)
   return 0;
 }
 
+static void
+test_bihash_writer_check (test_main_t * tm, u32 thread_index, u32 first,
+			  u32 stride, int is_present)
+{
+  BVT (clib_bihash_kv) kv, result;
+  u32 j;
+  int rv;
+
+  for (j = first; j < tm->nitems; j += stride)
+    {
+      kv.key = ((u64) thread_index << 32) | (u64) j;
+      rv = BV (clib_bihash_search) (&tm->hash, &kv, &result);
+      if (is_present ? (rv || result.value != kv.key) : rv == 0)
+	{
+	  if (tm->verbose > 1)
+	    fformat (stdout, "thread %u key %llx %s\n", thread_index,
+		     kv.key, is_present ? "missing" : "not deleted");
+	  (void) __atomic_add_fetch (&tm->n_errors, 1, __ATOMIC_RELAXED);
+	}
+    }
+}
+
+void *
+test_bihash_writer_fn (void *arg)
+{
+  BVT (clib_bihash_kv) kv;
+  test_main_t *tm = &test_main;
+  u32 my_thread_index = (u32) (u64) arg;
+  u32 i, j, last;
+
+  __os_thread_index = my_thread_index;
+  clib_mem_set_per_cpu_heap (tm->global_heap);
+
+  while (tm->thread_barrier)
+    ;
+
+  for (i = 0; i < tm->ncycles; i++)
+    {
+      for (j = 0; j < tm->nitems; j++)
+	{
+	  kv.key = ((u64) my_thread_index << 32) | (u64) j;
+	  kv.value = kv.key;
+	  BV (clib_bihash_add_del) (&tm->hash, &kv, 1 /* is_add */ );
+	}
+      test_bihash_writer_check (tm, my_thread_index, 0, 1, 1);
+
+      /* the last cycle leaves the even keys in the table */
+      last = i == tm->ncycles - 1;
+      for (j = last; j < tm->nitems; j += 1 + last)
+	{
+	  kv.key = ((u64) my_thread_index << 32) | (u64) j;
+	  BV (clib_bihash_add_del) (&tm->hash, &kv, 0 /* is_add */ );
+	}
+    }
+
+  (void) __atomic_sub_fetch (&tm->threads_running, 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static clib_error_t *
+test_bihash_writers (test_main_t * tm)
+{
+  BVT (clib_bihash) * h = &tm->hash;
+  pthread_t *handles = 0;
+  f64 before, delta;
+  u32 i;
+  int rv;
+
+  if (tm->nthreads == 0 || tm->ncycles == 0)
+    return clib_error_return (0, "threads and cycles must be non-zero");
+
+  BV (clib_bihash_init) (h, "test", tm->nbuckets, tm->hash_memory_size);
+
+  fformat (stdout, "%u threads add and delete %u keys %u times in %u "
+	   "buckets...\n", tm->nthreads, tm->nitems, tm->ncycles,
+	   tm->nbuckets);
+
+  tm->thread_barrier = 1;
+  tm->threads_running = tm->nthreads;
+  tm->n_errors = 0;
+  vec_validate (handles, tm->nthreads - 1);
+
+  for (i = 0; i < tm->nthreads; i++)
+    {
+      rv = pthread_create (&handles[i], NULL, test_bihash_writer_fn,
+			   (void *) (u64) i);
+      if (rv)
+	return clib_error_return (0, "pthread_create returned %d", rv);
+    }
+
+  CLIB_MEMORY_BARRIER ();
+  before = clib_time_now (&tm->clib_time);
+  tm->thread_barrier = 0;
+
+  for (i = 0; i < tm->nthreads; i++)
+    pthread_join (handles[i], 0);
+  delta = clib_time_now (&tm->clib_time) - before;
+  vec_free (handles);
+
+  fformat (stdout, "%.f adds + deletes per second\n",
+	   ((f64) tm->nthreads * tm->ncycles * tm->nitems * 2 -
+	    (f64) tm->nthreads * (tm->nitems / 2)) / delta);
+
+  /* each thread left its even keys */
+  for (i = 0; i < tm->nthreads; i++)
+    {
+      test_bihash_writer_check (tm, i, 0, 2, 1);
+      test_bihash_writer_check (tm, i, 1, 2, 0);
+    }
+
+  if (tm->verbose)
+    fformat (stdout, "%U", BV (format_bihash), h, 0 /* verbose */ );
+
+  BV (clib_bihash_free) (h);
+
+  if (tm->n_errors)
+    return clib_error_return (0, "%u keys missing or not deleted",
+			      tm->n_errors);
+
+  fformat (stdout, "No errors...\n");
+  return 0;
+}
 
 static clib_error_t *
 test_bihash (test_main_t * tm)
@@ -510,10 +740,16 @@ test_bihash_main (test_main_t * tm)
 	which = 1;
       else if (unformat (i, "threads %u", &tm->nthreads))
 	which = 2;
+      else if (unformat (i, "writers %u", &tm->nthreads))
+	which = 5;
       else if (unformat (i, "verbose"))
 	tm->verbose = 1;
       else if (unformat (i, "stale-overwrite"))
 	which = 3;
+      else if (unformat (i, "batch %u", &tm->batch_size))
+	which = 4;
+      else if (unformat (i, "batch"))
+	which = 4;
       else
 	return clib_error_return (0, "unknown input '%U'",
 				  format_unformat_error, i);
@@ -543,6 +779,14 @@ test_bihash_main (test_main_t * tm)
       error = test_bihash_stale_overwrite (tm);
       break;
 
+    case 4:
+      error = test_bihash_batch (tm);
+      break;
+
+    case 5:
+      error = test_bihash_writers (tm);
+      break;
+
     default:
       return clib_error_return (0, "no such test?");
     }
@@ -570,6 +814,7 @@ main (int argc, char *argv[])
   tm->ncycles = 1;
   tm->verbose = 1;
   tm->search_iter = 1;
+  tm->batch_size = 256;
   tm->careful_delete_tests = 0;
   clib_time_init (&tm->clib_time);
 
@@ -279,6 +279,21 @@ u32x8_gather (void *p0, void *p1, void *p2, void *p3, void *p4, void *p5,
   return r;
 }
 
+/* r[i] = base[indices[i]] */
+static_always_inline u32x8
+u32x8_gather_u32 (const u32 *base, u32x8 indices)
+{
+  return (u32x8) _mm256_i32gather_epi32 ((const int *) base, (__m256i) indices,
+					 4);
+}
+
+/* r[i] = base[indices[i]] where the msb of mask[i] is set, else src[i] */
+static_always_inline u32x8
+u32x8_mask_gather_u32 (u32x8 src, const u32 *base, u32x8 indices, u32x8 mask)
+{
+  return (u32x8) _mm256_mask_i32gather_epi32 (
+    (__m256i) src, (const int *) base, (__m256i) indices, (__m256i) mask, 4);
+}
 
 static_always_inline void
 u64x4_scatter (u64x4 r, void *p0, void *p1, void *p2, void *p3)
@@ -315,6 +315,21 @@ u32x16_mask_blend (u32x16 a, u32x16 b, u16 mask)
   return (u32x16) _mm512_mask_blend_epi32 (mask, (__m512i) a, (__m512i) b);
 }
 
+/* r[i] = base[indices[i]] */
+static_always_inline u32x16
+u32x16_gather_u32 (const u32 *base, u32x16 indices)
+{
+  return (u32x16) _mm512_i32gather_epi32 ((__m512i) indices, base, 4);
+}
+
+/* r[i] = base[indices[i]] where bit i of mask is set, else src[i] */
+static_always_inline u32x16
+u32x16_mask_gather_u32 (u32x16 src, const u32 *base, u32x16 indices, u16 mask)
+{
+  return (u32x16) _mm512_mask_i32gather_epi32 ((__m512i) src, mask,
+					       (__m512i) indices, base, 4);
+}
+
 static_always_inline u8x64
 u8x64_mask_blend (u8x64 a, u8x64 b, u64 mask)
 {
@@ -1634,6 +1634,7 @@ class SpdFlowCacheTemplate(VppTestCase):
         # close down pg intfs
         for pg in self.pg_interfaces:
             pg.unconfig_ip4()
+            pg.unconfig_ip6()
             pg.admin_down()
         super(SpdFlowCacheTemplate, self).tearDown()
 
@@ -1796,6 +1797,32 @@ class SpdFlowCacheTemplate(VppTestCase):
     def verify_num_outbound_flow_cache_entries(self, expected_elements):
         self.assertEqual(self.get_spd_flow_cache_entries(), expected_elements)
 
+    def get_spd_inbound_flow_cache_entries(self, af="ip4"):
+        """ 'show ipsec spd' output, per SPD:
+        inbound-flow-cache:
+          ip4-entries: 0
+        """
+        show_ipsec_reply = self.vapi.cli("show ipsec spd")
+        regex_match = re.search(
+            '%s-entries: ([0-9]+)' % af, show_ipsec_reply)
+        if regex_match is None:
+            raise Exception("Unable to find spd inbound flow cache entries \
+                in \'show ipsec spd\' CLI output - regex failed to match")
+        num_entries = int(regex_match.group(1))
+        self.logger.info("%s", regex_match.group(0))
+        return num_entries
+
+    def verify_num_inbound_flow_cache_entries(self, expected_elements,
+                                              af="ip4"):
+        self.assertEqual(self.get_spd_inbound_flow_cache_entries(af),
+                         expected_elements)
+
+    def get_spd_flow_cache_counter(self, name, spd_index=0):
+        """ '/net/ipsec/spd/flow-cache/<name>' summed over threads """
+        counter = self.statistics.get_counter(
+            "/net/ipsec/spd/flow-cache/" + name)
+        return sum(per_thread[spd_index] for per_thread in counter)
+
     def crc32_supported(self):
         # lscpu is part of util-linux package, available on all Linux Distros
         stream = os.popen('lscpu')
@@ -1433,6 +1433,33 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0315")
 
+    def test_0400_batched_hash_lookup(self):
+        """ batched hash ACL lookup matches the per packet one
+        """
+        self.logger.info("ACLP_TEST_START_0400")
+
+        reply = self.vapi.cli("test acl-plugin lookup perf rules 500 "
+                              "mask-types 64 lookups 16384")
+        self.logger.info(reply)
+        self.assertIn("mismatches: 0", reply)
+
+        self.logger.info("ACLP_TEST_FINISH_0400")
+
+
+class TestACLpluginBatched(TestACLplugin):
+    """ ACL plugin Test Case, batched hash lookup """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestACLpluginBatched, cls).setUpClass()
+        # lookup contexts this small use the per packet lookup by default
+        cls.vapi.cli("set acl-plugin use-batched-hash-acl-matching 1 "
+                     "min-entries 0")
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestACLpluginBatched, cls).tearDownClass()
+
 
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -404,3 +404,17 @@ class ACLPluginConnTestCase(VppTestCase):
     def test_3006_tcp_transient_teardown_conn_test(self):
         """ IPv6: transient TCP session (3WHS,ACK,FINACK), ref. on egress """
         self.run_tcp_transient_teardown_conn_test(AF_INET6, 1)
+
+
+class ACLPluginConnBatchedTestCase(ACLPluginConnTestCase):
+    """ ACL plugin connection-oriented extended testcases, batched lookup """
+
+    @classmethod
+    def setUpClass(cls):
+        super(ACLPluginConnBatchedTestCase, cls).setUpClass()
+        cls.vapi.cli("set acl-plugin use-batched-hash-acl-matching 1 "
+                     "min-entries 0")
+
+    @classmethod
+    def tearDownClass(cls):
+        super(ACLPluginConnBatchedTestCase, cls).tearDownClass()
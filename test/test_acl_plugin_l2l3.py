@@ -860,5 +860,19 @@ class TestACLpluginL2L3(VppTestCase):
                                                       self.STATEFUL_ICMP)
 
 
+class TestACLpluginL2L3Batched(TestACLpluginL2L3):
+    """ TestACLpluginL2L3 with the batched hash lookup """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestACLpluginL2L3Batched, cls).setUpClass()
+        cls.vapi.cli("set acl-plugin use-batched-hash-acl-matching 1 "
+                     "min-entries 0")
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestACLpluginL2L3Batched, cls).tearDownClass()
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
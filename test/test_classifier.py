@@ -782,6 +782,97 @@ class TestClassifierComplex(TestClassifier):
         self.pg2.assert_nothing_captured(remark="packets forwarded")
         self.pg3.assert_nothing_captured(remark="packets forwarded")
 
+    def test_iacl_nested_compiled(self):
+        """ Compiled nested input ACL test
+
+        Test scenario for a compiled chain of ACL tables
+            - Create IPv4 stream for pg0 -> pg1 interface.
+            - Create 1st classifier table, without any entries
+            - Create nested acl matching on ethernet+ip+udp header fields
+            - Compile the chain, send and verify received packets on pg1
+              interface and that the empty table was skipped.
+            - Add a matching session to the 1st table and verify it is
+              found through the compiled prefilter.
+        """
+
+        sport = 13720
+        dport = 9080
+        pkts = self.create_stream(self.pg0, self.pg1, self.pg_if_packet_sizes,
+                                  UDP(sport=sport, dport=dport))
+
+        self.pg0.add_stream(pkts)
+
+        mask = (self.build_mac_mask(src_mac='ffffffffffff',
+                                    dst_mac='ffffffffffff',
+                                    ether_type='ffff') +
+                self.build_ip_mask(proto='ff',
+                                   src_ip='ffffffff',
+                                   dst_ip='ffffffff',
+                                   src_port='ffff',
+                                   dst_port='ffff'))
+        match = (self.build_mac_match(src_mac=self.pg0.remote_mac,
+                                      dst_mac=self.pg0.local_mac,
+                                      # ipv4 next header
+                                      ether_type='0800') +
+                 self.build_ip_match(proto=socket.IPPROTO_UDP,
+                                     src_ip=self.pg0.remote_ip4,
+                                     dst_ip=self.pg1.remote_ip4,
+                                     src_port=sport,
+                                     dst_port=dport))
+
+        subtable_key = 'subtable_in'
+        self.create_classify_table(subtable_key, mask, data_offset=-14)
+        subtable = self.acl_tbl_idx.get(subtable_key)
+
+        key = 'nested_in'
+        self.create_classify_table(key, mask, data_offset=-14,
+                                   next_table_index=subtable)
+        table = self.acl_tbl_idx.get(key)
+
+        self.create_classify_session(subtable, match)
+
+        self.vapi.cli("classify chain compile table %d" % table)
+
+        self.input_acl_set_interface(self.pg0, table)
+        self.acl_active_table = key
+
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        rx = self.pg1.get_capture(len(pkts))
+        self.verify_capture(self.pg1, rx)
+        self.pg0.assert_nothing_captured(remark="packets forwarded")
+        self.pg2.assert_nothing_captured(remark="packets forwarded")
+        self.pg3.assert_nothing_captured(remark="packets forwarded")
+
+        self.logger.info(self.vapi.cli("show classify chain table %d" %
+                                       table))
+
+        # the empty table is skipped, the packets hit in the next one
+        lookups = self.statistics['/classify/table/lookups']
+        filtered = self.statistics['/classify/table/filtered']
+        hits = self.statistics['/classify/table/hits']
+        self.assertEqual(lookups[:, table].sum(), len(pkts))
+        self.assertEqual(filtered[:, table].sum(), len(pkts))
+        self.assertEqual(hits[:, table].sum(), 0)
+        self.assertEqual(lookups[:, subtable].sum(), len(pkts))
+        self.assertEqual(filtered[:, subtable].sum(), 0)
+        self.assertEqual(hits[:, subtable].sum(), len(pkts))
+
+        # a session added after the compile is found in the 1st table
+        self.create_classify_session(table, match)
+
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        rx = self.pg1.get_capture(len(pkts))
+        self.verify_capture(self.pg1, rx)
+
+        hits = self.statistics['/classify/table/hits']
+        self.assertEqual(hits[:, table].sum(), len(pkts))
+        self.assertEqual(hits[:, subtable].sum(), len(pkts))
+
 
 class TestClassifierPBR(TestClassifier):
     """ Classifier PBR Test Case """
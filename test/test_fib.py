@@ -44,5 +44,12 @@ class TestFIB(VppTestCase):
             self.logger.critical(error)
         self.assertNotIn("Failed", error)
 
+    def test_ip4_mtrie(self):
+        """ IP4 mtrie batched lookup """
+        reply = self.vapi.cli("test ip4 mtrie perf routes 20000 "
+                              "lookups 65536")
+        self.logger.info(reply)
+        self.assertIn("mismatches: 0", reply)
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
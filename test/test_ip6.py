@@ -1085,6 +1085,110 @@ class TestIPv6RouteLookup(VppTestCase):
         # Can't seem to delete the default route so no negative LPM test.
 
 
+class TestIPv6FibBinarySearch(VppTestCase):
+    """ IPv6 FIB Binary Search on Lengths Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestIPv6FibBinarySearch, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestIPv6FibBinarySearch, cls).tearDownClass()
+
+    def setUp(self):
+        super(TestIPv6FibBinarySearch, self).setUp()
+
+        self.create_pg_interfaces(range(2))
+
+        for i in self.pg_interfaces:
+            i.admin_up()
+            i.config_ip6()
+            i.resolve_ndp()
+
+    def tearDown(self):
+        super(TestIPv6FibBinarySearch, self).tearDown()
+        for i in self.pg_interfaces:
+            i.unconfig_ip6()
+            i.admin_down()
+
+    def send_to(self, dst):
+        p = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+             IPv6(src=self.pg0.remote_ip6, dst=dst) /
+             inet6.UDP(sport=1234, dport=1234) /
+             Raw(b'\xa5' * 100))
+        return p * NUM_PKTS
+
+    def test_binary_search(self):
+        """ IPv6 FIB binary search on lengths """
+
+        drop = VppRoutePath("::", 0xffffffff,
+                            type=FibPathType.FIB_PATH_TYPE_DROP)
+        via_pg1 = VppRoutePath(self.pg1.remote_ip6, self.pg1.sw_if_index)
+
+        #
+        # nested prefixes of many lengths, alternately forwarded and
+        # dropped, so the markers of the longer prefixes must carry the
+        # result of the shorter ones
+        #
+        routes = []
+        for i, plen in enumerate([16, 24, 32, 40, 48, 56, 64, 96, 112, 128]):
+            net = IPv6Network("2001:db8:1:2:3:4:5:6/%d" % plen, strict=False)
+            r = VppIpRoute(self, str(net.network_address), plen,
+                           [via_pg1 if i % 2 else drop])
+            r.add_vpp_config()
+            routes.append(r)
+
+        self.vapi.cli("set ip6 fib lookup table 0 binary-search")
+        self.sleep(0.1, "compile")
+
+        summary = self.vapi.cli("show ip6 fib summary table 0")
+        self.logger.info(summary)
+        self.assertIn("binary search on", summary)
+        self.assertNotIn("differ", summary)
+
+        # the /56 is the longest match, forwarded
+        self.send_and_expect(self.pg0, self.send_to("2001:db8:1:ff::1"),
+                             self.pg1)
+        # the /48 is the longest match, dropped
+        self.send_and_assert_no_replies(
+            self.pg0, self.send_to("2001:db8:1:ff00::1"))
+        # the /96 is the longest match, forwarded
+        self.send_and_expect(self.pg0, self.send_to("2001:db8:1:2:3:4:ff::1"),
+                             self.pg1)
+        # the /64 is the longest match, dropped
+        self.send_and_assert_no_replies(
+            self.pg0, self.send_to("2001:db8:1:2:3:ff::1"))
+        # the /128, forwarded
+        self.send_and_expect(self.pg0,
+                             self.send_to("2001:db8:1:2:3:4:5:6"),
+                             self.pg1)
+        # the /112 is the longest match, dropped
+        self.send_and_assert_no_replies(
+            self.pg0, self.send_to("2001:db8:1:2:3:4:5:7"))
+
+        #
+        # removing a route reverts to the per-length lookup until the
+        # table is compiled again
+        #
+        routes.pop(5).remove_vpp_config()
+        self.sleep(0.1, "compile")
+        summary = self.vapi.cli("show ip6 fib summary table 0")
+        self.assertIn("binary search on", summary)
+        self.assertNotIn("differ", summary)
+
+        # the /48 is now the longest match, dropped
+        self.send_and_assert_no_replies(
+            self.pg0, self.send_to("2001:db8:1:ff::1"))
+
+        self.vapi.cli("set ip6 fib lookup table 0 per-length")
+        summary = self.vapi.cli("show ip6 fib summary table 0")
+        self.assertIn("lookup: per-length", summary)
+
+        for r in routes:
+            r.remove_vpp_config()
+
+
 class TestIPv6IfAddrRoute(VppTestCase):
     """ IPv6 Interface Addr Route Test Case """
 
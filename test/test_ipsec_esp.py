@@ -19,6 +19,7 @@ from vpp_ipsec import VppIpsecSpd, VppIpsecSpdEntry, VppIpsecSA,\
 from vpp_ip_route import VppIpRoute, VppRoutePath
 from vpp_ip import DpoProto
 from vpp_papi import VppEnum
+from vpp_papi_provider import CliFailedCommandError
 
 NUM_PKTS = 67
 engines_supporting_chain_bufs = ["openssl", "async"]
@@ -677,6 +678,62 @@ class TestIpsecEspAsync(TemplateIpsecEsp):
         # screen scrape.
         self.assertTrue("DISABLED" in self.vapi.cli("sh crypto async status"))
 
+    def sw_scheduler_workers(self):
+        """ per worker counters of show sw_scheduler workers """
+        workers = {}
+        for line in self.vapi.cli("show sw_scheduler workers").splitlines():
+            f = line.split()
+            if len(f) == 9 and f[0].isdigit():
+                workers[int(f[0])] = {
+                    "elts": int(f[3]), "chunks": int(f[5]),
+                    "split": int(f[6]), "steals": int(f[7]),
+                    "stolen": int(f[8])}
+        return workers
+
+    def test_skewed_stream(self):
+        """ Async SA on one worker, shared with the other """
+        with self.assertRaises(CliFailedCommandError):
+            self.vapi.cli("set sw_scheduler chunk-size 0")
+        self.vapi.cli("set sw_scheduler chunk-size 16")
+        self.vapi.cli("clear sw_scheduler counters")
+
+        # all of it received, and encrypted, on worker 0, the other
+        # worker only gets crypto work by taking it
+        pkts = [(Ether(src=self.pg1.remote_mac, dst=self.pg1.local_mac) /
+                 IP(src=self.pg1.remote_ip4,
+                    dst=self.p_async.remote_tun_if_host) /
+                 UDP(sport=4444, dport=4444) /
+                 Raw(b'0x0' * 1000))]
+        pkts *= 2047
+
+        rxs = self.send_and_expect(self.pg1, pkts, self.pg0, worker=0)
+        self.assertEqual(len(rxs), len(pkts))
+
+        # still in order, chunks may have been done by either worker
+        seq = 0
+        for rx in rxs:
+            self.assertEqual(rx[ESP].spi, self.p_async.vpp_tun_spi)
+            self.assertGreater(rx[ESP].seq, seq)
+            seq = rx[ESP].seq
+            self.p_async.scapy_tun_sa.decrypt(rx[IP])
+
+        self.logger.info(self.vapi.cli("show sw_scheduler workers"))
+        workers = self.sw_scheduler_workers()
+        self.assertEqual(sum(w["elts"] for w in workers.values()), len(pkts))
+        self.assertEqual(workers[0]["steals"], 0)
+        self.assertEqual(workers[0]["stolen"], 0)
+        # worker 0 does a chunk at a time, its frames pile up and the
+        # idle worker takes some of them
+        self.assertGreater(workers[1]["elts"], 0)
+        self.assertGreater(workers[1]["steals"], 0)
+
+        # back to CRYPTO_SW_SCHEDULER_CHUNK_SIZE for the tests that follow
+        self.vapi.cli("set sw_scheduler chunk-size 16")
+        self.p_sync.spd.remove_vpp_config()
+        self.p_sync.sa.remove_vpp_config()
+        self.p_async.spd.remove_vpp_config()
+        self.p_async.sa.remove_vpp_config()
+
 
 class TestIpsecEspHandoff(TemplateIpsecEsp,
                           IpsecTun6HandoffTests,
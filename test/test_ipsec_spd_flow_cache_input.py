@@ -0,0 +1,173 @@
+import socket
+import unittest
+
+from scapy.layers.inet6 import IPv6
+from scapy.layers.ipsec import ESP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
+from util import ppp
+from framework import VppTestRunner
+from template_ipsec import SpdFlowCacheTemplate
+
+
+class SpdFlowCacheInbound(SpdFlowCacheTemplate):
+    # Override setUpConstants to enable inbound flow cache in config
+    @classmethod
+    def setUpConstants(cls):
+        super(SpdFlowCacheInbound, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["ipsec", "{",
+                                "ipv4-inbound-spd-flow-cache on",
+                                "}"])
+        cls.logger.info("VPP modified cmdline is %s" % " "
+                        .join(cls.vpp_cmdline))
+
+
+class IPSec4SpdTestCaseBypass(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: Policy mode test case with flow cache \
+        (bypass rule)"""
+    def test_ipsec_spd_inbound_bypass(self):
+        # In this test case, packets received on pg0 are configured
+        # to go through IPSec inbound SPD policy lookup.
+        # A single BYPASS rule is added, traffic sent on pg0 should
+        # match it and be forwarded to pg1. The protect lookup miss
+        # and the bypass lookup hit are both cached.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        policy_0 = self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="bypass")
+
+        # check flow cache is empty before sending traffic
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count)
+        self.pg0.add_stream(packets)
+        self.pg0.enable_capture()
+        self.pg1.enable_capture()
+        self.pg_start()
+        capture = self.pg1.get_capture()
+        for packet in capture:
+            try:
+                self.logger.debug(ppp("SPD - Got packet:", packet))
+            except Exception:
+                self.logger.error(ppp("Unexpected or invalid packet:", packet))
+                raise
+        self.logger.debug("SPD: Num packets: %s", len(capture.res))
+
+        self.pg0.assert_nothing_captured()
+        self.verify_capture(self.pg0, self.pg1, capture)
+        self.verify_policy_match(pkt_count, policy_0)
+        # the bypass result is cached, as are the protect misses
+        self.assertGreater(self.get_spd_inbound_flow_cache_entries(), 1)
+        # each packet does a protect and a bypass lookup, the bypass
+        # lookup of all but the first packet hits the cache
+        hits = self.get_spd_flow_cache_counter("hit")
+        misses = self.get_spd_flow_cache_counter("miss")
+        self.assertEqual(hits + misses, 2 * pkt_count)
+        self.assertGreaterEqual(hits, pkt_count - 1)
+        self.assertEqual(self.statistics.get_err_counter(
+            "/err/ipsec4-input-feature/IPSec policy bypass"), pkt_count)
+
+
+class IPSec4SpdTestCaseChange(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: Policy mode test case with flow cache \
+        (policy change)"""
+    def test_ipsec_spd_inbound_change(self):
+        # In this test case, traffic first matches an inbound BYPASS
+        # rule and is cached. The BYPASS rule is then replaced with a
+        # DISCARD rule, which must flush the cache so that the resent
+        # traffic is dropped rather than matching the stale entry.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        policy_0 = self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="bypass")
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count)
+        self.pg0.add_stream(packets)
+        self.pg0.enable_capture()
+        self.pg1.enable_capture()
+        self.pg_start()
+        capture = self.pg1.get_capture()
+        self.verify_capture(self.pg0, self.pg1, capture)
+        self.verify_policy_match(pkt_count, policy_0)
+        self.assertGreater(self.get_spd_inbound_flow_cache_entries(), 1)
+        hits = self.get_spd_flow_cache_counter("hit")
+
+        # replace the bypass rule with a discard rule
+        self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="bypass",
+            remove=True)
+        # verify flow cache counter has been reset by rule removal
+        self.verify_num_inbound_flow_cache_entries(0)
+        policy_1 = self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="discard")
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        # resend the same packets, all are dropped
+        self.pg0.add_stream(packets)
+        self.pg0.enable_capture()  # flush the old captures
+        self.pg1.enable_capture()
+        self.pg_start()
+        self.pg0.assert_nothing_captured()
+        self.pg1.assert_nothing_captured()
+        self.verify_policy_match(pkt_count, policy_1)
+        self.assertGreater(self.get_spd_inbound_flow_cache_entries(), 1)
+        # the discard result is cached after the first resent packet
+        self.assertGreater(self.get_spd_flow_cache_counter("hit"), hits)
+        self.assertEqual(self.statistics.get_err_counter(
+            "/err/ipsec4-input-feature/IPSec policy discard"), pkt_count)
+
+
+class IPSec6SpdTestCaseProtectMiss(SpdFlowCacheTemplate):
+    """ IPSec/IPv6 inbound: Policy mode test case with flow cache \
+        (protect miss)"""
+    @classmethod
+    def setUpConstants(cls):
+        super(IPSec6SpdTestCaseProtectMiss, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["ipsec", "{",
+                                "ipv6-inbound-spd-flow-cache on",
+                                "}"])
+
+    def test_ipsec6_spd_inbound_protect_miss(self):
+        # In this test case, ESP packets of one flow are received on pg0,
+        # which has an SPD without a matching protect rule. The first
+        # packet caches the protect miss, the others hit it, and all are
+        # forwarded to pg1 in the clear.
+        self.create_interfaces(2)
+        for pg in self.pg_interfaces:
+            pg.config_ip6()
+            pg.resolve_ndp()
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+
+        self.verify_num_inbound_flow_cache_entries(0, af="ip6")
+
+        packets = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                    IPv6(src=self.pg0.remote_ip6, dst=self.pg1.remote_ip6) /
+                    ESP(spi=1000, seq=i) /
+                    Raw(b"\xa5" * 64)) for i in range(pkt_count)]
+        self.pg0.add_stream(packets)
+        self.pg0.enable_capture()
+        self.pg1.enable_capture()
+        self.pg_start()
+        capture = self.pg1.get_capture(pkt_count)
+        for packet in capture:
+            self.assertEqual(packet[IPv6].dst, self.pg1.remote_ip6)
+        self.pg0.assert_nothing_captured()
+
+        self.verify_num_inbound_flow_cache_entries(1, af="ip6")
+        self.assertEqual(self.get_spd_flow_cache_counter("miss"), 1)
+        self.assertEqual(self.get_spd_flow_cache_counter("hit"),
+                         pkt_count - 1)
+        self.assertEqual(self.statistics.get_err_counter(
+            "/err/ipsec6-input-feature/IPSec pkts received"), pkt_count)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
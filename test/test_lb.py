@@ -1,3 +1,4 @@
+import re
 import socket
 
 import scapy.compat
@@ -229,6 +230,100 @@ class TestLB(VppTestCase):
                 "lb vip 90.0.0.0/8 encap gre4 del")
             self.vapi.cli("test lb flowtable flush")
 
+    def get_as_flows(self):
+        """ flows counted against each AS, by address """
+        reply = self.vapi.cli("show lb vip verbose")
+        return {a: int(n) for a, n in
+                re.findall(r"(\S+) \d+ buckets\s+(\d+) flows", reply)}
+
+    def send_and_get_as_by_flow(self):
+        """ the AS each flow went to, by the flow's source address """
+        self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        out = self.pg1.get_capture(len(self.packets))
+        return {IP(scapy.compat.raw(p[GRE].payload)).src: p[IP].dst
+                for p in out}
+
+    def test_lb_ip4_gre4_shared_sticky(self):
+        """ Load Balancer IP4 GRE4 with a shared sticky table """
+        try:
+            self.vapi.cli("lb conf sticky-table shared")
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4")
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u"
+                    % (asid))
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.checkCapture(encap='gre4', isv4=True)
+            self.assertIn("shared", self.vapi.cli("show lb"))
+
+            # a flush drops every flow and its AS reference, the table
+            # stays shared and the flows stick again once re-created
+            self.packets = range(20)
+            self.send_and_get_as_by_flow()
+            self.assertEqual(sum(self.get_as_flows().values()), 20)
+
+            self.vapi.cli("test lb flowtable flush")
+            self.assertEqual(sum(self.get_as_flows().values()), 0)
+            self.assertIn("shared", self.vapi.cli("show lb"))
+
+            as_by_flow = self.send_and_get_as_by_flow()
+            self.assertEqual(sum(self.get_as_flows().values()), 20)
+            self.assertEqual(self.send_and_get_as_by_flow(), as_by_flow)
+            self.assertEqual(sum(self.get_as_flows().values()), 20)
+
+        finally:
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u del"
+                    % (asid))
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4 del")
+            self.vapi.cli("test lb flowtable flush")
+            self.vapi.cli("lb conf sticky-table per-cpu")
+
+    def test_lb_sticky_table_rebalance(self):
+        """ Load Balancer shared sticky table keeps moved flows """
+        reply = self.vapi.cli("test lb sticky-table perf threads 4 "
+                              "lookups 100000 shared")
+        self.logger.info(reply)
+        self.assertIn("shared: 4 threads", reply)
+        self.assertIn(", 0 flows lost their AS", reply)
+
+    def test_lb_maglev_update(self):
+        """ Load Balancer new flow table updated slot by slot """
+        try:
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4 new_len 1024")
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u"
+                    % (asid))
+            self.vapi.cli("lb as 90.0.0.0/8 10.0.0.100")
+
+            reply = self.vapi.cli("show lb vip verbose")
+            self.logger.info(reply)
+            m = re.search(r"last update: (\d+) entries changed", reply)
+            self.assertIsNotNone(m)
+            # roughly the share of the new AS moves, not the whole table
+            self.assertGreater(int(m.group(1)), 0)
+            self.assertLess(int(m.group(1)), 1024 / 2)
+
+        finally:
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u del"
+                    % (asid))
+            self.vapi.cli("lb as 90.0.0.0/8 10.0.0.100 del")
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4 del")
+            self.vapi.cli("test lb flowtable flush")
+
     def test_lb_ip6_gre4(self):
         """ Load Balancer IP6 GRE4 on vip case """
 
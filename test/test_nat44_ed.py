@@ -2122,6 +2122,66 @@ class TestNAT44ED(VppTestCase):
             self.logger.error(ppp("Unexpected or invalid packet:", p))
             raise
 
+    def test_session_offload(self):
+        """ NAT44ED offload sessions to flow marks """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+        self.vapi.cli("nat44 offload threshold 5")
+
+        def i2o(count):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=self.udp_port_in, dport=20) / Raw(b'x' * 8))
+            self.pg0.add_stream(p * count)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg1.get_capture(count)
+            self.verify_capture_out(capture, ignore_port=True)
+
+        def o2i(count):
+            p = (Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+                 UDP(sport=20, dport=self.udp_port_out) / Raw(b'x' * 8))
+            self.pg1.add_stream(p * count)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg0.get_capture(count)
+            self.verify_capture_in(capture, self.pg0)
+
+        try:
+            # create the session, then pass the threshold in both directions
+            i2o(1)
+            o2i(1)
+            i2o(10)
+            o2i(10)
+            self.virtual_sleep(0.1, "wait for flow rules")
+
+            out = self.vapi.cli("show nat44 offload")
+            self.logger.info(out)
+            self.assertIn("installed flows: 2", out)
+
+            hits = self.statistics['/nat44-ed/offload/mark-hits']
+            i2o(10)
+            o2i(10)
+            self.assertEqual(
+                self.statistics['/nat44-ed/offload/mark-hits'][:, 0].sum() -
+                hits[:, 0].sum(), 20)
+
+            # removing the rules leaves the session in software
+            self.vapi.cli("nat44 offload disable")
+            out = self.vapi.cli("show nat44 offload")
+            self.assertIn("installed flows: 0", out)
+            hits = self.statistics['/nat44-ed/offload/mark-hits']
+            i2o(10)
+            o2i(10)
+            self.assertEqual(
+                self.statistics['/nat44-ed/offload/mark-hits'][:, 0].sum() -
+                hits[:, 0].sum(), 0)
+        finally:
+            self.vapi.cli("nat44 offload disable")
+
     def test_outside_address_distribution(self):
         """ Outside address distribution based on source address """
 
@@ -2557,6 +2617,48 @@ class TestNAT44EDMW(TestNAT44ED):
         self.pg_start()
         self.pg1.get_capture(len(pkts))
 
+    def test_session_expiry(self):
+        """ NAT44ED session expiry without traffic """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        self.vapi.nat_set_timeouts(
+            udp=2, tcp_established=7440, tcp_transitory=240, icmp=60)
+        # expired sessions are reclaimed over several dispatches
+        self.vapi.cli("nat44 expire budget 16")
+
+        n_sessions = 50
+        pkts = []
+        for i in range(0, n_sessions):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=7000+i, dport=80))
+            pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+        sessions = self.vapi.nat44_user_session_dump(self.pg0.remote_ip4, 0)
+        self.assertEqual(len(sessions), n_sessions)
+        reclaimed = self.statistics['/nat44-ed/expire/reclaimed']
+
+        try:
+            self.virtual_sleep(4, "wait for timeouts")
+            self.sleep(0.5, "wait for expire node")
+
+            sessions = self.vapi.nat44_user_session_dump(
+                self.pg0.remote_ip4, 0)
+            self.assertEqual(len(sessions), 0)
+            self.assertEqual(
+                self.statistics['/nat44-ed/expire/reclaimed'][:, 0].sum() -
+                reclaimed[:, 0].sum(), n_sessions)
+            self.logger.info(self.vapi.cli("show nat44 expire"))
+        finally:
+            self.vapi.cli("nat44 expire budget 256")
+
     def test_session_rst_timeout(self):
         """ NAT44ED session RST timeouts """
 
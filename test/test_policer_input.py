@@ -142,5 +142,54 @@ class TestPolicerInput(VppTestCase):
 
         policer.remove_vpp_config()
 
+    def test_policer_distributed(self):
+        """ Distributed policing across workers """
+        pkts = self.pkt * NUM_PKTS
+
+        action_tx = PolicerAction(
+            VppEnum.vl_api_sse2_qos_action_type_t.SSE2_QOS_ACTION_API_TRANSMIT,
+            0)
+        policer = VppPolicer(self, "pol3", 80, 0, 1000, 0,
+                             conform_action=action_tx,
+                             exceed_action=action_tx,
+                             violate_action=action_tx)
+        policer.add_vpp_config()
+
+        # Police on each worker against its share of the rate
+        policer.distribute_vpp_config(True)
+
+        # Start policing on pg0
+        policer.apply_vpp_config(self.pg0.sw_if_index, True)
+
+        for worker in [0, 1]:
+            self.send_and_expect(self.pg0, pkts, self.pg1, worker=worker)
+            self.logger.debug(self.vapi.cli("show trace max 100"))
+
+        self.logger.info(self.vapi.cli("show policer name pol3"))
+
+        stats = policer.get_stats()
+        stats0 = policer.get_stats(worker=0)
+        stats1 = policer.get_stats(worker=1)
+
+        # Both workers police locally, there is no handoff
+        self.assertEqual(stats0['conform_packets'] +
+                         stats0['violate_packets'], NUM_PKTS)
+        self.assertEqual(stats1['conform_packets'] +
+                         stats1['violate_packets'], NUM_PKTS)
+        self.assertGreater(stats0['conform_packets'], 0)
+        self.assertGreater(stats1['conform_packets'], 0)
+        self.assertEqual(stats['exceed_packets'], 0)
+        self.assertGreater(stats['violate_packets'], 0)
+
+        # Undistribute, the policer reverts to handing off
+        policer.distribute_vpp_config(False)
+        self.send_and_expect(self.pg0, pkts, self.pg1, worker=1)
+
+        # Stop policing on pg0
+        policer.apply_vpp_config(self.pg0.sw_if_index, False)
+
+        policer.remove_vpp_config()
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -159,5 +159,36 @@ class StatsClientTestCase(VppTestCase):
               self.statistics.get_counter('/mem/statseg/used'))
 
 
+class BarrierStatsTestCase(VppTestCase):
+    """Test barrier timings in the stats segment"""
+    vpp_worker_count = 1
+
+    @classmethod
+    def setUpConstants(cls):
+        cls.extra_vpp_statseg_config = "update-interval 0.05"
+        super(BarrierStatsTestCase, cls).setUpConstants()
+
+    def test_barrier_by_api_message(self):
+        """Barrier hold times per API message"""
+        for i in range(4):
+            self.vapi.create_loopback()
+        self.sleep(0.2)
+
+        names = self.statistics.get_counter('/sys/barrier/names')
+        self.logger.info(names)
+        self.assertIn('create_loopback', names)
+        i = names.index('create_loopback')
+
+        # a histogram per caller, each sync in one bucket
+        for h in ['open', 'close', 'hold']:
+            buckets = self.statistics.get_counter('/sys/barrier/' + h)[i]
+            self.assertEqual(len(buckets), 24)
+            self.assertEqual(sum(buckets), 4)
+
+        reply = self.vapi.cli("show barrier")
+        self.logger.info(reply)
+        self.assertIn("create_loopback", reply)
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -4,6 +4,7 @@ import unittest
 
 from framework import VppTestCase, VppTestRunner
 from vpp_ip_route import VppIpTable, VppIpRoute, VppRoutePath
+from vpp_neighbor import VppNeighbor
 
 
 class TestTCP(VppTestCase):
@@ -49,6 +50,53 @@ class TestTCP(VppTestCase):
         self.vapi.session_enable_disable(is_enable=0)
         super(TestTCP, self).tearDown()
 
+    def echo_transfer(self, mbytes=10, fifo_size=4):
+        """ Run the builtin echo client against the builtin server """
+
+        uri = "tcp://" + self.loop0.local_ip4 + "/1234"
+        error = self.vapi.cli("test echo server appns 0 fifo-size %d uri " %
+                              fifo_size + uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        error = self.vapi.cli("test echo client mbytes %d appns 1 " % mbytes +
+                              "fifo-size %d no-output test-bytes " %
+                              fifo_size + "syn-timeout 2 uri " + uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+    def nsim_path_add(self, drop_fraction):
+        """ Loop each side's packets through nsim on a 10ms path """
+
+        # Send each side's packets out of the other side's loopback, which
+        # loops them back in, so that they cross nsim on interface-output
+        objs = []
+        for dst, table_id in ((self.loop0, 1), (self.loop1, 0)):
+            objs.append(VppNeighbor(self, dst.sw_if_index, dst.local_mac,
+                                    dst.remote_ip4))
+            objs.append(VppIpRoute(self, dst.local_ip4, 32,
+                                   [VppRoutePath(dst.remote_ip4,
+                                                 dst.sw_if_index)],
+                                   table_id=table_id))
+        for obj in objs:
+            obj.add_vpp_config()
+
+        self.vapi.cli("set nsim delay 10 ms bandwidth 1 gbit "
+                      "packet-size 1460 drop-fraction %s" % drop_fraction)
+        for i in self.lo_interfaces:
+            self.vapi.cli("nsim output-feature enable-disable %s" % i.name)
+        return objs
+
+    def nsim_path_del(self, objs):
+        self.logger.info(self.vapi.cli("show nsim"))
+        for i in self.lo_interfaces:
+            self.vapi.cli("nsim output-feature enable-disable %s disable" %
+                          i.name)
+        for obj in reversed(objs):
+            obj.remove_vpp_config()
+
     def test_tcp_transfer(self):
         """ TCP echo client/server transfer """
 
@@ -65,19 +113,91 @@ class TestTCP(VppTestCase):
         ip_t10.add_vpp_config()
 
         # Start builtin server and client
-        uri = "tcp://" + self.loop0.local_ip4 + "/1234"
-        error = self.vapi.cli("test echo server appns 0 fifo-size 4 uri " +
-                              uri)
-        if error:
-            self.logger.critical(error)
-            self.assertNotIn("failed", error)
+        self.echo_transfer()
 
-        error = self.vapi.cli("test echo client mbytes 10 appns 1 " +
-                              "fifo-size 4 no-output test-bytes " +
-                              "syn-timeout 2 uri " + uri)
-        if error:
-            self.logger.critical(error)
-            self.assertNotIn("failed", error)
+        # Delete inter-table routes
+        ip_t01.remove_vpp_config()
+        ip_t10.remove_vpp_config()
+
+    def test_tcp_rto_recovery(self):
+        """ TCP transfer that recovers from retransmit timeouts """
+
+        # Drop enough to lose whole windows and their retransmits
+        objs = self.nsim_path_add(0.2)
+
+        self.echo_transfer(mbytes=1, fifo_size=64)
+
+        sessions = self.vapi.cli("show session verbose 2")
+        self.logger.info(sessions)
+        self.assertRegex(sessions, r"tr [1-9]")
+
+        self.nsim_path_del(objs)
+
+
+class TestTCPBBR(TestTCP):
+    """ TCP BBR Test Case """
+
+    extra_vpp_punt_config = ["tcp", "{", "cc-algo", "bbr", "}"]
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestTCPBBR, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestTCPBBR, cls).tearDownClass()
+
+    def test_tcp_bbr_nsim_transfer(self):
+        """ TCP BBR transfer over a delayed and lossy path """
+
+        objs = self.nsim_path_add(0.01)
+
+        # Fifos large enough to keep the 20ms round trip busy
+        self.echo_transfer(fifo_size=512)
+
+        # The connections are still closing and show their congestion
+        # control, which recovered from the drops
+        sessions = self.vapi.cli("show session verbose 2")
+        self.logger.info(sessions)
+        self.assertIn("algo bbr", sessions)
+        self.assertRegex(sessions, r"rxt segs [1-9]")
+
+        self.nsim_path_del(objs)
+
+
+class TestTCPGRO(TestTCP):
+    """ TCP Rx GRO Test Case """
+
+    extra_vpp_punt_config = ["tcp", "{", "gro", "}"]
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestTCPGRO, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestTCPGRO, cls).tearDownClass()
+
+    def test_tcp_gro_coalesced(self):
+        """ TCP rx gro coalesces back to back in order segments """
+
+        # Add inter-table routes
+        ip_t01 = VppIpRoute(self, self.loop1.local_ip4, 32,
+                            [VppRoutePath("0.0.0.0",
+                                          0xffffffff,
+                                          nh_table_id=1)])
+        ip_t10 = VppIpRoute(self, self.loop0.local_ip4, 32,
+                            [VppRoutePath("0.0.0.0",
+                                          0xffffffff,
+                                          nh_table_id=0)], table_id=1)
+        ip_t01.add_vpp_config()
+        ip_t10.add_vpp_config()
+
+        # Bursts of segments from the sender reach tcp4-input in a frame
+        self.echo_transfer()
+
+        coalesced = self.statistics.get_err_counter("/err/tcp4-input/gro")
+        self.assertGreater(coalesced, 0)
 
         # Delete inter-table routes
         ip_t01.remove_vpp_config()
@@ -144,5 +144,167 @@ class TestTLS(VppTestCase):
         ip_t10.remove_vpp_config()
 
 
+class TestTLSRecordOffload(TestTLS):
+    """ TLS Record Offload Test Case """
+
+    extra_vpp_punt_config = ["tls", "{", "record-offload", "}"]
+
+    def test_tls_record_offload_transfer(self):
+        """ TLS record offload echo client/server transfer """
+
+        # Add inter-table routes
+        ip_t01 = VppIpRoute(self, self.loop1.local_ip4, 32,
+                            [VppRoutePath("0.0.0.0",
+                                          0xffffffff,
+                                          nh_table_id=1)])
+
+        ip_t10 = VppIpRoute(self, self.loop0.local_ip4, 32,
+                            [VppRoutePath("0.0.0.0",
+                                          0xffffffff,
+                                          nh_table_id=0)], table_id=1)
+        ip_t01.add_vpp_config()
+        ip_t10.add_vpp_config()
+
+        # Start builtin server and client, records after the handshake
+        # are encrypted and decrypted by the tls record layer. The app
+        # rx fifos must hold a full 16k record
+        uri = "tls://" + self.loop0.local_ip4 + "/1234"
+        error = self.vapi.cli("test echo server appns 0 fifo-size 32 "
+                              "tls-engine 1 uri " +
+                              uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        error = self.vapi.cli("test echo client mbytes 10 appns 1 "
+                              "fifo-size 32 no-output test-bytes "
+                              "tls-engine 1 "
+                              "syn-timeout 2 uri " + uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        # 10MB each way, in records of at most 16k
+        reply = self.vapi.cli("show tls record-offload")
+        self.logger.info(reply)
+        counters = dict(line.split(": ") for line in reply.splitlines())
+        min_records = 2 * 10 * 2**20 // 2**14
+        self.assertGreaterEqual(int(counters["records encrypted"]),
+                                min_records)
+        self.assertGreaterEqual(int(counters["records decrypted"]),
+                                min_records)
+        self.assertEqual(int(counters["crypto errors"]), 0)
+
+        # Apps whose rx fifos can't hold a full record keep their records
+        # in openssl
+        self.vapi.cli("test echo server stop")
+        uri = "tls://" + self.loop0.local_ip4 + "/1235"
+        error = self.vapi.cli("test echo server appns 0 fifo-size 4 "
+                              "tls-engine 1 uri " +
+                              uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        error = self.vapi.cli("test echo client mbytes 1 appns 1 "
+                              "fifo-size 4 no-output test-bytes "
+                              "tls-engine 1 "
+                              "syn-timeout 2 uri " + uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        reply = self.vapi.cli("show tls record-offload")
+        self.logger.info(reply)
+        small = dict(line.split(": ") for line in reply.splitlines())
+        self.assertEqual(small["records encrypted"],
+                         counters["records encrypted"])
+        self.assertEqual(small["records decrypted"],
+                         counters["records decrypted"])
+
+        # Delete inter-table routes
+        ip_t01.remove_vpp_config()
+        ip_t10.remove_vpp_config()
+
+
+class TestTLSPkeyOffload(TestTLS):
+    """ TLS Private Key Offload Test Case """
+
+    def pkey_offload_handshakes(self, server_opts=""):
+        """ Run handshakes with the server's key ops on crypto threads """
+
+        # Add inter-table routes
+        ip_t01 = VppIpRoute(self, self.loop1.local_ip4, 32,
+                            [VppRoutePath("0.0.0.0",
+                                          0xffffffff,
+                                          nh_table_id=1)])
+
+        ip_t10 = VppIpRoute(self, self.loop0.local_ip4, 32,
+                            [VppRoutePath("0.0.0.0",
+                                          0xffffffff,
+                                          nh_table_id=0)], table_id=1)
+        ip_t01.add_vpp_config()
+        ip_t10.add_vpp_config()
+
+        # Must be enabled before the listener loads its key
+        error = self.vapi.cli("tls openssl set pkey-offload threads 2")
+        if "needs openssl 3.0" in error:
+            self.skipTest("pkey offload needs openssl 3.0")
+        self.assertIn("enabled", error)
+
+        # Ops run by earlier tests are still counted
+        reply = self.vapi.cli("show tls openssl pkey-offload")
+        counters = dict(line.split(": ") for line in reply.splitlines())
+        base_ops = int(counters["ops offloaded"])
+
+        uri = "tls://" + self.loop0.local_ip4 + "/1234"
+        error = self.vapi.cli("test echo server appns 0 fifo-size 4 "
+                              "tls-engine 1 " + server_opts + "uri " +
+                              uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        # Several clients so that handshakes are parked concurrently
+        error = self.vapi.cli("test echo client mbytes 1 nclients 8 "
+                              "appns 1 fifo-size 4 no-output test-bytes "
+                              "tls-engine 1 "
+                              "syn-timeout 2 uri " + uri)
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn("failed", error)
+
+        # One private key op per server handshake
+        reply = self.vapi.cli("show tls openssl pkey-offload")
+        self.logger.info(reply)
+        counters = dict(line.split(": ") for line in reply.splitlines())
+        self.assertEqual(int(counters["crypto threads"]), 2)
+        self.assertGreaterEqual(int(counters["ops offloaded"]),
+                                base_ops + 8)
+
+        # Threads are joined, what they ran is still counted
+        error = self.vapi.cli("tls openssl set pkey-offload disable")
+        self.assertIn("disabled", error)
+        reply = self.vapi.cli("show tls openssl pkey-offload")
+        counters = dict(line.split(": ") for line in reply.splitlines())
+        self.assertEqual(int(counters["crypto threads"]), 0)
+        self.assertGreaterEqual(int(counters["ops offloaded"]),
+                                base_ops + 8)
+
+        self.vapi.cli("test echo server stop")
+
+        # Delete inter-table routes
+        ip_t01.remove_vpp_config()
+        ip_t10.remove_vpp_config()
+
+    def test_tls_pkey_offload_handshake(self):
+        """ TLS handshakes with private key ops on crypto threads """
+        self.pkey_offload_handshakes()
+
+    def test_tls_pkey_offload_handshake_ec(self):
+        """ TLS handshakes with ECDSA signs on crypto threads """
+        self.pkey_offload_handshakes("ec-cert ")
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
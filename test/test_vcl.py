@@ -142,6 +142,37 @@ class VCLTestCase(VppTestCase):
             self.fail("Failed with %s" % error)
         self.sleep(self.post_test_sleep)
 
+    def cut_thru_relay_test(self, server_app, server_args, relay_app,
+                            relay_args, client_app, client_args):
+        self.vcl_app_env = {'VCL_APP_SCOPE_LOCAL': "true"}
+
+        self.update_vcl_app_env("", "", self.sapi_server_sock)
+        worker_server = VCLAppWorker(server_app, server_args,
+                                     self.logger, self.vcl_app_env, "server")
+        worker_server.start()
+        self.sleep(self.pre_test_sleep)
+
+        worker_relay = VCLAppWorker(relay_app, relay_args,
+                                    self.logger, self.vcl_app_env, "relay")
+        worker_relay.start()
+        self.sleep(self.pre_test_sleep)
+
+        self.update_vcl_app_env("", "", self.sapi_client_sock)
+        worker_client = VCLAppWorker(client_app, client_args,
+                                     self.logger, self.vcl_app_env, "client")
+        worker_client.start()
+        worker_client.join(self.timeout)
+        try:
+            self.validateResults(worker_client, worker_server, self.timeout)
+        except Exception as error:
+            self.fail("Failed with %s" % error)
+        finally:
+            if os.path.isdir('/proc/{}'.format(worker_relay.process.pid)):
+                os.killpg(os.getpgid(worker_relay.process.pid),
+                          signal.SIGTERM)
+                worker_relay.join()
+        self.sleep(self.post_test_sleep)
+
     def thru_host_stack_setup(self):
         self.vapi.session_enable_disable(is_enable=1)
         self.create_loopback_interfaces(2)
@@ -356,6 +387,71 @@ class LDPCutThruTestCase(VCLTestCase):
                            self.client_bi_dir_nsock_test_args)
 
 
+class LDPCutThruSpliceTestCase(VCLTestCase):
+    """ LDP Cut Thru Splice Tests """
+
+    @classmethod
+    def setUpClass(cls):
+        cls.session_startup = ["poll-main", "use-app-socket-api"]
+        super(LDPCutThruSpliceTestCase, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(LDPCutThruSpliceTestCase, cls).tearDownClass()
+
+    def setUp(self):
+        super(LDPCutThruSpliceTestCase, self).setUp()
+
+        self.cut_thru_setup()
+        self.relay_port = "22001"
+        self.relay_args = [self.relay_port, self.server_addr,
+                           self.server_port]
+        self.client_echo_test_args = ["-E", self.echo_phrase, "-X",
+                                      self.server_addr, self.relay_port]
+        self.client_uni_dir_nsock_timeout = 20
+        self.client_uni_dir_nsock_test_args = ["-N", "1000", "-U", "-X",
+                                               "-I", "2",
+                                               self.server_addr,
+                                               self.relay_port]
+        self.sapi_client_sock = "default"
+        self.sapi_server_sock = "default"
+
+    def tearDown(self):
+        super(LDPCutThruSpliceTestCase, self).tearDown()
+        self.cut_thru_tear_down()
+
+    def show_commands_at_teardown(self):
+        self.logger.debug(self.vapi.cli("show session verbose 2"))
+        self.logger.debug(self.vapi.cli("show app mq"))
+
+    def test_ldp_cut_thru_splice_echo(self):
+        """ run LDP cut thru echo test through a splice relay """
+
+        self.cut_thru_relay_test("sock_test_server", self.server_args,
+                                 "sock_test_splice", self.relay_args,
+                                 "sock_test_client",
+                                 self.client_echo_test_args)
+
+    def test_ldp_cut_thru_splice_uni_dir_nsock(self):
+        """ run LDP cut thru uni-directional test through a splice relay """
+
+        self.timeout = self.client_uni_dir_nsock_timeout
+        self.cut_thru_relay_test("sock_test_server", self.server_args,
+                                 "sock_test_splice", self.relay_args,
+                                 "sock_test_client",
+                                 self.client_uni_dir_nsock_test_args)
+
+    def test_ldp_cut_thru_sendfile_uni_dir_nsock(self):
+        """ run LDP cut thru uni-directional test through a sendfile relay """
+
+        self.timeout = self.client_uni_dir_nsock_timeout
+        self.cut_thru_relay_test("sock_test_server", self.server_args,
+                                 "sock_test_splice",
+                                 ["-f"] + self.relay_args,
+                                 "sock_test_client",
+                                 self.client_uni_dir_nsock_test_args)
+
+
 class VCLCutThruTestCase(VCLTestCase):
     """ VCL Cut Thru Tests """
 
@@ -6,6 +6,9 @@ import time
 import signal
 from config import config
 from framework import VppTestCase, VppTestRunner
+from scapy.layers.l2 import Ether
+from scapy.layers.inet import IP, UDP
+from scapy.packet import Raw
 from vpp_ip_route import VppIpTable, VppIpRoute, VppRoutePath
 
 
@@ -214,5 +217,83 @@ class TestVlib(VppTestCase):
                 else:
                     self.logger.info(cmd + " FAIL retval " + str(r.retval))
 
+
+class TestVlibRcu(VppTestCase):
+    """ Vlib RCU Test Cases """
+    vpp_worker_count = 2
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestVlibRcu, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestVlibRcu, cls).tearDownClass()
+
+    def test_rcu_calls(self):
+        """ Deferred calls wait for the workers """
+        reply = self.vapi.cli("test rcu calls 1000")
+        self.logger.info(reply)
+        self.assertIn("2 workers", reply)
+        self.assertIn("1000 calls run from the main loop, 0 early", reply)
+
+        reply = self.vapi.cli("show rcu")
+        self.logger.info(reply)
+        self.assertIn("0 calls pending", reply)
+        self.assertIn("0 timed out", reply)
+
+
+class TestVlibFrameQueue(VppTestCase):
+    """ Vlib Frame Queue Batching Test Cases """
+    vpp_worker_count = 2
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestVlibFrameQueue, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestVlibFrameQueue, cls).tearDownClass()
+
+    def test_frame_queue_batching(self):
+        """ Handoff with coalescing and push-back """
+        self.vapi.cli("set interface handoff pg0 workers 0-1")
+
+        pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src="10.10.%u.%u" % (i >> 8, i & 0xff),
+                    dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b"\xa5" * 100)) for i in range(257)]
+
+        for mode in ["coalesce 50", "coalesce 50 push-back", "push-back",
+                     "drop"]:
+            self.vapi.cli("set frame-queue node ethernet-input " + mode)
+            self.send_and_expect(self.pg0, pkts, self.pg1, worker=0)
+
+        reply = self.vapi.cli("show frame-queue occupancy")
+        self.logger.info(reply)
+        self.assertIn("coalesce 0.00us, on congestion drop", reply)
+
+        # nothing dropped, nor left behind, by any of the senders
+        table = reply.split("sender")[1].split("queued")[0]
+        senders = [line.split() for line in table.splitlines()[1:-1]]
+        self.assertTrue(senders)
+        self.assertIn("push-back", table.splitlines()[0])
+        for s in senders:
+            self.assertEqual(s[6], "0")
+            self.assertEqual(s[7], "0")
+        self.assertEqual(sum(int(s[2]) for s in senders), 4 * len(pkts))
+
+        self.vapi.cli("set interface handoff pg0 workers 0-1 disable")
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
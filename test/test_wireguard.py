@@ -8,6 +8,7 @@ import os
 from hashlib import blake2s
 from scapy.packet import Packet
 from scapy.packet import Raw
+from scapy.all import fragment
 from scapy.layers.l2 import Ether, ARP
 from scapy.layers.inet import IP, UDP
 from scapy.layers.inet6 import IPv6
@@ -27,6 +28,7 @@ from vpp_interface import VppInterface
 from vpp_ip_route import VppIpRoute, VppRoutePath
 from vpp_object import VppObject
 from vpp_papi import VppEnum
+from vpp_pg_interface import is_ipv6_misc
 from framework import VppTestCase
 from re import compile
 import unittest
@@ -386,6 +388,7 @@ class TestWg(VppTestCase):
     kp6_error = wg6_output_node_name + "Keypair error"
     mac6_error = wg6_input_node_name + "Invalid MAC handshake"
     peer6_error = wg6_input_node_name + "Peer error"
+    cookie4_error = wg4_input_node_name + "Handshake under load, Cookie sent"
 
     @classmethod
     def setUpClass(cls):
@@ -544,6 +547,111 @@ class TestWg(VppTestCase):
         peer_1.remove_vpp_config()
         wg0.remove_vpp_config()
 
+    def test_wg_handshake_under_load(self):
+        """ Handshake under load is answered with a cookie """
+        port = 12333
+
+        # Create interfaces
+        wg0 = VppWgInterface(self,
+                             self.pg1.local_ip4,
+                             port).add_vpp_config()
+        wg0.admin_up()
+        wg0.config_ip4()
+
+        peer_1 = VppWgPeer(self,
+                           wg0,
+                           self.pg1.remote_ip4,
+                           port+1,
+                           ["10.11.3.0/24"]).add_vpp_config()
+        self.assertEqual(len(self.vapi.wireguard_peers_dump()), 1)
+
+        # every handshake is received under load; an initiation that
+        # carries no mac2 gets a cookie reply instead of a response
+        self.vapi.cli("set wireguard handshake under-load 0")
+        base_cookie4_err = self.statistics.get_err_counter(self.cookie4_error)
+
+        p = peer_1.mk_handshake(self.pg1)
+        rx = self.send_and_expect(self.pg1, [p], self.pg1)
+
+        peer_1.verify_header(rx[0])
+        cookie = Wireguard(rx[0][Raw])
+        self.assertEqual(cookie[Wireguard].message_type, 3)
+        self.assertEqual(cookie[Wireguard].reserved_zero, 0)
+        self.assertEqual(len(cookie), 64)
+        self.assertEqual(base_cookie4_err + 1,
+                         self.statistics.get_err_counter(self.cookie4_error))
+
+        # below the threshold the initiation is answered again
+        self.vapi.cli("set wireguard handshake under-load 1024")
+
+        p = peer_1.mk_handshake(self.pg1)
+        rx = self.send_and_expect(self.pg1, [p], self.pg1)
+
+        peer_1.consume_response(rx[0])
+
+        peer_1.remove_vpp_config()
+        wg0.remove_vpp_config()
+
+    def test_wg_many_peers(self):
+        """ Handshakes find their peer among many """
+        port = 12343
+        NUM_PEERS = 512
+
+        wg0 = VppWgInterface(self,
+                             self.pg1.local_ip4,
+                             port).add_vpp_config()
+        wg0.admin_up()
+        wg0.config_ip4()
+
+        peers = []
+        for i in range(NUM_PEERS):
+            peers.append(VppWgPeer(self,
+                                   wg0,
+                                   self.pg1.remote_ip4,
+                                   port+1+i,
+                                   ["10.12.%d.%d/32" % (i >> 8, i & 0xff)],
+                                   persistent_keepalive=0).add_vpp_config())
+        self.assertEqual(len(self.vapi.wireguard_peers_dump()), NUM_PEERS)
+
+        # vpp keeps initiating handshakes with the peers it has not heard
+        # from, leave those out of the captures
+        def is_initiation(p):
+            return is_ipv6_misc(p) or (Raw in p and bytes(p[Raw])[0] == 1)
+
+        def send_and_expect_reply(peer):
+            self.pg_send(self.pg1, [peer.mk_handshake(self.pg1)])
+            return self.pg1.get_capture(1, filter_out_fn=is_initiation)[0]
+
+        # peers added first and last are found by their public key
+        for peer in [peers[0], peers[NUM_PEERS // 2], peers[-1]]:
+            peer.consume_response(send_and_expect_reply(peer))
+
+        # under load a few of them are sent a cookie, each encrypted with
+        # a key of its own
+        self.vapi.cli("set wireguard handshake under-load 0")
+        base_cookie4_err = self.statistics.get_err_counter(self.cookie4_error)
+
+        for peer in peers[1:5]:
+            cookie = Wireguard(send_and_expect_reply(peer)[Raw])
+            self.assertEqual(cookie[Wireguard].message_type, 3)
+            self.assertEqual(len(cookie), 64)
+        self.assertEqual(base_cookie4_err + 4,
+                         self.statistics.get_err_counter(self.cookie4_error))
+
+        self.vapi.cli("set wireguard handshake under-load 1024")
+
+        # a removed peer is no longer found
+        peers[-1].remove_vpp_config()
+        self.pg_send(self.pg1, [peers[-1].mk_handshake(self.pg1)])
+        self.pg1.assert_nothing_captured(filter_out_fn=is_initiation)
+        self.assertEqual(self.base_peer4_err + 1,
+                         self.statistics.get_err_counter(self.peer4_error))
+
+        for peer in peers[:-1]:
+            peer.remove_vpp_config()
+        self.assertEqual(len(self.vapi.wireguard_peers_dump()), 0)
+        wg0.remove_vpp_config()
+
     def test_wg_peer_v4o4(self):
         """ Test v4o4"""
 
@@ -664,6 +772,116 @@ class TestWg(VppTestCase):
         peer_1.remove_vpp_config()
         wg0.remove_vpp_config()
 
+    def test_wg_peer_v4o4_chained(self):
+        """ Test v4o4 with chained buffers"""
+
+        port = 12335
+        too_big4_in = self.wg4_input_node_name + "Packet too big"
+        too_big4_out = self.wg4_output_node_name + "packet too big"
+
+        # Create interfaces
+        wg0 = VppWgInterface(self,
+                             self.pg1.local_ip4,
+                             port).add_vpp_config()
+        wg0.admin_up()
+        wg0.config_ip4()
+
+        peer_1 = VppWgPeer(self,
+                           wg0,
+                           self.pg1.remote_ip4,
+                           port+1,
+                           ["10.11.3.0/24"]).add_vpp_config()
+
+        r1 = VppIpRoute(self, "10.11.3.0", 24,
+                        [VppRoutePath("10.11.3.1",
+                                      wg0.sw_if_index)]).add_vpp_config()
+
+        # complete the handshake
+        p = peer_1.mk_handshake(self.pg1)
+        rx = self.send_and_expect(self.pg1, [p], self.pg1)
+        peer_1.consume_response(rx[0])
+
+        def mk_tunnel_frags(counter, payload_len, frag_size):
+            d = peer_1.encrypt_transport(
+                IP(src="10.11.3.1", dst=self.pg0.remote_ip4, ttl=20) /
+                UDP(sport=222, dport=223) /
+                Raw(b'\x00' * payload_len))
+            p = (peer_1.mk_tunnel_header(self.pg1) /
+                 Wireguard(message_type=4, reserved_zero=0) /
+                 WireguardTransport(receiver_index=peer_1.sender,
+                                    counter=counter,
+                                    encrypted_encapsulated_packet=d))
+            return [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                     f) for f in fragment(p[IP], frag_size)]
+
+        # fragments of the tunnel packet are reassembled into a buffer
+        # chain before they reach wg4-input; one that fits a single
+        # buffer is linearized, decrypted and forwarded
+        rxs = self.send_and_expect(self.pg1,
+                                   mk_tunnel_frags(0, 1200, 600),
+                                   self.pg0)
+        for rx in rxs:
+            self.assertEqual(rx[IP].dst, self.pg0.remote_ip4)
+            self.assertEqual(rx[IP].ttl, 19)
+            self.assertEqual(len(rx[Raw]), 1200)
+
+        # one that does not fit is dropped as too big, not punted
+        base_too_big = self.statistics.get_err_counter(too_big4_in)
+        base_drops = self.statistics["/if/drops"][
+            :, self.pg1.sw_if_index].sum()
+        base_punts = self.statistics["/if/punt"][
+            :, self.pg1.sw_if_index].sum()
+
+        self.send_and_assert_no_replies(self.pg1,
+                                        mk_tunnel_frags(1, 3000, 1200))
+
+        self.assertEqual(base_too_big + 1,
+                         self.statistics.get_err_counter(too_big4_in))
+        self.assertEqual(base_drops + 1,
+                         self.statistics["/if/drops"][
+                             :, self.pg1.sw_if_index].sum())
+        self.assertEqual(base_punts,
+                         self.statistics["/if/punt"][
+                             :, self.pg1.sw_if_index].sum())
+
+        # the tunnel still works after the drop
+        rxs = self.send_and_expect(self.pg1,
+                                   mk_tunnel_frags(2, 1200, 600),
+                                   self.pg0)
+
+        # reassemble on pg0 so the packets routed into the tunnel
+        # are chained
+        self.vapi.ip_reassembly_enable_disable(
+            sw_if_index=self.pg0.sw_if_index, enable_ip4=True)
+
+        def mk_inner_frags(payload_len, frag_size):
+            p = (IP(src=self.pg0.remote_ip4, dst="10.11.3.2") /
+                 UDP(sport=555, dport=556) /
+                 Raw(b'\x00' * payload_len))
+            return [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                     f) for f in fragment(p, frag_size)]
+
+        rxs = self.send_and_expect(self.pg0,
+                                   mk_inner_frags(1200, 600),
+                                   self.pg1)
+        for rx in rxs:
+            rx = IP(peer_1.decrypt_transport(rx))
+            self.assertEqual(rx[IP].dst, "10.11.3.2")
+            self.assertEqual(len(rx[Raw]), 1200)
+
+        base_too_big = self.statistics.get_err_counter(too_big4_out)
+        self.send_and_assert_no_replies(self.pg0,
+                                        mk_inner_frags(3000, 1200))
+        self.assertEqual(base_too_big + 1,
+                         self.statistics.get_err_counter(too_big4_out))
+
+        self.vapi.ip_reassembly_enable_disable(
+            sw_if_index=self.pg0.sw_if_index, enable_ip4=False)
+
+        r1.remove_vpp_config()
+        peer_1.remove_vpp_config()
+        wg0.remove_vpp_config()
+
     def test_wg_peer_v6o6(self):
         """ Test v6o6"""
 
@@ -1394,6 +1612,61 @@ class WireguardHandoffTests(TestWg):
         peer_1.remove_vpp_config()
         wg0.remove_vpp_config()
 
+    def test_wg_handshake_on_worker(self):
+        """ Handshakes are processed on the workers """
+
+        port = 12393
+
+        wg0 = VppWgInterface(self,
+                             self.pg1.local_ip4,
+                             port).add_vpp_config()
+        wg0.admin_up()
+        wg0.config_ip4()
+
+        peer_1 = VppWgPeer(self,
+                           wg0,
+                           self.pg1.remote_ip4,
+                           port+1,
+                           ["10.11.3.0/24"]).add_vpp_config()
+        self.assertEqual(len(self.vapi.wireguard_peers_dump()), 1)
+
+        # an initiation is answered by the worker that received it,
+        # it is not handed off to the main thread
+        p = peer_1.mk_handshake(self.pg1)
+        rx = self.send_and_expect(self.pg1, [p], self.pg1, worker=1)
+        peer_1.consume_response(rx[0])
+        self.assertNotIn("wg4-handshake-handoff", self.vapi.cli("show trace"))
+
+        # the session is up, data from the peer pins it to worker 0
+        p = (IP(src="10.11.3.1", dst=self.pg0.remote_ip4, ttl=20) /
+             UDP(sport=222, dport=223) /
+             Raw())
+        d = peer_1.encrypt_transport(p)
+        p = (peer_1.mk_tunnel_header(self.pg1) /
+             (Wireguard(message_type=4, reserved_zero=0) /
+              WireguardTransport(receiver_index=peer_1.sender,
+                                 counter=0,
+                                 encrypted_encapsulated_packet=d)))
+        self.send_and_expect(self.pg1, [p], self.pg0, worker=0)
+
+        # a cookie for the peer received on worker 1 goes to the
+        # peer's worker, which fails to decrypt it
+        cookie_err = self.statistics.get_err_counter(
+            self.wg4_input_node_name + "Failed during Cookie decryption")
+        p = (peer_1.mk_tunnel_header(self.pg1) /
+             Wireguard(message_type=3, reserved_zero=0) /
+             Raw(struct.pack("<I", peer_1.sender) + b'\x00' * 56))
+        self.pg_send(self.pg1, [p], worker=1)
+        self.pg1.assert_nothing_captured(timeout=1)
+        trace = self.vapi.cli("show trace")
+        self.assertIn("wg4-handshake-handoff", trace)
+        self.assertIn("next-worker 1", trace)
+        self.assertEqual(cookie_err + 1, self.statistics.get_err_counter(
+            self.wg4_input_node_name + "Failed during Cookie decryption"))
+
+        peer_1.remove_vpp_config()
+        wg0.remove_vpp_config()
+
     @unittest.skip("test disabled")
     def test_wg_multi_interface(self):
         """ Multi-tunnel on the same port """
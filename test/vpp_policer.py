@@ -61,6 +61,11 @@ class VppPolicer(VppObject):
         self._test.vapi.policer_bind(name=self.name, worker_index=worker,
                                      bind_enable=bind)
 
+    def distribute_vpp_config(self, enable, max_error_pct=5):
+        self._test.vapi.policer_distribute(name=self.name,
+                                           max_error_pct=max_error_pct,
+                                           enable=enable)
+
     def apply_vpp_config(self, if_index, apply):
         self._test.vapi.policer_input(name=self.name, sw_if_index=if_index,
                                       apply=apply)